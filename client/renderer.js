@@ -7,6 +7,7 @@ class QuizNetClient {
         this.isCreator = false;
         this.sessionId = null;
         this.sessionMode = 'solo';
+        this.roster = [];
         this.themes = [];
         this.score = 0;
         this.lives = 4;
@@ -391,6 +392,9 @@ class QuizNetClient {
             case 'session/player/left':
                 this.handlePlayerLeft(data);
                 break;
+            case 'session/roster':
+                this.handleRoster(data);
+                break;
             case 'session/started':
                 this.handleSessionStarted(data);
                 break;
@@ -497,9 +501,8 @@ class QuizNetClient {
                 this.jokers = data.jokers;
             }
 
-            if (!data.players) {
-                data.players = [this.pseudo];
-            }
+            // The full roster follows as session/roster pages
+            this.roster = [this.pseudo];
 
             if (!data.name) {
                 data.name = 'Session';
@@ -515,17 +518,7 @@ class QuizNetClient {
     updateWaitingRoom(data) {
         document.getElementById('waiting-mode').textContent = this.sessionMode === 'battle' ? 'Battle (Vies)' : 'Solo (Score)';
 
-        const playersContainer = document.getElementById('waiting-players');
-        if (data.players) {
-            playersContainer.innerHTML = data.players.map(pseudo => `
-                <div class="player-card ${pseudo === this.pseudo ? 'self' : ''}">
-                    <span class="player-name">${pseudo}</span>
-                </div>
-            `).join('');
-        }
-
-        const startBtn = document.getElementById('start-session');
-        startBtn.disabled = !this.isCreator || (data.players && data.players.length < 2);
+        this.renderRoster();
 
         document.getElementById('joker-fifty-count').textContent = this.jokers.fifty;
         document.getElementById('joker-skip-count').textContent = this.jokers.skip;
@@ -538,19 +531,51 @@ class QuizNetClient {
         }
     }
 
-    handlePlayerJoined(data) {
+    renderRoster() {
         const playersContainer = document.getElementById('waiting-players');
-        const playerCard = document.createElement('div');
-        playerCard.className = 'player-card';
-        playerCard.innerHTML = `<span class="player-name">${data.pseudo}</span>`;
-        playersContainer.appendChild(playerCard);
-        if (this.isCreator && data.nbPlayers >= 2) 
-            document.getElementById('start-session').disabled = false;
-        this.showToast(`${data.pseudo} a rejoint la session`, 'info');
+        playersContainer.innerHTML = this.roster.map(pseudo => `
+            <div class="player-card ${pseudo === this.pseudo ? 'self' : ''}">
+                <span class="player-name">${pseudo}</span>
+            </div>
+        `).join('');
+
+        const startBtn = document.getElementById('start-session');
+        startBtn.disabled = !this.isCreator || this.roster.length < 2;
+    }
+
+    handleRoster(data) {
+        if (data.offset === 0) {
+            this.roster = [];
+        }
+        this.roster.push(...data.players);
+        this.renderRoster();
+    }
+
+    handlePlayerJoined(data) {
+        const pseudos = data.pseudos || [];
+        this.roster.push(...pseudos);
+        this.renderRoster();
+        if (pseudos.length === 1) {
+            this.showToast(`${pseudos[0]} a rejoint la session`, 'info');
+        } else if (pseudos.length > 1) {
+            this.showToast(`${pseudos.length} joueurs ont rejoint la session`, 'info');
+        }
     }
 
     handlePlayerLeft(data) {
-        this.showToast(`${data.pseudo} a quitté la session`, 'info');
+        const pseudos = data.pseudos || [];
+        for (const pseudo of pseudos) {
+            const index = this.roster.indexOf(pseudo);
+            if (index >= 0) {
+                this.roster.splice(index, 1);
+            }
+        }
+        this.renderRoster();
+        if (pseudos.length === 1) {
+            this.showToast(`${pseudos[0]} a quitté la session`, 'info');
+        } else if (pseudos.length > 1) {
+            this.showToast(`${pseudos.length} joueurs ont quitté la session`, 'info');
+        }
     }
 
     handleSessionStarted(data) {
@@ -639,8 +664,13 @@ class QuizNetClient {
         this.stopTimer();
         this.showScreen('results-screen');
 
-        const myResult = data.results.find(r => r.pseudo === this.pseudo);
+        const myResult = data.you;
         const isCorrect = myResult ? myResult.correct : false;
+        if (myResult) {
+            this.score = myResult.totalScore;
+            if (myResult.lives !== undefined) 
+                this.lives = myResult.lives;
+        }
         
         document.body.classList.add(isCorrect ? 'flash-correct' : 'flash-wrong');
 
@@ -667,17 +697,16 @@ class QuizNetClient {
             explanationEl.classList.add('hidden');
         }
 
-        const resultsEl = document.getElementById('question-results');
-        resultsEl.innerHTML = data.results.map(result => {
-            if (result.pseudo === this.pseudo) {
-                this.score = result.totalScore;
-                if (result.lives !== undefined) 
-                    this.lives = result.lives;
-            }
+        // The server sends the top players only, plus our own line
+        const results = data.results.slice();
+        if (myResult && myResult.rank > results.length) 
+            results.push(myResult);
 
+        const resultsEl = document.getElementById('question-results');
+        resultsEl.innerHTML = results.map(result => {
             return `
                 <div class="result-item">
-                    <span class="player-name">${result.pseudo}</span>
+                    <span class="player-name">#${result.rank} ${result.pseudo}</span>
                     <span class="${result.correct ? 'result-correct' : 'result-wrong'}">
                         ${result.correct ? 'Correct' : 'Incorrect'}
                     </span>
@@ -691,7 +720,14 @@ class QuizNetClient {
     }
 
     handlePlayerEliminated(data) {
-        this.showToast(`${data.pseudo} a été éliminé !`, 'error');
+        const pseudos = data.pseudos || [];
+        if (pseudos.includes(this.pseudo)) {
+            this.showToast('Vous avez été éliminé !', 'error');
+        } else if (pseudos.length === 1) {
+            this.showToast(`${pseudos[0]} a été éliminé !`, 'error');
+        } else if (pseudos.length > 1) {
+            this.showToast(`${pseudos.length} joueurs ont été éliminés !`, 'error');
+        }
     }
 
     handleSessionFinished(data) {
@@ -706,8 +742,12 @@ class QuizNetClient {
             winnerBanner.classList.add('hidden');
         }
 
+        const ranking = data.ranking.slice();
+        if (data.you && data.you.rank > ranking.length) 
+            ranking.push(data.you);
+
         const rankingEl = document.getElementById('final-ranking');
-        rankingEl.innerHTML = data.ranking.map((player, index) => {
+        rankingEl.innerHTML = ranking.map((player, index) => {
             let positionClass = '';
             let positionIcon = `#${player.rank}`;
 
@@ -0,0 +1,60 @@
+#ifndef ACTOR_H
+#define ACTOR_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+// Actors own state that only their message handler touches, one message
+// at a time, so it needs no lock. Any thread posts messages into an
+// actor's lock-free inbox; an actor with pending messages is queued on
+// one worker of an ActorPool, and idle workers steal queued actors from
+// busy ones.
+
+typedef struct ActorMsg {
+    struct ActorMsg *next;         /**< Inbox link */
+} ActorMsg;
+
+typedef struct Actor Actor;
+
+typedef void (*ActorFn)(void *context, Actor *actor, ActorMsg *msg);
+typedef void (*ActorReleaseFn)(void *context, Actor *actor);
+
+struct Actor {
+    ActorMsg *inbox;               /**< Posted messages, newest first; NULL when idle (atomic) */
+    ActorFn handler;               /**< Called for each message, in posting order */
+    ActorReleaseFn release;        /**< Set by actor_finish, called once the inbox drains */
+    Actor *older;                  /**< Deque link toward the oldest queued actor */
+    Actor *newer;                  /**< Deque link toward the newest queued actor */
+};
+
+typedef struct {
+    pthread_mutex_t mutex;         /**< Protects the deque */
+    Actor *oldest;                 /**< Taken by thieves */
+    Actor *newest;                 /**< Taken by the owner (last woken, cache-warm) */
+    pthread_t thread;              /**< Worker thread */
+    struct ActorPool *pool;        /**< Owning pool */
+} __attribute__((aligned(64))) ActorWorker;
+
+typedef struct ActorPool {
+    const char *name;              /**< Log tag of the pool */
+    void *context;                 /**< Passed as first argument to handlers */
+    ActorWorker *workers;          /**< One deque per worker thread */
+    int num_workers;               /**< Started workers */
+    int next_worker;               /**< Deque receiving actors woken from outside the pool (atomic) */
+    int queued;                    /**< Actors queued in all deques (atomic) */
+    int sleeping;                  /**< Workers waiting for work (atomic) */
+    pthread_mutex_t idle_mutex;    /**< Pairs with wake */
+    pthread_cond_t wake;           /**< Signaled when an actor is queued or on stop */
+    bool running;                  /**< Cleared to stop the workers (atomic) */
+} ActorPool;
+
+void actor_init(Actor *actor, ActorFn handler);
+void actor_post(ActorPool *pool, Actor *actor, ActorMsg *msg);
+bool actor_idle(const Actor *actor);
+void actor_finish(Actor *actor, ActorReleaseFn release);
+
+int actorpool_init(ActorPool *pool, const char *name, void *context);
+int actorpool_start(ActorPool *pool, int num_workers);
+void actorpool_stop(ActorPool *pool);
+
+#endif // ACTOR_H
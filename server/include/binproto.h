@@ -0,0 +1,49 @@
+#ifndef BINPROTO_H
+#define BINPROTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cJSON.h"
+#include "outqueue.h"
+
+// Optional binary protocol, negotiated per connection with a text request
+// "POST protocol/binary" ({"version":1}). After the text response every
+// message in both directions is a frame:
+//   uint32 payload length | uint16 message id | payload
+// (big-endian). The payload is a MessagePack map holding the fields of the
+// JSON message; the id replaces the "action" field (and the request line).
+// Id 0 marks a message without a registered id, its map keeps "action".
+// An empty payload stands for a request without a body.
+
+#define BINPROTO_VERSION 1
+#define BINPROTO_HEADER_LEN 6
+#define BINPROTO_MAX_DEPTH 16          /**< Nesting accepted in request payloads */
+#define BINPROTO_FIRST_PUSH_ID 32      /**< Server pushes from here, endpoint registry ids below */
+
+typedef struct {
+    uint16_t id;                   /**< Wire id, stable across versions */
+    const char *method;            /**< "GET"/"POST" for requests, NULL for push-only messages */
+    const char *name;              /**< Endpoint or action name */
+} BinMessage;
+
+// Message ids
+const BinMessage* binproto_message(int id);
+int binproto_id(const char *name);
+
+// Frame header helpers
+size_t binproto_payload_length(const char *header);
+int binproto_message_id(const char *header);
+
+// Request payload to a cJSON tree (NULL if malformed)
+cJSON* binproto_decode(const char *payload, size_t len);
+
+// Text message (JSON line) to a frame, one reference, NULL on failure
+MsgBuf* binproto_encode(const MsgBuf *text);
+
+// Per-recipient frames: object members transcoded once as MessagePack pairs,
+// then spliced into frames without re-parsing the whole message
+MsgBuf* binproto_encode_fields(const char *fields, size_t len, int *count);
+MsgBuf* binproto_frame(int id, MsgBuf *const *parts, const int *counts, int num_parts);
+
+#endif // BINPROTO_H
@@ -0,0 +1,82 @@
+#ifndef ENDPOINTS_H
+#define ENDPOINTS_H
+
+#include <stdint.h>
+
+#include "types.h"
+#include "cJSON.h"
+
+// Endpoint registry: every request the server accepts, in one table.
+//   X(id, method, path, handler, flags, rate class)
+// id doubles as the binary protocol message id (binproto.h), never renumber.
+// route_request applies the flags and the rate limit before the handler
+// runs, so handlers can rely on them. Lookup by (method, path) goes through
+// a perfect hash over this table, generated at build time by
+// tools/endpointgen.c (the build fails if no seed is collision-free).
+
+#define EP_JSON  0x01                  /**< Body required (400 without one) */
+#define EP_AUTH  0x02                  /**< Login required (401) */
+#define EP_LOCAL 0x04                  /**< Loopback clients only (403) */
+
+#define ENDPOINT_LIST(X) \
+    X(1,  POST, "player/register", handle_register,       EP_JSON,            RATE_ACCOUNT) \
+    X(2,  POST, "player/login",    handle_login,          EP_JSON,            RATE_ACCOUNT) \
+    X(3,  GET,  "themes/list",     handle_get_themes,     0,                  RATE_QUERY)   \
+    X(4,  GET,  "sessions/list",   handle_get_sessions,   0,                  RATE_QUERY)   \
+    X(5,  POST, "session/create",  handle_create_session, EP_JSON | EP_AUTH,  RATE_LOBBY)   \
+    X(6,  POST, "session/join",    handle_join_session,   EP_JSON | EP_AUTH,  RATE_LOBBY)   \
+    X(7,  POST, "session/start",   handle_start_session,  EP_AUTH,            RATE_LOBBY)   \
+    X(8,  POST, "question/answer", handle_answer,         EP_JSON | EP_AUTH,  RATE_GAME)    \
+    X(9,  POST, "joker/use",       handle_joker,          EP_JSON | EP_AUTH,  RATE_GAME)    \
+    X(10, GET,  "server/stats",    handle_get_stats,      0,                  RATE_QUERY)   \
+    X(11, POST, "server/trace",    handle_set_trace,      EP_JSON | EP_LOCAL, RATE_ADMIN)   \
+    X(12, POST, "protocol/binary", handle_binary_upgrade, EP_JSON,            RATE_LOBBY)
+
+#define ENDPOINT_COUNT_ENTRY(id, method, path, handler, flags, rate_class) + 1
+#define NUM_ENDPOINTS (0 ENDPOINT_LIST(ENDPOINT_COUNT_ENTRY))
+
+typedef enum {
+    METHOD_GET,
+    METHOD_POST
+} RequestMethod;
+
+#define ENDPOINT_HASH_BITS 5           /**< 32 slots, at least twice the endpoint count */
+
+/**
+ * Seeded FNV-1a over the method and path, reduced to a slot of the
+ * perfect hash table. Shared with the generator, which picks the seed.
+ * @param seed Hash seed
+ * @param method Request method
+ * @param path Endpoint path
+ * @return Slot, 0 .. (1 << ENDPOINT_HASH_BITS) - 1
+ */
+static inline uint32_t endpoint_hash(uint32_t seed, RequestMethod method, const char *path) {
+    uint32_t h = 2166136261u ^ seed;
+    h = (h ^ (uint32_t)method) * 16777619u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h >> (32 - ENDPOINT_HASH_BITS);
+}
+
+typedef void (*EndpointHandler)(ServerState *state, Client *client, cJSON *json);
+
+typedef struct {
+    uint16_t id;                   /**< Registry id, also the binary message id */
+    RequestMethod method;          /**< GET or POST */
+    const char *path;              /**< Endpoint path, also the response action */
+    EndpointHandler handler;       /**< Called once the checks passed */
+    unsigned flags;                /**< EP_* requirements */
+    RateClass rate_class;          /**< Token bucket charged per request */
+} Endpoint;
+
+int endpoints_init(void);
+const Endpoint* endpoint_lookup(RequestMethod method, const char *path);
+const Endpoint* endpoint_by_id(int id);
+
+// Dense registry order, 0 .. NUM_ENDPOINTS - 1 (per-endpoint tables)
+const Endpoint* endpoint_at(int index);
+int endpoint_index(const Endpoint *endpoint);
+const char* method_name(RequestMethod method);
+
+#endif // ENDPOINTS_H
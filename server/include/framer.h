@@ -0,0 +1,47 @@
+#ifndef FRAMER_H
+#define FRAMER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Newline framing over a growable receive buffer. Bytes are received in
+// place (framer_reserve/framer_commit), lines are handed out as slices of
+// the buffer with the newline replaced by a NUL, and every byte is scanned
+// once. Consumed bytes are dropped by compacting before the next receive,
+// never per line. One returned line can be held (a POST header waiting
+// for its body) and stays valid until released.
+
+#define FRAMER_MIN_READ 4096       /**< Free space guaranteed to each receive */
+
+typedef struct {
+    char *data;                    /**< Buffered bytes, NULL until first use */
+    size_t cap;                    /**< Allocated size of data */
+    size_t start;                  /**< First byte still needed (held line or unread) */
+    size_t read;                   /**< First byte not yet returned as a line */
+    size_t end;                    /**< End of received bytes */
+    size_t scan;                   /**< Bytes before this offset hold no newline */
+    size_t last;                   /**< Start of the line last returned */
+    size_t max_frame;              /**< Longest line accepted, newline excluded */
+    bool holding;                  /**< The line at start is held */
+} LineFramer;
+
+void framer_init(LineFramer *framer, size_t max_frame);
+void framer_destroy(LineFramer *framer);
+
+// Receive side: space for at least FRAMER_MIN_READ bytes, NULL on allocation failure
+char* framer_reserve(LineFramer *framer, size_t *room);
+void framer_commit(LineFramer *framer, size_t len);
+
+// 1 with a line, 0 when more bytes are needed, -1 if a line exceeds max_frame
+int framer_next(LineFramer *framer, char **line, size_t *len);
+
+// Raw access for length-prefixed frames (binary protocol)
+size_t framer_available(LineFramer *framer, char **data);
+void framer_consume(LineFramer *framer, size_t len);
+
+// Keep the line last returned by framer_next across later calls and receives
+void framer_hold(LineFramer *framer);
+char* framer_held(LineFramer *framer);
+void framer_release(LineFramer *framer);
+
+#endif // FRAMER_H
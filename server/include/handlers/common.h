@@ -3,12 +3,20 @@
 
 #include "types.h"
 #include "cJSON.h"
+#include "outqueue.h"
 
 // Send message to a specific client
 int send_to_client(ServerState *state, int client_id, const char *message);
+int send_buf_to_client(ServerState *state, int client_id, MsgBuf *buf);
+bool client_uses_binary(ServerState *state, int client_id);
 
-// Send message to all clients in a session
-int broadcast_to_session(ServerState *state, Session *session, const char *message);
+// Response to a request handled on another thread (echoes its correlation id)
+int send_reply_buf(ServerState *state, int client_id, long long rid, MsgBuf *buf);
+
+// Response to the request being handled (echoes its correlation id)
+MsgBuf* response_buf(Client *client, MsgBuf *buf);
+int send_response(Client *client, const char *message);
+int send_response_buf(Client *client, MsgBuf *buf);
 
 // Error responses
 void send_error(Client *client, const char *action, const char *status, const char *message);
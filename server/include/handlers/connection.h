@@ -0,0 +1,10 @@
+#ifndef HANDLERS_CONNECTION_H
+#define HANDLERS_CONNECTION_H
+
+#include "types.h"
+#include "cJSON.h"
+
+// Switch the connection to the binary protocol (see binproto.h)
+void handle_binary_upgrade(ServerState *state, Client *client, cJSON *json);
+
+#endif // HANDLERS_CONNECTION_H
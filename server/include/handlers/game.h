@@ -5,7 +5,7 @@
 #include "cJSON.h"
 
 // Game flow handlers
-void handle_get_themes(ServerState *state, Client *client);
+void handle_get_themes(ServerState *state, Client *client, cJSON *json);
 void handle_answer(ServerState *state, Client *client, cJSON *json);
 
 #endif // HANDLERS_GAME_H
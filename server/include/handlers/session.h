@@ -5,9 +5,9 @@
 #include "cJSON.h"
 
 // Session management handlers
-void handle_get_sessions(ServerState *state, Client *client);
+void handle_get_sessions(ServerState *state, Client *client, cJSON *json);
 void handle_create_session(ServerState *state, Client *client, cJSON *json);
 void handle_join_session(ServerState *state, Client *client, cJSON *json);
-void handle_start_session(ServerState *state, Client *client);
+void handle_start_session(ServerState *state, Client *client, cJSON *json);
 
 #endif // HANDLERS_SESSION_H
@@ -0,0 +1,13 @@
+#ifndef HANDLERS_STATS_H
+#define HANDLERS_STATS_H
+
+#include "types.h"
+#include "cJSON.h"
+
+// Server counters, used by the load generator
+void handle_get_stats(ServerState *state, Client *client, cJSON *json);
+
+// Runtime request tracing switches (loopback clients only)
+void handle_set_trace(ServerState *state, Client *client, cJSON *json);
+
+#endif // HANDLERS_STATS_H
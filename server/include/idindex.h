@@ -0,0 +1,24 @@
+#ifndef IDINDEX_H
+#define IDINDEX_H
+
+#include <stdbool.h>
+
+// Open-addressing hash index mapping positive ids to array slots
+
+typedef struct {
+    int *keys;                     /**< Ids, 0 marks an empty bucket */
+    int *values;                   /**< Slot index stored for each id */
+    int capacity;                  /**< Number of buckets (power of two) */
+    int count;                     /**< Number of ids stored */
+} IdIndex;
+
+int idindex_init(IdIndex *index, int expected);
+void idindex_destroy(IdIndex *index);
+void idindex_clear(IdIndex *index);
+
+// Lookup returns the stored slot, or -1 if the id is absent
+int idindex_get(const IdIndex *index, int id);
+int idindex_put(IdIndex *index, int id, int value);
+bool idindex_remove(IdIndex *index, int id);
+
+#endif // IDINDEX_H
@@ -0,0 +1,61 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Append-only record file with group commit. Records appended by any
+// thread are written and fsync'ed together by one writer thread; callers
+// that need durability wait for their sequence number. When the file grows
+// past a fraction of the last snapshot, the writer sets it aside
+// (path + ".old") and starts a fresh one, and a compactor thread runs the
+// owner's callback to write a snapshot of the state while the writer keeps
+// committing; the old file is deleted once the snapshot is safe.
+// Recovery: load the snapshot, then replay ".old" if present, then the file.
+
+#define JOURNAL_PATH_LEN 256
+#define JOURNAL_COMPACT_PERCENT 50     /**< Journal size, in % of the last snapshot, that triggers a compaction */
+
+// Writes a snapshot of the owner's state, returns its size in bytes or -1
+typedef int64_t (*JournalCompactFn)(void *context);
+
+typedef struct {
+    char path[JOURNAL_PATH_LEN];   /**< Live journal */
+    char old_path[JOURNAL_PATH_LEN]; /**< Journal being compacted away */
+    FILE *file;                    /**< Live journal, opened for append */
+    size_t file_bytes;             /**< Bytes written to the live journal */
+    size_t compact_min_bytes;      /**< Smallest journal worth compacting */
+    JournalCompactFn compact;      /**< Writes the snapshot */
+    void *context;                 /**< Passed to compact */
+
+    pthread_mutex_t mutex;         /**< Protects the fields below */
+    pthread_cond_t wake;           /**< Signals the writer: records or stop */
+    pthread_cond_t written;        /**< Signals waiters: durable_seq moved */
+    pthread_cond_t compact_wake;   /**< Signals the compactor: rotated or stop */
+    size_t compact_bytes;          /**< Size that triggers a compaction, SIZE_MAX when disabled */
+    bool compacting;               /**< The live journal was rotated, snapshot pending or running */
+    char *pending;                 /**< Records appended, not yet written */
+    size_t pending_len;            /**< Bytes in pending */
+    size_t pending_cap;            /**< Allocated size of pending */
+    uint64_t appended_seq;         /**< Sequence of the last appended record */
+    uint64_t durable_seq;          /**< Sequence of the last fsync'ed record */
+    bool failed;                   /**< A write failed, records are not durable */
+    bool running;                  /**< Cleared to stop the writer */
+    pthread_t thread;              /**< Writer thread */
+    pthread_t compactor;           /**< Snapshot thread */
+} Journal;
+
+int journal_open(Journal *journal, const char *path, size_t compact_min_bytes,
+                 size_t snapshot_bytes, JournalCompactFn compact, void *context);
+uint64_t journal_append(Journal *journal, const char *record, size_t len);
+bool journal_wait(Journal *journal, uint64_t seq);
+void journal_close(Journal *journal);
+int journal_reset(Journal *journal);
+
+// Durable file helpers, also used to write snapshots
+int journal_sync(FILE *file);
+int journal_replace(const char *from, const char *to);
+
+#endif // JOURNAL_H
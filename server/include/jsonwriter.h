@@ -0,0 +1,49 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "outqueue.h"
+
+// Append-only JSON writer: encodes straight into a MsgBuf that is then
+// queued as is, without a cJSON tree or an intermediate string. Output
+// matches cJSON_PrintUnformatted byte for byte. The buffer grows as needed,
+// so messages are never truncated; after an allocation failure every call
+// is a no-op and jsonw_finish returns NULL.
+
+typedef struct {
+    MsgBuf *buf;                   /**< Message being built, NULL once failed */
+    size_t cap;                    /**< Bytes available in buf->data */
+    bool need_comma;               /**< A value precedes at the current nesting level */
+} JsonWriter;
+
+void jsonw_init(JsonWriter *w, size_t size_hint);
+
+void jsonw_object_begin(JsonWriter *w);
+void jsonw_object_end(JsonWriter *w);
+void jsonw_array_begin(JsonWriter *w);
+void jsonw_array_end(JsonWriter *w);
+
+// Values: inside an object each one follows a jsonw_key
+void jsonw_key(JsonWriter *w, const char *key);
+void jsonw_string(JsonWriter *w, const char *value);
+void jsonw_int(JsonWriter *w, long long value);
+void jsonw_number(JsonWriter *w, double value);
+void jsonw_bool(JsonWriter *w, bool value);
+
+// Key and value in one call
+void jsonw_field_string(JsonWriter *w, const char *key, const char *value);
+void jsonw_field_int(JsonWriter *w, const char *key, long long value);
+void jsonw_field_number(JsonWriter *w, const char *key, double value);
+void jsonw_field_bool(JsonWriter *w, const char *key, bool value);
+
+// Pre-encoded "key":value pairs (comma-separated, no braces) spliced as is
+void jsonw_fields(JsonWriter *w, const char *fields, size_t len);
+size_t jsonw_mark(JsonWriter *w);
+
+// Appends the newline and hands over the buffer (one reference), NULL on failure
+MsgBuf* jsonw_finish(JsonWriter *w);
+void jsonw_discard(JsonWriter *w);
+
+#endif // JSONWRITER_H
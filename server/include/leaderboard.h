@@ -0,0 +1,42 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+// Ranking of a session's players, kept up to date as scores change: an
+// order-statistic treap (each node counts its subtree) over stable node
+// indices. Players rank by decreasing key, then in the order they joined.
+// Insert, remove, update and rank are O(log n); the top k is O(k + log n).
+
+typedef struct {
+    long long key;                 /**< Ranking key, higher ranks first */
+    int client_id;                 /**< Player */
+    unsigned int seq;              /**< Insertion order, breaks ties */
+    int left;                      /**< Subtree ranking before, -1 if none (free list link when unused) */
+    int right;                     /**< Subtree ranking after, -1 if none */
+    int size;                      /**< Nodes in the subtree rooted here */
+    unsigned int priority;         /**< Random heap priority keeping the tree balanced */
+} LeaderNode;
+
+typedef struct {
+    LeaderNode *nodes;             /**< Node storage, indices stay valid across growth */
+    int capacity;                  /**< Allocated nodes */
+    int used;                      /**< Nodes handed out so far (high-water mark) */
+    int free_head;                 /**< First released node, -1 if none */
+    int root;                      /**< Root node, -1 when empty */
+    unsigned int seed;             /**< xorshift state for priorities */
+    unsigned int next_seq;         /**< Insertion order of the next player */
+} Leaderboard;
+
+int leaderboard_init(Leaderboard *board, int expected);
+void leaderboard_destroy(Leaderboard *board);
+
+// Returns the player's node, -1 on allocation failure
+int leaderboard_insert(Leaderboard *board, int client_id, long long key);
+void leaderboard_remove(Leaderboard *board, int node);
+void leaderboard_update(Leaderboard *board, int node, long long key);
+
+// 1-based rank of a node
+int leaderboard_rank(const Leaderboard *board, int node);
+// Client IDs of the first k players, best first; returns how many
+int leaderboard_top(const Leaderboard *board, int k, int *client_ids);
+
+#endif // LEADERBOARD_H
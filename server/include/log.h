@@ -0,0 +1,69 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Asynchronous logger. Each thread appends raw arguments to its own
+// lock-free ring; a background thread formats them in timestamp order.
+// Before log_init and after log_shutdown, messages are written directly.
+// A message keeps at most LOG_ARGS_SIZE bytes of encoded arguments (64-bit
+// numbers, strings as a 16-bit length and their bytes); the rest is cut
+// and the line marked truncated, so long payloads must be split by callers.
+
+#define LOG_ARGS_SIZE 200              /**< Encoded argument bytes per message */
+
+typedef enum {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+} LogLevel;
+
+// Messages below this level compile to nothing (make LOG_LEVEL=WARN)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+typedef struct {
+    LogLevel level;                /**< Runtime threshold */
+    const char *path;              /**< Output file, NULL for stdout */
+    bool binary;                   /**< Write raw records for logdecode */
+} LogConfig;
+
+extern int log_runtime_level;
+
+#define LOG_AT(level, tag, ...) \
+    do { \
+        if ((level) >= LOG_COMPILE_LEVEL && (level) >= log_runtime_level) \
+            log_write((level), (tag), __VA_ARGS__); \
+    } while (0)
+
+#define log_debug(tag, ...) LOG_AT(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#define log_msg(tag, ...)   LOG_AT(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#define log_warn(tag, ...)  LOG_AT(LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#define log_error(tag, ...) LOG_AT(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+
+int log_init(const LogConfig *config);
+void log_shutdown(void);
+void log_set_level(LogLevel level);
+int log_parse_level(const char *name);
+
+void log_write(LogLevel level, const char *tag, const char *format, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+// Record encoding shared with the offline decoder (tools/logdecode.c)
+#define LOG_BINARY_MAGIC "QNLOG1\n"
+#define LOG_RECORD_FORMAT 1        /**< Defines a (tag, format) id */
+#define LOG_RECORD_EVENT 2         /**< One message: id, level, time, args */
+
+void log_format_line(char *out, size_t size, uint64_t time_ns, const char *tag,
+                     const char *format, const unsigned char *args, size_t args_len,
+                     bool truncated);
+
+#endif // LOG_H
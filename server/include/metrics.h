@@ -0,0 +1,39 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+#include "types.h"
+
+// Instrumentation: counters and latency histograms kept in per-thread
+// shards (relaxed atomic adds on a shard no other thread usually touches,
+// no lock), summed only when scraped. Histograms are log-linear, HDR
+// style: 8 sub-buckets per power of two of microseconds, so any recorded
+// value is known within 12.5%.
+// The sums are served as Prometheus text on a loopback-only TCP port:
+//   curl http://127.0.0.1:9556/metrics
+
+typedef enum {
+    METRIC_BYTES_RECEIVED,         /**< Bytes read from client sockets */
+    METRIC_BYTES_SENT,             /**< Bytes written to client sockets */
+    METRIC_CONNECTIONS,            /**< Client connections accepted */
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum {
+    SECTION_BROADCAST,             /**< One message fanned out to a session */
+    SECTION_QUESTION_RESULTS,      /**< send_question_results, end_session excluded */
+    SECTION_END_SESSION,           /**< end_session */
+    SECTION_COUNT
+} MetricSection;
+
+// Hot path, callable from any thread
+void metrics_count(MetricCounter counter, uint64_t amount);
+void metrics_observe_endpoint(int index, double elapsed_ms);
+void metrics_observe(MetricSection section, double elapsed_ms);
+
+// Scrape listener on 127.0.0.1:port
+int metrics_start(ServerState *state, int port);
+void metrics_stop(void);
+
+#endif // METRICS_H
@@ -0,0 +1,31 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <stdint.h>
+
+// Open-addressing hash index mapping names to array slots. Names are not
+// copied: the owner of the slots gives them back through a callback, the
+// index only keeps a hash per bucket to skip most comparisons.
+
+typedef const char* (*NameIndexKey)(const void *context, int slot);
+
+typedef struct {
+    uint32_t *hashes;              /**< Full hash of the name in each bucket */
+    int *values;                   /**< Slot stored in each bucket, -1 if empty */
+    int capacity;                  /**< Number of buckets (power of two) */
+    int count;                     /**< Number of names stored */
+    NameIndexKey key;              /**< Gives the name of a stored slot */
+    const void *context;           /**< Passed to key */
+} NameIndex;
+
+int nameindex_init(NameIndex *index, int expected, NameIndexKey key, const void *context);
+void nameindex_destroy(NameIndex *index);
+
+#define NAMEINDEX_EXISTS -2            /**< nameindex_put: the name is already stored */
+
+// Lookup returns the stored slot, or -1 if the name is absent. Put only
+// inserts, it never replaces the slot of a name already stored.
+int nameindex_get(const NameIndex *index, const char *name);
+int nameindex_put(NameIndex *index, const char *name, int value);
+
+#endif // NAMEINDEX_H
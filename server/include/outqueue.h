@@ -0,0 +1,49 @@
+#ifndef OUTQUEUE_H
+#define OUTQUEUE_H
+
+#include "types.h"
+#include "cJSON.h"
+
+// Per-client bounded output queue, flushed with non-blocking vectored writes
+
+typedef struct MsgBuf {
+    int refcount;                  /**< Queues and builders holding this buffer */
+    struct MsgBuf *binary;         /**< Binary-protocol frame of this message, built on first use */
+    size_t len;                    /**< Total bytes in data */
+    char data[];                   /**< Message followed by its newline and a NUL (not in len) */
+} MsgBuf;
+
+typedef struct OutChunk {
+    struct OutChunk *next;         /**< Next queued message */
+    MsgBuf *buf;                   /**< Shared encoded message */
+    size_t offset;                 /**< Bytes of buf already written */
+} OutChunk;
+
+// Encoded messages, built once and shared by every recipient
+MsgBuf* msgbuf_create(const char *message);
+MsgBuf* msgbuf_from_json(const cJSON *json);
+MsgBuf* msgbuf_retain(MsgBuf *buf);
+void msgbuf_release(MsgBuf *buf);
+MsgBuf* msgbuf_binary(MsgBuf *buf);
+MsgBuf* msgbuf_with_rid(MsgBuf *buf, long long rid);
+
+// Queue a message (newline appended) and try to write it right away
+int outqueue_push(Client *client, const char *message);
+int outqueue_push_buf(Client *client, MsgBuf *buf);
+int outqueue_push_buf_locked(Client *client, MsgBuf *buf);
+
+// Write as much of the queue as the socket accepts without blocking
+int outqueue_flush(Client *client);
+int outqueue_flush_locked(Client *client);
+
+// Hold writes back while a batch of requests is handled, then send the
+// queued responses together
+void outqueue_cork(Client *client);
+int outqueue_uncork(Client *client);
+
+// Drop every queued message (caller holds send_mutex)
+void outqueue_clear_locked(Client *client);
+
+bool outqueue_pending(Client *client);
+
+#endif // OUTQUEUE_H
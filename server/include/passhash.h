@@ -0,0 +1,21 @@
+#ifndef PASSHASH_H
+#define PASSHASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Salted password hashing (PBKDF2-HMAC-SHA256). Stored hashes read
+//   pbkdf2-sha256$<iterations>$<salt hex>$<derived key hex>
+// so the work factor can be raised without invalidating old accounts.
+// Deliberately slow: call from the auth worker pool, never under a lock.
+
+#define PASSHASH_ITERATIONS 100000     /**< Work factor of new hashes */
+#define PASSHASH_SALT_LEN 16           /**< Random salt bytes per account */
+#define PASSHASH_KEY_LEN 32            /**< Derived key bytes (one SHA-256 block) */
+#define PASSHASH_MAX_LEN 128           /**< Longest stored hash, NUL included */
+
+int passhash_create(const char *password, char *out, size_t out_size);
+bool passhash_verify(const char *password, const char *stored);
+bool passhash_is_current(const char *stored);
+
+#endif // PASSHASH_H
@@ -5,6 +5,7 @@
 
 // Player account management
 
+bool pseudo_is_valid(const char *pseudo);
 int register_player(ServerState *state, const char *pseudo, const char *password);
 int login_player(ServerState *state, const char *pseudo, const char *password);
 PlayerAccount* find_player_by_pseudo(ServerState *state, const char *pseudo);
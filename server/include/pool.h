@@ -0,0 +1,31 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+// Chunked slab of fixed-size elements with stable addresses.
+// Grows one chunk at a time up to a runtime limit; not thread-safe,
+// callers serialize with the mutex owning the pooled objects.
+
+typedef struct {
+    size_t elem_size;              /**< Size of one element in bytes */
+    int chunk_elems;               /**< Elements per chunk */
+    int max_elems;                 /**< Hard limit on slots */
+    int count;                     /**< Slots handed out so far (high-water mark) */
+    int capacity;                  /**< Slots backed by allocated chunks */
+    char **chunks;                 /**< Chunk directory, sized for max_elems up front */
+    int *free_slots;               /**< Released slots, reused before fresh ones */
+    int num_free;                  /**< Number of entries in free_slots */
+} Pool;
+
+int pool_init(Pool *pool, size_t elem_size, int chunk_elems, int max_elems);
+void pool_destroy(Pool *pool);
+
+// Returns a zeroed slot index, or -1 when the limit is reached
+int pool_alloc(Pool *pool);
+void pool_free(Pool *pool, int slot);
+
+// Element of a slot below pool->count
+void* pool_get(const Pool *pool, int slot);
+
+#endif // POOL_H
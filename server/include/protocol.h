@@ -9,7 +9,14 @@
 #include "handlers/session.h"
 #include "handlers/game.h"
 #include "handlers/joker.h"
+#include "handlers/stats.h"
+#include "handlers/connection.h"
 
-void handle_request(ServerState *state, Client *client, const char *request);
+void handle_request(ServerState *state, Client *client, const char *header, const char *body);
+void handle_binary_request(ServerState *state, Client *client, int id, const char *payload, size_t len);
+
+// Per-thread cJSON arena scope for work done outside handle_request
+cJSON_Arena* json_scratch_begin(void);
+void json_scratch_end(cJSON_Arena *previous);
 
 #endif // PROTOCOL_H
@@ -0,0 +1,109 @@
+#ifndef QBANK_H
+#define QBANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compiled question bank, produced offline by qbankc from a .dat file and
+// mapped read-only by the server. Layout (little-endian, 4-byte aligned):
+//   QBankHeader | Question[num_questions] | QBankTheme[num_themes]
+//   | uint16_t theme_refs[num_theme_refs]
+//   | uint32_t posting_starts[num_themes * QBANK_DIFFICULTIES + 1]
+//   | uint32_t postings[num_postings]
+//   | QuestionFragment[num_questions] | fragment pool | string pool
+// Question ids are dense: id N is record N - 1. String fields are offsets
+// into the pool, offset 0 is the empty string. Postings hold, for each
+// (theme, difficulty) pair, the ascending ids of its questions. Fragments
+// are the question's immutable JSON fields, encoded by the compiler so the
+// server splices them from the mapping without encoding anything itself.
+
+#define QBANK_MAGIC 0x4B4E4251u        /**< "QBNK" */
+#define QBANK_VERSION 3
+#define QBANK_DIFFICULTIES 3           /**< Easy, medium, hard */
+
+typedef struct {
+    uint32_t magic;                /**< QBANK_MAGIC */
+    uint32_t version;              /**< QBANK_VERSION */
+    uint32_t file_size;            /**< Total size of the bank in bytes */
+    uint32_t checksum;             /**< FNV-1a of every byte after the header */
+    uint32_t num_questions;        /**< Number of question records */
+    uint32_t num_themes;           /**< Number of theme records */
+    uint32_t num_theme_refs;       /**< Entries in the theme reference table */
+    uint32_t num_postings;         /**< Entries in the posting lists */
+    uint32_t questions_offset;     /**< File offset of the question records */
+    uint32_t themes_offset;        /**< File offset of the theme records */
+    uint32_t theme_refs_offset;    /**< File offset of the theme reference table */
+    uint32_t posting_starts_offset;/**< File offset of the posting list starts */
+    uint32_t postings_offset;      /**< File offset of the posting lists */
+    uint32_t fragments_offset;     /**< File offset of the fragment table */
+    uint32_t fragment_pool_offset; /**< File offset of the fragment pool */
+    uint32_t fragment_pool_size;   /**< Size of the fragment pool in bytes */
+    uint32_t strings_offset;       /**< File offset of the string pool */
+    uint32_t strings_size;         /**< Size of the string pool in bytes */
+} QBankHeader;
+
+typedef struct {
+    int32_t id;                    /**< Question id, record index + 1 */
+    uint8_t difficulty;            /**< Difficulty level */
+    uint8_t type;                  /**< QuestionType */
+    uint8_t num_themes;            /**< Theme references of this question */
+    uint8_t num_text_answers;      /**< Accepted text answers (text type) */
+    int32_t correct_answer;        /**< Answer index (QCM) or 0/1 (boolean) */
+    uint32_t themes_first;         /**< First entry in the theme reference table */
+    uint32_t question;             /**< Question text (string offset) */
+    uint32_t answers[4];           /**< Answer options (string offsets, QCM) */
+    uint32_t text_answers[4];      /**< Accepted text answers (string offsets) */
+    uint32_t explanation;          /**< Explanation (string offset) */
+} Question;
+
+typedef struct {
+    uint32_t name;                 /**< Theme name (string offset), id == index */
+} QBankTheme;
+
+/**
+ * Pre-encoded JSON fields of one question: slices of the fragment pool
+ * holding comma-separated "key":value pairs, spliced as is into messages.
+ */
+typedef struct {
+    uint32_t question_offset;      /**< question/new fields: type, difficulty, question, answers */
+    uint32_t question_len;         /**< Length of the question/new fields */
+    uint32_t results_offset;       /**< question/results fields: correctAnswer, explanation */
+    uint32_t results_len;          /**< Length of the question/results fields */
+} QuestionFragment;
+
+typedef struct {
+    const unsigned char *base;     /**< Start of the mapping */
+    size_t size;                   /**< Mapped length */
+    const QBankHeader *header;
+    const Question *questions;
+    const QBankTheme *themes;
+    const uint16_t *theme_refs;
+    const uint32_t *posting_starts;
+    const uint32_t *postings;
+    const QuestionFragment *fragments;
+    const char *fragment_pool;
+    const char *strings;
+#ifdef _WIN32
+    void *file_handle;
+    void *mapping_handle;
+#endif
+} QBank;
+
+// Mapping: open only checks structure (no full read), verify walks the checksum
+int qbank_open(QBank *bank, const char *path);
+void qbank_close(QBank *bank);
+int qbank_verify(const QBank *bank);
+
+// Offline compiler: parses a .dat file and atomically replaces bank_path
+int qbank_compile(const char *source_path, const char *bank_path);
+
+// Accessors, all bounds-checked against the mapping
+const Question* qbank_question(const QBank *bank, int id);
+const char* qbank_string(const QBank *bank, uint32_t offset);
+int qbank_question_theme(const QBank *bank, const Question *q, int i);
+const char* qbank_theme_name(const QBank *bank, int theme_id);
+int qbank_postings(const QBank *bank, int theme_id, int difficulty, const uint32_t **ids);
+const char* qbank_question_fields(const QBank *bank, const Question *q, size_t *len);
+const char* qbank_results_fields(const QBank *bank, const Question *q, size_t *len);
+
+#endif // QBANK_H
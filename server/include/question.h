@@ -5,8 +5,9 @@
 #include "cJSON.h"
 
 int load_questions(ServerState *state, const char *filename);
+void unload_questions(ServerState *state);
 int select_questions_for_session(ServerState *state, Session *session);
-bool check_answer(Question *q, int answer_index, const char *text_answer, bool bool_answer);
+bool check_answer(const QBank *bank, const Question *q, int answer_index, const char *text_answer, bool bool_answer);
 int calculate_points(Difficulty difficulty, double response_time, int time_limit);
 cJSON* create_themes_json(ServerState *state);
 
@@ -0,0 +1,28 @@
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stdbool.h>
+
+// Per-client token buckets, one per request class. Each endpoint belongs
+// to a class (see endpoints.h); a request is refused with 429 when its
+// bucket is empty. Rates and bursts are in ratelimit.c.
+
+typedef enum {
+    RATE_NONE,                     /**< Not limited */
+    RATE_ACCOUNT,                  /**< Registration and login (password guessing) */
+    RATE_QUERY,                    /**< Read-only lists and counters */
+    RATE_LOBBY,                    /**< Session creation, joining and starting */
+    RATE_GAME,                     /**< Answers and jokers during a game */
+    RATE_ADMIN,                    /**< Operator endpoints */
+    RATE_CLASS_COUNT
+} RateClass;
+
+typedef struct {
+    double tokens;                 /**< Requests currently allowed */
+    double updated_ms;             /**< Last refill, 0 before first use */
+} RateBucket;
+
+bool rate_allow(RateBucket *buckets, RateClass rate_class, double now_ms);
+const char* rate_class_name(RateClass rate_class);
+
+#endif // RATELIMIT_H
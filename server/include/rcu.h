@@ -0,0 +1,17 @@
+#ifndef RCU_H
+#define RCU_H
+
+// Read-copy-update for structures read on every send and changed rarely.
+// Readers bracket their accesses with rcu_read_lock/rcu_read_unlock: no
+// lock, no shared write, only a counter owned by the calling thread.
+// A writer unpublishes an object, then rcu_synchronize waits until every
+// reader that might still see it has left its read section; after that
+// the object can be reused or freed.
+// Rules: read sections are short and never block on a lock a writer may
+// hold while synchronizing; rcu_synchronize is never called inside one.
+
+void rcu_read_lock(void);
+void rcu_read_unlock(void);
+void rcu_synchronize(void);
+
+#endif // RCU_H
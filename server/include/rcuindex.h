@@ -0,0 +1,35 @@
+#ifndef RCUINDEX_H
+#define RCUINDEX_H
+
+#include <stdbool.h>
+
+// Open-addressing hash index from positive ids to pointers, readable
+// without a lock inside an RCU read section (see rcu.h). Writers are
+// serialized by the owner's lock. Removed ids leave a tombstone that is
+// never reused in place; when tombstones pile up, or the table fills, a
+// fresh table is built, published, and the old one freed after a grace
+// period.
+
+typedef struct {
+    int capacity;                  /**< Number of buckets (power of two) */
+    int *ids;                      /**< Ids, 0 marks an empty bucket, -1 a removed one */
+    void **values;                 /**< Pointer stored for each id */
+} RcuIndexTable;
+
+typedef struct {
+    RcuIndexTable *table;          /**< Published table (atomic) */
+    int count;                     /**< Ids stored (writers only) */
+    int used;                      /**< Buckets not empty: ids and tombstones (writers only) */
+} RcuIndex;
+
+int rcuindex_init(RcuIndex *index, int expected);
+void rcuindex_destroy(RcuIndex *index);
+
+// Reader side, under rcu_read_lock: the pointer, or NULL if the id is absent
+void* rcuindex_get(const RcuIndex *index, int id);
+
+// Writer side, serialized by the caller
+int rcuindex_put(RcuIndex *index, int id, void *value);
+bool rcuindex_remove(RcuIndex *index, int id);
+
+#endif // RCUINDEX_H
@@ -0,0 +1,19 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include "types.h"
+
+// Edge-triggered epoll reactor (Linux only, see IO_MODE_EPOLL)
+
+typedef struct Reactor {
+    ServerState *state;            /**< Owning server state */
+    int index;                     /**< Position in state->reactors */
+    int epoll_fd;                  /**< epoll instance for this I/O thread */
+    pthread_t thread;              /**< I/O thread running the event loop */
+} Reactor;
+
+int reactor_start(ServerState *state, int num_threads);
+int reactor_add_client(ServerState *state, Client *client);
+void reactor_stop(ServerState *state);
+
+#endif // REACTOR_H
@@ -0,0 +1,24 @@
+#ifndef ROSTER_H
+#define ROSTER_H
+
+#include <stdbool.h>
+
+#include "types.h"
+
+// Players of a session: a dense array for broadcasts plus an id index, so
+// joins, leaves and lookups are O(1) whatever the session size. A leaving
+// player is replaced by the last one, so positions are not stable and
+// SessionPlayer pointers are only valid until the next add or remove.
+// Every join and leave is also logged, in order, until the owner has
+// announced them and calls roster_clear_changes.
+
+int roster_init(Roster *roster, int expected);
+void roster_destroy(Roster *roster);
+
+// Returns the new player, NULL if already present or on allocation failure
+SessionPlayer* roster_add(Roster *roster, int client_id, const char *pseudo);
+SessionPlayer* roster_find(const Roster *roster, int client_id);
+bool roster_remove(Roster *roster, int client_id);
+void roster_clear_changes(Roster *roster);
+
+#endif // ROSTER_H
@@ -3,13 +3,16 @@
 
 #include "types.h"
 
-int init_server(ServerState *state, int tcp_port, int udp_port);
+int init_server(ServerState *state, int tcp_port, int udp_port, const ServerLimits *limits);
 void cleanup_server(ServerState *state);
 void run_server(ServerState *state);
 void stop_server(ServerState *state);
 Client* accept_client(ServerState *state);
+Client* find_client(ServerState *state, int client_id);
 void disconnect_client(ServerState *state, Client *client);
 void* client_handler(void *arg);
+int client_receive(Client *client, int flags);
+int client_process_input(ServerState *state, Client *client);
 void* udp_discovery_handler(void *arg);
 
 #endif // SERVER_H
@@ -3,32 +3,55 @@
 
 #include "cJSON.h"
 #include "types.h"
+#include "outqueue.h"
 
-Session* create_session(ServerState* state, const char* name, int* theme_ids,
-                        int num_themes, Difficulty difficulty,
-                        int num_questions, int time_limit, GameMode mode,
-                        int initial_lives, int max_players,
-                        int creator_client_id);
-Session* find_session(ServerState* state, int session_id);
-int join_session(ServerState* state, Session* session, int client_id,
-                 const char* pseudo);
-int leave_session(ServerState* state, Session* session, int client_id);
-int start_session(ServerState* state, Session* session);
-SessionPlayer* find_session_player(Session* session, int client_id);
-SessionPlayer* find_session_player_by_pseudo(Session* session,
-                                             const char* pseudo);
-void send_question_to_all(ServerState* state, Session* session);
-void process_answer(ServerState* state, Session* session, int client_id,
-                    int answer_index, const char* text_answer, bool bool_answer,
-                    double response_time);
-void check_question_timeout(ServerState* state, Session* session);
-void send_question_results(ServerState* state, Session* session);
-void advance_to_next_question(ServerState* state, Session* session);
-void end_session(ServerState* state, Session* session);
-int use_joker_fifty(ServerState* state, Session* session, int client_id,
-                    int* removed_answers);
-int use_joker_skip(ServerState* state, Session* session, int client_id);
-cJSON* create_sessions_list_json(ServerState* state);
-cJSON* create_session_join_response(Session* session, int client_id);
+// Each session runs as an actor (see actor.h) on state->session_pool:
+// request handlers and timer deadlines post a SessionMsg, and the session
+// replies to the requesting client itself, echoing the request id.
+
+typedef enum {
+  SESSION_MSG_JOIN,     /**< Add the client, reply session/join */
+  SESSION_MSG_LEAVE,    /**< Remove a disconnected client, no reply */
+  SESSION_MSG_START,    /**< Start the game (creator only), errors replied */
+  SESSION_MSG_ANSWER,   /**< Answer the current question, acknowledged */
+  SESSION_MSG_JOKER,    /**< Use a joker, reply joker/use */
+  SESSION_MSG_DEADLINE, /**< Phase deadline fired on the timer wheel */
+  SESSION_MSG_ROSTER    /**< Announce the roster changes logged meanwhile */
+} SessionMsgType;
+
+typedef enum {
+  JOKER_FIFTY,  /**< Remove two wrong answers */
+  JOKER_SKIP    /**< Skip the current question */
+} JokerType;
+
+typedef struct {
+  ActorMsg header;      /**< Inbox link, first member */
+  SessionMsgType type;  /**< Message kind, selects the data member */
+  int client_id;        /**< Client the message is about, 0 for deadlines */
+  long long rid;        /**< Correlation id to echo in the reply, -1 if none */
+  int endpoint;         /**< Registry index of the request, for its latency */
+  double received_ms;   /**< When the request was routed, 0 for internal messages */
+  union {
+    char pseudo[MAX_PSEUDO_LEN];  /**< JOIN: display name */
+    struct {
+      int index;                   /**< QCM answer index */
+      bool value;                  /**< Boolean answer */
+      char text[MAX_ANSWER_TEXT];  /**< Text answer */
+      double response_time;        /**< Seconds taken, as reported */
+    } answer;                      /**< ANSWER */
+    JokerType joker;               /**< JOKER */
+    unsigned int phase_seq;        /**< DEADLINE: phase it was armed for */
+  } data;
+} SessionMsg;
+
+int create_session(ServerState* state, const char* name, int* theme_ids,
+                   int num_themes, Difficulty difficulty, int num_questions,
+                   int time_limit, GameMode mode, int initial_lives,
+                   int max_players, int creator_client_id,
+                   const char* creator_pseudo);
+int session_post(ServerState* state, int session_id, const SessionMsg* msg);
+int session_post_request(ServerState* state, Client* client, int session_id,
+                         SessionMsg* msg);
+MsgBuf* encode_sessions_list(ServerState* state);
 
 #endif  // SESSION_H
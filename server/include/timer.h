@@ -0,0 +1,56 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hierarchical timer wheel driven by a single thread
+
+#define TIMER_TICK_MS 50             /**< Wheel resolution in milliseconds */
+#define TIMER_LEVELS 4               /**< Number of wheel levels */
+#define TIMER_SLOT_BITS 6            /**< log2 of slots per level */
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+
+typedef void (*TimerCallback)(void *context, void *arg, int tag);
+
+typedef struct TimerNode {
+    struct TimerNode *next;        /**< Next node in slot or free list */
+    struct TimerNode *prev;        /**< Previous node in slot list */
+    uint64_t expires;              /**< Absolute tick at which the timer fires */
+    unsigned int generation;       /**< Bumped on fire/cancel to invalidate handles */
+    bool pending;                  /**< Whether the node is linked in a slot */
+    int level;                     /**< Wheel level holding the node */
+    int slot;                      /**< Slot index within that level */
+    TimerCallback callback;        /**< Function invoked on expiry */
+    void *arg;                     /**< Callback argument */
+    int tag;                       /**< Callback integer tag */
+} TimerNode;
+
+typedef struct {
+    TimerNode *node;               /**< Scheduled node (NULL if none) */
+    unsigned int generation;       /**< Generation the handle refers to */
+} TimerHandle;
+
+typedef struct TimerChunk TimerChunk;
+
+typedef struct {
+    pthread_mutex_t mutex;         /**< Protects slots, free list and clock */
+    pthread_t thread;              /**< Thread advancing the wheel */
+    volatile bool running;         /**< Cleared to stop the thread */
+    void *context;                 /**< Passed as first argument to callbacks */
+    uint64_t current_tick;         /**< Next tick to be processed */
+    double start_ms;               /**< Monotonic time of tick 0 */
+    TimerNode *slots[TIMER_LEVELS][TIMER_SLOTS]; /**< Per-level slot lists */
+    TimerNode *free_list;          /**< Recycled nodes */
+    TimerChunk *chunks;            /**< Node allocations, released on destroy */
+} TimerWheel;
+
+int timer_wheel_init(TimerWheel *wheel, void *context);
+int timer_wheel_start(TimerWheel *wheel);
+void timer_wheel_stop(TimerWheel *wheel);
+void timer_wheel_destroy(TimerWheel *wheel);
+TimerHandle timer_schedule(TimerWheel *wheel, int delay_ms, TimerCallback callback, void *arg, int tag);
+bool timer_cancel(TimerWheel *wheel, TimerHandle *handle);
+
+#endif // TIMER_H
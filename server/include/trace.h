@@ -0,0 +1,35 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "cJSON.h"
+
+// Request tracing: bodies of requests from traced clients, to traced
+// endpoints, or picked by the 1-in-N sampler are dumped to the log (INFO,
+// tag TRACE) with passwords masked, long bodies split into numbered parts.
+// Nothing is serialized for other requests.
+
+#define TRACE_MAX_ENDPOINTS 16
+#define TRACE_ENDPOINT_LEN 64
+
+typedef struct {
+    int sample_rate;               /**< Trace 1 request in N, 0 for none */
+    unsigned long sample_counter;  /**< Requests seen by the sampler (atomic) */
+    int num_endpoints;             /**< Traced endpoints (atomic, checked without the lock) */
+    char endpoints[TRACE_MAX_ENDPOINTS][TRACE_ENDPOINT_LEN];
+    pthread_mutex_t mutex;         /**< Protects the endpoint list */
+} TraceConfig;
+
+void trace_init(TraceConfig *trace);
+void trace_destroy(TraceConfig *trace);
+void trace_set_sample_rate(TraceConfig *trace, int sample_rate);
+int trace_set_endpoint(TraceConfig *trace, const char *endpoint, bool enabled);
+
+// Hot path: decides whether a request is traced, before any serialization
+bool trace_wanted(TraceConfig *trace, bool client_traced, const char *endpoint);
+void trace_request(int client_id, const char *method, const char *endpoint,
+                   cJSON *body, double elapsed_ms);
+
+#endif // TRACE_H
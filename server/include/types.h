@@ -15,6 +15,21 @@
 #include <stdbool.h>
 #include <time.h>
 
+#include "timer.h"
+#include "idindex.h"
+#include "rcuindex.h"
+#include "pool.h"
+#include "qbank.h"
+#include "trace.h"
+#include "framer.h"
+#include "ratelimit.h"
+#include "workpool.h"
+#include "passhash.h"
+#include "nameindex.h"
+#include "journal.h"
+#include "actor.h"
+#include "leaderboard.h"
+
 /* ============================================================================
  * Configuration Constants
  * ============================================================================ */
@@ -23,14 +38,14 @@
  *  Maximum values for various server resources
  *  @{
  */
-#define MAX_CLIENTS 100              /**< Maximum simultaneous client connections */
-#define MAX_SESSIONS 20              /**< Maximum concurrent game sessions */
-#define MAX_PLAYERS_PER_SESSION 10   /**< Maximum players in a single session */
-#define MAX_QUESTIONS 200            /**< Maximum questions in the database */
-#define MAX_THEMES 20                /**< Maximum number of question themes/categories */
+#define DEFAULT_MAX_CLIENTS 1024     /**< Default limit on simultaneous client connections */
+#define DEFAULT_MAX_SESSIONS 256     /**< Default limit on game session slots */
+#define DEFAULT_MAX_ACCOUNTS 65536   /**< Default limit on registered accounts */
+#define MAX_PLAYERS_PER_SESSION 10000 /**< Maximum players in a single session */
+#define MAX_THEMES 20                /**< Maximum themes attached to one question or session */
 #define MAX_PSEUDO_LEN 32            /**< Maximum length of player username */
 #define MAX_PASSWORD_LEN 64          /**< Maximum length of player password */
-#define MAX_MESSAGE_LEN 8192         /**< Maximum length of protocol messages */
+#define MAX_MESSAGE_LEN 8192         /**< Maximum length of an inbound protocol line (responses are unbounded) */
 #define MAX_QUESTION_TEXT 512        /**< Maximum length of question text */
 #define MAX_ANSWER_TEXT 128          /**< Maximum length of an answer option */
 #define MAX_THEME_NAME 64            /**< Maximum length of a theme name */
@@ -42,6 +57,12 @@
  */
 #define UDP_PORT 5555                /**< UDP port for server discovery broadcasts */
 #define DEFAULT_TCP_PORT 5556        /**< Default TCP port for game connections */
+#define DEFAULT_IO_THREADS 4         /**< Default number of reactor I/O threads */
+#define DEFAULT_MAX_BACKLOG (1024 * 1024) /**< Default per-client unsent bytes before disconnect */
+#define DEFAULT_AUTH_THREADS 2       /**< Default number of password hashing workers */
+#define DEFAULT_SESSION_THREADS 4    /**< Default number of session actor workers */
+#define AUTH_QUEUE_CAPACITY 1024     /**< Logins/registrations waiting for a worker before 503 */
+#define DEFAULT_METRICS_PORT 9556    /**< Default loopback port for /metrics scrapes */
 /** @} */
 
 /* ============================================================================
@@ -76,6 +97,14 @@ typedef enum {
     MODE_BATTLE  /**< Multiplayer battle - compete with lives system */
 } GameMode;
 
+/**
+ * @brief How client sockets are serviced by the server
+ */
+typedef enum {
+    IO_MODE_THREADS, /**< One blocking handler thread per client (default) */
+    IO_MODE_EPOLL    /**< Edge-triggered epoll reactor on a fixed thread pool */
+} IoMode;
+
 /**
  * @brief Current status of a game session
  */
@@ -85,40 +114,19 @@ typedef enum {
     SESSION_FINISHED  /**< Game has ended */
 } SessionStatus;
 
-/* ============================================================================
- * Data Structures
- * ============================================================================ */
-
 /**
- * @brief Represents a question category/theme
- * 
- * Themes are used to categorize questions and allow players
- * to select specific topics for their quiz sessions.
+ * @brief Timed phase of a running session, driven by the timer wheel
  */
-typedef struct {
-    int id;                    /**< Unique theme identifier */
-    char name[MAX_THEME_NAME]; /**< Display name of the theme */
-} Theme;
+typedef enum {
+    PHASE_NONE,       /**< No pending deadline (lobby or finished) */
+    PHASE_COUNTDOWN,  /**< Start countdown before the first question */
+    PHASE_QUESTION,   /**< Question open, waiting for answers or expiry */
+    PHASE_RESULTS     /**< Results shown, pausing before the next question */
+} SessionPhase;
 
-/**
- * @brief Represents a quiz question with all its metadata
- * 
- * Supports multiple question types (QCM, boolean, text) and can
- * belong to multiple themes. Includes explanation for learning.
- */
-typedef struct {
-    int id;                                /**< Unique question identifier */
-    int theme_ids[MAX_THEMES];             /**< Array of theme IDs this question belongs to */
-    int num_themes;                        /**< Number of themes assigned to this question */
-    Difficulty difficulty;                 /**< Difficulty level of the question */
-    QuestionType type;                     /**< Type of question (QCM, boolean, text) */
-    char question[MAX_QUESTION_TEXT];      /**< The question text */
-    char answers[4][MAX_ANSWER_TEXT];      /**< Answer options (used for QCM type) */
-    int correct_answer;                    /**< Correct answer index (0-3 for QCM, 0/1 for boolean) */
-    char text_answers[4][MAX_ANSWER_TEXT]; /**< Accepted text answers (for text type questions) */
-    int num_text_answers;                  /**< Number of accepted text answers */
-    char explanation[MAX_QUESTION_TEXT];   /**< Explanation shown after answering */
-} Question;
+/* ============================================================================
+ * Data Structures
+ * ============================================================================ */
 
 /**
  * @brief Player state within a game session
@@ -141,14 +149,42 @@ typedef struct {
     bool joker_fifty_used;       /**< Whether 50/50 joker has been used */
     bool joker_skip_used;        /**< Whether skip joker has been used */
     bool used_skip_this_question;/**< Whether skip was used on current question */
+    bool roster_synced;          /**< Received the roster, now follows its changes */
+    int rank_node;               /**< Node of the player in the session ranking */
 } SessionPlayer;
 
+/**
+ * @brief A join or a leave recorded by a roster
+ */
+typedef struct {
+    bool joined;                 /**< Whether the player joined (or left) */
+    char pseudo[MAX_PSEUDO_LEN]; /**< Display name of the player */
+} RosterChange;
+
+/**
+ * @brief Players of a session, see roster.h
+ */
+typedef struct {
+    SessionPlayer *players;      /**< Dense array, in no particular order */
+    int count;                   /**< Number of players (atomic) */
+    int capacity;                /**< Allocated entries in players */
+    IdIndex positions;           /**< Client ID -> index in players */
+    RosterChange *changes;       /**< Joins and leaves not announced yet, oldest first */
+    int num_changes;             /**< Number of entries in changes */
+    int changes_capacity;        /**< Allocated entries in changes */
+} Roster;
+
 /**
  * @brief Represents a game session (lobby + active game)
  * 
  * A session is created by a player, configured with themes/difficulty,
  * and can host multiple players. Manages the full game lifecycle from
  * waiting room to game completion.
+ * 
+ * Once published, a session is an actor: only its message handler (see
+ * session.h) reads or writes it, one message at a time, without a lock.
+ * The sessions list only reads the immutable settings plus status and
+ * roster.count, which the handler stores atomically.
  */
 typedef struct {
     int id;                        /**< Unique session identifier */
@@ -161,29 +197,36 @@ typedef struct {
     GameMode mode;                 /**< Game mode (solo or battle) */
     int initial_lives;             /**< Starting lives for battle mode */
     int max_players;               /**< Maximum players allowed */
-    SessionStatus status;          /**< Current session status */
+    SessionStatus status;          /**< Current session status (atomic) */
     
-    SessionPlayer players[MAX_PLAYERS_PER_SESSION]; /**< Array of players in session */
-    int num_players;               /**< Current number of players */
+    Roster roster;                 /**< Players in session */
+    Leaderboard ranking;           /**< Players by rank, updated as scores change */
     int creator_client_id;         /**< Client ID of session creator (host) */
+    TimerHandle roster_timer;      /**< Next announcement of roster changes */
+    bool roster_flush_pending;     /**< Whether roster_timer is armed */
     
     int question_ids[50];          /**< IDs of questions selected for this game */
     int current_question;          /**< Index of current question (0-based) */
     time_t question_start_time;    /**< Timestamp when current question started */
+    SessionPhase phase;            /**< Current timed phase of the game */
+    TimerHandle phase_timer;       /**< Deadline of the current phase */
+    unsigned int phase_seq;        /**< Bumped on each phase change, tells stale deadlines apart */
+    int awaiting_answers;          /**< Active players yet to answer the current question */
     
-    pthread_mutex_t mutex;         /**< Mutex for thread-safe session access */
+    Actor actor;                   /**< Inbox of the session's messages */
+    int slot;                      /**< Slot in ServerState::sessions, freed once the retired actor drains */
 } Session;
 
 /**
  * @brief Persistent player account for authentication
  * 
  * Stores player credentials for login/registration.
- * Password is stored as a hashed value, never plaintext.
+ * Password is stored as a salted hash, never plaintext (see passhash.h).
  */
 typedef struct {
     int id;                        /**< Unique account identifier */
     char pseudo[MAX_PSEUDO_LEN];   /**< Username/display name */
-    char password_hash[65];        /**< SHA256 hash of password (64 hex chars + null) */
+    char password_hash[PASSHASH_MAX_LEN]; /**< Salted PBKDF2 hash (legacy accounts: unsalted hex) */
     bool logged_in;                /**< Whether account is currently logged in */
 } PlayerAccount;
 
@@ -196,15 +239,47 @@ typedef struct {
 typedef struct {
     int socket;                    /**< TCP socket file descriptor */
     int id;                        /**< Unique client identifier */
+    int slot;                      /**< Slot in the clients pool */
     bool connected;                /**< Whether client is currently connected */
-    bool authenticated;            /**< Whether client has logged in */
+    bool authenticated;            /**< Whether client has logged in (set by auth workers, atomic) */
     char pseudo[MAX_PSEUDO_LEN];   /**< Player's username (if authenticated) */
-    int current_session_id;        /**< ID of session player is in (-1 if none) */
+    int current_session_id;        /**< ID of session player is in, -1 if none (atomic, set by session actors) */
     pthread_t thread;              /**< Thread handling this client's messages */
     char ip[16];                   /**< Client's IP address (IPv4) */
     int port;                      /**< Client's port number */
+    int reactor_id;                /**< Reactor owning this socket (-1 in thread mode) */
+    bool trace;                    /**< Dump this client's requests to the log (atomic) */
+    bool binary;                   /**< Binary protocol negotiated (set under send_mutex) */
+    RateBucket rate[RATE_CLASS_COUNT]; /**< Request budget per endpoint class */
+    long long rid;                 /**< Correlation id of the request being handled, -1 if none */
+    int request_endpoint;          /**< Registry index of the request being handled */
+    double request_started;        /**< When the request being handled was routed (ms) */
+    bool request_handed_off;       /**< Posted to a session, which records its latency */
+    
+    /* Input framing state (METHOD path\n{json}\n) */
+    LineFramer framer;             /**< Received bytes; a held line is a POST header awaiting its body */
+    
+    /* Output queue, flushed without blocking (see outqueue.h) */
+    pthread_mutex_t send_mutex;    /**< Protects the output queue and the socket for writes */
+    struct OutChunk *out_head;     /**< Oldest queued message (partially sent first) */
+    struct OutChunk *out_tail;     /**< Newest queued message */
+    size_t out_bytes;              /**< Bytes queued and not yet written */
+    size_t out_limit;              /**< Backlog above which the client is dropped */
+    bool out_failed;               /**< Backlog exceeded or write error, connection closing */
+    bool out_corked;               /**< Writes deferred until the request batch ends */
 } Client;
 
+/**
+ * @brief Runtime capacity limits
+ * 
+ * Pools grow on demand up to these values (see --max-* options).
+ */
+typedef struct {
+    int max_clients;               /**< Simultaneous client connections */
+    int max_sessions;              /**< Game session slots */
+    int max_accounts;              /**< Registered accounts */
+} ServerLimits;
+
 /**
  * @brief Global server state containing all runtime data
  * 
@@ -221,35 +296,58 @@ typedef struct {
     int udp_socket;                /**< UDP socket for discovery broadcasts */
     int tcp_port;                  /**< TCP port the server is listening on */
     int udp_port;                  /**< UDP port for discovery */
+    int metrics_port;              /**< Loopback port for /metrics scrapes, 0 to disable */
     int next_client_id;            /**< Next ID to assign to a new client */
     pthread_t udp_thread;          /**< Thread handle for UDP discovery handler */
     
+    /* I/O model */
+    IoMode io_mode;                /**< Thread-per-client or epoll reactor */
+    int num_io_threads;            /**< Number of reactor threads (epoll mode) */
+    struct Reactor *reactors;      /**< Reactor threads (epoll mode only) */
+    int next_reactor;              /**< Round-robin cursor for new clients */
+    size_t max_backlog;            /**< Per-client output queue limit in bytes */
+    
+    ServerLimits limits;           /**< Capacity limits for the pools below */
+    
     /* Client management */
-    Client clients[MAX_CLIENTS];   /**< Array of all client connections */
-    int num_clients;               /**< Current number of connected clients */
-    pthread_mutex_t clients_mutex; /**< Mutex for clients array access */
+    Pool clients;                  /**< Pool of Client, slots reused a grace period after disconnect */
+    int num_clients;               /**< Current number of connected clients (atomic) */
+    pthread_mutex_t clients_mutex; /**< Serializes accepts and disconnects; lookups never take it */
+    RcuIndex client_index;         /**< Client id -> Client, read under rcu_read_lock */
     
     /* Session management */
-    Session sessions[MAX_SESSIONS];/**< Array of all game sessions */
-    int num_sessions;              /**< Current number of active sessions */
+    Pool sessions;                 /**< Pool of Session, finished slots reused */
     int next_session_id;           /**< Next ID to assign to a new session */
-    pthread_mutex_t sessions_mutex;/**< Mutex for sessions array access */
+    pthread_mutex_t sessions_mutex;/**< Mutex for sessions pool access */
+    RcuIndex session_index;        /**< Session id -> Session, read under rcu_read_lock (writers hold sessions_mutex) */
+    ActorPool session_pool;        /**< Runs the session actors */
+    int num_session_threads;       /**< Workers started in session_pool */
     
     /* Question database */
-    Question questions[MAX_QUESTIONS]; /**< Array of all loaded questions */
+    QBank bank;                    /**< Compiled question bank, mapped read-only */
+    const Question *questions;     /**< Question records in the bank, id == index + 1 */
     int num_questions;             /**< Total number of questions loaded */
-    
-    /* Theme database */
-    Theme themes[MAX_THEMES];      /**< Array of all available themes */
-    int num_themes;                /**< Total number of themes */
+    int num_themes;                /**< Total number of themes in the bank */
     
     /* Account management */
-    PlayerAccount accounts[MAX_CLIENTS]; /**< Array of registered accounts */
+    Pool accounts;                 /**< Pool of PlayerAccount, slot == account id */
     int num_accounts;              /**< Total number of registered accounts */
+    NameIndex account_index;       /**< Pseudo -> accounts slot (under accounts_mutex) */
+    Journal account_journal;       /**< Account changes since the last snapshot */
     pthread_mutex_t accounts_mutex;/**< Mutex for accounts array access */
     pthread_mutex_t players_mutex; /**< Mutex for player-related operations */
+    WorkPool auth_pool;            /**< Password hashing off the I/O threads */
+    int num_auth_threads;          /**< Workers started in auth_pool */
     int num_players;               /**< Current number of active players */
     
+    /* Timers */
+    TimerWheel timers;             /**< Question, countdown and result deadlines */
+    
+    /* Statistics */
+    time_t start_time;             /**< Server start, for uptime */
+    unsigned long long requests_handled; /**< Requests routed since start (atomic) */
+    TraceConfig trace;             /**< Request tracing switches */
+    
     bool running;                  /**< Server running flag (false to shutdown) */
 } ServerState;
 
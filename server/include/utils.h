@@ -3,14 +3,17 @@
 
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stddef.h>
+
+#include "log.h"
 
-void log_msg(const char *tag, const char *format, ...);
 void str_to_lower(char *str);
 bool str_equals(const char *a, const char *b);
 void trim_whitespace(char *str);
-void sha256_hash(const char *input, char *output);
+void legacy_password_hash(const char *input, char *output);
 void init_random(void);
 int random_int(int min, int max);
+int random_bytes(void *buffer, size_t len);
 void shuffle_array(int *array, int n);
 double get_current_time_ms(void);
 const char* difficulty_to_string(int difficulty);
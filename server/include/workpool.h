@@ -0,0 +1,38 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+// Fixed set of worker threads draining a bounded FIFO of jobs. Used for
+// work too slow for the I/O threads (password hashing); a full queue
+// refuses new jobs instead of letting the backlog grow.
+
+typedef void (*WorkFn)(void *context, void *arg);
+
+typedef struct {
+    WorkFn fn;                     /**< Job function */
+    void *arg;                     /**< Job data, freed once the job ran */
+} WorkItem;
+
+typedef struct {
+    const char *name;              /**< Log tag of the pool */
+    void *context;                 /**< Passed as first argument to jobs */
+    pthread_mutex_t mutex;         /**< Protects the queue and running */
+    pthread_cond_t ready;          /**< Signaled when a job is queued or on stop */
+    WorkItem *queue;               /**< Ring buffer of pending jobs */
+    int capacity;                  /**< Ring buffer size */
+    int head;                      /**< Oldest pending job */
+    int count;                     /**< Pending jobs */
+    pthread_t *threads;            /**< Worker threads */
+    int num_threads;               /**< Started workers */
+    bool running;                  /**< Cleared to stop the workers */
+} WorkPool;
+
+int workpool_init(WorkPool *pool, const char *name, void *context, int capacity);
+int workpool_start(WorkPool *pool, int num_threads);
+int workpool_submit(WorkPool *pool, WorkFn fn, void *arg);
+void workpool_stop(WorkPool *pool);
+void workpool_destroy(WorkPool *pool);
+
+#endif // WORKPOOL_H
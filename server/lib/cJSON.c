@@ -9,14 +9,134 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <ctype.h>
+#include <stdint.h>
 #include "cJSON.h"
 
 static void *(*cJSON_malloc)(size_t sz) = malloc;
 static void (*cJSON_free)(void *ptr) = free;
 
+/* Bump arena: allocations are carved from blocks and never freed one by
+   one, the whole arena is rewound by cJSON_ArenaReset. */
+#define ARENA_ALIGN 16
+#define ARENA_MAX_RETAINED (256 * 1024)   /* Largest block kept across resets */
+#define ARENA_BLOCK_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+struct cJSON_Arena {
+    ArenaBlock *blocks;             /* Current block first */
+    size_t block_size;
+    unsigned long long allocs;      /* Served since the last reset */
+};
+
+static __thread cJSON_Arena *current_arena;
+static unsigned long long heap_allocs;
+static unsigned long long arena_allocs;
+
+static void *heap_alloc(size_t size) {
+    __atomic_add_fetch(&heap_allocs, 1, __ATOMIC_RELAXED);
+    return cJSON_malloc(size);
+}
+
+static void *arena_alloc(cJSON_Arena *arena, size_t size) {
+    ArenaBlock *block = arena->blocks;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (!block || block->size - block->used < size) {
+        size_t block_size = arena->block_size;
+        while (block_size < size) block_size *= 2;
+        ArenaBlock *fresh = (ArenaBlock*)heap_alloc(ARENA_BLOCK_HEADER + block_size);
+        if (!fresh) return NULL;
+        fresh->next = block;
+        fresh->size = block_size;
+        fresh->used = 0;
+        arena->blocks = block = fresh;
+    }
+    void *ptr = (char*)block + ARENA_BLOCK_HEADER + block->used;
+    block->used += size;
+    arena->allocs++;
+    return ptr;
+}
+
+static int arena_owns(const cJSON_Arena *arena, const void *ptr) {
+    uintptr_t p = (uintptr_t)ptr;
+    for (const ArenaBlock *b = arena->blocks; b; b = b->next) {
+        uintptr_t start = (uintptr_t)b + ARENA_BLOCK_HEADER;
+        if (p >= start && p < start + b->size) return 1;
+    }
+    return 0;
+}
+
+static void *cjson_alloc(size_t size) {
+    return current_arena ? arena_alloc(current_arena, size) : heap_alloc(size);
+}
+
+static void cjson_release(void *ptr) {
+    if (!ptr || (current_arena && arena_owns(current_arena, ptr))) return;
+    cJSON_free(ptr);
+}
+
+static void arena_free_blocks(cJSON_Arena *arena) {
+    ArenaBlock *block = arena->blocks;
+    while (block) {
+        ArenaBlock *next = block->next;
+        cJSON_free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+}
+
+cJSON_Arena *cJSON_ArenaCreate(size_t block_size) {
+    cJSON_Arena *arena = (cJSON_Arena*)heap_alloc(sizeof(cJSON_Arena));
+    if (!arena) return NULL;
+    arena->blocks = NULL;
+    arena->block_size = block_size ? block_size : 4096;
+    arena->allocs = 0;
+    return arena;
+}
+
+void cJSON_ArenaReset(cJSON_Arena *arena) {
+    ArenaBlock *block = arena->blocks;
+    __atomic_add_fetch(&arena_allocs, arena->allocs, __ATOMIC_RELAXED);
+    if (block && block->next) {
+        /* Overflowed: keep a single block sized for the whole request */
+        size_t total = 0;
+        for (ArenaBlock *b = block; b; b = b->next) total += b->size;
+        arena_free_blocks(arena);
+        if (total > ARENA_MAX_RETAINED) total = ARENA_MAX_RETAINED;
+        if (total > arena->block_size) arena_alloc(arena, total);
+        if (arena->blocks) arena->blocks->used = 0;
+    } else if (block) {
+        block->used = 0;
+    }
+    arena->allocs = 0;
+}
+
+void cJSON_ArenaDestroy(cJSON_Arena *arena) {
+    if (!arena) return;
+    if (current_arena == arena) current_arena = NULL;
+    __atomic_add_fetch(&arena_allocs, arena->allocs, __ATOMIC_RELAXED);
+    arena_free_blocks(arena);
+    cJSON_free(arena);
+}
+
+cJSON_Arena *cJSON_ArenaUse(cJSON_Arena *arena) {
+    cJSON_Arena *previous = current_arena;
+    current_arena = arena;
+    return previous;
+}
+
+void cJSON_GetAllocStats(cJSON_AllocStats *stats) {
+    stats->heap_allocs = __atomic_load_n(&heap_allocs, __ATOMIC_RELAXED);
+    stats->arena_allocs = __atomic_load_n(&arena_allocs, __ATOMIC_RELAXED);
+}
+
 static char* cJSON_strdup(const char* str) {
     size_t len = strlen(str) + 1;
-    char* copy = (char*)cJSON_malloc(len);
+    char* copy = (char*)cjson_alloc(len);
     if (!copy) return NULL;
     memcpy(copy, str, len);
     return copy;
@@ -33,7 +153,7 @@ void cJSON_InitHooks(cJSON_Hooks* hooks) {
 }
 
 static cJSON *cJSON_New_Item(void) {
-    cJSON* node = (cJSON*)cJSON_malloc(sizeof(cJSON));
+    cJSON* node = (cJSON*)cjson_alloc(sizeof(cJSON));
     if (node) memset(node, 0, sizeof(cJSON));
     return node;
 }
@@ -43,9 +163,9 @@ void cJSON_Delete(cJSON *c) {
     while (c) {
         next = c->next;
         if (!(c->type & cJSON_IsReference) && c->child) cJSON_Delete(c->child);
-        if (!(c->type & cJSON_IsReference) && c->valuestring) cJSON_free(c->valuestring);
-        if (!(c->type & cJSON_StringIsConst) && c->string) cJSON_free(c->string);
-        cJSON_free(c);
+        if (!(c->type & cJSON_IsReference) && c->valuestring) cjson_release(c->valuestring);
+        if (!(c->type & cJSON_StringIsConst) && c->string) cjson_release(c->string);
+        cjson_release(c);
         c = next;
     }
 }
@@ -75,41 +195,51 @@ static const char *parse_number(cJSON *item, const char *num) {
     return num;
 }
 
-static size_t pow2gt(size_t x) { --x; x |= x >> 1; x |= x >> 2; x |= x >> 4; x |= x >> 8; x |= x >> 16; return x + 1; }
+static size_t pow2gt(size_t x) {
+    --x; x |= x >> 1; x |= x >> 2; x |= x >> 4; x |= x >> 8; x |= x >> 16;
+#if SIZE_MAX > 0xFFFFFFFFu
+    x |= x >> 32;
+#endif
+    return x + 1;
+}
 
-typedef struct { char *buffer; size_t length; size_t offset; int noalloc; } printbuffer;
+/* Output is appended to one growing buffer; it is NUL-terminated only once
+   printing is done. */
+typedef struct { char *buffer; size_t length; size_t offset; } printbuffer;
 
 static char* ensure(printbuffer *p, size_t needed) {
     char *newbuffer;
     size_t newsize;
-    if (!p || !p->buffer) return NULL;
-    if ((p->length > 0) && (p->offset + needed <= p->length)) return p->buffer + p->offset;
-    if (p->noalloc) return NULL;
+    if (p->offset + needed <= p->length) return p->buffer + p->offset;
     newsize = pow2gt(p->offset + needed);
-    newbuffer = (char*)cJSON_malloc(newsize);
+    newbuffer = (char*)cjson_alloc(newsize);
     if (!newbuffer) return NULL;
-    memcpy(newbuffer, p->buffer, p->offset + 1);
-    cJSON_free(p->buffer);
+    memcpy(newbuffer, p->buffer, p->offset);
+    cjson_release(p->buffer);
     p->length = newsize;
     p->buffer = newbuffer;
     return newbuffer + p->offset;
 }
 
-static char *print_number(const cJSON *item, printbuffer *p) {
-    char *str = NULL;
+static int print_raw(const char *text, size_t len, printbuffer *p) {
+    char *out = ensure(p, len);
+    if (!out) return 0;
+    memcpy(out, text, len);
+    p->offset += len;
+    return 1;
+}
+
+static int print_number(const cJSON *item, printbuffer *p) {
     double d = item->valuedouble;
-    
-    if (p) str = ensure(p, 64);
-    else str = (char*)cJSON_malloc(64);
-    if (!str) return NULL;
+    char *str = ensure(p, 64);
+    if (!str) return 0;
     
     if (d == (double)item->valueint) {
-        sprintf(str, "%d", item->valueint);
+        p->offset += sprintf(str, "%d", item->valueint);
     } else {
-        sprintf(str, "%g", d);
+        p->offset += sprintf(str, "%g", d);
     }
-    if (p) p->offset += strlen(str);
-    return str;
+    return 1;
 }
 
 static unsigned parse_hex4(const char *str) {
@@ -134,7 +264,7 @@ static const char *parse_string(cJSON *item, const char *str) {
     if (*str != '\"') return NULL;
     while (*ptr != '\"' && *ptr && ++len) if (*ptr++ == '\\') ptr++;
     
-    out = (char*)cJSON_malloc(len + 1);
+    out = (char*)cjson_alloc(len + 1);
     if (!out) return NULL;
     
     ptr = str + 1;
@@ -177,19 +307,13 @@ static const char *parse_string(cJSON *item, const char *str) {
     return ptr;
 }
 
-static char *print_string_ptr(const char *str, printbuffer *p) {
+static int print_string_ptr(const char *str, printbuffer *p) {
     const char *ptr;
     char *ptr2, *out;
     size_t len = 0, flag = 0;
     unsigned char token;
     
-    if (!str) {
-        if (p) out = ensure(p, 3);
-        else out = (char*)cJSON_malloc(3);
-        if (!out) return NULL;
-        strcpy(out, "\"\"");
-        return out;
-    }
+    if (!str) str = "";
     
     for (ptr = str; *ptr; ptr++) {
         flag |= ((*ptr > 0 && *ptr < 32) || (*ptr == '\"') || (*ptr == '\\')) ? 1 : 0;
@@ -197,20 +321,17 @@ static char *print_string_ptr(const char *str, printbuffer *p) {
     len = ptr - str;
     
     if (!flag) {
-        if (p) out = ensure(p, len + 3);
-        else out = (char*)cJSON_malloc(len + 3);
-        if (!out) return NULL;
-        ptr2 = out;
-        *ptr2++ = '\"';
-        strcpy(ptr2, str);
-        ptr2[len] = '\"';
-        ptr2[len + 1] = 0;
-        return out;
+        out = ensure(p, len + 2);
+        if (!out) return 0;
+        out[0] = '\"';
+        memcpy(out + 1, str, len);
+        out[len + 1] = '\"';
+        p->offset += len + 2;
+        return 1;
     }
     
-    if (p) out = ensure(p, len * 6 + 3);
-    else out = (char*)cJSON_malloc(len * 6 + 3);
-    if (!out) return NULL;
+    out = ensure(p, len * 6 + 3);
+    if (!out) return 0;
     
     ptr2 = out;
     ptr = str;
@@ -232,11 +353,11 @@ static char *print_string_ptr(const char *str, printbuffer *p) {
         }
     }
     *ptr2++ = '\"';
-    *ptr2 = 0;
-    return out;
+    p->offset += ptr2 - out;
+    return 1;
 }
 
-static char *print_string(const cJSON *item, printbuffer *p) {
+static int print_string(const cJSON *item, printbuffer *p) {
     return print_string_ptr(item->valuestring, p);
 }
 
@@ -246,7 +367,7 @@ static const char *skip(const char *in) {
 }
 
 static const char *parse_value(cJSON *item, const char *value);
-static char *print_value(const cJSON *item, int depth, int fmt, printbuffer *p);
+static int print_value(const cJSON *item, int depth, int fmt, printbuffer *p);
 
 static const char *parse_array(cJSON *item, const char *value) {
     cJSON *child;
@@ -274,80 +395,16 @@ static const char *parse_array(cJSON *item, const char *value) {
     return NULL;
 }
 
-static char *print_array(const cJSON *item, int depth, int fmt, printbuffer *p) {
-    char **entries;
-    char *out = NULL, *ptr, *ret;
-    size_t len = 5;
+static int print_array(const cJSON *item, int depth, int fmt, printbuffer *p) {
     cJSON *child = item->child;
-    int numentries = 0, i = 0, fail = 0;
     
-    while (child) { numentries++; child = child->next; }
-    if (!numentries) {
-        if (p) out = ensure(p, 3);
-        else out = (char*)cJSON_malloc(3);
-        if (out) strcpy(out, "[]");
-        return out;
+    if (!print_raw("[", 1, p)) return 0;
+    while (child) {
+        if (!print_value(child, depth + 1, fmt, p)) return 0;
+        if (child->next && !print_raw(", ", fmt ? 2 : 1, p)) return 0;
+        child = child->next;
     }
-    
-    if (p) {
-        size_t needed = 2;
-        ptr = ensure(p, needed + 1);
-        if (!ptr) return NULL;
-        *ptr++ = '[';
-        p->offset++;
-        child = item->child;
-        while (child) {
-            print_value(child, depth + 1, fmt, p);
-            if (child->next) {
-                len = fmt ? 2 : 1;
-                ptr = ensure(p, len + 1);
-                if (!ptr) return NULL;
-                *ptr++ = ',';
-                if (fmt) *ptr++ = ' ';
-                *ptr = 0;
-                p->offset += len;
-            }
-            child = child->next;
-        }
-        ptr = ensure(p, 2);
-        if (!ptr) return NULL;
-        *ptr++ = ']';
-        *ptr = 0;
-        out = p->buffer;
-    } else {
-        entries = (char**)cJSON_malloc(numentries * sizeof(char*));
-        if (!entries) return NULL;
-        memset(entries, 0, numentries * sizeof(char*));
-        child = item->child;
-        while (child && !fail) {
-            ret = print_value(child, depth + 1, fmt, 0);
-            entries[i++] = ret;
-            if (ret) len += strlen(ret) + 2 + (fmt ? 1 : 0);
-            else fail = 1;
-            child = child->next;
-        }
-        if (!fail) out = (char*)cJSON_malloc(len);
-        if (!out) fail = 1;
-        if (fail) {
-            for (i = 0; i < numentries; i++) if (entries[i]) cJSON_free(entries[i]);
-            cJSON_free(entries);
-            return NULL;
-        }
-        *out = '[';
-        ptr = out + 1;
-        *ptr = 0;
-        for (i = 0; i < numentries; i++) {
-            size_t tmplen = strlen(entries[i]);
-            memcpy(ptr, entries[i], tmplen);
-            ptr += tmplen;
-            if (i != numentries - 1) { *ptr++ = ','; if (fmt) *ptr++ = ' '; *ptr = 0; }
-            cJSON_free(entries[i]);
-        }
-        cJSON_free(entries);
-        *ptr++ = ']';
-        *ptr++ = 0;
-    }
-    return out;
+    return print_raw("]", 1, p);
 }
 
 static const char *parse_object(cJSON *item, const char *value) {
@@ -386,117 +443,34 @@ static const char *parse_object(cJSON *item, const char *value) {
     return NULL;
 }
 
-static char *print_object(const cJSON *item, int depth, int fmt, printbuffer *p) {
-    char **entries = NULL, **names = NULL;
-    char *out = NULL, *ptr, *ret, *str;
-    size_t len = 7;
-    int i = 0, j, numentries = 0, fail = 0;
+static int print_object(const cJSON *item, int depth, int fmt, printbuffer *p) {
+    char *ptr;
+    int j;
     cJSON *child = item->child;
     
-    while (child) { numentries++; child = child->next; }
-    if (!numentries) {
-        if (p) out = ensure(p, fmt ? depth + 4 : 3);
-        else out = (char*)cJSON_malloc(fmt ? depth + 4 : 3);
-        if (!out) return NULL;
-        ptr = out;
-        *ptr++ = '{';
-        if (fmt) { *ptr++ = '\n'; for (i = 0; i < depth; i++) *ptr++ = '\t'; }
-        *ptr++ = '}';
-        *ptr = 0;
-        return out;
-    }
-    
-    if (p) {
-        ptr = ensure(p, fmt ? 2 : 1);
-        if (!ptr) return NULL;
-        *ptr++ = '{';
-        if (fmt) *ptr++ = '\n';
-        p->offset += fmt ? 2 : 1;
-        child = item->child;
-        depth++;
-        while (child) {
-            if (fmt) {
-                ptr = ensure(p, depth);
-                if (!ptr) return NULL;
-                for (j = 0; j < depth; j++) *ptr++ = '\t';
-                p->offset += depth;
-            }
-            print_string_ptr(child->string, p);
-            p->offset += strlen(p->buffer + p->offset);
-            ptr = ensure(p, fmt ? 2 : 1);
-            if (!ptr) return NULL;
-            *ptr++ = ':';
-            if (fmt) *ptr++ = '\t';
-            p->offset += fmt ? 2 : 1;
-            print_value(child, depth, fmt, p);
-            p->offset += strlen(p->buffer + p->offset);
-            len = (fmt ? 1 : 0) + (child->next ? 1 : 0);
-            ptr = ensure(p, len + 1);
-            if (!ptr) return NULL;
-            if (child->next) *ptr++ = ',';
-            if (fmt) *ptr++ = '\n';
-            *ptr = 0;
-            p->offset += len;
-            child = child->next;
-        }
-        ptr = ensure(p, fmt ? (depth + 1) : 2);
-        if (!ptr) return NULL;
-        if (fmt) for (i = 0; i < depth - 1; i++) *ptr++ = '\t';
-        *ptr++ = '}';
-        *ptr = 0;
-        out = p->buffer;
-    } else {
-        entries = (char**)cJSON_malloc(numentries * sizeof(char*));
-        if (!entries) return NULL;
-        names = (char**)cJSON_malloc(numentries * sizeof(char*));
-        if (!names) { cJSON_free(entries); return NULL; }
-        memset(entries, 0, sizeof(char*) * numentries);
-        memset(names, 0, sizeof(char*) * numentries);
-        child = item->child;
-        depth++;
-        if (fmt) len += depth;
-        while (child && !fail) {
-            names[i] = str = print_string_ptr(child->string, 0);
-            entries[i++] = ret = print_value(child, depth, fmt, 0);
-            if (str && ret) len += strlen(ret) + strlen(str) + 2 + (fmt ? 2 + depth : 0);
-            else fail = 1;
-            child = child->next;
+    if (!print_raw("{\n", fmt ? 2 : 1, p)) return 0;
+    depth++;
+    while (child) {
+        if (fmt) {
+            ptr = ensure(p, depth);
+            if (!ptr) return 0;
+            for (j = 0; j < depth; j++) *ptr++ = '\t';
+            p->offset += depth;
         }
-        if (!fail) out = (char*)cJSON_malloc(len);
-        if (!out) fail = 1;
-        if (fail) {
-            for (i = 0; i < numentries; i++) { if (names[i]) cJSON_free(names[i]); if (entries[i]) cJSON_free(entries[i]); }
-            cJSON_free(names);
-            cJSON_free(entries);
-            return NULL;
-        }
-        *out = '{';
-        ptr = out + 1;
-        if (fmt) *ptr++ = '\n';
-        *ptr = 0;
-        for (i = 0; i < numentries; i++) {
-            if (fmt) for (j = 0; j < depth; j++) *ptr++ = '\t';
-            size_t tmplen = strlen(names[i]);
-            memcpy(ptr, names[i], tmplen);
-            ptr += tmplen;
-            *ptr++ = ':';
-            if (fmt) *ptr++ = '\t';
-            tmplen = strlen(entries[i]);
-            memcpy(ptr, entries[i], tmplen);
-            ptr += tmplen;
-            if (i != numentries - 1) *ptr++ = ',';
-            if (fmt) *ptr++ = '\n';
-            *ptr = 0;
-            cJSON_free(names[i]);
-            cJSON_free(entries[i]);
-        }
-        cJSON_free(names);
-        cJSON_free(entries);
-        if (fmt) for (i = 0; i < depth - 1; i++) *ptr++ = '\t';
-        *ptr++ = '}';
-        *ptr = 0;
+        if (!print_string_ptr(child->string, p)) return 0;
+        if (!print_raw(":\t", fmt ? 2 : 1, p)) return 0;
+        if (!print_value(child, depth, fmt, p)) return 0;
+        if (child->next && !print_raw(",", 1, p)) return 0;
+        if (fmt && !print_raw("\n", 1, p)) return 0;
+        child = child->next;
     }
-    return out;
+    
+    ptr = ensure(p, depth);
+    if (!ptr) return 0;
+    if (fmt) for (j = 0; j < depth - 1; j++) *ptr++ = '\t';
+    *ptr = '}';
+    p->offset += fmt ? depth : 1;
+    return 1;
 }
 
 static const char *parse_value(cJSON *item, const char *value) {
@@ -511,31 +485,18 @@ static const char *parse_value(cJSON *item, const char *value) {
     return NULL;
 }
 
-static char *print_value(const cJSON *item, int depth, int fmt, printbuffer *p) {
-    char *out = NULL;
-    if (!item) return NULL;
-    if (p) {
-        switch ((item->type) & 0xFF) {
-            case cJSON_NULL: out = ensure(p, 5); if (out) strcpy(out, "null"); break;
-            case cJSON_False: out = ensure(p, 6); if (out) strcpy(out, "false"); break;
-            case cJSON_True: out = ensure(p, 5); if (out) strcpy(out, "true"); break;
-            case cJSON_Number: out = print_number(item, p); break;
-            case cJSON_String: out = print_string(item, p); break;
-            case cJSON_Array: out = print_array(item, depth, fmt, p); break;
-            case cJSON_Object: out = print_object(item, depth, fmt, p); break;
-        }
-    } else {
-        switch ((item->type) & 0xFF) {
-            case cJSON_NULL: out = cJSON_strdup("null"); break;
-            case cJSON_False: out = cJSON_strdup("false"); break;
-            case cJSON_True: out = cJSON_strdup("true"); break;
-            case cJSON_Number: out = print_number(item, 0); break;
-            case cJSON_String: out = print_string(item, 0); break;
-            case cJSON_Array: out = print_array(item, depth, fmt, 0); break;
-            case cJSON_Object: out = print_object(item, depth, fmt, 0); break;
-        }
+static int print_value(const cJSON *item, int depth, int fmt, printbuffer *p) {
+    if (!item) return 0;
+    switch ((item->type) & 0xFF) {
+        case cJSON_NULL: return print_raw("null", 4, p);
+        case cJSON_False: return print_raw("false", 5, p);
+        case cJSON_True: return print_raw("true", 4, p);
+        case cJSON_Number: return print_number(item, p);
+        case cJSON_String: return print_string(item, p);
+        case cJSON_Array: return print_array(item, depth, fmt, p);
+        case cJSON_Object: return print_object(item, depth, fmt, p);
     }
-    return out;
+    return 0;
 }
 
 cJSON *cJSON_Parse(const char *value) {
@@ -545,8 +506,29 @@ cJSON *cJSON_Parse(const char *value) {
     return c;
 }
 
-char *cJSON_Print(const cJSON *item) { return print_value(item, 0, 1, 0); }
-char *cJSON_PrintUnformatted(const cJSON *item) { return print_value(item, 0, 0, 0); }
+static char *print_root(const cJSON *item, int fmt) {
+    printbuffer p;
+    char *out;
+    
+    p.length = 256;
+    p.offset = 0;
+    p.buffer = (char*)cjson_alloc(p.length);
+    if (!p.buffer) return NULL;
+    if (!print_value(item, 0, fmt, &p) || !ensure(&p, 1)) {
+        cjson_release(p.buffer);
+        return NULL;
+    }
+    p.buffer[p.offset] = '\0';
+    if (!current_arena) return p.buffer;
+    
+    /* Printed text outlives the arena: hand back a single heap copy */
+    out = (char*)heap_alloc(p.offset + 1);
+    if (out) memcpy(out, p.buffer, p.offset + 1);
+    return out;
+}
+
+char *cJSON_Print(const cJSON *item) { return print_root(item, 1); }
+char *cJSON_PrintUnformatted(const cJSON *item) { return print_root(item, 0); }
 
 int cJSON_GetArraySize(const cJSON *array) {
     cJSON *c = array ? array->child : NULL;
@@ -621,7 +603,7 @@ void cJSON_AddItemToArray(cJSON *array, cJSON *item) {
 
 void cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item) {
     if (!item) return;
-    if (item->string) cJSON_free(item->string);
+    if (item->string) cjson_release(item->string);
     item->string = cJSON_strdup(string);
     cJSON_AddItemToArray(object, item);
 }
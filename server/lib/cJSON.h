@@ -69,6 +69,28 @@ typedef struct cJSON_Hooks
 /* Supply malloc, realloc and free functions to cJSON */
 extern void cJSON_InitHooks(cJSON_Hooks* hooks);
 
+/* Per-thread bump arena. While an arena is in use on a thread, every node and
+   string cJSON allocates on that thread is carved from it, and cJSON_Delete
+   on them is a no-op: the tree lives until cJSON_ArenaReset. Trees built in
+   an arena must not outlive that reset. Printed strings are always plain
+   heap memory (free them as usual). */
+typedef struct cJSON_Arena cJSON_Arena;
+
+extern cJSON_Arena *cJSON_ArenaCreate(size_t block_size);
+extern void cJSON_ArenaDestroy(cJSON_Arena *arena);
+extern void cJSON_ArenaReset(cJSON_Arena *arena);
+/* Routes the calling thread's allocations to arena (NULL for the heap), returns the previous one */
+extern cJSON_Arena *cJSON_ArenaUse(cJSON_Arena *arena);
+
+/* Allocation counters, process-wide. Arena allocations are added on reset. */
+typedef struct cJSON_AllocStats
+{
+    unsigned long long heap_allocs;
+    unsigned long long arena_allocs;
+} cJSON_AllocStats;
+
+extern void cJSON_GetAllocStats(cJSON_AllocStats *stats);
+
 /* Memory Management: the caller is always responsible to free the results from all variants of cJSON_Parse and cJSON_Print. */
 extern cJSON *cJSON_Parse(const char *value);
 extern char  *cJSON_Print(const cJSON *item);
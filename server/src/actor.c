@@ -0,0 +1,342 @@
+#include "actor.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#define ACTOR_BATCH_LIMIT 64       /**< Messages handled before a busy actor yields its worker */
+
+// Inbox of an actor that is queued or running, with no message posted
+// since its handler last emptied the inbox
+static ActorMsg running_marker;
+#define ACTOR_RUNNING (&running_marker)
+
+static __thread ActorWorker *current_worker;
+
+/**
+ * Initializes an idle actor.
+ * @param actor Actor to initialize
+ * @param handler Function receiving its messages
+ */
+void actor_init(Actor *actor, ActorFn handler) {
+    memset(actor, 0, sizeof(Actor));
+    actor->handler = handler;
+}
+
+/**
+ * Tells whether an actor has no message left and is not queued or running.
+ * Once an actor can receive no new message, an idle actor is never
+ * touched by the pool again and its memory can be reused.
+ * @param actor Actor to check
+ * @return true if idle
+ */
+bool actor_idle(const Actor *actor) {
+    return __atomic_load_n(&actor->inbox, __ATOMIC_ACQUIRE) == NULL;
+}
+
+/**
+ * Marks an actor finished. Called from its own handler once no new message
+ * can be posted to it: when the messages already posted are handled, the
+ * worker calls release as its last access to the actor, so release may
+ * free or reuse the actor's memory.
+ * @param actor Actor whose handler is running
+ * @param release Called with the pool context once the inbox drains
+ */
+void actor_finish(Actor *actor, ActorReleaseFn release) {
+    actor->release = release;
+}
+
+/**
+ * Queues an actor on a worker's deque.
+ * @param worker Worker owning the deque
+ * @param actor Actor with pending messages, in no deque
+ * @param oldest Queue it behind the others (yield) instead of next up
+ */
+static void deque_push(ActorWorker *worker, Actor *actor, bool oldest) {
+    pthread_mutex_lock(&worker->mutex);
+    if (oldest) {
+        actor->older = NULL;
+        actor->newer = worker->oldest;
+        if (worker->oldest) worker->oldest->older = actor;
+        else worker->newest = actor;
+        worker->oldest = actor;
+    } else {
+        actor->newer = NULL;
+        actor->older = worker->newest;
+        if (worker->newest) worker->newest->newer = actor;
+        else worker->oldest = actor;
+        worker->newest = actor;
+    }
+    __atomic_add_fetch(&worker->pool->queued, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+/**
+ * Takes an actor off a worker's deque.
+ * @param worker Worker owning the deque
+ * @param newest Owner side (newest) or thief side (oldest)
+ * @return Actor, NULL if the deque is empty
+ */
+static Actor* deque_pop(ActorWorker *worker, bool newest) {
+    pthread_mutex_lock(&worker->mutex);
+    Actor *actor = newest ? worker->newest : worker->oldest;
+    if (actor) {
+        if (newest) {
+            worker->newest = actor->older;
+            if (worker->newest) worker->newest->newer = NULL;
+            else worker->oldest = NULL;
+        } else {
+            worker->oldest = actor->newer;
+            if (worker->oldest) worker->oldest->older = NULL;
+            else worker->newest = NULL;
+        }
+        __atomic_sub_fetch(&worker->pool->queued, 1, __ATOMIC_SEQ_CST);
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return actor;
+}
+
+/**
+ * Queues an actor that just received its first pending message, on the
+ * posting worker's own deque when called from the pool, and wakes a
+ * sleeping worker.
+ * @param pool Pool running the actor
+ * @param actor Actor to queue
+ */
+static void schedule(ActorPool *pool, Actor *actor) {
+    ActorWorker *worker = current_worker;
+    if (!worker || worker->pool != pool) {
+        if (pool->num_workers == 0) return;
+        unsigned int next = (unsigned int)__atomic_fetch_add(&pool->next_worker, 1, __ATOMIC_RELAXED);
+        worker = &pool->workers[next % (unsigned int)pool->num_workers];
+    }
+    deque_push(worker, actor, false);
+
+    // Pairs with the check of queued by workers going to sleep
+    if (__atomic_load_n(&pool->sleeping, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->idle_mutex);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->idle_mutex);
+    }
+}
+
+/**
+ * Posts a message to an actor (any thread, lock-free). The message is
+ * handled after every message posted before it, then freed by the pool.
+ * @param pool Pool running the actor
+ * @param actor Destination
+ * @param msg malloc'ed message, starting with its ActorMsg header
+ */
+void actor_post(ActorPool *pool, Actor *actor, ActorMsg *msg) {
+    ActorMsg *head = __atomic_load_n(&actor->inbox, __ATOMIC_RELAXED);
+    do {
+        msg->next = head;
+    } while (!__atomic_compare_exchange_n(&actor->inbox, &head, msg, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    // The message that finds the actor idle is the one queuing it
+    if (head == NULL) {
+        schedule(pool, actor);
+    }
+}
+
+/**
+ * Handles the pending messages of an actor until its inbox stays empty,
+ * or requeues it behind the other actors after ACTOR_BATCH_LIMIT messages.
+ * @param pool Pool running the actor
+ * @param self Worker running it
+ * @param actor Actor taken off a deque
+ */
+static void run_actor(ActorPool *pool, ActorWorker *self, Actor *actor) {
+    int handled = 0;
+    for (;;) {
+        ActorMsg *batch = __atomic_exchange_n(&actor->inbox, ACTOR_RUNNING, __ATOMIC_ACQUIRE);
+
+        // The inbox is newest first: reverse it to handle in posting order
+        ActorMsg *pending = NULL;
+        while (batch && batch != ACTOR_RUNNING) {
+            ActorMsg *next = batch->next;
+            batch->next = pending;
+            pending = batch;
+            batch = next;
+        }
+        while (pending) {
+            ActorMsg *next = pending->next;
+            actor->handler(pool->context, actor, pending);
+            free(pending);
+            pending = next;
+            handled++;
+        }
+
+        // Last access to the actor when nothing was posted meanwhile; a
+        // finished actor gets no new message, so it is handed to release
+        ActorReleaseFn release = actor->release;
+        ActorMsg *expected = ACTOR_RUNNING;
+        if (__atomic_compare_exchange_n(&actor->inbox, &expected, NULL, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            if (release) release(pool->context, actor);
+            return;
+        }
+        if (handled >= ACTOR_BATCH_LIMIT) {
+            deque_push(self, actor, true);
+            return;
+        }
+    }
+}
+
+/**
+ * Takes the next actor to run: the newest on the worker's own deque,
+ * else the oldest on another worker's deque.
+ * @param self Worker looking for work
+ * @return Actor, NULL if every deque is empty
+ */
+static Actor* find_work(ActorWorker *self) {
+    Actor *actor = deque_pop(self, true);
+    if (actor) return actor;
+
+    ActorPool *pool = self->pool;
+    int me = (int)(self - pool->workers);
+    for (int i = 1; i < pool->num_workers && !actor; i++) {
+        actor = deque_pop(&pool->workers[(me + i) % pool->num_workers], false);
+    }
+    return actor;
+}
+
+/**
+ * Worker loop: runs queued actors, steals when its deque is empty and
+ * sleeps when every deque is.
+ * @param arg The worker's ActorWorker
+ * @return NULL when the pool stops
+ */
+static void* actor_worker_thread(void *arg) {
+    ActorWorker *self = (ActorWorker*)arg;
+    ActorPool *pool = self->pool;
+    current_worker = self;
+
+    while (__atomic_load_n(&pool->running, __ATOMIC_ACQUIRE)) {
+        Actor *actor = find_work(self);
+        if (actor) {
+            run_actor(pool, self, actor);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->idle_mutex);
+        __atomic_add_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 && pool->running) {
+            pthread_cond_wait(&pool->wake, &pool->idle_mutex);
+        }
+        __atomic_sub_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->idle_mutex);
+    }
+    return NULL;
+}
+
+/**
+ * Prepares an empty pool; no thread runs before actorpool_start.
+ * @param pool Pool to initialize
+ * @param name Log tag (static string)
+ * @param context Passed to every handler
+ * @return 0 on success
+ */
+int actorpool_init(ActorPool *pool, const char *name, void *context) {
+    memset(pool, 0, sizeof(ActorPool));
+    pool->name = name;
+    pool->context = context;
+    pthread_mutex_init(&pool->idle_mutex, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    return 0;
+}
+
+/**
+ * Stops and joins the first started workers.
+ * @param pool Pool being stopped
+ * @param started Number of workers whose thread is running
+ */
+static void join_workers(ActorPool *pool, int started) {
+    pthread_mutex_lock(&pool->idle_mutex);
+    __atomic_store_n(&pool->running, false, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->idle_mutex);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+}
+
+/**
+ * Allocates the workers on cache-line boundaries, so no two deques share
+ * a line. The MSVC runtime mingw links against has no aligned_alloc.
+ * @param num_workers Number of workers
+ * @return Workers, NULL on allocation failure
+ */
+static ActorWorker* alloc_workers(int num_workers) {
+    size_t size = (size_t)num_workers * sizeof(ActorWorker);
+#ifdef _WIN32
+    return _aligned_malloc(size, 64);
+#else
+    return aligned_alloc(64, size);
+#endif
+}
+
+/**
+ * Releases workers allocated by alloc_workers.
+ * @param workers Workers to free
+ */
+static void free_workers(ActorWorker *workers) {
+#ifdef _WIN32
+    _aligned_free(workers);
+#else
+    free(workers);
+#endif
+}
+
+/**
+ * Starts the worker threads, one deque each.
+ * @param pool Initialized pool
+ * @param num_workers Number of workers (at least 1)
+ * @return 0 on success, -1 if the workers could not all be started
+ */
+int actorpool_start(ActorPool *pool, int num_workers) {
+    if (num_workers < 1) num_workers = 1;
+    pool->workers = alloc_workers(num_workers);
+    if (!pool->workers) return -1;
+
+    memset(pool->workers, 0, (size_t)num_workers * sizeof(ActorWorker));
+    for (int i = 0; i < num_workers; i++) {
+        pthread_mutex_init(&pool->workers[i].mutex, NULL);
+        pool->workers[i].pool = pool;
+    }
+
+    pool->num_workers = num_workers;
+    pool->running = true;
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, actor_worker_thread, &pool->workers[i]) != 0) {
+            join_workers(pool, i);
+            pool->num_workers = 0;
+            free_workers(pool->workers);
+            pool->workers = NULL;
+            return -1;
+        }
+    }
+
+    log_msg(pool->name, "Actor pool started (%d worker(s))", num_workers);
+    return 0;
+}
+
+/**
+ * Stops the workers after the message each is handling and joins them.
+ * Actors still queued keep their messages, unhandled.
+ * @param pool Pool to stop
+ */
+void actorpool_stop(ActorPool *pool) {
+    if (!__atomic_load_n(&pool->running, __ATOMIC_ACQUIRE)) return;
+    join_workers(pool, pool->num_workers);
+
+    int queued = __atomic_load_n(&pool->queued, __ATOMIC_RELAXED);
+    if (queued > 0) {
+        log_warn(pool->name, "Actor pool stopped with %d actor(s) still queued", queued);
+    }
+}
@@ -0,0 +1,498 @@
+#include "binproto.h"
+#include "endpoints.h"
+#include "types.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BIN_REQUEST(id, method, path, handler, flags, rate_class) { id, #method, path },
+
+// Wire ids: requests below BINPROTO_FIRST_PUSH_ID (the endpoint registry
+// ids, checked in endpoints.c), server pushes from it. Never renumber.
+static const BinMessage binproto_messages[] = {
+    ENDPOINT_LIST(BIN_REQUEST)
+    { 32, NULL, "session/started" },
+    { 33, NULL, "question/new" },
+    { 34, NULL, "question/results" },
+    { 35, NULL, "session/finished" },
+    { 36, NULL, "session/player/joined" },
+    { 37, NULL, "session/player/left" },
+    { 38, NULL, "session/player/eliminated" },
+};
+
+#define BINPROTO_NUM_MESSAGES (int)(sizeof(binproto_messages) / sizeof(binproto_messages[0]))
+
+/**
+ * Looks up a message by wire id.
+ * @param id Message id from a frame header
+ * @return Registered message, NULL if unknown
+ */
+const BinMessage* binproto_message(int id) {
+    for (int i = 0; i < BINPROTO_NUM_MESSAGES; i++) {
+        if (binproto_messages[i].id == id) return &binproto_messages[i];
+    }
+    return NULL;
+}
+
+/**
+ * Looks up the wire id of an endpoint or action name.
+ * @param name Endpoint or action (e.g. "question/new")
+ * @return Message id, 0 if the name has none
+ */
+int binproto_id(const char *name) {
+    for (int i = 0; i < BINPROTO_NUM_MESSAGES; i++) {
+        if (strcmp(binproto_messages[i].name, name) == 0) return binproto_messages[i].id;
+    }
+    return 0;
+}
+
+/**
+ * Reads the payload length of a frame.
+ * @param header At least BINPROTO_HEADER_LEN bytes
+ * @return Payload length in bytes
+ */
+size_t binproto_payload_length(const char *header) {
+    const unsigned char *h = (const unsigned char *)header;
+    return ((size_t)h[0] << 24) | ((size_t)h[1] << 16) | ((size_t)h[2] << 8) | h[3];
+}
+
+/**
+ * Reads the message id of a frame.
+ * @param header At least BINPROTO_HEADER_LEN bytes
+ * @return Message id
+ */
+int binproto_message_id(const char *header) {
+    const unsigned char *h = (const unsigned char *)header;
+    return (h[4] << 8) | h[5];
+}
+
+/* ============================================================================
+ * Decoding (MessagePack request payload -> cJSON)
+ * ============================================================================ */
+
+typedef struct {
+    const unsigned char *pos;      /**< Next byte to decode */
+    const unsigned char *end;      /**< End of the payload */
+} Reader;
+
+// Strings are copied here to be NUL-terminated before cJSON duplicates them
+static __thread char decode_text[MAX_MESSAGE_LEN + 1];
+
+static bool read_uint(Reader *r, int bytes, uint64_t *value) {
+    if (r->end - r->pos < bytes) return false;
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v = (v << 8) | *r->pos++;
+    *value = v;
+    return true;
+}
+
+static const char* read_text(Reader *r, uint64_t len) {
+    if ((uint64_t)(r->end - r->pos) < len || len > MAX_MESSAGE_LEN) return NULL;
+    memcpy(decode_text, r->pos, (size_t)len);
+    decode_text[len] = '\0';
+    r->pos += len;
+    return decode_text;
+}
+
+static cJSON* decode_value(Reader *r, int depth);
+
+/**
+ * Decodes a map key into a NUL-terminated copy.
+ * @param r Reader positioned on the key
+ * @param name Output buffer
+ * @param size Size of name
+ * @return true on success, false if the key is not a string or too long
+ */
+static bool decode_key(Reader *r, char *name, size_t size) {
+    if (r->pos >= r->end) return false;
+
+    uint8_t tag = *r->pos++;
+    uint64_t len;
+    if ((tag & 0xe0) == 0xa0) {
+        len = tag & 0x1f;
+    } else if (tag < 0xd9 || tag > 0xdb || !read_uint(r, 1 << (tag - 0xd9), &len)) {
+        return false;
+    }
+    if (len >= size || (uint64_t)(r->end - r->pos) < len) return false;
+
+    memcpy(name, r->pos, (size_t)len);
+    name[len] = '\0';
+    r->pos += len;
+    return true;
+}
+
+/**
+ * Decodes the members of a map into a new object.
+ * @param r Reader positioned after the map header
+ * @param count Number of key/value pairs
+ * @param depth Current nesting depth
+ * @return Object, NULL if malformed
+ */
+static cJSON* decode_map(Reader *r, uint64_t count, int depth) {
+    cJSON *object = cJSON_CreateObject();
+
+    for (uint64_t i = 0; object && i < count; i++) {
+        char name[64];
+        cJSON *value = NULL;
+        if (decode_key(r, name, sizeof(name))) {
+            value = decode_value(r, depth + 1);
+        }
+        if (!value) {
+            cJSON_Delete(object);
+            return NULL;
+        }
+        cJSON_AddItemToObject(object, name, value);
+    }
+    return object;
+}
+
+/**
+ * Decodes one MessagePack value. Binary and extension types are refused.
+ * @param r Reader
+ * @param depth Current nesting depth
+ * @return Decoded value, NULL if malformed or too deep
+ */
+static cJSON* decode_value(Reader *r, int depth) {
+    if (depth > BINPROTO_MAX_DEPTH || r->pos >= r->end) return NULL;
+
+    uint8_t tag = *r->pos++;
+    uint64_t n;
+
+    if (tag <= 0x7f) return cJSON_CreateNumber(tag);
+    if (tag >= 0xe0) return cJSON_CreateNumber((int8_t)tag);
+    if ((tag & 0xf0) == 0x80) return decode_map(r, tag & 0x0f, depth);
+    if ((tag & 0xe0) == 0xa0) {
+        const char *text = read_text(r, tag & 0x1f);
+        return text ? cJSON_CreateString(text) : NULL;
+    }
+
+    bool is_array = (tag & 0xf0) == 0x90;
+    if (is_array || tag == 0xdc || tag == 0xdd) {
+        if (is_array) {
+            n = tag & 0x0f;
+        } else if (!read_uint(r, tag == 0xdc ? 2 : 4, &n)) {
+            return NULL;
+        }
+
+        cJSON *array = cJSON_CreateArray();
+        for (uint64_t i = 0; array && i < n; i++) {
+            cJSON *item = decode_value(r, depth + 1);
+            if (!item) {
+                cJSON_Delete(array);
+                return NULL;
+            }
+            cJSON_AddItemToArray(array, item);
+        }
+        return array;
+    }
+
+    switch (tag) {
+        case 0xc0: return cJSON_CreateNull();
+        case 0xc2: return cJSON_CreateFalse();
+        case 0xc3: return cJSON_CreateTrue();
+        case 0xcc: case 0xcd: case 0xce: case 0xcf:
+            if (!read_uint(r, 1 << (tag - 0xcc), &n)) return NULL;
+            return cJSON_CreateNumber((double)n);
+        case 0xd0:
+            if (!read_uint(r, 1, &n)) return NULL;
+            return cJSON_CreateNumber((int8_t)n);
+        case 0xd1:
+            if (!read_uint(r, 2, &n)) return NULL;
+            return cJSON_CreateNumber((int16_t)n);
+        case 0xd2:
+            if (!read_uint(r, 4, &n)) return NULL;
+            return cJSON_CreateNumber((int32_t)n);
+        case 0xd3:
+            if (!read_uint(r, 8, &n)) return NULL;
+            return cJSON_CreateNumber((double)(int64_t)n);
+        case 0xca: {
+            if (!read_uint(r, 4, &n)) return NULL;
+            uint32_t bits = (uint32_t)n;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return cJSON_CreateNumber(f);
+        }
+        case 0xcb: {
+            if (!read_uint(r, 8, &n)) return NULL;
+            double d;
+            memcpy(&d, &n, sizeof(d));
+            return cJSON_CreateNumber(d);
+        }
+        case 0xd9: case 0xda: case 0xdb: {
+            if (!read_uint(r, 1 << (tag - 0xd9), &n)) return NULL;
+            const char *text = read_text(r, n);
+            return text ? cJSON_CreateString(text) : NULL;
+        }
+        case 0xde: case 0xdf:
+            if (!read_uint(r, tag == 0xde ? 2 : 4, &n)) return NULL;
+            return decode_map(r, n, depth);
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Decodes a request payload into the tree the handlers expect.
+ * @param payload MessagePack bytes (a single map)
+ * @param len Payload length
+ * @return Object, NULL if the payload is malformed, not a map or has trailing bytes
+ */
+cJSON* binproto_decode(const char *payload, size_t len) {
+    Reader r = { (const unsigned char *)payload, (const unsigned char *)payload + len };
+    cJSON *json = decode_value(&r, 0);
+    if (json && (!cJSON_IsObject(json) || r.pos != r.end)) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+    return json;
+}
+
+/* ============================================================================
+ * Encoding (JSON message -> frame)
+ * ============================================================================ */
+
+typedef struct {
+    MsgBuf *buf;                   /**< Frame being built, NULL once failed */
+    size_t cap;                    /**< Bytes available in buf->data */
+} Writer;
+
+static unsigned char* writer_reserve(Writer *w, size_t extra) {
+    if (!w->buf) return NULL;
+    if (w->buf->len + extra > w->cap) {
+        size_t cap = w->cap * 2;
+        while (cap < w->buf->len + extra) cap *= 2;
+        MsgBuf *grown = realloc(w->buf, sizeof(MsgBuf) + cap);
+        if (!grown) {
+            free(w->buf);
+            w->buf = NULL;
+            return NULL;
+        }
+        w->buf = grown;
+        w->cap = cap;
+    }
+    return (unsigned char *)w->buf->data + w->buf->len;
+}
+
+/**
+ * Appends a type byte followed by a big-endian integer.
+ * @param w Writer
+ * @param tag MessagePack type byte
+ * @param value Integer to write
+ * @param bytes Width of the integer (0 for the tag alone)
+ */
+static void write_tagged(Writer *w, uint8_t tag, uint64_t value, int bytes) {
+    unsigned char *out = writer_reserve(w, 1 + bytes);
+    if (!out) return;
+    out[0] = tag;
+    for (int i = 0; i < bytes; i++) {
+        out[1 + i] = (unsigned char)(value >> (8 * (bytes - 1 - i)));
+    }
+    w->buf->len += 1 + bytes;
+}
+
+/**
+ * Writes a collection or string header with the smallest encoding.
+ * @param w Writer
+ * @param fix Fixed-size tag base (0xa0 fixstr, 0x90 fixarray, 0x80 fixmap)
+ * @param fix_max Largest count the fixed form holds
+ * @param tag8 Tag of the 8-bit form, 0 if the type has none
+ * @param tag16 Tag of the 16-bit form (the 32-bit tag follows it)
+ * @param n Length or element count
+ */
+static void write_header(Writer *w, uint8_t fix, uint64_t fix_max, uint8_t tag8, uint8_t tag16, uint64_t n) {
+    if (n <= fix_max) write_tagged(w, (uint8_t)(fix | n), 0, 0);
+    else if (tag8 && n <= 0xff) write_tagged(w, tag8, n, 1);
+    else if (n <= 0xffff) write_tagged(w, tag16, n, 2);
+    else write_tagged(w, tag16 + 1, n, 4);
+}
+
+static void write_string(Writer *w, const char *str) {
+    size_t len = str ? strlen(str) : 0;
+    write_header(w, 0xa0, 31, 0xd9, 0xda, len);
+    unsigned char *out = writer_reserve(w, len);
+    if (!out) return;
+    memcpy(out, str, len);
+    w->buf->len += len;
+}
+
+/**
+ * Writes a number: integral values as the smallest integer, others as float64.
+ * @param w Writer
+ * @param d Number to write
+ */
+static void write_number(Writer *w, double d) {
+    if (d >= -9.2e18 && d <= 9.2e18 && d == (double)(int64_t)d) {
+        int64_t v = (int64_t)d;
+        if (v >= 0) {
+            if (v <= 0x7f) write_tagged(w, (uint8_t)v, 0, 0);
+            else if (v <= 0xff) write_tagged(w, 0xcc, (uint64_t)v, 1);
+            else if (v <= 0xffff) write_tagged(w, 0xcd, (uint64_t)v, 2);
+            else if (v <= 0xffffffffLL) write_tagged(w, 0xce, (uint64_t)v, 4);
+            else write_tagged(w, 0xcf, (uint64_t)v, 8);
+        } else {
+            if (v >= -32) write_tagged(w, (uint8_t)v, 0, 0);
+            else if (v >= INT8_MIN) write_tagged(w, 0xd0, (uint64_t)v, 1);
+            else if (v >= INT16_MIN) write_tagged(w, 0xd1, (uint64_t)v, 2);
+            else if (v >= INT32_MIN) write_tagged(w, 0xd2, (uint64_t)v, 4);
+            else write_tagged(w, 0xd3, (uint64_t)v, 8);
+        }
+        return;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    write_tagged(w, 0xcb, bits, 8);
+}
+
+static void write_value(Writer *w, const cJSON *item, const char *skip_key) {
+    if (cJSON_IsObject(item) || cJSON_IsArray(item)) {
+        uint64_t count = 0;
+        for (const cJSON *c = item->child; c; c = c->next) {
+            if (!skip_key || !c->string || strcmp(c->string, skip_key) != 0) count++;
+        }
+
+        if (cJSON_IsObject(item)) write_header(w, 0x80, 15, 0, 0xde, count);
+        else write_header(w, 0x90, 15, 0, 0xdc, count);
+
+        for (const cJSON *c = item->child; c; c = c->next) {
+            if (cJSON_IsObject(item)) {
+                if (skip_key && c->string && strcmp(c->string, skip_key) == 0) continue;
+                write_string(w, c->string);
+            }
+            write_value(w, c, NULL);
+        }
+    } else if (cJSON_IsString(item) || cJSON_IsRaw(item)) {
+        write_string(w, item->valuestring);
+    } else if (cJSON_IsNumber(item)) {
+        write_number(w, item->valuedouble);
+    } else if (cJSON_IsTrue(item)) {
+        write_tagged(w, 0xc3, 0, 0);
+    } else if (cJSON_IsFalse(item)) {
+        write_tagged(w, 0xc2, 0, 0);
+    } else {
+        write_tagged(w, 0xc0, 0, 0);
+    }
+}
+
+/**
+ * Starts an output buffer.
+ * @param w Writer to initialize
+ * @param cap Initial capacity, grown as needed
+ * @param reserved Bytes left at the start (the frame header)
+ */
+static void writer_init(Writer *w, size_t cap, size_t reserved) {
+    w->cap = cap > reserved ? cap : reserved + 16;
+    w->buf = malloc(sizeof(MsgBuf) + w->cap);
+    if (w->buf) {
+        w->buf->refcount = 1;
+        w->buf->binary = NULL;
+        w->buf->len = reserved;
+    }
+}
+
+/**
+ * Fills in the frame header once the payload is written.
+ * @param w Writer started with BINPROTO_HEADER_LEN reserved
+ * @param id Message id
+ * @return The frame, NULL if an allocation failed
+ */
+static MsgBuf* writer_finish_frame(Writer *w, int id) {
+    if (!w->buf) return NULL;
+
+    size_t payload = w->buf->len - BINPROTO_HEADER_LEN;
+    unsigned char *header = (unsigned char *)w->buf->data;
+    header[0] = (unsigned char)(payload >> 24);
+    header[1] = (unsigned char)(payload >> 16);
+    header[2] = (unsigned char)(payload >> 8);
+    header[3] = (unsigned char)payload;
+    header[4] = (unsigned char)(id >> 8);
+    header[5] = (unsigned char)id;
+    return w->buf;
+}
+
+/**
+ * Re-encodes a text message as a binary frame.
+ * The "action" field becomes the message id when it has one.
+ * @param text Encoded JSON line (NUL-terminated, see MsgBuf)
+ * @return Frame with one reference, NULL if the message is not a JSON object
+ */
+MsgBuf* binproto_encode(const MsgBuf *text) {
+    cJSON *json = cJSON_Parse(text->data);
+    if (!json || !cJSON_IsObject(json)) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+
+    cJSON *action = cJSON_GetObjectItem(json, "action");
+    int id = cJSON_IsString(action) ? binproto_id(action->valuestring) : 0;
+
+    Writer w;
+    writer_init(&w, text->len + BINPROTO_HEADER_LEN, BINPROTO_HEADER_LEN);
+    write_value(&w, json, id ? "action" : NULL);
+    cJSON_Delete(json);
+    return writer_finish_frame(&w, id);
+}
+
+/**
+ * Transcodes object members to MessagePack key/value pairs, without a map
+ * header, so that members shared by many messages are transcoded once and
+ * spliced into each frame with binproto_frame.
+ * @param fields Comma-separated "key":value pairs, as spliced by jsonw_fields
+ * @param len Length of fields
+ * @param count Output, number of pairs
+ * @return Pairs with one reference (not a frame), NULL if malformed or on allocation failure
+ */
+MsgBuf* binproto_encode_fields(const char *fields, size_t len, int *count) {
+    char *object = malloc(len + 3);
+    if (!object) return NULL;
+    object[0] = '{';
+    memcpy(object + 1, fields, len);
+    object[len + 1] = '}';
+    object[len + 2] = '\0';
+
+    cJSON *json = cJSON_Parse(object);
+    free(object);
+    if (!json || !cJSON_IsObject(json)) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+
+    Writer w;
+    writer_init(&w, len, 0);
+    *count = 0;
+    for (const cJSON *c = json->child; c; c = c->next) {
+        write_string(&w, c->string);
+        write_value(&w, c, NULL);
+        (*count)++;
+    }
+    cJSON_Delete(json);
+    return w.buf;
+}
+
+/**
+ * Assembles a frame whose map is the concatenation of pre-encoded pairs.
+ * @param id Message id (0 if the message has none, its pairs then hold "action")
+ * @param parts Pairs from binproto_encode_fields
+ * @param counts Number of pairs in each part
+ * @param num_parts Number of parts
+ * @return Frame with one reference, NULL on allocation failure
+ */
+MsgBuf* binproto_frame(int id, MsgBuf *const *parts, const int *counts, int num_parts) {
+    size_t len = 0;
+    uint64_t count = 0;
+    for (int i = 0; i < num_parts; i++) {
+        len += parts[i]->len;
+        count += (uint64_t)counts[i];
+    }
+
+    Writer w;
+    writer_init(&w, BINPROTO_HEADER_LEN + 5 + len, BINPROTO_HEADER_LEN);
+    write_header(&w, 0x80, 15, 0, 0xde, count);
+    for (int i = 0; i < num_parts; i++) {
+        unsigned char *out = writer_reserve(&w, parts[i]->len);
+        if (!out) break;
+        memcpy(out, parts[i]->data, parts[i]->len);
+        w.buf->len += parts[i]->len;
+    }
+    return writer_finish_frame(&w, id);
+}
@@ -28,7 +28,7 @@ void send_discovery_response(ServerState* state,
   snprintf(response, sizeof(response), "hello i'm a quiznet server:%s:%d",
            state->server_name, state->tcp_port);
 
-  log_msg("DISCOVER", "Sending response: '%s'", response);
+  log_debug("DISCOVER", "Sending response: '%s'", response);
   sendto(state->udp_socket, response, strlen(response), 0,
          (struct sockaddr*)client_addr, addr_len);
 }
@@ -55,16 +55,16 @@ void* udp_discovery_handler(void* arg) {
 
     if (received > 0) {
       buffer[received] = '\0';
-      log_msg("DISCOVER", "Received %d bytes from %s:%d: '%s'", received,
-             inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port),
-             buffer);
+      log_debug("DISCOVER", "Received %d bytes from %s:%d: '%s'", received,
+               inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port),
+               buffer);
 
       // Check for discovery request
       if (strcmp(buffer, "looking for quiznet servers") == 0) {
-        log_msg("DISCOVER", "Discovery request received");
+        log_debug("DISCOVER", "Discovery request received");
         send_discovery_response(state, &client_addr, addr_len);
       } else
-        log_msg("DISCOVER", "Unknown message, ignoring");
+        log_debug("DISCOVER", "Unknown message, ignoring");
     }
   }
 
@@ -0,0 +1,103 @@
+#include "endpoints.h"
+#include "binproto.h"
+#include "protocol.h"
+#include "utils.h"
+#include <string.h>
+
+#define ENDPOINT_ENTRY(id, method, path, handler, flags, rate_class) \
+    { id, METHOD_##method, path, handler, flags, rate_class },
+
+static const Endpoint endpoints[] = {
+    ENDPOINT_LIST(ENDPOINT_ENTRY)
+};
+
+// ENDPOINT_HASH_SEED and endpoint_slots (endpoint index + 1, 0 if empty)
+#include "endpoint_slots.h"
+
+#define ENDPOINT_MAX_ID BINPROTO_FIRST_PUSH_ID
+
+#define ENDPOINT_ID_CHECK(id, method, path, handler, flags, rate_class) \
+    _Static_assert((id) > 0 && (id) < ENDPOINT_MAX_ID, "endpoint id of " path " must be below BINPROTO_FIRST_PUSH_ID");
+ENDPOINT_LIST(ENDPOINT_ID_CHECK)
+_Static_assert(NUM_ENDPOINTS * 2 <= (1 << ENDPOINT_HASH_BITS), "ENDPOINT_HASH_BITS too small for ENDPOINT_LIST");
+_Static_assert(sizeof(endpoint_slots) == (1 << ENDPOINT_HASH_BITS), "endpoint_slots.h is stale, rebuild it");
+
+static int8_t endpoint_ids[ENDPOINT_MAX_ID];            /**< Endpoint index + 1 by id */
+
+/**
+ * Indexes the registry by id and checks the generated perfect hash
+ * against it. Must run before the first request is routed.
+ * @return 0 on success, -1 if the registry is inconsistent
+ */
+int endpoints_init(void) {
+    memset(endpoint_ids, 0, sizeof(endpoint_ids));
+    for (int i = 0; i < NUM_ENDPOINTS; i++) {
+        int id = endpoints[i].id;
+        if (endpoint_ids[id]) {
+            log_error("PROTOCOL", "ERROR - endpoint %s has a duplicate id %d", endpoints[i].path, id);
+            return -1;
+        }
+        endpoint_ids[id] = (int8_t)(i + 1);
+        
+        uint32_t slot = endpoint_hash(ENDPOINT_HASH_SEED, endpoints[i].method, endpoints[i].path);
+        if (endpoint_slots[slot] != i + 1) {
+            log_error("PROTOCOL", "ERROR - endpoint %s is not in the generated hash table (stale endpoint_slots.h)",
+                     endpoints[i].path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Finds the endpoint for a request with one hash and one comparison.
+ * @param method Request method
+ * @param path Endpoint path
+ * @return Endpoint, NULL if none matches
+ */
+const Endpoint* endpoint_lookup(RequestMethod method, const char *path) {
+    int slot = endpoint_slots[endpoint_hash(ENDPOINT_HASH_SEED, method, path)];
+    if (!slot) return NULL;
+    
+    const Endpoint *endpoint = &endpoints[slot - 1];
+    if (endpoint->method != method || strcmp(endpoint->path, path) != 0) return NULL;
+    return endpoint;
+}
+
+/**
+ * Finds an endpoint by registry id (binary protocol requests).
+ * @param id Registry id
+ * @return Endpoint, NULL if the id is unknown
+ */
+const Endpoint* endpoint_by_id(int id) {
+    if (id <= 0 || id >= ENDPOINT_MAX_ID || !endpoint_ids[id]) return NULL;
+    return &endpoints[endpoint_ids[id] - 1];
+}
+
+/**
+ * Gives the endpoint at a registry position.
+ * @param index Position, 0 .. NUM_ENDPOINTS - 1
+ * @return Endpoint, NULL if out of range
+ */
+const Endpoint* endpoint_at(int index) {
+    if (index < 0 || index >= NUM_ENDPOINTS) return NULL;
+    return &endpoints[index];
+}
+
+/**
+ * Gives the registry position of an endpoint.
+ * @param endpoint Endpoint returned by the lookups
+ * @return Position, 0 .. NUM_ENDPOINTS - 1
+ */
+int endpoint_index(const Endpoint *endpoint) {
+    return (int)(endpoint - endpoints);
+}
+
+/**
+ * Gives the protocol name of a method.
+ * @param method Request method
+ * @return "GET" or "POST"
+ */
+const char* method_name(RequestMethod method) {
+    return method == METHOD_GET ? "GET" : "POST";
+}
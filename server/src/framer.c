@@ -0,0 +1,152 @@
+#include "framer.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Sets up an empty framer; the buffer is allocated on the first receive.
+ * @param framer Framer to initialize
+ * @param max_frame Longest line accepted, newline excluded
+ */
+void framer_init(LineFramer *framer, size_t max_frame) {
+    memset(framer, 0, sizeof(LineFramer));
+    framer->max_frame = max_frame;
+}
+
+/**
+ * Frees the buffer; held and returned lines become invalid.
+ * @param framer Framer to release
+ */
+void framer_destroy(LineFramer *framer) {
+    free(framer->data);
+    framer->data = NULL;
+    framer->cap = 0;
+    framer->start = framer->read = framer->end = framer->scan = framer->last = 0;
+    framer->holding = false;
+}
+
+/**
+ * Provides room for the next receive.
+ * Bytes no longer needed are dropped first by moving the live tail to the
+ * front (at most one held line and one partial line); the buffer only grows
+ * when those alone leave less than FRAMER_MIN_READ bytes free.
+ * Pointers to previously returned lines are invalidated.
+ * @param framer Framer
+ * @param room Output, free bytes at the returned position
+ * @return Where to receive into, NULL on allocation failure
+ */
+char* framer_reserve(LineFramer *framer, size_t *room) {
+    if (framer->cap - framer->end < FRAMER_MIN_READ && framer->start > 0) {
+        size_t live = framer->end - framer->start;
+        memmove(framer->data, framer->data + framer->start, live);
+        framer->read -= framer->start;
+        framer->scan -= framer->start;
+        framer->last = framer->last >= framer->start ? framer->last - framer->start : 0;
+        framer->end = live;
+        framer->start = 0;
+    }
+    
+    if (framer->cap - framer->end < FRAMER_MIN_READ) {
+        size_t cap = framer->cap ? framer->cap * 2 : FRAMER_MIN_READ * 2;
+        while (cap - framer->end < FRAMER_MIN_READ) cap *= 2;
+        
+        char *grown = realloc(framer->data, cap);
+        if (!grown) return NULL;
+        framer->data = grown;
+        framer->cap = cap;
+    }
+    
+    *room = framer->cap - framer->end;
+    return framer->data + framer->end;
+}
+
+/**
+ * Accounts for bytes received at the position given by framer_reserve.
+ * @param framer Framer
+ * @param len Number of bytes received
+ */
+void framer_commit(LineFramer *framer, size_t len) {
+    framer->end += len;
+}
+
+/**
+ * Returns the next complete line, scanning only bytes not seen before.
+ * The newline is replaced by a NUL so the line can be used as a string;
+ * it stays valid until the next framer_reserve.
+ * @param framer Framer
+ * @param line Output, start of the line
+ * @param len Output, length of the line without its newline
+ * @return 1 with a line, 0 if none is complete, -1 if a line exceeds max_frame
+ */
+int framer_next(LineFramer *framer, char **line, size_t *len) {
+    char *newline = NULL;
+    if (framer->scan < framer->end) {
+        newline = memchr(framer->data + framer->scan, '\n', framer->end - framer->scan);
+    }
+    
+    if (!newline) {
+        framer->scan = framer->end;
+        return framer->end - framer->read > framer->max_frame ? -1 : 0;
+    }
+    
+    size_t line_len = (size_t)(newline - (framer->data + framer->read));
+    if (line_len > framer->max_frame) return -1;
+    
+    *newline = '\0';
+    *line = framer->data + framer->read;
+    *len = line_len;
+    
+    framer->last = framer->read;
+    framer->read += line_len + 1;
+    framer->scan = framer->read;
+    if (!framer->holding) framer->start = framer->read;
+    return 1;
+}
+
+/**
+ * Gives the bytes received but not yet consumed, without scanning them.
+ * @param framer Framer
+ * @param data Output, first unread byte (valid until the next framer_reserve)
+ * @return Number of unread bytes
+ */
+size_t framer_available(LineFramer *framer, char **data) {
+    *data = framer->data + framer->read;
+    return framer->end - framer->read;
+}
+
+/**
+ * Consumes bytes read through framer_available.
+ * @param framer Framer
+ * @param len Number of bytes consumed (at most what is available)
+ */
+void framer_consume(LineFramer *framer, size_t len) {
+    framer->read += len;
+    if (framer->scan < framer->read) framer->scan = framer->read;
+    if (!framer->holding) framer->start = framer->read;
+}
+
+/**
+ * Keeps the line last returned by framer_next. Only one line can be held.
+ * @param framer Framer
+ */
+void framer_hold(LineFramer *framer) {
+    framer->start = framer->last;
+    framer->holding = true;
+}
+
+/**
+ * Gives the held line, at its current position in the buffer.
+ * @param framer Framer
+ * @return NUL-terminated held line, NULL if none
+ */
+char* framer_held(LineFramer *framer) {
+    return framer->holding ? framer->data + framer->start : NULL;
+}
+
+/**
+ * Drops the held line; its bytes are reclaimed by the next compaction.
+ * @param framer Framer
+ */
+void framer_release(LineFramer *framer) {
+    framer->holding = false;
+    framer->start = framer->read;
+}
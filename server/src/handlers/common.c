@@ -1,54 +1,135 @@
 #include "handlers/common.h"
+#include "outqueue.h"
+#include "rcu.h"
+#include "server.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef _WIN32
-#include <winsock2.h>
-#else
-#include <sys/socket.h>
-#endif
-
 /**
- * Sends a message to a specific client by ID.
- * Thread-safe, finds client in list and sends with newline terminator.
+ * Queues an encoded message for a specific client by ID.
+ * Thread-safe without any global lock: the lookup runs in an RCU read
+ * section, which keeps the client alive, and only the target's send
+ * mutex is taken. The buffer is appended to its output queue (by
+ * reference) and written without blocking, so a slow reader never stalls
+ * other senders and broadcasts to different clients run in parallel.
  * @param state Server state containing clients list
  * @param client_id Target client's unique ID
- * @param message JSON message string to send
- * @return Bytes sent on success, -1 if client not found
+ * @param buf Shared encoded message
+ * @return 0 on success, -1 if client not found or being dropped
  */
-int send_to_client(ServerState *state, int client_id, const char *message) {
-    pthread_mutex_lock(&state->clients_mutex);
+int send_buf_to_client(ServerState *state, int client_id, MsgBuf *buf) {
+    rcu_read_lock();
     
-    for (int i = 0; i < state->num_clients; i++) {
-        if (state->clients[i].id == client_id && state->clients[i].connected) {
-            char buffer[MAX_MESSAGE_LEN + 4];
-            int len = snprintf(buffer, sizeof(buffer), "%s\n", message);
-            
-            int result = send(state->clients[i].socket, buffer, len, 0);
-            pthread_mutex_unlock(&state->clients_mutex);
-            return result;
-        }
+    Client *client = find_client(state, client_id);
+    if (!client) {
+        rcu_read_unlock();
+        return -1;
     }
     
-    pthread_mutex_unlock(&state->clients_mutex);
-    return -1;
+    pthread_mutex_lock(&client->send_mutex);
+    int result = outqueue_push_buf_locked(client, buf);
+    pthread_mutex_unlock(&client->send_mutex);
+    
+    rcu_read_unlock();
+    return result;
 }
 
 /**
- * Broadcasts a message to all players in a session.
- * Iterates through session players and sends to each.
- * @param state Server state for send_to_client
- * @param session Session containing player list
- * @param message JSON message string to broadcast
- * @return 0 always
+ * Tells whether a client negotiated the binary protocol, so that a sender
+ * can build its frame directly. The upgrade is one-way: a client that
+ * switches right after the check still gets a frame, encoded at queue time.
+ * @param state Server state containing clients list
+ * @param client_id Client to check
+ * @return true if the client is connected and uses binary frames
  */
-int broadcast_to_session(ServerState *state, Session *session, const char *message) {
-    for (int i = 0; i < session->num_players; i++) {
-        send_to_client(state, session->players[i].client_id, message);
+bool client_uses_binary(ServerState *state, int client_id) {
+    rcu_read_lock();
+
+    Client *client = find_client(state, client_id);
+    bool binary = false;
+    if (client) {
+        pthread_mutex_lock(&client->send_mutex);
+        binary = client->binary;
+        pthread_mutex_unlock(&client->send_mutex);
     }
-    return 0;
+
+    rcu_read_unlock();
+    return binary;
+}
+
+/**
+ * Sends a message to a specific client by ID.
+ * @param state Server state containing clients list
+ * @param client_id Target client's unique ID
+ * @param message JSON message string to send
+ * @return 0 on success, -1 if client not found or being dropped
+ */
+int send_to_client(ServerState *state, int client_id, const char *message) {
+    MsgBuf *buf = msgbuf_create(message);
+    if (!buf) return -1;
+    int result = send_buf_to_client(state, client_id, buf);
+    msgbuf_release(buf);
+    return result;
+}
+
+/**
+ * Queues the response to a request handled off its client's thread (by a
+ * session actor), tagged with the correlation id the request carried.
+ * @param state Server state containing clients list
+ * @param client_id Client that made the request
+ * @param rid Correlation id of the request, -1 if none
+ * @param buf Encoded response
+ * @return 0 on success, -1 if client not found or being dropped
+ */
+int send_reply_buf(ServerState *state, int client_id, long long rid, MsgBuf *buf) {
+    MsgBuf *reply = rid >= 0 ? msgbuf_with_rid(buf, rid) : msgbuf_retain(buf);
+    if (!reply) return -1;
+    int result = send_buf_to_client(state, client_id, reply);
+    msgbuf_release(reply);
+    return result;
+}
+
+/**
+ * Gives the buffer to queue as the response to the request being handled,
+ * tagged with its correlation id when the request carried one. Pushes
+ * (broadcasts, timer events) are sent as is and never carry an id.
+ * @param client Client whose request is being handled
+ * @param buf Encoded response
+ * @return New reference to queue then release, NULL on allocation failure
+ */
+MsgBuf* response_buf(Client *client, MsgBuf *buf) {
+    if (client->rid < 0) return msgbuf_retain(buf);
+    return msgbuf_with_rid(buf, client->rid);
+}
+
+/**
+ * Queues an encoded response for the client making the request.
+ * @param client Client whose request is being handled
+ * @param buf Encoded response
+ * @return 0 on success, -1 on failure or if the client is being dropped
+ */
+int send_response_buf(Client *client, MsgBuf *buf) {
+    MsgBuf *response = response_buf(client, buf);
+    if (!response) return -1;
+    int result = outqueue_push_buf(client, response);
+    msgbuf_release(response);
+    return result;
+}
+
+/**
+ * Queues a response for the client making the request.
+ * @param client Client whose request is being handled
+ * @param message JSON message string
+ * @return 0 on success, -1 on failure or if the client is being dropped
+ */
+int send_response(Client *client, const char *message) {
+    MsgBuf *buf = msgbuf_create(message);
+    if (!buf) return -1;
+    int result = send_response_buf(client, buf);
+    msgbuf_release(buf);
+    return result;
 }
 
 /**
@@ -60,8 +141,8 @@ int broadcast_to_session(ServerState *state, Session *session, const char *messa
  * @param message Error description
  */
 void send_error(Client *client, const char *action, const char *status, const char *message) {
-    log_msg("PROTOCOL", "send_error() - action=%s, status=%s, message=%s", 
-           action ? action : "null", status, message);
+    log_debug("PROTOCOL", "send_error() - action=%s, status=%s, message=%s", 
+             action ? action : "null", status, message);
     cJSON *response = cJSON_CreateObject();
     if (action) {
         cJSON_AddStringToObject(response, "action", action);
@@ -70,9 +151,7 @@ void send_error(Client *client, const char *action, const char *status, const ch
     cJSON_AddStringToObject(response, "message", message);
     
     char *json = cJSON_PrintUnformatted(response);
-    char buffer[MAX_MESSAGE_LEN];
-    int len = snprintf(buffer, sizeof(buffer), "%s\n", json);
-    send(client->socket, buffer, len, 0);
+    send_response(client, json);
     
     free(json);
     cJSON_Delete(response);
@@ -84,7 +163,7 @@ void send_error(Client *client, const char *action, const char *status, const ch
  * @param client Client to send error to
  */
 void send_bad_request(Client *client) {
-    log_msg("PROTOCOL", "send_bad_request() to client %d", client->id);
+    log_debug("PROTOCOL", "send_bad_request() to client %d", client->id);
     send_error(client, NULL, "400", "Bad request");
 }
 
@@ -94,6 +173,6 @@ void send_bad_request(Client *client) {
  * @param client Client to send error to
  */
 void send_unknown_error(Client *client) {
-    log_msg("PROTOCOL", "send_unknown_error() to client %d", client->id);
+    log_debug("PROTOCOL", "send_unknown_error() to client %d", client->id);
     send_error(client, NULL, "520", "Unknown Error");
 }
@@ -0,0 +1,56 @@
+#include "handlers/connection.h"
+#include "handlers/common.h"
+#include "binproto.h"
+#include "outqueue.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Handles a request to switch to the binary protocol.
+ * The text response is queued and the switch made under the send mutex,
+ * so every message queued before it is text and every one after a frame.
+ * The client's next requests must be frames as well.
+ * @param state Server state (unused)
+ * @param client Client asking for the switch
+ * @param json Request body with the protocol version
+ */
+void handle_binary_upgrade(ServerState *state, Client *client, cJSON *json) {
+    (void)state;
+    log_debug("PROTOCOL", "handle_binary_upgrade() - client %d", client->id);
+    
+    if (client->binary) {
+        send_error(client, "protocol/binary", "400", "binary protocol already active");
+        return;
+    }
+    
+    cJSON *version = cJSON_GetObjectItem(json, "version");
+    if (!version || !cJSON_IsNumber(version) || version->valueint != BINPROTO_VERSION) {
+        log_warn("PROTOCOL", "handle_binary_upgrade() FAILED - unsupported version");
+        send_error(client, "protocol/binary", "400", "unsupported version");
+        return;
+    }
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "action", "protocol/binary");
+    cJSON_AddStringToObject(response, "statut", "200");
+    cJSON_AddStringToObject(response, "message", "binary protocol enabled");
+    cJSON_AddNumberToObject(response, "version", BINPROTO_VERSION);
+    
+    char *json_str = cJSON_PrintUnformatted(response);
+    MsgBuf *text = json_str ? msgbuf_create(json_str) : NULL;
+    MsgBuf *buf = text ? response_buf(client, text) : NULL;
+    msgbuf_release(text);
+    free(json_str);
+    cJSON_Delete(response);
+    if (!buf) return;
+    
+    pthread_mutex_lock(&client->send_mutex);
+    outqueue_push_buf_locked(client, buf);
+    client->binary = true;
+    pthread_mutex_unlock(&client->send_mutex);
+    msgbuf_release(buf);
+    
+    log_msg("PROTOCOL", "Client %d switched to the binary protocol", client->id);
+}
@@ -1,102 +1,190 @@
 #include "handlers/player.h"
 #include "handlers/common.h"
 #include "player.h"
+#include "protocol.h"
+#include "server.h"
+#include "outqueue.h"
+#include "rcu.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef _WIN32
-#include <winsock2.h>
-#else
-#include <sys/socket.h>
-#endif
+/**
+ * @brief Registration or login waiting for an auth worker
+ * 
+ * Strings are stored after the struct, in the same allocation.
+ */
+typedef struct {
+    int client_id;                 /**< Requesting client, looked up again when done */
+    long long rid;                 /**< Correlation id of the request, -1 if none */
+    bool login;                    /**< Login (true) or registration (false) */
+    char *pseudo;                  /**< Requested username */
+    char *password;                /**< Password in clear, wiped after use */
+} AuthJob;
 
 /**
- * Handles player registration request.
- * Validates pseudo/password, creates new account if unique.
- * @param state Server state with accounts list
+ * Copies a request into a job for the auth worker pool.
  * @param client Client making the request
- * @param json Request body with pseudo and password
+ * @param login Login or registration
+ * @param pseudo Requested username
+ * @param password Password in clear
+ * @return malloc'ed job, NULL on allocation failure
  */
-void handle_register(ServerState *state, Client *client, cJSON *json) {
-    log_msg("PROTOCOL", "handle_register() - client %d", client->id);
-    cJSON *pseudo = cJSON_GetObjectItem(json, "pseudo");
-    cJSON *password = cJSON_GetObjectItem(json, "password");
+static AuthJob* auth_job_create(Client *client, bool login, const char *pseudo, const char *password) {
+    size_t pseudo_len = strlen(pseudo) + 1;
+    size_t password_len = strlen(password) + 1;
+    AuthJob *job = malloc(sizeof(AuthJob) + pseudo_len + password_len);
+    if (!job) return NULL;
     
-    if (!pseudo || !password || !cJSON_IsString(pseudo) || !cJSON_IsString(password)) {
-        log_msg("PROTOCOL", "handle_register() FAILED - missing or invalid pseudo/password");
-        send_bad_request(client);
+    job->client_id = client->id;
+    job->rid = client->rid;
+    job->login = login;
+    job->pseudo = (char*)(job + 1);
+    job->password = job->pseudo + pseudo_len;
+    memcpy(job->pseudo, pseudo, pseudo_len);
+    memcpy(job->password, password, password_len);
+    return job;
+}
+
+/**
+ * Delivers the outcome of a job to its client, if still connected.
+ * A successful login marks the client authenticated before the response
+ * is queued, so requests sent after reading it are admitted.
+ * @param state Server state with the clients
+ * @param job Completed job
+ * @param response Response to send
+ * @param authenticated Whether the client is now logged in as job->pseudo
+ */
+static void post_auth_result(ServerState *state, AuthJob *job, cJSON *response, bool authenticated) {
+    char *json_str = cJSON_PrintUnformatted(response);
+    MsgBuf *text = json_str ? msgbuf_create(json_str) : NULL;
+    free(json_str);
+    if (!text) return;
+    MsgBuf *buf = job->rid >= 0 ? msgbuf_with_rid(text, job->rid) : msgbuf_retain(text);
+    msgbuf_release(text);
+    if (!buf) return;
+    
+    // RCU read section, as in send_buf_to_client
+    rcu_read_lock();
+    Client *client = find_client(state, job->client_id);
+    if (!client) {
+        rcu_read_unlock();
+        log_debug("PROTOCOL", "Client %d left before its %s completed", job->client_id,
+                 job->login ? "login" : "registration");
+        msgbuf_release(buf);
         return;
     }
     
-    log_msg("PROTOCOL", "handle_register() - pseudo='%s'", pseudo->valuestring);
-    int result = register_player(state, pseudo->valuestring, password->valuestring);
+    pthread_mutex_lock(&client->send_mutex);
+    if (authenticated) {
+        strncpy(client->pseudo, job->pseudo, MAX_PSEUDO_LEN - 1);
+        __atomic_store_n(&client->authenticated, true, __ATOMIC_RELEASE);
+    }
+    outqueue_push_buf_locked(client, buf);
+    pthread_mutex_unlock(&client->send_mutex);
+    rcu_read_unlock();
+    msgbuf_release(buf);
+}
+
+/**
+ * Runs a registration or login on an auth worker and posts the response.
+ * @param context Server state
+ * @param arg AuthJob, freed by the pool
+ */
+static void run_auth_job(void *context, void *arg) {
+    ServerState *state = (ServerState*)context;
+    AuthJob *job = (AuthJob*)arg;
+    
+    int result = job->login ? login_player(state, job->pseudo, job->password)
+                            : register_player(state, job->pseudo, job->password);
+    memset(job->password, 0, strlen(job->password));
     
+    cJSON_Arena *previous = json_scratch_begin();
     cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "action", "player/register");
+    cJSON_AddStringToObject(response, "action", job->login ? "player/login" : "player/register");
     
-    if (result == 0) {
+    if (job->login && result == 0) {
+        log_msg("PROTOCOL", "handle_login() SUCCESS - '%s' logged in", job->pseudo);
+        cJSON_AddStringToObject(response, "statut", "200");
+        cJSON_AddStringToObject(response, "message", "login successful");
+    } else if (job->login) {
+        log_warn("PROTOCOL", "handle_login() FAILED - invalid credentials");
+        cJSON_AddStringToObject(response, "statut", "401");
+        cJSON_AddStringToObject(response, "message", "invalid credentials");
+    } else if (result == 0) {
         log_msg("PROTOCOL", "handle_register() SUCCESS - player registered");
         cJSON_AddStringToObject(response, "statut", "201");
         cJSON_AddStringToObject(response, "message", "player registered successfully");
-    } else {
-        log_msg("PROTOCOL", "handle_register() FAILED - pseudo already exists (result=%d)", result);
+    } else if (result == -1) {
+        log_warn("PROTOCOL", "handle_register() FAILED - pseudo already exists");
         cJSON_AddStringToObject(response, "statut", "409");
         cJSON_AddStringToObject(response, "message", "pseudo already exists");
+    } else {
+        log_warn("PROTOCOL", "handle_register() FAILED - account not created (result=%d)", result);
+        cJSON_AddStringToObject(response, "statut", "503");
+        cJSON_AddStringToObject(response, "message", "registration unavailable");
     }
     
-    char *json_str = cJSON_PrintUnformatted(response);
-    char buffer[MAX_MESSAGE_LEN];
-    int len = snprintf(buffer, sizeof(buffer), "%s\n", json_str);
-    send(client->socket, buffer, len, 0);
-    
-    free(json_str);
+    post_auth_result(state, job, response, job->login && result == 0);
     cJSON_Delete(response);
+    json_scratch_end(previous);
 }
 
 /**
- * Handles player login request.
- * Validates credentials, marks client as authenticated on success.
- * @param state Server state with accounts list
+ * Hands a registration or login to the auth worker pool.
+ * The response is sent by the worker once the password is hashed.
+ * @param state Server state with the pool
  * @param client Client making the request
  * @param json Request body with pseudo and password
+ * @param login Login or registration
  */
-void handle_login(ServerState *state, Client *client, cJSON *json) {
-    log_msg("PROTOCOL", "handle_login() - client %d", client->id);
+static void submit_auth(ServerState *state, Client *client, cJSON *json, bool login) {
+    const char *action = login ? "player/login" : "player/register";
     cJSON *pseudo = cJSON_GetObjectItem(json, "pseudo");
     cJSON *password = cJSON_GetObjectItem(json, "password");
     
     if (!pseudo || !password || !cJSON_IsString(pseudo) || !cJSON_IsString(password)) {
-        log_msg("PROTOCOL", "handle_login() FAILED - missing or invalid pseudo/password");
+        log_warn("PROTOCOL", "%s FAILED - missing or invalid pseudo/password", action);
         send_bad_request(client);
         return;
     }
-    
-    log_msg("PROTOCOL", "handle_login() - attempting login for pseudo='%s'", pseudo->valuestring);
-    int result = login_player(state, pseudo->valuestring, password->valuestring);
-    
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "action", "player/login");
-    
-    if (result == 0) {
-        log_msg("PROTOCOL", "handle_login() SUCCESS - '%s' logged in", pseudo->valuestring);
-        cJSON_AddStringToObject(response, "statut", "200");
-        cJSON_AddStringToObject(response, "message", "login successful");
-        
-        strncpy(client->pseudo, pseudo->valuestring, MAX_PSEUDO_LEN - 1);
-        client->authenticated = true;
-    } else {
-        log_msg("PROTOCOL", "handle_login() FAILED - invalid credentials");
-        cJSON_AddStringToObject(response, "statut", "401");
-        cJSON_AddStringToObject(response, "message", "invalid credentials");
+    if (!pseudo_is_valid(pseudo->valuestring)) {
+        log_warn("PROTOCOL", "%s FAILED - pseudo empty, too long or with forbidden characters", action);
+        send_bad_request(client);
+        return;
     }
     
-    char *json_str = cJSON_PrintUnformatted(response);
-    char buffer[MAX_MESSAGE_LEN];
-    int len = snprintf(buffer, sizeof(buffer), "%s\n", json_str);
-    send(client->socket, buffer, len, 0);
-    
-    free(json_str);
-    cJSON_Delete(response);
+    log_debug("PROTOCOL", "%s - pseudo='%s'", action, pseudo->valuestring);
+    AuthJob *job = auth_job_create(client, login, pseudo->valuestring, password->valuestring);
+    if (!job || workpool_submit(&state->auth_pool, run_auth_job, job) < 0) {
+        log_warn("PROTOCOL", "%s FAILED - auth workers saturated", action);
+        free(job);
+        send_error(client, action, "503", "server busy, retry later");
+    }
+}
+
+/**
+ * Handles player registration request.
+ * Validates pseudo/password, the account is created by an auth worker.
+ * @param state Server state with accounts list
+ * @param client Client making the request
+ * @param json Request body with pseudo and password
+ */
+void handle_register(ServerState *state, Client *client, cJSON *json) {
+    log_debug("PROTOCOL", "handle_register() - client %d", client->id);
+    submit_auth(state, client, json, false);
+}
+
+/**
+ * Handles player login request.
+ * Validates pseudo/password, the credentials are checked by an auth
+ * worker which marks the client as authenticated on success.
+ * @param state Server state with accounts list
+ * @param client Client making the request
+ * @param json Request body with pseudo and password
+ */
+void handle_login(ServerState *state, Client *client, cJSON *json) {
+    log_debug("PROTOCOL", "handle_login() - client %d", client->id);
+    submit_auth(state, client, json, true);
 }
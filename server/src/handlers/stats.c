@@ -0,0 +1,102 @@
+#include "handlers/stats.h"
+#include "handlers/common.h"
+#include "outqueue.h"
+#include "rcu.h"
+#include "server.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Handles server statistics request.
+ * Reports uptime, load and allocation counters so benchmarks can compute
+ * per-request costs from two snapshots.
+ * @param state Server state with the counters
+ * @param client Client making the request
+ * @param json Unused, the endpoint takes no body
+ */
+void handle_get_stats(ServerState *state, Client *client, cJSON *json) {
+    (void)json;
+    log_debug("PROTOCOL", "handle_get_stats() - client %d", client->id);
+    
+    cJSON_AllocStats allocs;
+    cJSON_GetAllocStats(&allocs);
+    
+    int num_clients = __atomic_load_n(&state->num_clients, __ATOMIC_RELAXED);
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "action", "server/stats");
+    cJSON_AddStringToObject(response, "statut", "200");
+    cJSON_AddStringToObject(response, "message", "ok");
+    cJSON_AddNumberToObject(response, "uptime", (double)(time(NULL) - state->start_time));
+    cJSON_AddNumberToObject(response, "clients", num_clients);
+    cJSON_AddNumberToObject(response, "requests",
+                            (double)__atomic_load_n(&state->requests_handled, __ATOMIC_RELAXED));
+    cJSON_AddNumberToObject(response, "jsonHeapAllocs", (double)allocs.heap_allocs);
+    cJSON_AddNumberToObject(response, "jsonArenaAllocs", (double)allocs.arena_allocs);
+    
+    char *json_str = cJSON_PrintUnformatted(response);
+    send_response(client, json_str);
+    
+    free(json_str);
+    cJSON_Delete(response);
+}
+
+/**
+ * Handles a request tracing change (loopback clients only, see endpoints.h).
+ * The body holds "enabled" plus one target: "clientId", "endpoint" or
+ * "sampleRate" (1 request in N, 0 to stop sampling).
+ * @param state Server state with the trace configuration and clients
+ * @param client Client making the request
+ * @param json Request body
+ */
+void handle_set_trace(ServerState *state, Client *client, cJSON *json) {
+    log_debug("PROTOCOL", "handle_set_trace() - client %d from %s", client->id, client->ip);
+    
+    cJSON *enabled = cJSON_GetObjectItem(json, "enabled");
+    cJSON *client_id = cJSON_GetObjectItem(json, "clientId");
+    cJSON *endpoint = cJSON_GetObjectItem(json, "endpoint");
+    cJSON *sample_rate = cJSON_GetObjectItem(json, "sampleRate");
+    bool on = cJSON_IsTrue(enabled);
+    
+    if (cJSON_IsNumber(sample_rate)) {
+        trace_set_sample_rate(&state->trace, sample_rate->valueint);
+        log_msg("PROTOCOL", "Trace sampling set to 1 in %d", sample_rate->valueint);
+    } else if (cJSON_IsNumber(client_id) && cJSON_IsBool(enabled)) {
+        rcu_read_lock();
+        Client *target = find_client(state, client_id->valueint);
+        if (target) {
+            __atomic_store_n(&target->trace, on, __ATOMIC_RELAXED);
+        }
+        rcu_read_unlock();
+        
+        if (!target) {
+            send_error(client, "server/trace", "404", "client not found");
+            return;
+        }
+        log_msg("PROTOCOL", "Tracing %s for client %d", on ? "enabled" : "disabled",
+                client_id->valueint);
+    } else if (cJSON_IsString(endpoint) && cJSON_IsBool(enabled)) {
+        if (trace_set_endpoint(&state->trace, endpoint->valuestring, on) < 0) {
+            send_error(client, "server/trace", "400", "too many traced endpoints");
+            return;
+        }
+        log_msg("PROTOCOL", "Tracing %s for endpoint %s", on ? "enabled" : "disabled",
+                endpoint->valuestring);
+    } else {
+        send_bad_request(client);
+        return;
+    }
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "action", "server/trace");
+    cJSON_AddStringToObject(response, "statut", "200");
+    cJSON_AddStringToObject(response, "message", "trace updated");
+    
+    char *json_str = cJSON_PrintUnformatted(response);
+    send_response(client, json_str);
+    
+    free(json_str);
+    cJSON_Delete(response);
+}
@@ -0,0 +1,163 @@
+#include "idindex.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IDINDEX_MIN_CAPACITY 16
+
+/**
+ * Fibonacci hashing: spreads sequential ids over the whole table.
+ * @param id Key to hash
+ * @param mask Capacity - 1
+ * @return Home bucket of the id
+ */
+static int home_bucket(int id, int mask) {
+    uint32_t h = (uint32_t)id * 2654435769u;
+    return (int)((h ^ (h >> 16)) & (uint32_t)mask);
+}
+
+/**
+ * Allocates the bucket arrays for a given capacity.
+ * @param index Index to set up
+ * @param capacity Power-of-two bucket count
+ * @return 0 on success, -1 on allocation failure
+ */
+static int alloc_buckets(IdIndex *index, int capacity) {
+    int *keys = calloc(capacity, sizeof(int));
+    int *values = malloc(capacity * sizeof(int));
+    if (!keys || !values) {
+        free(keys);
+        free(values);
+        return -1;
+    }
+    index->keys = keys;
+    index->values = values;
+    index->capacity = capacity;
+    index->count = 0;
+    return 0;
+}
+
+/**
+ * Doubles the table and reinserts every id.
+ * @param index Index to grow
+ * @return 0 on success, -1 on allocation failure (index left untouched)
+ */
+static int grow(IdIndex *index) {
+    IdIndex old = *index;
+    if (alloc_buckets(index, old.capacity * 2) < 0) {
+        *index = old;
+        return -1;
+    }
+    for (int i = 0; i < old.capacity; i++) {
+        if (old.keys[i] != 0) {
+            idindex_put(index, old.keys[i], old.values[i]);
+        }
+    }
+    free(old.keys);
+    free(old.values);
+    return 0;
+}
+
+/**
+ * Initializes an empty index sized for an expected number of ids.
+ * @param index Index to initialize
+ * @param expected Expected number of ids (the table keeps load <= 1/2)
+ * @return 0 on success, -1 on allocation failure
+ */
+int idindex_init(IdIndex *index, int expected) {
+    int capacity = IDINDEX_MIN_CAPACITY;
+    while (capacity < expected * 2) capacity <<= 1;
+    memset(index, 0, sizeof(IdIndex));
+    return alloc_buckets(index, capacity);
+}
+
+/**
+ * Releases the bucket arrays.
+ * @param index Index to destroy
+ */
+void idindex_destroy(IdIndex *index) {
+    free(index->keys);
+    free(index->values);
+    memset(index, 0, sizeof(IdIndex));
+}
+
+/**
+ * Removes every id, keeping the allocated capacity.
+ * @param index Index to clear
+ */
+void idindex_clear(IdIndex *index) {
+    memset(index->keys, 0, index->capacity * sizeof(int));
+    index->count = 0;
+}
+
+/**
+ * Looks up the slot stored for an id (linear probing).
+ * @param index Index to search
+ * @param id Positive id
+ * @return Stored slot, -1 if absent
+ */
+int idindex_get(const IdIndex *index, int id) {
+    if (id <= 0 || !index->keys) return -1;
+
+    int mask = index->capacity - 1;
+    for (int i = home_bucket(id, mask); ; i = (i + 1) & mask) {
+        if (index->keys[i] == id) return index->values[i];
+        if (index->keys[i] == 0) return -1;
+    }
+}
+
+/**
+ * Inserts or updates the slot stored for an id.
+ * Grows the table when it would become more than half full.
+ * @param index Index to update
+ * @param id Positive id
+ * @param value Slot to store
+ * @return 0 on success, -1 on invalid id or allocation failure
+ */
+int idindex_put(IdIndex *index, int id, int value) {
+    if (id <= 0 || !index->keys) return -1;
+    if ((index->count + 1) * 2 > index->capacity && grow(index) < 0) return -1;
+
+    int mask = index->capacity - 1;
+    int i = home_bucket(id, mask);
+    while (index->keys[i] != 0 && index->keys[i] != id) {
+        i = (i + 1) & mask;
+    }
+    if (index->keys[i] == 0) index->count++;
+    index->keys[i] = id;
+    index->values[i] = value;
+    return 0;
+}
+
+/**
+ * Removes an id using backward-shift deletion, so lookups never need
+ * tombstones and probe chains stay short.
+ * @param index Index to update
+ * @param id Id to remove
+ * @return true if the id was present
+ */
+bool idindex_remove(IdIndex *index, int id) {
+    if (id <= 0 || !index->keys) return false;
+
+    int mask = index->capacity - 1;
+    int i = home_bucket(id, mask);
+    while (index->keys[i] != id) {
+        if (index->keys[i] == 0) return false;
+        i = (i + 1) & mask;
+    }
+
+    // Pull back every following entry whose home bucket is at or before the hole
+    int hole = i;
+    for (int j = (hole + 1) & mask; index->keys[j] != 0; j = (j + 1) & mask) {
+        int home = home_bucket(index->keys[j], mask);
+        bool movable = (hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j);
+        if (movable) {
+            index->keys[hole] = index->keys[j];
+            index->values[hole] = index->values[j];
+            hole = j;
+        }
+    }
+    index->keys[hole] = 0;
+    index->count--;
+    return true;
+}
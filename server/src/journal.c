@@ -0,0 +1,377 @@
+#include "journal.h"
+#include "utils.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define JOURNAL_MIN_BUFFER 4096
+
+/**
+ * Flushes a stdio stream and forces its data to stable storage.
+ * @param file Stream to sync
+ * @return 0 on success, -1 on error
+ */
+int journal_sync(FILE *file) {
+    if (fflush(file) != 0) return -1;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0 ? 0 : -1;
+#else
+    return fsync(fileno(file)) == 0 ? 0 : -1;
+#endif
+}
+
+/**
+ * Atomically replaces a file with another one (a freshly written
+ * snapshot), then syncs the directory so the rename itself survives a crash.
+ * @param from Complete, synced temporary file
+ * @param to Destination path
+ * @return 0 on success, -1 on error
+ */
+int journal_replace(const char *from, const char *to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+#else
+    if (rename(from, to) != 0) return -1;
+
+    char dir[JOURNAL_PATH_LEN];
+    const char *slash = strrchr(to, '/');
+    if (slash && (size_t)(slash - to) < sizeof(dir)) {
+        memcpy(dir, to, (size_t)(slash - to));
+        dir[slash - to] = '\0';
+    } else {
+        strcpy(dir, ".");
+    }
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return 0;
+#endif
+}
+
+/**
+ * Computes the journal size that triggers the next compaction: a fixed
+ * share of the last snapshot, so rewriting it stays amortized O(1) per record.
+ * @param journal Journal
+ * @param snapshot_bytes Size of the last snapshot
+ * @return Trigger size in bytes
+ */
+static size_t compact_threshold(const Journal *journal, size_t snapshot_bytes) {
+    size_t bytes = snapshot_bytes / 100 * JOURNAL_COMPACT_PERCENT;
+    return bytes > journal->compact_min_bytes ? bytes : journal->compact_min_bytes;
+}
+
+/**
+ * Sets the live journal aside and starts a fresh one, then hands the
+ * snapshot to the compactor. Records appended meanwhile go to the fresh
+ * journal, so replaying it over the snapshot is always correct. Runs on
+ * the writer thread, the only one touching the file.
+ * @param journal Journal to rotate
+ */
+static void journal_rotate(Journal *journal) {
+    fclose(journal->file);
+    bool rotated = rename(journal->path, journal->old_path) == 0;
+    journal->file = fopen(journal->path, "ab");
+
+    pthread_mutex_lock(&journal->mutex);
+    if (!journal->file) {
+        journal->failed = true;
+    }
+    if (journal->file && rotated) {
+        journal->file_bytes = 0;
+        journal->compacting = true;
+        pthread_cond_signal(&journal->compact_wake);
+    } else {
+        journal->compact_bytes = SIZE_MAX;
+    }
+    pthread_mutex_unlock(&journal->mutex);
+
+    if (!journal->file || !rotated) {
+        log_error("JOURNAL", "ERROR - cannot rotate %s, compaction disabled", journal->path);
+    }
+}
+
+/**
+ * Compactor thread: writes a snapshot each time the writer rotates the
+ * journal, off the writer so group commits continue meanwhile. A snapshot
+ * still pending at shutdown is left to the owner (the set-aside file is
+ * replayed or folded on the next start).
+ * @param arg Pointer to the Journal
+ * @return NULL when the journal closes
+ */
+static void* journal_compactor(void *arg) {
+    Journal *journal = (Journal*)arg;
+
+    pthread_mutex_lock(&journal->mutex);
+    for (;;) {
+        while (journal->running && !journal->compacting) {
+            pthread_cond_wait(&journal->compact_wake, &journal->mutex);
+        }
+        if (!journal->running) break;
+        pthread_mutex_unlock(&journal->mutex);
+
+        double started = get_current_time_ms();
+        int64_t snapshot_bytes = journal->compact(journal->context);
+        if (snapshot_bytes >= 0) {
+            remove(journal->old_path);
+            log_msg("JOURNAL", "%s compacted in %.0f ms (%lld byte snapshot)", journal->path,
+                    get_current_time_ms() - started, (long long)snapshot_bytes);
+        } else {
+            // The set-aside file must survive until a snapshot covers it
+            log_error("JOURNAL", "ERROR - snapshot failed, %s kept and compaction disabled", journal->old_path);
+        }
+
+        pthread_mutex_lock(&journal->mutex);
+        journal->compact_bytes = snapshot_bytes >= 0 ? compact_threshold(journal, (size_t)snapshot_bytes) : SIZE_MAX;
+        journal->compacting = false;
+    }
+    pthread_mutex_unlock(&journal->mutex);
+    return NULL;
+}
+
+/**
+ * Writer thread: takes every pending record at once, writes and syncs
+ * them, then wakes the threads waiting for them (group commit).
+ * Drains what is left before exiting.
+ * @param arg Pointer to the Journal
+ * @return NULL when the journal closes
+ */
+static void* journal_thread(void *arg) {
+    Journal *journal = (Journal*)arg;
+    char *batch = NULL;
+    size_t batch_cap = 0;
+
+    pthread_mutex_lock(&journal->mutex);
+    for (;;) {
+        while (journal->running && journal->pending_len == 0) {
+            pthread_cond_wait(&journal->wake, &journal->mutex);
+        }
+        if (journal->pending_len == 0) break;
+
+        // Swap buffers: appends continue into the other one while we write
+        char *data = journal->pending;
+        size_t data_cap = journal->pending_cap;
+        size_t len = journal->pending_len;
+        uint64_t seq = journal->appended_seq;
+        journal->pending = batch;
+        journal->pending_cap = batch_cap;
+        journal->pending_len = 0;
+        batch = data;
+        batch_cap = data_cap;
+        pthread_mutex_unlock(&journal->mutex);
+
+        bool ok = fwrite(batch, 1, len, journal->file) == len && journal_sync(journal->file) == 0;
+
+        pthread_mutex_lock(&journal->mutex);
+        if (ok) {
+            journal->durable_seq = seq;
+            journal->file_bytes += len;
+        } else if (!journal->failed) {
+            journal->failed = true;
+            log_error("JOURNAL", "ERROR - cannot write %s, records are no longer durable", journal->path);
+        }
+        pthread_cond_broadcast(&journal->written);
+
+        if (ok && journal->running && !journal->compacting &&
+            journal->file_bytes >= journal->compact_bytes) {
+            pthread_mutex_unlock(&journal->mutex);
+            journal_rotate(journal);
+            pthread_mutex_lock(&journal->mutex);
+        }
+    }
+    pthread_mutex_unlock(&journal->mutex);
+
+    free(batch);
+    return NULL;
+}
+
+/**
+ * Tells whether the previous run left work behind: a set-aside file from
+ * an interrupted compaction, or a last record torn by a crash (appending
+ * after it would glue the next record to it).
+ * @param journal Journal about to open
+ * @return true if the files must be folded into a snapshot first
+ */
+static bool journal_needs_fold(const Journal *journal) {
+    FILE *old = fopen(journal->old_path, "rb");
+    if (old) {
+        fclose(old);
+        return true;
+    }
+
+    FILE *live = fopen(journal->path, "rb");
+    if (!live) return false;
+    bool torn = fseek(live, -1, SEEK_END) == 0 && fgetc(live) != '\n';
+    fclose(live);
+    return torn;
+}
+
+/**
+ * Opens a journal for appending and starts its writer thread.
+ * The owner must have replayed both journal files first. Leftovers of a
+ * previous run are folded into a snapshot right away.
+ * @param journal Journal to open
+ * @param path Live journal path
+ * @param compact_min_bytes Smallest journal worth compacting
+ * @param snapshot_bytes Size of the owner's current snapshot
+ * @param compact Writes a snapshot of the owner's state
+ * @param context Passed to compact
+ * @return 0 on success, -1 on error
+ */
+int journal_open(Journal *journal, const char *path, size_t compact_min_bytes,
+                 size_t snapshot_bytes, JournalCompactFn compact, void *context) {
+    memset(journal, 0, sizeof(Journal));
+    snprintf(journal->path, sizeof(journal->path), "%s", path);
+    snprintf(journal->old_path, sizeof(journal->old_path), "%s.old", path);
+    journal->compact_min_bytes = compact_min_bytes;
+    journal->compact_bytes = compact_threshold(journal, snapshot_bytes);
+    journal->compact = compact;
+    journal->context = context;
+
+    if (journal_needs_fold(journal)) {
+        log_msg("JOURNAL", "Folding %s into a snapshot after an interrupted run", path);
+        int64_t folded_bytes = compact(context);
+        if (folded_bytes >= 0) {
+            remove(journal->old_path);
+            remove(journal->path);
+            journal->compact_bytes = compact_threshold(journal, (size_t)folded_bytes);
+        } else {
+            log_error("JOURNAL", "ERROR - snapshot failed, compaction disabled");
+            journal->compact_bytes = SIZE_MAX;
+        }
+    }
+
+    journal->file = fopen(path, "ab");
+    if (!journal->file) {
+        log_error("JOURNAL", "ERROR - cannot open %s for appending", path);
+        return -1;
+    }
+    fseek(journal->file, 0, SEEK_END);
+    long size = ftell(journal->file);
+    journal->file_bytes = size > 0 ? (size_t)size : 0;
+
+    pthread_mutex_init(&journal->mutex, NULL);
+    pthread_cond_init(&journal->wake, NULL);
+    pthread_cond_init(&journal->written, NULL);
+    pthread_cond_init(&journal->compact_wake, NULL);
+    journal->running = true;
+    if (pthread_create(&journal->compactor, NULL, journal_compactor, journal) != 0) {
+        journal->running = false;
+        fclose(journal->file);
+        journal->file = NULL;
+        return -1;
+    }
+    if (pthread_create(&journal->thread, NULL, journal_thread, journal) != 0) {
+        pthread_mutex_lock(&journal->mutex);
+        journal->running = false;
+        pthread_cond_signal(&journal->compact_wake);
+        pthread_mutex_unlock(&journal->mutex);
+        pthread_join(journal->compactor, NULL);
+        fclose(journal->file);
+        journal->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Queues a record for the next group commit. Never blocks on I/O.
+ * @param journal Open journal
+ * @param record Record bytes (one line, newline included)
+ * @param len Record length
+ * @return Sequence number to pass to journal_wait, 0 if the record was dropped
+ */
+uint64_t journal_append(Journal *journal, const char *record, size_t len) {
+    if (!journal->file) return 0;
+
+    pthread_mutex_lock(&journal->mutex);
+    if (!journal->running) {
+        pthread_mutex_unlock(&journal->mutex);
+        return 0;
+    }
+    if (journal->pending_len + len > journal->pending_cap) {
+        size_t cap = journal->pending_cap ? journal->pending_cap : JOURNAL_MIN_BUFFER;
+        while (cap < journal->pending_len + len) cap *= 2;
+        char *grown = realloc(journal->pending, cap);
+        if (!grown) {
+            pthread_mutex_unlock(&journal->mutex);
+            return 0;
+        }
+        journal->pending = grown;
+        journal->pending_cap = cap;
+    }
+    memcpy(journal->pending + journal->pending_len, record, len);
+    journal->pending_len += len;
+    uint64_t seq = ++journal->appended_seq;
+    pthread_cond_signal(&journal->wake);
+    pthread_mutex_unlock(&journal->mutex);
+    return seq;
+}
+
+/**
+ * Blocks until a record is on stable storage.
+ * @param journal Open journal
+ * @param seq Value returned by journal_append
+ * @return true if the record is durable, false if it was dropped or a write failed
+ */
+bool journal_wait(Journal *journal, uint64_t seq) {
+    if (seq == 0) return false;
+
+    pthread_mutex_lock(&journal->mutex);
+    while (journal->durable_seq < seq && !journal->failed) {
+        pthread_cond_wait(&journal->written, &journal->mutex);
+    }
+    bool durable = journal->durable_seq >= seq;
+    pthread_mutex_unlock(&journal->mutex);
+    return durable;
+}
+
+/**
+ * Writes the pending records, stops the writer and the compactor (waiting
+ * for a snapshot in progress) and closes the file.
+ * No record may be appended afterwards.
+ * @param journal Journal to close (ignored if it never opened)
+ */
+void journal_close(Journal *journal) {
+    if (!journal->file) return;
+
+    pthread_mutex_lock(&journal->mutex);
+    journal->running = false;
+    pthread_cond_signal(&journal->wake);
+    pthread_cond_signal(&journal->compact_wake);
+    pthread_mutex_unlock(&journal->mutex);
+    pthread_join(journal->thread, NULL);
+    pthread_join(journal->compactor, NULL);
+
+    fclose(journal->file);
+    journal->file = NULL;
+    free(journal->pending);
+    journal->pending = NULL;
+    pthread_mutex_destroy(&journal->mutex);
+    pthread_cond_destroy(&journal->wake);
+    pthread_cond_destroy(&journal->written);
+    pthread_cond_destroy(&journal->compact_wake);
+}
+
+/**
+ * Deletes the journal files of a closed journal, once a snapshot
+ * written after journal_close covers every record.
+ * @param journal Closed journal
+ * @return 0 on success, -1 if a file could not be removed
+ */
+int journal_reset(Journal *journal) {
+    int result = 0;
+    if (remove(journal->path) != 0 && errno != ENOENT) result = -1;
+    if (remove(journal->old_path) != 0 && errno != ENOENT) result = -1;
+    return result;
+}
@@ -0,0 +1,283 @@
+#include "jsonwriter.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSONW_MIN_SIZE 256
+
+/**
+ * Starts a message in a fresh buffer.
+ * @param w Writer to initialize
+ * @param size_hint Expected encoded size, sized so the common case never grows
+ */
+void jsonw_init(JsonWriter *w, size_t size_hint) {
+    w->cap = size_hint > JSONW_MIN_SIZE ? size_hint : JSONW_MIN_SIZE;
+    w->need_comma = false;
+    w->buf = malloc(sizeof(MsgBuf) + w->cap);
+    if (w->buf) {
+        w->buf->refcount = 1;
+        w->buf->binary = NULL;
+        w->buf->len = 0;
+    }
+}
+
+/**
+ * Makes room for more bytes at the end of the message.
+ * The buffer is still private to the writer, so it can be moved.
+ * @param w Writer
+ * @param extra Bytes about to be appended
+ * @return Write position, NULL if the writer failed
+ */
+static char* jsonw_reserve(JsonWriter *w, size_t extra) {
+    if (!w->buf) return NULL;
+
+    size_t needed = w->buf->len + extra;
+    if (needed > w->cap) {
+        size_t cap = w->cap * 2;
+        while (cap < needed) cap *= 2;
+
+        MsgBuf *grown = realloc(w->buf, sizeof(MsgBuf) + cap);
+        if (!grown) {
+            free(w->buf);
+            w->buf = NULL;
+            return NULL;
+        }
+        w->buf = grown;
+        w->cap = cap;
+    }
+    return w->buf->data + w->buf->len;
+}
+
+/**
+ * Appends raw bytes.
+ * @param w Writer
+ * @param data Bytes to append
+ * @param len Number of bytes
+ */
+static void jsonw_append(JsonWriter *w, const char *data, size_t len) {
+    char *out = jsonw_reserve(w, len);
+    if (!out) return;
+    memcpy(out, data, len);
+    w->buf->len += len;
+}
+
+/**
+ * Emits the separator owed before a value or key, if any.
+ * @param w Writer
+ */
+static void jsonw_separator(JsonWriter *w) {
+    if (w->need_comma) jsonw_append(w, ",", 1);
+    w->need_comma = true;
+}
+
+void jsonw_object_begin(JsonWriter *w) {
+    jsonw_separator(w);
+    jsonw_append(w, "{", 1);
+    w->need_comma = false;
+}
+
+void jsonw_object_end(JsonWriter *w) {
+    jsonw_append(w, "}", 1);
+    w->need_comma = true;
+}
+
+void jsonw_array_begin(JsonWriter *w) {
+    jsonw_separator(w);
+    jsonw_append(w, "[", 1);
+    w->need_comma = false;
+}
+
+void jsonw_array_end(JsonWriter *w) {
+    jsonw_append(w, "]", 1);
+    w->need_comma = true;
+}
+
+/**
+ * Appends a quoted string, escaped like cJSON does.
+ * Control characters become short escapes or \u00XX; bytes >= 0x80 are
+ * copied as is (UTF-8 passes through).
+ * @param w Writer
+ * @param str String to quote (NULL is written as "")
+ */
+static void jsonw_quoted(JsonWriter *w, const char *str) {
+    if (!str) str = "";
+
+    size_t len = 0;
+    bool plain = true;
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++, len++) {
+        if (*p < 32 || *p == '\"' || *p == '\\') plain = false;
+    }
+
+    if (plain) {
+        char *out = jsonw_reserve(w, len + 2);
+        if (!out) return;
+        out[0] = '\"';
+        memcpy(out + 1, str, len);
+        out[len + 1] = '\"';
+        w->buf->len += len + 2;
+        return;
+    }
+
+    char *out = jsonw_reserve(w, len * 6 + 2);
+    if (!out) return;
+
+    char *start = out;
+    *out++ = '\"';
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        if (*p > 31 && *p != '\"' && *p != '\\') {
+            *out++ = (char)*p;
+            continue;
+        }
+        *out++ = '\\';
+        switch (*p) {
+            case '\\': *out++ = '\\'; break;
+            case '\"': *out++ = '\"'; break;
+            case '\b': *out++ = 'b'; break;
+            case '\f': *out++ = 'f'; break;
+            case '\n': *out++ = 'n'; break;
+            case '\r': *out++ = 'r'; break;
+            case '\t': *out++ = 't'; break;
+            default:
+                *out++ = 'u';
+                *out++ = '0';
+                *out++ = '0';
+                *out++ = "0123456789abcdef"[*p >> 4];
+                *out++ = "0123456789abcdef"[*p & 0xf];
+                break;
+        }
+    }
+    *out++ = '\"';
+    w->buf->len += out - start;
+}
+
+/**
+ * Writes an object key and its colon.
+ * @param w Writer
+ * @param key Key name
+ */
+void jsonw_key(JsonWriter *w, const char *key) {
+    jsonw_separator(w);
+    jsonw_quoted(w, key);
+    jsonw_append(w, ":", 1);
+    w->need_comma = false;
+}
+
+void jsonw_string(JsonWriter *w, const char *value) {
+    jsonw_separator(w);
+    jsonw_quoted(w, value);
+}
+
+/**
+ * Writes an integer without going through printf.
+ * @param w Writer
+ * @param value Integer value
+ */
+void jsonw_int(JsonWriter *w, long long value) {
+    jsonw_separator(w);
+
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    char *p = end;
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value
+                                             : (unsigned long long)value;
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) *--p = '-';
+
+    jsonw_append(w, p, end - p);
+}
+
+/**
+ * Writes a number the way cJSON prints it: integral values in the int
+ * range without a fraction, everything else with %g.
+ * @param w Writer
+ * @param value Number to write
+ */
+void jsonw_number(JsonWriter *w, double value) {
+    if (value >= INT_MIN && value <= INT_MAX && value == (double)(int)value) {
+        jsonw_int(w, (int)value);
+        return;
+    }
+
+    jsonw_separator(w);
+    char *out = jsonw_reserve(w, 64);
+    if (!out) return;
+    w->buf->len += snprintf(out, 64, "%g", value);
+}
+
+void jsonw_bool(JsonWriter *w, bool value) {
+    jsonw_separator(w);
+    if (value) {
+        jsonw_append(w, "true", 4);
+    } else {
+        jsonw_append(w, "false", 5);
+    }
+}
+
+void jsonw_field_string(JsonWriter *w, const char *key, const char *value) {
+    jsonw_key(w, key);
+    jsonw_string(w, value);
+}
+
+void jsonw_field_int(JsonWriter *w, const char *key, long long value) {
+    jsonw_key(w, key);
+    jsonw_int(w, value);
+}
+
+void jsonw_field_number(JsonWriter *w, const char *key, double value) {
+    jsonw_key(w, key);
+    jsonw_number(w, value);
+}
+
+void jsonw_field_bool(JsonWriter *w, const char *key, bool value) {
+    jsonw_key(w, key);
+    jsonw_bool(w, value);
+}
+
+/**
+ * Splices pre-encoded object members into the current object.
+ * @param w Writer
+ * @param fields Comma-separated "key":value pairs, as produced between two jsonw_mark calls
+ * @param len Length of fields (0 writes nothing)
+ */
+void jsonw_fields(JsonWriter *w, const char *fields, size_t len) {
+    if (len == 0) return;
+    jsonw_separator(w);
+    jsonw_append(w, fields, len);
+}
+
+/**
+ * Starts a standalone run of members at the current position, with no
+ * separator owed to what precedes it. Used to encode reusable fragments.
+ * @param w Writer
+ * @return Current length of the message
+ */
+size_t jsonw_mark(JsonWriter *w) {
+    w->need_comma = false;
+    return w->buf ? w->buf->len : 0;
+}
+
+/**
+ * Terminates the message with its newline and hands the buffer over.
+ * @param w Writer (empty afterwards)
+ * @return Buffer with one reference, NULL if an allocation failed
+ */
+MsgBuf* jsonw_finish(JsonWriter *w) {
+    jsonw_append(w, "\n\0", 2);
+    if (w->buf) w->buf->len--;
+    MsgBuf *buf = w->buf;
+    w->buf = NULL;
+    return buf;
+}
+
+/**
+ * Drops a message that will not be sent.
+ * @param w Writer (empty afterwards)
+ */
+void jsonw_discard(JsonWriter *w) {
+    free(w->buf);
+    w->buf = NULL;
+}
@@ -0,0 +1,261 @@
+#include "leaderboard.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LEADERBOARD_MIN_CAPACITY 16
+
+/**
+ * Tells whether a player ranks before another.
+ * @param a Node of the first player
+ * @param b Node of the second player
+ * @return true if a ranks before b
+ */
+static bool ranks_before(const LeaderNode *a, const LeaderNode *b) {
+    if (a->key != b->key) return a->key > b->key;
+    return a->seq < b->seq;
+}
+
+/**
+ * Node count of a subtree.
+ * @param board Leaderboard
+ * @param node Subtree root, -1 for none
+ * @return Number of nodes
+ */
+static int subtree_size(const Leaderboard *board, int node) {
+    return node < 0 ? 0 : board->nodes[node].size;
+}
+
+/**
+ * Recomputes the subtree count of a node from its children.
+ * @param board Leaderboard
+ * @param node Node to update
+ */
+static void update_size(Leaderboard *board, int node) {
+    LeaderNode *n = &board->nodes[node];
+    n->size = 1 + subtree_size(board, n->left) + subtree_size(board, n->right);
+}
+
+/**
+ * Joins two subtrees, every node of the first ranking before the second.
+ * @param board Leaderboard
+ * @param a First subtree, -1 if empty
+ * @param b Second subtree, -1 if empty
+ * @return Root of the joined tree
+ */
+static int merge(Leaderboard *board, int a, int b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    if (board->nodes[a].priority > board->nodes[b].priority) {
+        board->nodes[a].right = merge(board, board->nodes[a].right, b);
+        update_size(board, a);
+        return a;
+    }
+    board->nodes[b].left = merge(board, a, board->nodes[b].left);
+    update_size(board, b);
+    return b;
+}
+
+/**
+ * Splits a subtree into the nodes ranking before a pivot and the others.
+ * @param board Leaderboard
+ * @param root Subtree to split, -1 if empty
+ * @param pivot Node compared against, not in the subtree
+ * @param before Output, nodes ranking before the pivot
+ * @param after Output, nodes ranking after it
+ */
+static void split(Leaderboard *board, int root, const LeaderNode *pivot, int *before, int *after) {
+    if (root < 0) {
+        *before = *after = -1;
+        return;
+    }
+    LeaderNode *n = &board->nodes[root];
+    if (ranks_before(n, pivot)) {
+        split(board, n->right, pivot, &n->right, after);
+        *before = root;
+    } else {
+        split(board, n->left, pivot, before, &n->left);
+        *after = root;
+    }
+    update_size(board, root);
+}
+
+/**
+ * Unlinks a node from a subtree.
+ * @param board Leaderboard
+ * @param root Subtree containing the node
+ * @param node Node to unlink
+ * @return New root of the subtree
+ */
+static int unlink_node(Leaderboard *board, int root, int node) {
+    if (root == node) {
+        return merge(board, board->nodes[node].left, board->nodes[node].right);
+    }
+    LeaderNode *n = &board->nodes[root];
+    if (ranks_before(&board->nodes[node], n)) {
+        n->left = unlink_node(board, n->left, node);
+    } else {
+        n->right = unlink_node(board, n->right, node);
+    }
+    update_size(board, root);
+    return root;
+}
+
+/**
+ * Links a detached node at its place in the tree.
+ * @param board Leaderboard
+ * @param node Node with its key set
+ */
+static void link_node(Leaderboard *board, int node) {
+    LeaderNode *n = &board->nodes[node];
+    n->left = n->right = -1;
+    n->size = 1;
+
+    int before, after;
+    split(board, board->root, n, &before, &after);
+    board->root = merge(board, merge(board, before, node), after);
+}
+
+/**
+ * Initializes an empty leaderboard sized for an expected number of players.
+ * @param board Leaderboard to initialize
+ * @param expected Expected number of players
+ * @return 0 on success, -1 on allocation failure
+ */
+int leaderboard_init(Leaderboard *board, int expected) {
+    memset(board, 0, sizeof(Leaderboard));
+    int capacity = LEADERBOARD_MIN_CAPACITY;
+    while (capacity < expected) capacity <<= 1;
+
+    board->nodes = malloc((size_t)capacity * sizeof(LeaderNode));
+    if (!board->nodes) return -1;
+    board->capacity = capacity;
+    board->free_head = -1;
+    board->root = -1;
+    board->seed = 2463534242u;
+    return 0;
+}
+
+/**
+ * Releases the nodes. Safe on a zeroed leaderboard.
+ * @param board Leaderboard to destroy
+ */
+void leaderboard_destroy(Leaderboard *board) {
+    free(board->nodes);
+    memset(board, 0, sizeof(Leaderboard));
+}
+
+/**
+ * Adds a player at its rank, after the players already there with the
+ * same key.
+ * @param board Leaderboard to update
+ * @param client_id Player, absent from the leaderboard
+ * @param key Ranking key
+ * @return Node of the player, -1 on allocation failure
+ */
+int leaderboard_insert(Leaderboard *board, int client_id, long long key) {
+    int node = board->free_head;
+    if (node >= 0) {
+        board->free_head = board->nodes[node].left;
+    } else {
+        if (board->used == board->capacity) {
+            int capacity = board->capacity ? board->capacity * 2 : LEADERBOARD_MIN_CAPACITY;
+            LeaderNode *grown = realloc(board->nodes, (size_t)capacity * sizeof(LeaderNode));
+            if (!grown) return -1;
+            board->nodes = grown;
+            board->capacity = capacity;
+        }
+        node = board->used++;
+    }
+
+    board->seed ^= board->seed << 13;
+    board->seed ^= board->seed >> 17;
+    board->seed ^= board->seed << 5;
+
+    LeaderNode *n = &board->nodes[node];
+    n->key = key;
+    n->client_id = client_id;
+    n->seq = board->next_seq++;
+    n->priority = board->seed;
+    link_node(board, node);
+    return node;
+}
+
+/**
+ * Removes a player and releases its node.
+ * @param board Leaderboard to update
+ * @param node Node returned by leaderboard_insert
+ */
+void leaderboard_remove(Leaderboard *board, int node) {
+    board->root = unlink_node(board, board->root, node);
+    board->nodes[node].left = board->free_head;
+    board->free_head = node;
+}
+
+/**
+ * Moves a player to the rank of its new key. The node stays the same.
+ * @param board Leaderboard to update
+ * @param node Node of the player
+ * @param key New ranking key
+ */
+void leaderboard_update(Leaderboard *board, int node, long long key) {
+    if (board->nodes[node].key == key) return;
+    board->root = unlink_node(board, board->root, node);
+    board->nodes[node].key = key;
+    link_node(board, node);
+}
+
+/**
+ * Computes the rank of a player by walking down from the root.
+ * @param board Leaderboard
+ * @param node Node of the player
+ * @return 1-based rank, -1 if the node is not linked
+ */
+int leaderboard_rank(const Leaderboard *board, int node) {
+    int rank = 0;
+    int current = board->root;
+    while (current >= 0) {
+        const LeaderNode *n = &board->nodes[current];
+        if (current == node) {
+            return rank + subtree_size(board, n->left) + 1;
+        }
+        if (ranks_before(&board->nodes[node], n)) {
+            current = n->left;
+        } else {
+            rank += subtree_size(board, n->left) + 1;
+            current = n->right;
+        }
+    }
+    return -1;
+}
+
+/**
+ * In-order walk collecting client IDs until k are found.
+ * @param board Leaderboard
+ * @param node Subtree root, -1 if empty
+ * @param k Number of players wanted
+ * @param client_ids Output
+ * @param found Number of players collected so far, updated
+ */
+static void collect(const Leaderboard *board, int node, int k, int *client_ids, int *found) {
+    if (node < 0 || *found >= k) return;
+    const LeaderNode *n = &board->nodes[node];
+    collect(board, n->left, k, client_ids, found);
+    if (*found < k) {
+        client_ids[(*found)++] = n->client_id;
+    }
+    collect(board, n->right, k, client_ids, found);
+}
+
+/**
+ * Lists the best players.
+ * @param board Leaderboard
+ * @param k Maximum number of players
+ * @param client_ids Output, room for k IDs
+ * @return Number of IDs written, best first
+ */
+int leaderboard_top(const Leaderboard *board, int k, int *client_ids) {
+    int found = 0;
+    collect(board, board->root, k, client_ids, &found);
+    return found;
+}
@@ -0,0 +1,768 @@
+#include "log.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define LOG_RING_ENTRIES 512           /**< Per-thread ring size (power of two) */
+#define LOG_MAX_RINGS 1024             /**< Threads that can hold a ring at once */
+#define LOG_LINE_MAX 2048              /**< Longest formatted line */
+#define LOG_DRAIN_IDLE_MS 2            /**< Drain thread sleep when all rings are empty */
+#define LOG_FORMAT_IDS 4096            /**< Distinct (tag, format) pairs in a binary log */
+
+/**
+ * One message as captured by the producing thread: the format is kept by
+ * pointer (always a literal) and the arguments in raw binary form.
+ */
+typedef struct {
+    uint64_t time_ns;
+    const char *tag;
+    const char *format;
+    uint8_t level;
+    uint8_t truncated;
+    uint16_t args_len;
+    unsigned char args[LOG_ARGS_SIZE];
+} LogEntry;
+
+enum { RING_ACTIVE, RING_ORPHANED, RING_FREE };
+
+/**
+ * Single-producer single-consumer ring owned by one thread. head is only
+ * written by the owner, tail only by the drain thread.
+ */
+typedef struct {
+    uint32_t head;
+    uint32_t cached_tail;          /**< Owner's last view of tail, refreshed when full */
+    char head_pad[56];
+    uint32_t tail;
+    char tail_pad[60];
+    uint32_t dropped;              /**< Messages lost because the ring was full */
+    int status;                    /**< RING_ACTIVE / RING_ORPHANED / RING_FREE */
+    LogEntry entries[LOG_RING_ENTRIES];
+} LogRing;
+
+/**
+ * Pending range of one ring during a drain pass.
+ */
+typedef struct {
+    LogRing *ring;
+    uint32_t tail;
+    uint32_t head;
+} PendingRing;
+
+typedef struct {
+    const char *tag;
+    const char *format;
+    uint32_t id;
+} FormatId;
+
+/**
+ * Parsed printf conversion. Text ranges point into the format string.
+ */
+typedef struct {
+    const char *flags;
+    int flags_len;
+    const char *width;
+    int width_len;
+    bool width_star;
+    bool has_precision;
+    const char *precision;
+    int precision_len;
+    bool precision_star;
+    char length[3];
+    char conv;
+} FormatSpec;
+
+int log_runtime_level = LOG_LEVEL_INFO;
+
+static LogRing *rings[LOG_MAX_RINGS];
+static int num_rings;
+static int running;
+static int stop_requested;
+static uint32_t lost_messages;
+static pthread_t drain_thread;
+static pthread_key_t ring_key;
+static bool ring_key_created;
+static pthread_mutex_t direct_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static FILE *log_out;
+static bool log_binary;
+static FormatId format_ids[LOG_FORMAT_IDS];
+static uint32_t num_format_ids;
+
+/**
+ * Wall clock time in nanoseconds since the epoch.
+ * @return Current time
+ */
+static uint64_t now_ns(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (ticks - 116444736000000000ULL) * 100;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Parses one conversion specification.
+ * @param p Character after the '%'
+ * @param spec Receives the parsed parts
+ * @return Pointer past the conversion character, NULL if unsupported
+ */
+static const char* parse_spec(const char *p, FormatSpec *spec) {
+    memset(spec, 0, sizeof(FormatSpec));
+
+    spec->flags = p;
+    while (*p && strchr("-+ #0", *p)) p++;
+    spec->flags_len = (int)(p - spec->flags);
+
+    spec->width = p;
+    if (*p == '*') {
+        spec->width_star = true;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    spec->width_len = (int)(p - spec->width);
+
+    if (*p == '.') {
+        spec->has_precision = true;
+        p++;
+        spec->precision = p;
+        if (*p == '*') {
+            spec->precision_star = true;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') p++;
+        }
+        spec->precision_len = (int)(p - spec->precision);
+    }
+
+    int n = 0;
+    while (*p && strchr("hlzjtL", *p) && n < 2) spec->length[n++] = *p++;
+
+    if (!*p || !strchr("diuoxXcseEfFgGaApn", *p)) return NULL;
+    spec->conv = *p;
+    return p + 1;
+}
+
+/**
+ * Appends a fixed-size value to an argument buffer.
+ * @return true if it fit
+ */
+static bool put_bytes(unsigned char *buf, size_t size, size_t *pos, const void *data, size_t len) {
+    if (*pos + len > size) return false;
+    memcpy(buf + *pos, data, len);
+    *pos += len;
+    return true;
+}
+
+/**
+ * Reads a fixed-size value from an argument buffer.
+ * @return true if enough bytes were left
+ */
+static bool get_bytes(const unsigned char *buf, size_t size, size_t *pos, void *data, size_t len) {
+    if (*pos + len > size) return false;
+    memcpy(data, buf + *pos, len);
+    *pos += len;
+    return true;
+}
+
+/**
+ * Captures the arguments of a message in binary form, following the
+ * conversions of its format: integers and pointers as 64-bit values,
+ * floating point as double, strings as a 16-bit length and their bytes.
+ * This runs on the logging thread, so it scans the format in a single
+ * pass and leaves all formatting work to the drain thread.
+ * @param buf Destination
+ * @param size Destination size
+ * @param format printf-style format
+ * @param ap Arguments
+ * @param truncated Set when arguments did not fit or a conversion is unknown
+ * @return Number of bytes written
+ */
+static size_t encode_args(unsigned char *buf, size_t size, const char *format, va_list ap, bool *truncated) {
+    enum { LEN_NONE, LEN_HH, LEN_H, LEN_L, LEN_LL, LEN_Z, LEN_J, LEN_T, LEN_LD };
+    size_t pos = 0;
+    int64_t star;
+    *truncated = false;
+
+    for (const char *p = strchr(format, '%'); p; p = strchr(p, '%')) {
+        p++;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') p++;
+        if (*p == '*') {
+            star = va_arg(ap, int);
+            if (!put_bytes(buf, size, &pos, &star, sizeof(star))) goto full;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') p++;
+
+        int precision = -1;
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                star = va_arg(ap, int);
+                precision = (int)star;
+                if (!put_bytes(buf, size, &pos, &star, sizeof(star))) goto full;
+                p++;
+            } else {
+                precision = 0;
+                while (*p >= '0' && *p <= '9') precision = precision * 10 + (*p++ - '0');
+            }
+        }
+
+        int length = LEN_NONE;
+        switch (*p) {
+            case 'h': length = (p[1] == 'h') ? LEN_HH : LEN_H; break;
+            case 'l': length = (p[1] == 'l') ? LEN_LL : LEN_L; break;
+            case 'z': length = LEN_Z; break;
+            case 'j': length = LEN_J; break;
+            case 't': length = LEN_T; break;
+            case 'L': length = LEN_LD; break;
+        }
+        if (length == LEN_HH || length == LEN_LL) p += 2;
+        else if (length != LEN_NONE) p++;
+
+        switch (*p++) {
+            case 'd': case 'i': case 'c': {
+                int64_t v;
+                switch (length) {
+                    case LEN_LL: case LEN_J: v = va_arg(ap, long long); break;
+                    case LEN_L: v = va_arg(ap, long); break;
+                    case LEN_Z: case LEN_T: v = va_arg(ap, ptrdiff_t); break;
+                    case LEN_HH: v = (signed char)va_arg(ap, int); break;
+                    case LEN_H: v = (short)va_arg(ap, int); break;
+                    default: v = va_arg(ap, int); break;
+                }
+                if (!put_bytes(buf, size, &pos, &v, sizeof(v))) goto full;
+                break;
+            }
+            case 'u': case 'o': case 'x': case 'X': {
+                uint64_t v;
+                switch (length) {
+                    case LEN_LL: case LEN_J: case LEN_T: v = va_arg(ap, unsigned long long); break;
+                    case LEN_L: v = va_arg(ap, unsigned long); break;
+                    case LEN_Z: v = va_arg(ap, size_t); break;
+                    case LEN_HH: v = (unsigned char)va_arg(ap, unsigned int); break;
+                    case LEN_H: v = (unsigned short)va_arg(ap, unsigned int); break;
+                    default: v = va_arg(ap, unsigned int); break;
+                }
+                if (!put_bytes(buf, size, &pos, &v, sizeof(v))) goto full;
+                break;
+            }
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A': {
+                double v = (length == LEN_LD) ? (double)va_arg(ap, long double) : va_arg(ap, double);
+                if (!put_bytes(buf, size, &pos, &v, sizeof(v))) goto full;
+                break;
+            }
+            case 'p': {
+                uint64_t v = (uint64_t)(uintptr_t)va_arg(ap, void*);
+                if (!put_bytes(buf, size, &pos, &v, sizeof(v))) goto full;
+                break;
+            }
+            case 's': {
+                const char *s = va_arg(ap, const char*);
+                if (!s) s = "(null)";
+                if (pos + sizeof(uint16_t) > size) goto full;
+
+                // Copy while scanning; the length goes in front afterwards
+                size_t limit = size - pos - sizeof(uint16_t);
+                if (precision >= 0 && (size_t)precision < limit) limit = (size_t)precision;
+                unsigned char *dst = buf + pos + sizeof(uint16_t);
+                size_t n = 0;
+                while (n < limit && s[n]) {
+                    dst[n] = (unsigned char)s[n];
+                    n++;
+                }
+                if ((precision < 0 || n < (size_t)precision) && s[n]) *truncated = true;
+
+                uint16_t n16 = (uint16_t)n;
+                memcpy(buf + pos, &n16, sizeof(n16));
+                pos += sizeof(n16) + n;
+                break;
+            }
+            case 'n':
+                (void)va_arg(ap, void*);
+                break;
+            default:
+                // Unknown conversion: stop before va_list gets out of step
+                *truncated = true;
+                return pos;
+        }
+    }
+    return pos;
+
+full:
+    *truncated = true;
+    return pos;
+}
+
+/**
+ * Formats the "HH:MM:SS.mmm [TAG] " prefix of a line.
+ * @return Number of characters written
+ */
+static int format_prefix(char *out, size_t size, uint64_t time_ns, const char *tag) {
+    time_t secs = (time_t)(time_ns / 1000000000ULL);
+    int millis = (int)((time_ns / 1000000ULL) % 1000);
+    struct tm tm_info;
+#ifdef _WIN32
+    localtime_s(&tm_info, &secs);
+#else
+    localtime_r(&secs, &tm_info);
+#endif
+    int n = snprintf(out, size, "%02d:%02d:%02d.%03d [%s] ", tm_info.tm_hour, tm_info.tm_min,
+                     tm_info.tm_sec, millis, tag);
+    return n < 0 ? 0 : (n >= (int)size ? (int)size - 1 : n);
+}
+
+/**
+ * Formats a captured message back into text. Integer conversions are
+ * printed through a long long specifier, so the line reads exactly as
+ * printf would have produced it.
+ * @param out Destination buffer
+ * @param size Destination size
+ * @param time_ns Message timestamp
+ * @param tag Message tag
+ * @param format Original format
+ * @param args Encoded arguments
+ * @param args_len Length of args
+ * @param truncated Whether arguments were cut at capture time
+ */
+void log_format_line(char *out, size_t size, uint64_t time_ns, const char *tag,
+                     const char *format, const unsigned char *args, size_t args_len,
+                     bool truncated) {
+    size_t used = (size_t)format_prefix(out, size, time_ns, tag);
+    size_t pos = 0;
+
+    for (const char *p = format; *p && used + 1 < size; p++) {
+        if (*p != '%') {
+            out[used++] = *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[used++] = '%';
+            p++;
+            continue;
+        }
+
+        FormatSpec spec;
+        const char *end = parse_spec(p + 1, &spec);
+        if (!end) break;
+
+        // Rebuild the specifier with '*' replaced and the length normalized
+        char fmt[64];
+        int64_t star;
+        int f = snprintf(fmt, sizeof(fmt), "%%%.*s", spec.flags_len, spec.flags);
+        if (spec.width_star) {
+            if (!get_bytes(args, args_len, &pos, &star, sizeof(star))) break;
+            f += snprintf(fmt + f, sizeof(fmt) - f, "%d", (int)star);
+        } else {
+            f += snprintf(fmt + f, sizeof(fmt) - f, "%.*s", spec.width_len, spec.width);
+        }
+        if (spec.precision_star) {
+            if (!get_bytes(args, args_len, &pos, &star, sizeof(star))) break;
+            f += snprintf(fmt + f, sizeof(fmt) - f, ".%d", (int)star);
+        } else if (spec.has_precision) {
+            f += snprintf(fmt + f, sizeof(fmt) - f, ".%.*s", spec.precision_len, spec.precision);
+        }
+
+        int n = 0;
+        switch (spec.conv) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': {
+                int64_t v;
+                if (!get_bytes(args, args_len, &pos, &v, sizeof(v))) goto done;
+                snprintf(fmt + f, sizeof(fmt) - f, "ll%c", spec.conv);
+                n = snprintf(out + used, size - used, fmt, (long long)v);
+                break;
+            }
+            case 'c': {
+                int64_t v;
+                if (!get_bytes(args, args_len, &pos, &v, sizeof(v))) goto done;
+                snprintf(fmt + f, sizeof(fmt) - f, "c");
+                n = snprintf(out + used, size - used, fmt, (int)v);
+                break;
+            }
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A': {
+                double v;
+                if (!get_bytes(args, args_len, &pos, &v, sizeof(v))) goto done;
+                snprintf(fmt + f, sizeof(fmt) - f, "%c", spec.conv);
+                n = snprintf(out + used, size - used, fmt, v);
+                break;
+            }
+            case 'p': {
+                uint64_t v;
+                if (!get_bytes(args, args_len, &pos, &v, sizeof(v))) goto done;
+                snprintf(fmt + f, sizeof(fmt) - f, "p");
+                n = snprintf(out + used, size - used, fmt, (void*)(uintptr_t)v);
+                break;
+            }
+            case 's': {
+                uint16_t len;
+                char str[LOG_ARGS_SIZE + 1];
+                if (!get_bytes(args, args_len, &pos, &len, sizeof(len)) || len > LOG_ARGS_SIZE ||
+                    !get_bytes(args, args_len, &pos, str, len)) {
+                    goto done;
+                }
+                str[len] = '\0';
+                snprintf(fmt + f, sizeof(fmt) - f, "s");
+                n = snprintf(out + used, size - used, fmt, str);
+                break;
+            }
+            case 'n':
+                break;
+        }
+        if (n > 0) used += (size_t)n < size - used ? (size_t)n : size - used - 1;
+        p = end - 1;
+    }
+
+done:
+    if (truncated && used + 12 < size) {
+        memcpy(out + used, " [truncated]", 12);
+        used += 12;
+    }
+    out[used < size ? used : size - 1] = '\0';
+}
+
+/**
+ * Formats and writes a message synchronously. Used when the drain thread
+ * is not running (startup, shutdown, tools).
+ */
+static void write_direct(const char *tag, const char *format, va_list ap) {
+    char line[LOG_LINE_MAX];
+    int used = format_prefix(line, sizeof(line) - 1, now_ns(), tag);
+    int n = vsnprintf(line + used, sizeof(line) - 1 - used, format, ap);
+    if (n > 0) used += n < (int)sizeof(line) - 1 - used ? n : (int)sizeof(line) - 2 - used;
+    line[used++] = '\n';
+
+    pthread_mutex_lock(&direct_mutex);
+    fwrite(line, 1, (size_t)used, stdout);
+    fflush(stdout);
+    pthread_mutex_unlock(&direct_mutex);
+}
+
+/**
+ * Thread exit hook: hands the ring back once the drain thread emptied it.
+ * @param arg Ring of the exiting thread
+ */
+static void release_ring(void *arg) {
+    LogRing *ring = arg;
+    __atomic_store_n(&ring->status, RING_ORPHANED, __ATOMIC_RELEASE);
+}
+
+/**
+ * Returns the calling thread's ring, taking a free one or allocating a
+ * new one on first use.
+ * @return Ring, NULL if every slot is taken or memory ran out
+ */
+static LogRing* thread_ring(void) {
+    LogRing *ring = pthread_getspecific(ring_key);
+    if (ring) return ring;
+
+    int count = __atomic_load_n(&num_rings, __ATOMIC_ACQUIRE);
+    if (count > LOG_MAX_RINGS) count = LOG_MAX_RINGS;
+    for (int i = 0; i < count && !ring; i++) {
+        LogRing *candidate = __atomic_load_n(&rings[i], __ATOMIC_ACQUIRE);
+        int expected = RING_FREE;
+        if (candidate && __atomic_compare_exchange_n(&candidate->status, &expected, RING_ACTIVE, false,
+                                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            ring = candidate;
+        }
+    }
+
+    if (!ring) {
+        int index = __atomic_fetch_add(&num_rings, 1, __ATOMIC_ACQ_REL);
+        if (index >= LOG_MAX_RINGS) return NULL;
+        ring = calloc(1, sizeof(LogRing));
+        if (!ring) return NULL;
+        ring->status = RING_ACTIVE;
+        __atomic_store_n(&rings[index], ring, __ATOMIC_RELEASE);
+    }
+
+    pthread_setspecific(ring_key, ring);
+    return ring;
+}
+
+/**
+ * Logs a message. While the logger runs this only captures the raw
+ * arguments into the thread's ring; formatting happens on the drain thread.
+ * @param level Message level
+ * @param tag Subsystem tag
+ * @param format printf-style format (must be a string literal)
+ */
+void log_write(LogLevel level, const char *tag, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        write_direct(tag, format, ap);
+        va_end(ap);
+        return;
+    }
+
+    LogRing *ring = thread_ring();
+    if (!ring) {
+        __atomic_add_fetch(&lost_messages, 1, __ATOMIC_RELAXED);
+        va_end(ap);
+        return;
+    }
+
+    // Only touch the drain thread's cache line when the ring looks full
+    uint32_t head = ring->head;
+    if (head - ring->cached_tail >= LOG_RING_ENTRIES) {
+        ring->cached_tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head - ring->cached_tail >= LOG_RING_ENTRIES) {
+            __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+            va_end(ap);
+            return;
+        }
+    }
+
+    LogEntry *entry = &ring->entries[head & (LOG_RING_ENTRIES - 1)];
+    bool truncated;
+    entry->time_ns = now_ns();
+    entry->tag = tag;
+    entry->format = format;
+    entry->level = (uint8_t)level;
+    entry->args_len = (uint16_t)encode_args(entry->args, sizeof(entry->args), format, ap, &truncated);
+    entry->truncated = truncated;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    va_end(ap);
+}
+
+/**
+ * Returns the id of a (tag, format) pair in the binary log, writing its
+ * definition record the first time it is seen.
+ * @return Id, -1 if the table is full
+ */
+static int64_t binary_format_id(const char *tag, const char *format) {
+    uintptr_t h = ((uintptr_t)format >> 3) * 2654435761u ^ ((uintptr_t)tag >> 3);
+    for (uint32_t probe = 0; probe < LOG_FORMAT_IDS; probe++) {
+        FormatId *slot = &format_ids[(h + probe) & (LOG_FORMAT_IDS - 1)];
+        if (slot->format == format && slot->tag == tag) return slot->id;
+        if (slot->format) continue;
+        if (num_format_ids >= LOG_FORMAT_IDS / 2) return -1;
+
+        slot->tag = tag;
+        slot->format = format;
+        slot->id = num_format_ids++;
+
+        uint8_t type = LOG_RECORD_FORMAT;
+        uint16_t tag_len = (uint16_t)strlen(tag);
+        uint16_t format_len = (uint16_t)strlen(format);
+        fwrite(&type, 1, 1, log_out);
+        fwrite(&slot->id, sizeof(slot->id), 1, log_out);
+        fwrite(&tag_len, sizeof(tag_len), 1, log_out);
+        fwrite(tag, 1, tag_len, log_out);
+        fwrite(&format_len, sizeof(format_len), 1, log_out);
+        fwrite(format, 1, format_len, log_out);
+        return slot->id;
+    }
+    return -1;
+}
+
+/**
+ * Writes one captured message to the log output.
+ * @param entry Message to write
+ */
+static void emit_entry(const LogEntry *entry) {
+    if (log_binary) {
+        int64_t id = binary_format_id(entry->tag, entry->format);
+        if (id < 0) {
+            __atomic_add_fetch(&lost_messages, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        uint8_t header[2] = {LOG_RECORD_EVENT, 0};
+        uint32_t id32 = (uint32_t)id;
+        fwrite(&header[0], 1, 1, log_out);
+        fwrite(&id32, sizeof(id32), 1, log_out);
+        fwrite(&entry->level, 1, 1, log_out);
+        fwrite(&entry->truncated, 1, 1, log_out);
+        fwrite(&entry->time_ns, sizeof(entry->time_ns), 1, log_out);
+        fwrite(&entry->args_len, sizeof(entry->args_len), 1, log_out);
+        fwrite(entry->args, 1, entry->args_len, log_out);
+        return;
+    }
+
+    char line[LOG_LINE_MAX];
+    log_format_line(line, sizeof(line) - 1, entry->time_ns, entry->tag, entry->format,
+                    entry->args, entry->args_len, entry->truncated);
+    size_t len = strlen(line);
+    line[len++] = '\n';
+    fwrite(line, 1, len, log_out);
+}
+
+/**
+ * Empties every ring, merging their entries by timestamp.
+ * @return Number of messages written
+ */
+static int drain_rings(void) {
+    static PendingRing pending[LOG_MAX_RINGS];
+    int num_pending = 0;
+    uint32_t dropped = __atomic_exchange_n(&lost_messages, 0, __ATOMIC_RELAXED);
+
+    int count = __atomic_load_n(&num_rings, __ATOMIC_ACQUIRE);
+    if (count > LOG_MAX_RINGS) count = LOG_MAX_RINGS;
+    for (int i = 0; i < count; i++) {
+        LogRing *ring = __atomic_load_n(&rings[i], __ATOMIC_ACQUIRE);
+        if (!ring) continue;
+
+        // Status first: an orphaned ring's last head store is then visible
+        int status = __atomic_load_n(&ring->status, __ATOMIC_ACQUIRE);
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        dropped += __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+
+        if (head != ring->tail) {
+            pending[num_pending].ring = ring;
+            pending[num_pending].tail = ring->tail;
+            pending[num_pending].head = head;
+            num_pending++;
+        } else if (status == RING_ORPHANED) {
+            __atomic_store_n(&ring->status, RING_FREE, __ATOMIC_RELEASE);
+        }
+    }
+
+    int written = 0;
+    while (num_pending > 0) {
+        int oldest = 0;
+        for (int i = 1; i < num_pending; i++) {
+            const PendingRing *a = &pending[i];
+            const PendingRing *b = &pending[oldest];
+            if (a->ring->entries[a->tail & (LOG_RING_ENTRIES - 1)].time_ns <
+                b->ring->entries[b->tail & (LOG_RING_ENTRIES - 1)].time_ns) {
+                oldest = i;
+            }
+        }
+
+        // Space is handed back once the ring's whole pending range is out
+        PendingRing *p = &pending[oldest];
+        emit_entry(&p->ring->entries[p->tail & (LOG_RING_ENTRIES - 1)]);
+        p->tail++;
+        written++;
+
+        if (p->tail == p->head) {
+            __atomic_store_n(&p->ring->tail, p->tail, __ATOMIC_RELEASE);
+            pending[oldest] = pending[--num_pending];
+        }
+    }
+
+    if (dropped > 0 && !log_binary) {
+        char line[128];
+        int n = format_prefix(line, sizeof(line), now_ns(), "LOG");
+        n += snprintf(line + n, sizeof(line) - n, "%u message(s) dropped\n", dropped);
+        fwrite(line, 1, (size_t)n, log_out);
+    }
+    if (written > 0 || dropped > 0) fflush(log_out);
+    return written;
+}
+
+/**
+ * Drain thread: writes out ring contents until shutdown.
+ */
+static void* drain_main(void *arg) {
+    (void)arg;
+    while (!__atomic_load_n(&stop_requested, __ATOMIC_ACQUIRE)) {
+        if (drain_rings() == 0) {
+#ifdef _WIN32
+            Sleep(LOG_DRAIN_IDLE_MS);
+#else
+            usleep(LOG_DRAIN_IDLE_MS * 1000);
+#endif
+        }
+    }
+    drain_rings();
+    return NULL;
+}
+
+/**
+ * Starts the asynchronous logger.
+ * @param config Level, output file and format
+ * @return 0 on success, -1 if the output cannot be opened
+ */
+int log_init(const LogConfig *config) {
+    if (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) return 0;
+
+    log_out = stdout;
+    log_binary = config->binary;
+    if (config->path) {
+        log_out = fopen(config->path, log_binary ? "wb" : "a");
+        if (!log_out) {
+            log_out = stdout;
+            return -1;
+        }
+    } else if (log_binary) {
+        return -1;
+    }
+    if (log_binary) {
+        fwrite(LOG_BINARY_MAGIC, 1, strlen(LOG_BINARY_MAGIC), log_out);
+        memset(format_ids, 0, sizeof(format_ids));
+        num_format_ids = 0;
+    }
+
+    if (!ring_key_created) {
+        pthread_key_create(&ring_key, release_ring);
+        ring_key_created = true;
+    }
+    log_set_level(config->level);
+
+    __atomic_store_n(&stop_requested, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&drain_thread, NULL, drain_main, NULL) != 0) {
+        __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Stops the drain thread after writing out everything captured so far.
+ * Later messages are written synchronously to stdout.
+ */
+void log_shutdown(void) {
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) return;
+
+    __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&stop_requested, 1, __ATOMIC_RELEASE);
+    pthread_join(drain_thread, NULL);
+
+    if (log_out != stdout) fclose(log_out);
+    log_out = stdout;
+}
+
+/**
+ * Changes the runtime level threshold.
+ * @param level Lowest level still written
+ */
+void log_set_level(LogLevel level) {
+    __atomic_store_n(&log_runtime_level, (int)level, __ATOMIC_RELAXED);
+}
+
+/**
+ * Parses a level name.
+ * @param name debug, info, warn, error or off
+ * @return Level, -1 if the name is unknown
+ */
+int log_parse_level(const char *name) {
+    static const char *names[] = {"debug", "info", "warn", "error", "off"};
+    for (int i = 0; i <= LOG_LEVEL_OFF; i++) {
+        if (strcmp(name, names[i]) == 0) return i;
+    }
+    return -1;
+}
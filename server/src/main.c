@@ -30,6 +30,28 @@ void print_usage(const char* program) {
   printf("  --tcp <port>   TCP port (default: %d)\n", DEFAULT_TCP_PORT);
   printf("  --udp <port>   UDP port (default: %d)\n", DEFAULT_UDP_PORT);
   printf("  --name <name>  Server name (default: QuizNet #XXXX)\n");
+  printf("  --io-mode <m>  I/O model: threads or epoll (default: threads)\n");
+  printf("  --io-threads <n> Reactor threads in epoll mode (default: %d)\n",
+         DEFAULT_IO_THREADS);
+  printf("  --max-backlog <bytes> Unsent bytes per client before disconnect (default: %d)\n",
+         DEFAULT_MAX_BACKLOG);
+  printf("  --max-clients <n>  Connected clients limit (default: %d)\n",
+         DEFAULT_MAX_CLIENTS);
+  printf("  --max-sessions <n> Simultaneous sessions limit (default: %d)\n",
+         DEFAULT_MAX_SESSIONS);
+  printf("  --max-accounts <n> Registered accounts limit (default: %d)\n",
+         DEFAULT_MAX_ACCOUNTS);
+  printf("  --auth-threads <n> Password hashing workers (default: %d)\n",
+         DEFAULT_AUTH_THREADS);
+  printf("  --session-threads <n> Session actor workers (default: %d)\n",
+         DEFAULT_SESSION_THREADS);
+  printf("  --metrics-port <port> Loopback port serving GET /metrics, 0 for none (default: %d)\n",
+         DEFAULT_METRICS_PORT);
+  printf("  --log-level <l>    debug, info, warn, error or off (default: info)\n");
+  printf("  --log-file <path>  Write the log to a file instead of stdout\n");
+  printf("  --log-format <f>   text or binary (binary needs --log-file, read with logdecode)\n");
+  printf("  --trace-sample <n>     Log the body of 1 request in n (default: off)\n");
+  printf("  --trace-endpoint <e>   Log every request to endpoint e (repeatable)\n");
   printf("  -h, --help     Show this help\n");
 }
 
@@ -37,6 +59,18 @@ int main(int argc, char* argv[]) {
   int tcp_port = DEFAULT_TCP_PORT;
   int udp_port = DEFAULT_UDP_PORT;
   char* custom_name = NULL;
+  IoMode io_mode = IO_MODE_THREADS;
+  int io_threads = DEFAULT_IO_THREADS;
+  int auth_threads = DEFAULT_AUTH_THREADS;
+  int session_threads = DEFAULT_SESSION_THREADS;
+  int metrics_port = DEFAULT_METRICS_PORT;
+  long max_backlog = DEFAULT_MAX_BACKLOG;
+  LogConfig log_config = {LOG_LEVEL_INFO, NULL, false};
+  ServerLimits limits = {DEFAULT_MAX_CLIENTS, DEFAULT_MAX_SESSIONS,
+                         DEFAULT_MAX_ACCOUNTS};
+  int trace_sample = 0;
+  const char* trace_endpoints[TRACE_MAX_ENDPOINTS];
+  int num_trace_endpoints = 0;
 
   for (int i = 1; i < argc; i++)
     if (strcmp(argv[i], "--tcp") == 0) {
@@ -45,6 +79,39 @@ int main(int argc, char* argv[]) {
       if (i + 1 < argc) udp_port = atoi(argv[++i]);
     } else if (strcmp(argv[i], "--name") == 0) {
       if (i + 1 < argc) custom_name = argv[++i];
+    } else if (strcmp(argv[i], "--io-mode") == 0) {
+      if (i + 1 < argc)
+        io_mode = strcmp(argv[++i], "epoll") == 0 ? IO_MODE_EPOLL : IO_MODE_THREADS;
+    } else if (strcmp(argv[i], "--io-threads") == 0) {
+      if (i + 1 < argc) io_threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--auth-threads") == 0) {
+      if (i + 1 < argc) auth_threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--session-threads") == 0) {
+      if (i + 1 < argc) session_threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--metrics-port") == 0) {
+      if (i + 1 < argc) metrics_port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--max-backlog") == 0) {
+      if (i + 1 < argc) max_backlog = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--max-clients") == 0) {
+      if (i + 1 < argc) limits.max_clients = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--max-sessions") == 0) {
+      if (i + 1 < argc) limits.max_sessions = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--max-accounts") == 0) {
+      if (i + 1 < argc) limits.max_accounts = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--log-level") == 0) {
+      if (i + 1 < argc) {
+        int level = log_parse_level(argv[++i]);
+        if (level >= 0) log_config.level = (LogLevel)level;
+      }
+    } else if (strcmp(argv[i], "--log-file") == 0) {
+      if (i + 1 < argc) log_config.path = argv[++i];
+    } else if (strcmp(argv[i], "--log-format") == 0) {
+      if (i + 1 < argc) log_config.binary = strcmp(argv[++i], "binary") == 0;
+    } else if (strcmp(argv[i], "--trace-sample") == 0) {
+      if (i + 1 < argc) trace_sample = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--trace-endpoint") == 0) {
+      if (i + 1 < argc && num_trace_endpoints < TRACE_MAX_ENDPOINTS)
+        trace_endpoints[num_trace_endpoints++] = argv[++i];
     } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
       print_usage(argv[0]);
       return 0;
@@ -52,6 +119,11 @@ int main(int argc, char* argv[]) {
 
   printf("QuizNet\n\n");
 
+  if (log_init(&log_config) < 0) {
+    printf("Failed to open log output\n");
+    return 1;
+  }
+
   init_random();
 
 #ifdef _WIN32
@@ -66,8 +138,9 @@ int main(int argc, char* argv[]) {
   sigaction(SIGTERM, &sa, NULL);
 #endif
 
-  if (init_server(&server_state, tcp_port, udp_port) < 0) {
+  if (init_server(&server_state, tcp_port, udp_port, &limits) < 0) {
     printf("Failed to initialize server\n");
+    log_shutdown();
     return 1;
   }
 
@@ -79,8 +152,19 @@ int main(int argc, char* argv[]) {
     snprintf(server_state.server_name, sizeof(server_state.server_name),
              "QuizNet #%04d", rand() % 10000);
 
+  server_state.io_mode = io_mode;
+  server_state.num_io_threads = io_threads > 0 ? io_threads : 1;
+  server_state.num_auth_threads = auth_threads > 0 ? auth_threads : 1;
+  server_state.num_session_threads = session_threads > 0 ? session_threads : 1;
+  server_state.metrics_port = metrics_port > 0 ? metrics_port : 0;
+  server_state.max_backlog = max_backlog > 0 ? (size_t)max_backlog : DEFAULT_MAX_BACKLOG;
+  trace_set_sample_rate(&server_state.trace, trace_sample);
+  for (int i = 0; i < num_trace_endpoints; i++)
+    trace_set_endpoint(&server_state.trace, trace_endpoints[i], true);
+
   run_server(&server_state);
   cleanup_server(&server_state);
+  log_shutdown();
 
   printf("Server stopped.\n");
   return 0;
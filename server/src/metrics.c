@@ -0,0 +1,445 @@
+#include "metrics.h"
+#include "endpoints.h"
+#include "utils.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define METRICS_SHARDS 32              /**< Threads beyond this share shards */
+#define METRICS_LINEAR 16              /**< Values below this (us) get a bucket each */
+#define METRICS_SUB_BITS 3             /**< 8 sub-buckets per power of two */
+#define METRICS_BUCKETS 256            /**< Up to 2^34 us (about 4.7 hours) */
+#define METRICS_HISTOGRAMS (NUM_ENDPOINTS + SECTION_COUNT)
+#define METRICS_POLL_MS 200            /**< Stop flag check interval of the listener */
+#define METRICS_REQUEST_MAX 1024       /**< Scrape request head, anything longer is cut */
+#define METRICS_TIMEOUT_MS 1000        /**< A slow scraper cannot hold the listener longer */
+
+typedef struct {
+    uint64_t buckets[METRICS_BUCKETS]; /**< Observations per log-linear bucket */
+    uint64_t sum_us;               /**< Sum of observations in microseconds */
+} Histogram;
+
+typedef struct {
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    Histogram histograms[METRICS_HISTOGRAMS];
+} __attribute__((aligned(64))) MetricsShard;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    bool failed;                   /**< An allocation failed, the text is truncated */
+} MetricsText;
+
+static MetricsShard shards[METRICS_SHARDS];
+static int next_shard;
+static __thread int thread_shard = -1;
+
+static const char *section_names[SECTION_COUNT] = {
+    "broadcast",
+    "question_results",
+    "end_session"
+};
+
+// Bucket boundaries exposed to Prometheus, in microseconds
+static const uint64_t exposed_le_us[] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+
+static struct {
+    ServerState *state;
+    int socket;
+    pthread_t thread;
+    bool running;                  /**< Listener stop flag (atomic) */
+} listener = { NULL, -1, 0, false };
+
+/**
+ * Returns the calling thread's shard, assigned round-robin on first use.
+ * @return Shard to update
+ */
+static MetricsShard* my_shard(void) {
+    if (thread_shard < 0) {
+        thread_shard = __atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED) % METRICS_SHARDS;
+    }
+    return &shards[thread_shard];
+}
+
+/**
+ * Maps a duration to its log-linear bucket.
+ * @param us Duration in microseconds
+ * @return Bucket index, the last one for anything out of range
+ */
+static int bucket_of(uint64_t us) {
+    if (us < METRICS_LINEAR) return (int)us;
+    int exponent = 63 - __builtin_clzll(us);
+    int sub = (int)(us >> (exponent - METRICS_SUB_BITS)) & ((1 << METRICS_SUB_BITS) - 1);
+    int index = METRICS_LINEAR + ((exponent - 4) << METRICS_SUB_BITS) + sub;
+    return index < METRICS_BUCKETS ? index : METRICS_BUCKETS - 1;
+}
+
+/**
+ * Exclusive upper bound of a bucket.
+ * @param index Bucket index
+ * @return Smallest duration (us) above the bucket
+ */
+static uint64_t bucket_upper(int index) {
+    if (index < METRICS_LINEAR) return (uint64_t)index + 1;
+    int exponent = ((index - METRICS_LINEAR) >> METRICS_SUB_BITS) + 4;
+    int sub = (index - METRICS_LINEAR) & ((1 << METRICS_SUB_BITS) - 1);
+    return (uint64_t)((1 << METRICS_SUB_BITS) + sub + 1) << (exponent - METRICS_SUB_BITS);
+}
+
+/**
+ * Records one duration in the calling thread's copy of a histogram.
+ * @param histogram Histogram index (endpoints first, then sections)
+ * @param elapsed_ms Duration in milliseconds
+ */
+static void observe(int histogram, double elapsed_ms) {
+    uint64_t us = elapsed_ms > 0 ? (uint64_t)(elapsed_ms * 1000.0) : 0;
+    Histogram *h = &my_shard()->histograms[histogram];
+    __atomic_fetch_add(&h->buckets[bucket_of(us)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_us, us, __ATOMIC_RELAXED);
+}
+
+/**
+ * Adds to a counter.
+ * @param counter Counter to increment
+ * @param amount Value to add
+ */
+void metrics_count(MetricCounter counter, uint64_t amount) {
+    __atomic_fetch_add(&my_shard()->counters[counter], amount, __ATOMIC_RELAXED);
+}
+
+/**
+ * Records the time taken by a request.
+ * @param index Registry position of the endpoint (endpoint_index())
+ * @param elapsed_ms Routing and handling time in milliseconds
+ */
+void metrics_observe_endpoint(int index, double elapsed_ms) {
+    if (index < 0 || index >= NUM_ENDPOINTS) return;
+    observe(index, elapsed_ms);
+}
+
+/**
+ * Records the time taken by a timed section of the game loop.
+ * @param section Section that ran
+ * @param elapsed_ms Duration in milliseconds
+ */
+void metrics_observe(MetricSection section, double elapsed_ms) {
+    observe(NUM_ENDPOINTS + section, elapsed_ms);
+}
+
+/**
+ * Appends formatted text to the scrape output, growing it as needed.
+ * @param text Output being built
+ * @param format printf-style format
+ */
+static void text_printf(MetricsText *text, const char *format, ...) {
+    if (text->failed) return;
+
+    for (;;) {
+        size_t room = text->cap - text->len;
+        va_list args;
+        va_start(args, format);
+        int needed = vsnprintf(text->data + text->len, room, format, args);
+        va_end(args);
+        if (needed < 0) {
+            text->failed = true;
+            return;
+        }
+        if ((size_t)needed < room) {
+            text->len += (size_t)needed;
+            return;
+        }
+
+        size_t cap = text->cap ? text->cap * 2 : 16384;
+        while (cap - text->len <= (size_t)needed) cap *= 2;
+        char *grown = realloc(text->data, cap);
+        if (!grown) {
+            text->failed = true;
+            return;
+        }
+        text->data = grown;
+        text->cap = cap;
+    }
+}
+
+/**
+ * Writes one histogram series (buckets, sum and count) summed over shards.
+ * @param text Output being built
+ * @param name Metric family name
+ * @param label_name Label distinguishing the series
+ * @param label_value Value of that label
+ * @param histogram Histogram index
+ */
+static void render_histogram(MetricsText *text, const char *name, const char *label_name,
+                             const char *label_value, int histogram) {
+    uint64_t buckets[METRICS_BUCKETS] = {0};
+    uint64_t sum_us = 0;
+    for (int s = 0; s < METRICS_SHARDS; s++) {
+        const Histogram *h = &shards[s].histograms[histogram];
+        for (int b = 0; b < METRICS_BUCKETS; b++) {
+            buckets[b] += __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+        }
+        sum_us += __atomic_load_n(&h->sum_us, __ATOMIC_RELAXED);
+    }
+
+    uint64_t cumulative = 0;
+    int b = 0;
+    for (size_t i = 0; i < sizeof(exposed_le_us) / sizeof(exposed_le_us[0]); i++) {
+        while (b < METRICS_BUCKETS && bucket_upper(b) <= exposed_le_us[i]) {
+            cumulative += buckets[b++];
+        }
+        text_printf(text, "%s_bucket{%s=\"%s\",le=\"%g\"} %llu\n", name, label_name, label_value,
+                    (double)exposed_le_us[i] / 1e6, (unsigned long long)cumulative);
+    }
+    while (b < METRICS_BUCKETS) {
+        cumulative += buckets[b++];
+    }
+    text_printf(text, "%s_bucket{%s=\"%s\",le=\"+Inf\"} %llu\n", name, label_name, label_value,
+                (unsigned long long)cumulative);
+    text_printf(text, "%s_sum{%s=\"%s\"} %.6f\n", name, label_name, label_value, (double)sum_us / 1e6);
+    text_printf(text, "%s_count{%s=\"%s\"} %llu\n", name, label_name, label_value,
+                (unsigned long long)cumulative);
+}
+
+/**
+ * Writes every metric in the Prometheus text exposition format.
+ * @param state Server state, for the gauges
+ * @param text Output to fill
+ */
+static void render_metrics(ServerState *state, MetricsText *text) {
+    uint64_t counters[METRIC_COUNTER_COUNT] = {0};
+    for (int s = 0; s < METRICS_SHARDS; s++) {
+        for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+            counters[c] += __atomic_load_n(&shards[s].counters[c], __ATOMIC_RELAXED);
+        }
+    }
+
+    int sessions = 0;
+    pthread_mutex_lock(&state->sessions_mutex);
+    for (int i = 0; i < state->sessions.count; i++) {
+        Session *session = pool_get(&state->sessions, i);
+        if (session->id != 0 && session->status != SESSION_FINISHED) sessions++;
+    }
+    pthread_mutex_unlock(&state->sessions_mutex);
+
+    text_printf(text, "# HELP quiznet_uptime_seconds Time since the server started.\n"
+                      "# TYPE quiznet_uptime_seconds gauge\n"
+                      "quiznet_uptime_seconds %lld\n", (long long)(time(NULL) - state->start_time));
+    text_printf(text, "# HELP quiznet_clients Connected clients.\n"
+                      "# TYPE quiznet_clients gauge\n"
+                      "quiznet_clients %d\n", __atomic_load_n(&state->num_clients, __ATOMIC_RELAXED));
+    text_printf(text, "# HELP quiznet_sessions Sessions waiting for players or playing.\n"
+                      "# TYPE quiznet_sessions gauge\n"
+                      "quiznet_sessions %d\n", sessions);
+    text_printf(text, "# HELP quiznet_connections_total Client connections accepted.\n"
+                      "# TYPE quiznet_connections_total counter\n"
+                      "quiznet_connections_total %llu\n", (unsigned long long)counters[METRIC_CONNECTIONS]);
+    text_printf(text, "# HELP quiznet_received_bytes_total Bytes read from clients.\n"
+                      "# TYPE quiznet_received_bytes_total counter\n"
+                      "quiznet_received_bytes_total %llu\n", (unsigned long long)counters[METRIC_BYTES_RECEIVED]);
+    text_printf(text, "# HELP quiznet_sent_bytes_total Bytes written to clients.\n"
+                      "# TYPE quiznet_sent_bytes_total counter\n"
+                      "quiznet_sent_bytes_total %llu\n", (unsigned long long)counters[METRIC_BYTES_SENT]);
+
+    text_printf(text, "# HELP quiznet_request_duration_seconds Time to route and handle a request.\n"
+                      "# TYPE quiznet_request_duration_seconds histogram\n");
+    for (int i = 0; i < NUM_ENDPOINTS; i++) {
+        render_histogram(text, "quiznet_request_duration_seconds", "endpoint", endpoint_at(i)->path, i);
+    }
+
+    text_printf(text, "# HELP quiznet_section_duration_seconds Time spent in game loop sections.\n"
+                      "# TYPE quiznet_section_duration_seconds histogram\n");
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        render_histogram(text, "quiznet_section_duration_seconds", "section", section_names[i],
+                         NUM_ENDPOINTS + i);
+    }
+}
+
+/**
+ * Sends a whole buffer on a blocking socket.
+ * @param sock Connected socket
+ * @param data Bytes to send
+ * @param len Number of bytes
+ * @return 0 on success, -1 on error
+ */
+static int send_all(int sock, const char *data, size_t len) {
+    while (len > 0) {
+        int sent = send(sock, data, len > 65536 ? 65536 : (int)len, MSG_NOSIGNAL);
+        if (sent <= 0) return -1;
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return 0;
+}
+
+/**
+ * Answers one HTTP request: GET /metrics gets the scrape, anything else
+ * a 404 or 405. The connection is closed afterwards.
+ * @param state Server state, for the gauges
+ * @param sock Accepted connection
+ */
+static void serve_scrape(ServerState *state, int sock) {
+#ifdef _WIN32
+    DWORD timeout = METRICS_TIMEOUT_MS;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (char*)&timeout, sizeof(timeout));
+#else
+    struct timeval timeout = { METRICS_TIMEOUT_MS / 1000, (METRICS_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#endif
+
+    char request[METRICS_REQUEST_MAX];
+    size_t len = 0;
+    while (len < sizeof(request) - 1) {
+        int received = recv(sock, request + len, (int)(sizeof(request) - 1 - len), 0);
+        if (received <= 0) break;
+        len += (size_t)received;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+    request[len] = '\0';
+
+    char method[8] = "";
+    char path[256] = "";
+    sscanf(request, "%7s %255s", method, path);
+    path[strcspn(path, "?")] = '\0';
+
+    const char *status = "200 OK";
+    MetricsText text = { NULL, 0, 0, false };
+    if (strcmp(method, "GET") != 0) {
+        status = "405 Method Not Allowed";
+        text_printf(&text, "only GET is supported\n");
+    } else if (strcmp(path, "/metrics") != 0) {
+        status = "404 Not Found";
+        text_printf(&text, "try /metrics\n");
+    } else {
+        render_metrics(state, &text);
+    }
+    if (text.failed) {
+        status = "500 Internal Server Error";
+        text.len = 0;
+    }
+
+    char head[256];
+    int head_len = snprintf(head, sizeof(head),
+                            "HTTP/1.0 %s\r\n"
+                            "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                            "Content-Length: %lu\r\n"
+                            "Connection: close\r\n\r\n",
+                            status, (unsigned long)text.len);
+    if (send_all(sock, head, (size_t)head_len) == 0 && text.len > 0) {
+        send_all(sock, text.data, text.len);
+    }
+    free(text.data);
+}
+
+/**
+ * Listener thread: serves scrapes one at a time until metrics_stop.
+ * Waits with a timeout so the stop flag is seen without closing the
+ * socket under it.
+ * @param arg Unused
+ * @return NULL when stopped
+ */
+static void* metrics_thread(void *arg) {
+    (void)arg;
+
+    while (__atomic_load_n(&listener.running, __ATOMIC_RELAXED)) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listener.socket, &readable);
+        struct timeval wait = { 0, METRICS_POLL_MS * 1000 };
+        if (select(listener.socket + 1, &readable, NULL, NULL, &wait) <= 0) continue;
+
+        int sock = accept(listener.socket, NULL, NULL);
+        if (sock < 0) continue;
+        serve_scrape(listener.state, sock);
+#ifdef _WIN32
+        closesocket(sock);
+#else
+        close(sock);
+#endif
+    }
+    return NULL;
+}
+
+/**
+ * Opens the scrape port on the loopback interface and starts the listener.
+ * @param state Server state, for the gauges
+ * @param port TCP port
+ * @return 0 on success, -1 if the port cannot be bound
+ */
+int metrics_start(ServerState *state, int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+
+    int opt = 1;
+#ifdef _WIN32
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+#else
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+#endif
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 4) < 0) {
+#ifdef _WIN32
+        closesocket(sock);
+#else
+        close(sock);
+#endif
+        return -1;
+    }
+
+    listener.state = state;
+    listener.socket = sock;
+    listener.running = true;
+    if (pthread_create(&listener.thread, NULL, metrics_thread, NULL) != 0) {
+        listener.running = false;
+        metrics_stop();
+        return -1;
+    }
+
+    log_msg("METRICS", "Serving metrics on http://127.0.0.1:%d/metrics", port);
+    return 0;
+}
+
+/**
+ * Stops the listener and closes the scrape port (no-op if not started).
+ */
+void metrics_stop(void) {
+    if (listener.socket < 0) return;
+
+    if (__atomic_exchange_n(&listener.running, false, __ATOMIC_RELAXED)) {
+        pthread_join(listener.thread, NULL);
+    }
+#ifdef _WIN32
+    closesocket(listener.socket);
+#else
+    close(listener.socket);
+#endif
+    listener.socket = -1;
+}
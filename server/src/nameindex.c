@@ -0,0 +1,153 @@
+#include "nameindex.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NAMEINDEX_MIN_CAPACITY 16
+
+/**
+ * FNV-1a over the name.
+ * @param name NUL-terminated name
+ * @return 32-bit hash
+ */
+static uint32_t name_hash(const char *name) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Allocates empty bucket arrays for a given capacity.
+ * @param index Index to set up
+ * @param capacity Power-of-two bucket count
+ * @return 0 on success, -1 on allocation failure
+ */
+static int alloc_buckets(NameIndex *index, int capacity) {
+    uint32_t *hashes = malloc(capacity * sizeof(uint32_t));
+    int *values = malloc(capacity * sizeof(int));
+    if (!hashes || !values) {
+        free(hashes);
+        free(values);
+        return -1;
+    }
+    memset(values, 0xff, capacity * sizeof(int));
+    index->hashes = hashes;
+    index->values = values;
+    index->capacity = capacity;
+    index->count = 0;
+    return 0;
+}
+
+/**
+ * Stores a slot in the first free bucket of its probe chain.
+ * The name must not be present and the table must have room.
+ * @param index Index to update
+ * @param hash Hash of the slot's name
+ * @param value Slot to store
+ */
+static void place(NameIndex *index, uint32_t hash, int value) {
+    int mask = index->capacity - 1;
+    int i = (int)(hash & (uint32_t)mask);
+    while (index->values[i] >= 0) {
+        i = (i + 1) & mask;
+    }
+    index->hashes[i] = hash;
+    index->values[i] = value;
+    index->count++;
+}
+
+/**
+ * Doubles the table and reinserts every slot (hashes are kept, names
+ * are not read again).
+ * @param index Index to grow
+ * @return 0 on success, -1 on allocation failure (index left untouched)
+ */
+static int grow(NameIndex *index) {
+    NameIndex old = *index;
+    if (alloc_buckets(index, old.capacity * 2) < 0) {
+        *index = old;
+        return -1;
+    }
+    for (int i = 0; i < old.capacity; i++) {
+        if (old.values[i] >= 0) {
+            place(index, old.hashes[i], old.values[i]);
+        }
+    }
+    free(old.hashes);
+    free(old.values);
+    return 0;
+}
+
+/**
+ * Initializes an empty index sized for an expected number of names.
+ * @param index Index to initialize
+ * @param expected Expected number of names (the table keeps load <= 1/2)
+ * @param key Gives the name of a stored slot
+ * @param context Passed to key
+ * @return 0 on success, -1 on allocation failure
+ */
+int nameindex_init(NameIndex *index, int expected, NameIndexKey key, const void *context) {
+    int capacity = NAMEINDEX_MIN_CAPACITY;
+    while (capacity < expected * 2) capacity <<= 1;
+    memset(index, 0, sizeof(NameIndex));
+    index->key = key;
+    index->context = context;
+    return alloc_buckets(index, capacity);
+}
+
+/**
+ * Releases the bucket arrays.
+ * @param index Index to destroy
+ */
+void nameindex_destroy(NameIndex *index) {
+    free(index->hashes);
+    free(index->values);
+    memset(index, 0, sizeof(NameIndex));
+}
+
+/**
+ * Looks up the slot stored for a name (linear probing).
+ * @param index Index to search
+ * @param name Name to find
+ * @return Stored slot, -1 if absent
+ */
+int nameindex_get(const NameIndex *index, const char *name) {
+    if (!index->values) return -1;
+
+    uint32_t hash = name_hash(name);
+    int mask = index->capacity - 1;
+    for (int i = (int)(hash & (uint32_t)mask); index->values[i] >= 0; i = (i + 1) & mask) {
+        if (index->hashes[i] == hash &&
+            strcmp(index->key(index->context, index->values[i]), name) == 0) {
+            return index->values[i];
+        }
+    }
+    return -1;
+}
+
+/**
+ * Inserts the slot of a new name. A name already stored keeps its slot.
+ * Grows the table when it would become more than half full.
+ * @param index Index to update
+ * @param name Name of the slot
+ * @param value Slot to store (non-negative)
+ * @return 0 on success, NAMEINDEX_EXISTS if the name is taken,
+ *         -1 on invalid slot or allocation failure
+ */
+int nameindex_put(NameIndex *index, const char *name, int value) {
+    if (value < 0 || !index->values) return -1;
+
+    uint32_t hash = name_hash(name);
+    int mask = index->capacity - 1;
+    for (int i = (int)(hash & (uint32_t)mask); index->values[i] >= 0; i = (i + 1) & mask) {
+        if (index->hashes[i] == hash &&
+            strcmp(index->key(index->context, index->values[i]), name) == 0) {
+            return NAMEINDEX_EXISTS;
+        }
+    }
+
+    if ((index->count + 1) * 2 > index->capacity && grow(index) < 0) return -1;
+    place(index, hash, value);
+    return 0;
+}
@@ -0,0 +1,360 @@
+#include "outqueue.h"
+#include "binproto.h"
+#include "metrics.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define OUTQUEUE_MAX_IOV 64
+
+/**
+ * Allocates a shared message buffer holding the message and its newline.
+ * @param message NUL-terminated message (JSON line without newline)
+ * @return Buffer with one reference, NULL on allocation failure
+ */
+MsgBuf* msgbuf_create(const char *message) {
+    size_t len = strlen(message);
+    MsgBuf *buf = malloc(sizeof(MsgBuf) + len + 2);
+    if (!buf) return NULL;
+
+    buf->refcount = 1;
+    buf->binary = NULL;
+    memcpy(buf->data, message, len);
+    buf->data[len] = '\n';
+    buf->data[len + 1] = '\0';
+    buf->len = len + 1;
+    return buf;
+}
+
+/**
+ * Serializes a JSON tree once into a shared message buffer.
+ * @param json Tree to serialize
+ * @return Buffer with one reference, NULL on failure
+ */
+MsgBuf* msgbuf_from_json(const cJSON *json) {
+    char *text = cJSON_PrintUnformatted(json);
+    if (!text) return NULL;
+    MsgBuf *buf = msgbuf_create(text);
+    free(text);
+    return buf;
+}
+
+/**
+ * Takes an additional reference on a buffer.
+ * @param buf Buffer to share
+ * @return The same buffer
+ */
+MsgBuf* msgbuf_retain(MsgBuf *buf) {
+    __atomic_add_fetch(&buf->refcount, 1, __ATOMIC_RELAXED);
+    return buf;
+}
+
+/**
+ * Drops a reference, freeing the buffer with the last one.
+ * @param buf Buffer to release (NULL is ignored)
+ */
+void msgbuf_release(MsgBuf *buf) {
+    if (buf && __atomic_sub_fetch(&buf->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        msgbuf_release(buf->binary);
+        free(buf);
+    }
+}
+
+/**
+ * Gives the binary-protocol frame of a text message, encoding it on first
+ * use. The frame is cached on the message, so a broadcast is encoded once
+ * for all binary recipients; concurrent first uses keep a single frame.
+ * @param buf Text message
+ * @return Frame owned by buf (no reference taken), NULL if it cannot be encoded
+ */
+MsgBuf* msgbuf_binary(MsgBuf *buf) {
+    MsgBuf *frame = __atomic_load_n(&buf->binary, __ATOMIC_ACQUIRE);
+    if (frame) return frame;
+
+    frame = binproto_encode(buf);
+    if (!frame) return NULL;
+
+    MsgBuf *expected = NULL;
+    if (!__atomic_compare_exchange_n(&buf->binary, &expected, frame, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        msgbuf_release(frame);
+        frame = expected;
+    }
+    return frame;
+}
+
+/**
+ * Copies a response with a correlation id added as its first field.
+ * Messages that are not JSON objects are shared unchanged.
+ * @param buf Text message ({...} line)
+ * @param rid Correlation id to echo
+ * @return New reference on the tagged copy (or on buf), NULL on allocation failure
+ */
+MsgBuf* msgbuf_with_rid(MsgBuf *buf, long long rid) {
+    if (buf->len < 3 || buf->data[0] != '{') return msgbuf_retain(buf);
+
+    char prefix[32];
+    int prefix_len = snprintf(prefix, sizeof(prefix),
+                              buf->data[1] == '}' ? "{\"rid\":%lld" : "{\"rid\":%lld,", rid);
+    size_t len = (size_t)prefix_len + buf->len - 1;
+
+    MsgBuf *tagged = malloc(sizeof(MsgBuf) + len + 1);
+    if (!tagged) return NULL;
+
+    tagged->refcount = 1;
+    tagged->binary = NULL;
+    memcpy(tagged->data, prefix, (size_t)prefix_len);
+    memcpy(tagged->data + prefix_len, buf->data + 1, buf->len - 1);
+    tagged->data[len] = '\0';
+    tagged->len = len;
+    return tagged;
+}
+
+/**
+ * Marks the connection as failed and wakes up its reader.
+ * The queue is dropped and the socket shut down; the thread owning the
+ * client then sees EOF and runs the usual disconnect path.
+ * Caller must hold the client send mutex.
+ * @param client Client to drop
+ * @param reason Short description for the log
+ */
+static void outqueue_fail(Client *client, const char *reason) {
+    if (client->out_failed) return;
+
+    log_msg("OUTQUEUE", "Client %d: %s, dropping connection (%zu bytes pending)",
+           client->id, reason, client->out_bytes);
+
+    client->out_failed = true;
+    outqueue_clear_locked(client);
+#ifdef _WIN32
+    shutdown(client->socket, SD_BOTH);
+#else
+    shutdown(client->socket, SHUT_RDWR);
+#endif
+}
+
+/**
+ * Releases the head chunk of the queue.
+ * Caller must hold the client send mutex.
+ * @param client Client owning the queue
+ */
+static void pop_chunk(Client *client) {
+    OutChunk *chunk = client->out_head;
+    client->out_head = chunk->next;
+    if (!client->out_head) client->out_tail = NULL;
+    client->out_bytes -= chunk->buf->len - chunk->offset;
+    msgbuf_release(chunk->buf);
+    free(chunk);
+}
+
+/**
+ * Appends a shared buffer to the client queue (taking a reference), then
+ * flushes what the socket accepts. Caller must hold the client send mutex.
+ * @param client Destination client
+ * @param buf Encoded message
+ * @return 0 on success, -1 if the client is being dropped
+ */
+int outqueue_push_buf_locked(Client *client, MsgBuf *buf) {
+    if (!client->connected || client->out_failed) return -1;
+
+    if (client->binary) {
+        buf = msgbuf_binary(buf);
+        if (!buf) {
+            log_warn("OUTQUEUE", "Client %d: message cannot be framed, dropped", client->id);
+            return 0;
+        }
+    }
+
+    if (client->out_limit > 0 && client->out_bytes + buf->len > client->out_limit) {
+        outqueue_fail(client, "output backlog exceeded");
+        return -1;
+    }
+
+    OutChunk *chunk = malloc(sizeof(OutChunk));
+    if (!chunk) {
+        outqueue_fail(client, "out of memory");
+        return -1;
+    }
+    chunk->buf = msgbuf_retain(buf);
+    chunk->offset = 0;
+    chunk->next = NULL;
+
+    if (client->out_tail) client->out_tail->next = chunk;
+    else client->out_head = chunk;
+    client->out_tail = chunk;
+    client->out_bytes += buf->len;
+
+    if (client->out_corked) return 0;
+    return outqueue_flush_locked(client);
+}
+
+/**
+ * Thread-safe variant of outqueue_push_buf_locked.
+ * The caller must guarantee the client slot stays valid (its own I/O thread,
+ * or an RCU read section around the lookup and the push).
+ * @param client Destination client
+ * @param buf Encoded message
+ * @return 0 on success, -1 if the client is being dropped
+ */
+int outqueue_push_buf(Client *client, MsgBuf *buf) {
+    pthread_mutex_lock(&client->send_mutex);
+    int result = outqueue_push_buf_locked(client, buf);
+    pthread_mutex_unlock(&client->send_mutex);
+    return result;
+}
+
+/**
+ * Queues a single message for one client.
+ * @param client Destination client (see outqueue_push_buf)
+ * @param message NUL-terminated message
+ * @return 0 on success, -1 on failure or if the client is being dropped
+ */
+int outqueue_push(Client *client, const char *message) {
+    MsgBuf *buf = msgbuf_create(message);
+    if (!buf) return -1;
+    int result = outqueue_push_buf(client, buf);
+    msgbuf_release(buf);
+    return result;
+}
+
+/**
+ * Writes queued messages with one vectored send per batch of chunks until
+ * the queue is empty or the socket would block. Never blocks on Linux;
+ * the remaining bytes are written when the socket signals writability.
+ * Caller must hold the client send mutex.
+ * @param client Client whose queue is flushed
+ * @return 0 if the connection is healthy, -1 if it is being dropped
+ */
+int outqueue_flush_locked(Client *client) {
+    if (client->out_failed) return -1;
+
+#ifdef _WIN32
+    // No per-call non-blocking flag on winsock: fall back to blocking sends
+    while (client->out_head) {
+        OutChunk *chunk = client->out_head;
+        int sent = send(client->socket, chunk->buf->data + chunk->offset,
+                        (int)(chunk->buf->len - chunk->offset), 0);
+        if (sent <= 0) {
+            outqueue_fail(client, "send failed");
+            return -1;
+        }
+        chunk->offset += sent;
+        client->out_bytes -= sent;
+        metrics_count(METRIC_BYTES_SENT, (uint64_t)sent);
+        if (chunk->offset == chunk->buf->len) {
+            pop_chunk(client);
+        }
+    }
+#else
+    while (client->out_head) {
+        struct iovec iov[OUTQUEUE_MAX_IOV];
+        int count = 0;
+        for (OutChunk *chunk = client->out_head; chunk && count < OUTQUEUE_MAX_IOV; chunk = chunk->next) {
+            iov[count].iov_base = chunk->buf->data + chunk->offset;
+            iov[count].iov_len = chunk->buf->len - chunk->offset;
+            count++;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+
+        ssize_t sent = sendmsg(client->socket, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            outqueue_fail(client, "write error");
+            return -1;
+        }
+
+        size_t remaining = (size_t)sent;
+        metrics_count(METRIC_BYTES_SENT, remaining);
+        while (remaining > 0 && client->out_head) {
+            OutChunk *chunk = client->out_head;
+            size_t left = chunk->buf->len - chunk->offset;
+            if (remaining < left) {
+                chunk->offset += remaining;
+                client->out_bytes -= remaining;
+                break;
+            }
+            remaining -= left;
+            pop_chunk(client);
+        }
+    }
+#endif
+    return 0;
+}
+
+/**
+ * Thread-safe variant of outqueue_flush_locked, called when the socket
+ * becomes writable again.
+ * @param client Client whose queue is flushed
+ * @return 0 if the connection is healthy, -1 if it is being dropped
+ */
+int outqueue_flush(Client *client) {
+    pthread_mutex_lock(&client->send_mutex);
+    int result = outqueue_flush_locked(client);
+    pthread_mutex_unlock(&client->send_mutex);
+    return result;
+}
+
+/**
+ * Defers writes: messages pushed from now on are only queued, so the
+ * responses to several pipelined requests leave in a single vectored send.
+ * Called by the thread handling the client's requests.
+ * @param client Client about to handle a batch of requests
+ */
+void outqueue_cork(Client *client) {
+    pthread_mutex_lock(&client->send_mutex);
+    client->out_corked = true;
+    pthread_mutex_unlock(&client->send_mutex);
+}
+
+/**
+ * Ends a batch started with outqueue_cork and writes what it queued,
+ * including messages other threads pushed in the meantime.
+ * @param client Client whose batch is complete
+ * @return 0 if the connection is healthy, -1 if it is being dropped
+ */
+int outqueue_uncork(Client *client) {
+    pthread_mutex_lock(&client->send_mutex);
+    client->out_corked = false;
+    int result = outqueue_flush_locked(client);
+    pthread_mutex_unlock(&client->send_mutex);
+    return result;
+}
+
+/**
+ * Frees every queued chunk. Caller must hold the client send mutex.
+ * @param client Client whose queue is emptied
+ */
+void outqueue_clear_locked(Client *client) {
+    while (client->out_head) {
+        pop_chunk(client);
+    }
+    client->out_bytes = 0;
+}
+
+/**
+ * Tells whether bytes are waiting for the socket to become writable.
+ * Unlocked read: only used as a hint to decide whether to poll for POLLOUT.
+ * @param client Client to inspect
+ * @return true if the queue is not empty
+ */
+bool outqueue_pending(Client *client) {
+    return client->out_head != NULL;
+}
@@ -0,0 +1,321 @@
+#include "passhash.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PASSHASH_PREFIX "pbkdf2-sha256$"
+#define PASSHASH_MIN_ITERATIONS 1000
+#define PASSHASH_MAX_ITERATIONS 10000000
+#define LEGACY_HASH_LEN 64             /**< Unsalted hex digest of the first account files */
+
+typedef struct {
+    uint32_t h[8];                 /**< Chaining state */
+    uint64_t bytes;                /**< Message length so far */
+    unsigned char block[64];       /**< Pending partial block */
+    size_t used;                   /**< Bytes in block */
+} Sha256;
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * Runs the SHA-256 compression function over one 64-byte block.
+ * @param h Chaining state, updated in place
+ * @param block Message block
+ */
+static void sha256_compress(uint32_t h[8], const unsigned char block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 |
+               (uint32_t)block[i * 4 + 2] << 8 | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) +
+                      sha256_k[i] + w[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+/**
+ * Starts a SHA-256 digest.
+ * @param ctx Digest state
+ */
+static void sha256_init(Sha256 *ctx) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->h, iv, sizeof(iv));
+    ctx->bytes = 0;
+    ctx->used = 0;
+}
+
+/**
+ * Absorbs message bytes.
+ * @param ctx Digest state
+ * @param data Bytes to hash
+ * @param len Number of bytes
+ */
+static void sha256_update(Sha256 *ctx, const void *data, size_t len) {
+    const unsigned char *p = data;
+    ctx->bytes += len;
+    while (len > 0) {
+        size_t take = 64 - ctx->used < len ? 64 - ctx->used : len;
+        memcpy(ctx->block + ctx->used, p, take);
+        ctx->used += take;
+        p += take;
+        len -= take;
+        if (ctx->used == 64) {
+            sha256_compress(ctx->h, ctx->block);
+            ctx->used = 0;
+        }
+    }
+}
+
+/**
+ * Pads the message and writes the digest.
+ * @param ctx Digest state, unusable afterwards
+ * @param digest Output, 32 bytes
+ */
+static void sha256_final(Sha256 *ctx, unsigned char digest[32]) {
+    uint64_t bits = ctx->bytes * 8;
+    ctx->block[ctx->used++] = 0x80;
+    if (ctx->used > 56) {
+        memset(ctx->block + ctx->used, 0, 64 - ctx->used);
+        sha256_compress(ctx->h, ctx->block);
+        ctx->used = 0;
+    }
+    memset(ctx->block + ctx->used, 0, 56 - ctx->used);
+    for (int i = 0; i < 8; i++) ctx->block[56 + i] = (unsigned char)(bits >> (56 - 8 * i));
+    sha256_compress(ctx->h, ctx->block);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (unsigned char)(ctx->h[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(ctx->h[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(ctx->h[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)ctx->h[i];
+    }
+}
+
+typedef struct {
+    Sha256 inner;                  /**< State after absorbing key ^ ipad */
+    Sha256 outer;                  /**< State after absorbing key ^ opad */
+} HmacKey;
+
+/**
+ * Absorbs the padded key once so each HMAC costs two compressions per
+ * short message instead of four.
+ * @param key HMAC state to fill
+ * @param secret Key bytes (the password)
+ * @param len Key length
+ */
+static void hmac_init(HmacKey *key, const void *secret, size_t len) {
+    unsigned char block[64];
+    memset(block, 0, sizeof(block));
+    if (len > sizeof(block)) {
+        Sha256 ctx;
+        sha256_init(&ctx);
+        sha256_update(&ctx, secret, len);
+        sha256_final(&ctx, block);
+    } else {
+        memcpy(block, secret, len);
+    }
+
+    unsigned char pad[64];
+    for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x36;
+    sha256_init(&key->inner);
+    sha256_update(&key->inner, pad, sizeof(pad));
+    for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x5c;
+    sha256_init(&key->outer);
+    sha256_update(&key->outer, pad, sizeof(pad));
+}
+
+/**
+ * Computes HMAC-SHA256 with a prepared key.
+ * @param key Prepared key
+ * @param data Message
+ * @param len Message length
+ * @param mac Output, 32 bytes (may alias data)
+ */
+static void hmac(const HmacKey *key, const void *data, size_t len, unsigned char mac[32]) {
+    Sha256 ctx = key->inner;
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, mac);
+    ctx = key->outer;
+    sha256_update(&ctx, mac, 32);
+    sha256_final(&ctx, mac);
+}
+
+/**
+ * Derives one block of PBKDF2-HMAC-SHA256 (enough for a 32-byte key).
+ * @param password Password
+ * @param salt Salt bytes
+ * @param salt_len Salt length (at most 64)
+ * @param iterations Work factor
+ * @param key Derived key output
+ */
+static void pbkdf2_sha256(const char *password, const unsigned char *salt, size_t salt_len,
+                          unsigned long iterations, unsigned char key[PASSHASH_KEY_LEN]) {
+    HmacKey hkey;
+    hmac_init(&hkey, password, strlen(password));
+
+    unsigned char first[64 + 4];
+    memcpy(first, salt, salt_len);
+    first[salt_len] = 0;
+    first[salt_len + 1] = 0;
+    first[salt_len + 2] = 0;
+    first[salt_len + 3] = 1;
+
+    unsigned char u[32];
+    hmac(&hkey, first, salt_len + 4, u);
+    memcpy(key, u, 32);
+    for (unsigned long i = 1; i < iterations; i++) {
+        hmac(&hkey, u, sizeof(u), u);
+        for (int j = 0; j < 32; j++) key[j] ^= u[j];
+    }
+}
+
+/**
+ * Writes bytes as lowercase hex digits.
+ * @param bytes Bytes to format
+ * @param len Number of bytes
+ * @param out Output, 2 * len + 1 chars
+ */
+static void to_hex(const unsigned char *bytes, size_t len, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[i * 2] = digits[bytes[i] >> 4];
+        out[i * 2 + 1] = digits[bytes[i] & 0x0f];
+    }
+    out[len * 2] = '\0';
+}
+
+/**
+ * Parses hex digits into bytes.
+ * @param hex Digits
+ * @param hex_len Number of digits
+ * @param out Output bytes
+ * @param max Capacity of out
+ * @return Number of bytes, -1 if malformed or too long
+ */
+static int from_hex(const char *hex, size_t hex_len, unsigned char *out, size_t max) {
+    if (hex_len % 2 != 0 || hex_len / 2 > max) return -1;
+    for (size_t i = 0; i < hex_len / 2; i++) {
+        unsigned int byte;
+        if (sscanf(hex + i * 2, "%2x", &byte) != 1) return -1;
+        out[i] = (unsigned char)byte;
+    }
+    return (int)(hex_len / 2);
+}
+
+/**
+ * Compares two buffers in time independent of where they differ.
+ * @param a First buffer
+ * @param b Second buffer
+ * @param len Bytes to compare
+ * @return true if equal
+ */
+static bool equal_constant_time(const unsigned char *a, const unsigned char *b, size_t len) {
+    unsigned char diff = 0;
+    for (size_t i = 0; i < len; i++) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+/**
+ * Hashes a password for storage with a fresh random salt.
+ * @param password Password in clear
+ * @param out Output, stored form (see passhash.h)
+ * @param out_size Size of out, at least PASSHASH_MAX_LEN
+ * @return 0 on success, -1 if no salt could be drawn
+ */
+int passhash_create(const char *password, char *out, size_t out_size) {
+    unsigned char salt[PASSHASH_SALT_LEN];
+    if (random_bytes(salt, sizeof(salt)) < 0) {
+        log_error("PASSHASH", "ERROR - cannot read random bytes for a salt");
+        return -1;
+    }
+
+    unsigned char key[PASSHASH_KEY_LEN];
+    pbkdf2_sha256(password, salt, sizeof(salt), PASSHASH_ITERATIONS, key);
+
+    char salt_hex[PASSHASH_SALT_LEN * 2 + 1];
+    char key_hex[PASSHASH_KEY_LEN * 2 + 1];
+    to_hex(salt, sizeof(salt), salt_hex);
+    to_hex(key, sizeof(key), key_hex);
+    snprintf(out, out_size, PASSHASH_PREFIX "%d$%s$%s", PASSHASH_ITERATIONS, salt_hex, key_hex);
+    return 0;
+}
+
+/**
+ * Checks a password against its stored hash. Hashes written before salted
+ * hashing (64 hex digits) are still accepted so they can be upgraded.
+ * @param password Password in clear
+ * @param stored Stored form
+ * @return true if the password matches
+ */
+bool passhash_verify(const char *password, const char *stored) {
+    if (strncmp(stored, PASSHASH_PREFIX, strlen(PASSHASH_PREFIX)) != 0) {
+        if (strlen(stored) != LEGACY_HASH_LEN) return false;
+        char legacy[LEGACY_HASH_LEN + 1];
+        legacy_password_hash(password, legacy);
+        return equal_constant_time((const unsigned char *)legacy, (const unsigned char *)stored,
+                                   LEGACY_HASH_LEN);
+    }
+
+    const char *p = stored + strlen(PASSHASH_PREFIX);
+    char *end;
+    unsigned long iterations = strtoul(p, &end, 10);
+    if (*end != '$' || iterations < PASSHASH_MIN_ITERATIONS || iterations > PASSHASH_MAX_ITERATIONS) {
+        return false;
+    }
+
+    const char *salt_hex = end + 1;
+    const char *key_hex = strchr(salt_hex, '$');
+    if (!key_hex) return false;
+    key_hex++;
+
+    unsigned char salt[64];
+    unsigned char expected[PASSHASH_KEY_LEN];
+    int salt_len = from_hex(salt_hex, (size_t)(key_hex - 1 - salt_hex), salt, sizeof(salt));
+    if (salt_len < 0 || from_hex(key_hex, strlen(key_hex), expected, sizeof(expected)) != PASSHASH_KEY_LEN) {
+        return false;
+    }
+
+    unsigned char key[PASSHASH_KEY_LEN];
+    pbkdf2_sha256(password, salt, (size_t)salt_len, iterations, key);
+    return equal_constant_time(key, expected, sizeof(key));
+}
+
+/**
+ * Tells whether a stored hash uses the current scheme and work factor.
+ * Older ones are rehashed after the next successful login.
+ * @param stored Stored form
+ * @return true if no upgrade is needed
+ */
+bool passhash_is_current(const char *stored) {
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), PASSHASH_PREFIX "%d$", PASSHASH_ITERATIONS);
+    return strncmp(stored, prefix, strlen(prefix)) == 0;
+}
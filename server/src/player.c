@@ -1,179 +1,414 @@
 #include "player.h"
+#include "passhash.h"
+#include "journal.h"
 #include "utils.h"
 #include <stdio.h>
 #include <string.h>
 
 #define ACCOUNTS_FILE "data/accounts.dat"
+#define ACCOUNTS_TMP_FILE "data/accounts.dat.tmp"
+#define ACCOUNTS_JOURNAL "data/accounts.journal"
+#define ACCOUNTS_COMPACT_MIN_BYTES (64 * 1024)
+#define SNAPSHOT_BATCH 64
 #define NOT_FOUND -1
 #define TOO_MANY_ACCOUNTS -2
+#define HASH_FAILED -3
+#define NOT_DURABLE -4
+#define INVALID_PSEUDO -5
 #define MAX_PSEUDO_LEN 32
+#define ACCOUNT_RECORD_LEN (MAX_PSEUDO_LEN + PASSHASH_MAX_LEN + 2)
+
+/**
+ * Gives the pseudo of an account slot to the name index.
+ * @param context Accounts pool
+ * @param slot Account slot
+ * @return Pseudo of the account
+ */
+static const char* account_pseudo(const void *context, int slot) {
+    PlayerAccount *account = pool_get((const Pool*)context, slot);
+    return account->pseudo;
+}
+
+/**
+ * Tells whether a pseudo can name an account: non-empty, short enough to
+ * be stored untruncated, and free of the journal's ';' separator and of
+ * control characters (which would split or forge records).
+ * @param pseudo Requested username
+ * @return true if the pseudo is acceptable
+ */
+bool pseudo_is_valid(const char *pseudo) {
+    size_t len = strlen(pseudo);
+    if (len == 0 || len > MAX_PSEUDO_LEN - 1) return false;
+    for (const unsigned char *p = (const unsigned char *)pseudo; *p; p++) {
+        if (*p < 32 || *p == 127 || *p == ';') return false;
+    }
+    return true;
+}
+
+/**
+ * Finds the slot of an account. Caller must hold accounts_mutex.
+ * @param state Server state containing accounts array
+ * @param pseudo The username to search for
+ * @return Account slot, NOT_FOUND if none
+ */
+static int find_account_locked(ServerState *state, const char *pseudo) {
+    int slot = nameindex_get(&state->account_index, pseudo);
+    return slot >= 0 ? slot : NOT_FOUND;
+}
+
+/**
+ * Creates an account or replaces its hash, as read from a snapshot or
+ * journal record. Caller must hold accounts_mutex (or be single-threaded).
+ * @param state Server state containing accounts array
+ * @param pseudo Account username, already validated
+ * @param hash Stored password hash
+ * @return Account slot, TOO_MANY_ACCOUNTS if the pool is full, NOT_FOUND
+ *         if the index already holds the name for another slot
+ */
+static int upsert_account_locked(ServerState *state, const char *pseudo, const char *hash) {
+    int slot = find_account_locked(state, pseudo);
+    if (slot == NOT_FOUND) {
+        slot = pool_alloc(&state->accounts);
+        if (slot < 0) return TOO_MANY_ACCOUNTS;
+
+        PlayerAccount *account = pool_get(&state->accounts, slot);
+        account->id = slot;
+        strncpy(account->pseudo, pseudo, MAX_PSEUDO_LEN - 1);
+        account->pseudo[MAX_PSEUDO_LEN - 1] = '\0';
+        account->logged_in = false;
+        int rc = nameindex_put(&state->account_index, account->pseudo, slot);
+        if (rc < 0) {
+            pool_free(&state->accounts, slot);
+            return rc == NAMEINDEX_EXISTS ? NOT_FOUND : TOO_MANY_ACCOUNTS;
+        }
+        state->num_accounts++;
+    }
+
+    PlayerAccount *account = pool_get(&state->accounts, slot);
+    strncpy(account->password_hash, hash, PASSHASH_MAX_LEN - 1);
+    account->password_hash[PASSHASH_MAX_LEN - 1] = '\0';
+    return slot;
+}
+
+/**
+ * Queues an account record ("pseudo;hash\n") in the accounts journal.
+ * Called under accounts_mutex so records reach the journal in the order
+ * the accounts changed.
+ * @param state Server state owning the journal
+ * @param account Account to record
+ * @return Journal sequence number, 0 if the record was dropped
+ */
+static uint64_t journal_account_locked(ServerState *state, const PlayerAccount *account) {
+    char record[ACCOUNT_RECORD_LEN + 1];
+    int len = snprintf(record, sizeof(record), "%s;%s\n", account->pseudo, account->password_hash);
+    return journal_append(&state->account_journal, record, (size_t)len);
+}
 
 /**
  * Registers a new player account with the given credentials.
- * The password is hashed before storage. Thread-safe.
+ * The password is hashed with a fresh salt before storage, outside
+ * accounts_mutex: slow by design, call it from the auth worker pool.
+ * Returns once the account is in the journal on disk.
+ * Thread-safe.
  * @param state Server state containing accounts array
  * @param pseudo The username for the new account
  * @param password The password (will be hashed)
- * @return 0 on success, -1 if pseudo exists, -2 if max accounts reached
+ * @return 0 on success, -1 if pseudo exists, -2 if max accounts reached,
+ *         -3 if the password could not be hashed, -4 if the account could
+ *         not be written to disk, -5 if the pseudo is invalid
  */
 int register_player(ServerState *state, const char *pseudo, const char *password) {
-    log_msg("PLAYER", "register_player() called - pseudo='%s'", pseudo);
+    log_debug("PLAYER", "register_player() called - pseudo='%s'", pseudo);
     
+    if (!pseudo_is_valid(pseudo)) {
+        log_warn("PLAYER", "register_player() FAILED - invalid pseudo");
+        return INVALID_PSEUDO;
+    }
+    
+    // Cheap early refusal, checked again once the hash is ready
     pthread_mutex_lock(&state->accounts_mutex);
+    int existing = find_account_locked(state, pseudo);
+    pthread_mutex_unlock(&state->accounts_mutex);
+    if (existing != NOT_FOUND) {
+        log_warn("PLAYER", "register_player() FAILED - pseudo '%s' already exists", pseudo);
+        return NOT_FOUND;
+    }
     
-    for (int i = 0; i < state->num_accounts; i++) {
-        if (strcmp(state->accounts[i].pseudo, pseudo) == 0) {
-            log_msg("PLAYER", "register_player() FAILED - pseudo '%s' already exists", pseudo);
-            pthread_mutex_unlock(&state->accounts_mutex);
-            return NOT_FOUND;
-        }
+    char password_hash[PASSHASH_MAX_LEN];
+    if (passhash_create(password, password_hash, sizeof(password_hash)) < 0) {
+        return HASH_FAILED;
+    }
+    
+    pthread_mutex_lock(&state->accounts_mutex);
+    
+    if (find_account_locked(state, pseudo) != NOT_FOUND) {
+        log_warn("PLAYER", "register_player() FAILED - pseudo '%s' already exists", pseudo);
+        pthread_mutex_unlock(&state->accounts_mutex);
+        return NOT_FOUND;
     }
     
-    if (state->num_accounts >= MAX_CLIENTS) {
-        log_msg("PLAYER", "register_player() FAILED - max accounts reached (%d)", MAX_CLIENTS);
+    int slot = upsert_account_locked(state, pseudo, password_hash);
+    if (slot == NOT_FOUND) {
+        log_warn("PLAYER", "register_player() FAILED - pseudo '%s' already exists", pseudo);
+        pthread_mutex_unlock(&state->accounts_mutex);
+        return NOT_FOUND;
+    }
+    if (slot < 0) {
+        log_warn("PLAYER", "register_player() FAILED - max accounts reached (%d)",
+                state->limits.max_accounts);
         pthread_mutex_unlock(&state->accounts_mutex);
         return TOO_MANY_ACCOUNTS;
     }
     
-    PlayerAccount *account = &state->accounts[state->num_accounts];
-    account->id = state->num_accounts;
-    strncpy(account->pseudo, pseudo, MAX_PSEUDO_LEN - 1);
-    account->pseudo[MAX_PSEUDO_LEN - 1] = '\0';
-    sha256_hash(password, account->password_hash);
-    account->logged_in = false;
-    
-    state->num_accounts++;
+    PlayerAccount *account = pool_get(&state->accounts, slot);
+    uint64_t seq = journal_account_locked(state, account);
     log_msg("PLAYER", "register_player() SUCCESS - new account id=%d, total=%d", account->id, state->num_accounts);
     
     pthread_mutex_unlock(&state->accounts_mutex);
 
-    save_accounts(state);
+    // Group commit: concurrent registrations share one fsync
+    if (!journal_wait(&state->account_journal, seq)) {
+        log_error("PLAYER", "register_player() ERROR - account '%s' not written to disk", pseudo);
+        return NOT_DURABLE;
+    }
     
     return 0;
 }
 
 /**
  * Authenticates a player with the given credentials.
- * Compares password hash against stored hash. Thread-safe.
+ * The stored hash is copied under accounts_mutex and checked outside it,
+ * so slow verifications never hold the lock; call it from the auth worker
+ * pool. Hashes from older schemes are replaced after a successful check.
+ * Thread-safe.
  * @param state Server state containing accounts array
  * @param pseudo The username to authenticate
  * @param password The password to verify
  * @return 0 on success, -1 on invalid credentials
  */
 int login_player(ServerState *state, const char *pseudo, const char *password) {
-    log_msg("PLAYER", "login_player() called - pseudo='%s'", pseudo);
+    log_debug("PLAYER", "login_player() called - pseudo='%s'", pseudo);
 
+    char stored[PASSHASH_MAX_LEN];
     pthread_mutex_lock(&state->accounts_mutex);
+    int slot = find_account_locked(state, pseudo);
+    if (slot != NOT_FOUND) {
+        PlayerAccount *account = pool_get(&state->accounts, slot);
+        strcpy(stored, account->password_hash);
+    }
+    pthread_mutex_unlock(&state->accounts_mutex);
     
-    char password_hash[65];
-    sha256_hash(password, password_hash);
-    
-    for (int i = 0; i < state->num_accounts; i++) {
-        if (strcmp(state->accounts[i].pseudo, pseudo) == 0) {
-            if (strcmp(state->accounts[i].password_hash, password_hash) == 0) {
-                state->accounts[i].logged_in = true;
-                log_msg("PLAYER", "login_player() SUCCESS - '%s' logged in", pseudo);
-                pthread_mutex_unlock(&state->accounts_mutex);
-                return 0;
-            }
-            log_msg("PLAYER", "login_player() FAILED - wrong password for '%s'", pseudo);
-            pthread_mutex_unlock(&state->accounts_mutex);
-            return -1;
-        }
+    if (slot == NOT_FOUND) {
+        log_warn("PLAYER", "login_player() FAILED - player '%s' not found", pseudo);
+        return NOT_FOUND;
     }
     
-    log_msg("PLAYER", "login_player() FAILED - player '%s' not found", pseudo);
+    if (!passhash_verify(password, stored)) {
+        log_warn("PLAYER", "login_player() FAILED - wrong password for '%s'", pseudo);
+        return -1;
+    }
+    
+    char upgraded[PASSHASH_MAX_LEN];
+    bool upgrade = !passhash_is_current(stored) &&
+                   passhash_create(password, upgraded, sizeof(upgraded)) == 0;
+    
+    pthread_mutex_lock(&state->accounts_mutex);
+    PlayerAccount *account = pool_get(&state->accounts, slot);
+    account->logged_in = true;
+    if (upgrade && strcmp(account->password_hash, stored) == 0) {
+        strcpy(account->password_hash, upgraded);
+        // Not waited for: the old hash still verifies if this record is lost
+        journal_account_locked(state, account);
+    } else {
+        upgrade = false;
+    }
     pthread_mutex_unlock(&state->accounts_mutex);
-    return NOT_FOUND;
+    
+    log_msg("PLAYER", "login_player() SUCCESS - '%s' logged in", pseudo);
+    if (upgrade) {
+        log_msg("PLAYER", "login_player() - password hash of '%s' upgraded", pseudo);
+    }
+    return 0;
 }
 
 /**
  * Finds a player account by their username.
+ * Caller must hold accounts_mutex while using the result.
  * @param state Server state containing accounts array
  * @param pseudo The username to search for
  * @return Pointer to the PlayerAccount if found, NULL otherwise
  */
 PlayerAccount* find_player_by_pseudo(ServerState *state, const char *pseudo) {
-    log_msg("PLAYER", "find_player_by_pseudo() - searching for '%s'", pseudo);
+    int slot = find_account_locked(state, pseudo);
+    log_debug("PLAYER", "find_player_by_pseudo() - '%s' %s", pseudo, slot == NOT_FOUND ? "NOT FOUND" : "FOUND");
+    return slot == NOT_FOUND ? NULL : pool_get(&state->accounts, slot);
+}
 
-    for (int i = 0; i < state->num_accounts; i++) {
-        if (strcmp(state->accounts[i].pseudo, pseudo) == 0) {
-            log_msg("PLAYER", "find_player_by_pseudo() - FOUND at index %d", i);
-            return &state->accounts[i];
+/**
+ * Applies every account record of a snapshot or journal file.
+ * Records are upserts, so replaying a file twice is harmless. The hash
+ * follows the last ';' and records with an invalid pseudo are skipped, so
+ * a record can only ever change its own account. A last line without its
+ * newline is a write torn by a crash: it was never acknowledged and is
+ * skipped.
+ * @param state Server state to populate
+ * @param path File to read
+ * @param bytes Receives the size of the file read, may be NULL
+ * @return Number of records applied, -1 if the file does not exist
+ */
+static int replay_accounts_file(ServerState *state, const char *path, size_t *bytes) {
+    FILE *file = fopen(path, "r");
+    if (!file) return -1;
+    
+    char line[256];
+    int applied = 0;
+    
+    while (fgets(line, sizeof(line), file)) {
+        if (!strchr(line, '\n')) {
+            log_warn("PLAYER", "load_accounts() - ignoring torn record at the end of %s", path);
+            break;
+        }
+        trim_whitespace(line);
+        if (strlen(line) == 0) continue;
+        
+        char *separator = strrchr(line, ';');
+        if (!separator) continue;
+        *separator = '\0';
+        const char *pseudo = line;
+        const char *hash = separator + 1;
+        if (!pseudo_is_valid(pseudo) || *hash == '\0' || strlen(hash) >= PASSHASH_MAX_LEN) {
+            log_warn("PLAYER", "load_accounts() - ignoring invalid record in %s", path);
+            continue;
+        }
+        
+        int slot = upsert_account_locked(state, pseudo, hash);
+        if (slot == TOO_MANY_ACCOUNTS) {
+            log_warn("PLAYER", "load_accounts() - WARNING max accounts reached (%d), ignoring the rest",
+                    state->limits.max_accounts);
+            break;
         }
+        if (slot < 0) continue;
+        log_debug("PLAYER", "load_accounts() - loaded account: pseudo='%s'", pseudo);
+        applied++;
     }
-    log_msg("PLAYER", "find_player_by_pseudo() - NOT FOUND");
-    return NULL;
+    
+    if (bytes) {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        *bytes = size > 0 ? (size_t)size : 0;
+    }
+    fclose(file);
+    return applied;
 }
 
 /**
- * Loads all player accounts from the data file into memory.
- * Creates an empty accounts list if file doesn't exist.
+ * Writes every account to a new snapshot and swaps it in atomically.
+ * Accounts are copied in small batches so registrations and logins only
+ * wait for one batch at a time. Used as the journal compaction callback,
+ * run on the journal's compactor thread.
+ * @param context Server state containing accounts to save
+ * @return Size of the snapshot in bytes, -1 on file write error
+ */
+static int64_t write_accounts_snapshot(void *context) {
+    ServerState *state = (ServerState*)context;
+    
+    FILE *file = fopen(ACCOUNTS_TMP_FILE, "w");
+    if (!file) {
+        log_error("PLAYER", "save_accounts() ERROR - Failed to open %s for writing", ACCOUNTS_TMP_FILE);
+        return -1;
+    }
+    
+    PlayerAccount batch[SNAPSHOT_BATCH];
+    int next = 0;
+    int written = 0;
+    int64_t bytes = 0;
+    bool ok = true;
+    
+    for (;;) {
+        int count = 0;
+        pthread_mutex_lock(&state->accounts_mutex);
+        while (count < SNAPSHOT_BATCH && next < state->num_accounts) {
+            batch[count++] = *(PlayerAccount*)pool_get(&state->accounts, next++);
+        }
+        pthread_mutex_unlock(&state->accounts_mutex);
+        if (count == 0) break;
+        
+        for (int i = 0; i < count; i++) {
+            int len = fprintf(file, "%s;%s\n", batch[i].pseudo, batch[i].password_hash);
+            if (len < 0) ok = false;
+            else bytes += len;
+        }
+        written += count;
+    }
+    
+    if (journal_sync(file) != 0) ok = false;
+    if (fclose(file) != 0) ok = false;
+    if (!ok || journal_replace(ACCOUNTS_TMP_FILE, ACCOUNTS_FILE) != 0) {
+        log_error("PLAYER", "save_accounts() ERROR - Failed to write %s", ACCOUNTS_FILE);
+        remove(ACCOUNTS_TMP_FILE);
+        return -1;
+    }
+    
+    log_msg("PLAYER", "save_accounts() - %d accounts saved to %s", written, ACCOUNTS_FILE);
+    return bytes;
+}
+
+/**
+ * Loads all player accounts into memory: the snapshot, then the journal
+ * set aside by an interrupted compaction, then the live journal. Opens the
+ * journal for the changes to come.
+ * Creates an empty accounts list if no file exists.
  * @param state Server state to populate with loaded accounts
- * @return Number of accounts loaded, 0 if file not found
+ * @return Number of accounts loaded
  */
 int load_accounts(ServerState *state) {
     log_msg("PLAYER", "load_accounts() - opening %s...", ACCOUNTS_FILE);
 
-    FILE *file = fopen(ACCOUNTS_FILE, "r");
-    if (!file) {
-        log_msg("PLAYER", "load_accounts() - No accounts file found, starting fresh");
+    state->num_accounts = 0;
+    if (nameindex_init(&state->account_index, 256, account_pseudo, &state->accounts) < 0) {
+        log_error("PLAYER", "load_accounts() ERROR - cannot allocate the account index");
         return 0;
     }
     
-    char line[256];
-    state->num_accounts = 0;
+    size_t snapshot_bytes = 0;
+    if (replay_accounts_file(state, ACCOUNTS_FILE, &snapshot_bytes) < 0) {
+        log_msg("PLAYER", "load_accounts() - No accounts file found, starting fresh");
+    }
+    int replayed = 0;
+    int old = replay_accounts_file(state, ACCOUNTS_JOURNAL ".old", NULL);
+    int live = replay_accounts_file(state, ACCOUNTS_JOURNAL, NULL);
+    if (old > 0) replayed += old;
+    if (live > 0) replayed += live;
+    if (replayed > 0) {
+        log_msg("PLAYER", "load_accounts() - %d journal record(s) replayed", replayed);
+    }
     
-    while (fgets(line, sizeof(line), file) && state->num_accounts < MAX_CLIENTS) {
-        trim_whitespace(line);
-        if (strlen(line) == 0) continue;
-        
-        char pseudo[MAX_PSEUDO_LEN];
-        char hash[65];
-        
-        if (sscanf(line, "%31[^;];%64s", pseudo, hash) == 2) {
-            PlayerAccount *account = &state->accounts[state->num_accounts];
-            account->id = state->num_accounts;
-            strncpy(account->pseudo, pseudo, MAX_PSEUDO_LEN - 1);
-            strncpy(account->password_hash, hash, 64);
-            account->logged_in = false;
-            log_msg("PLAYER", "load_accounts() - loaded account: id=%d, pseudo='%s'", account->id, pseudo);
-            state->num_accounts++;
-        }
+    if (journal_open(&state->account_journal, ACCOUNTS_JOURNAL, ACCOUNTS_COMPACT_MIN_BYTES,
+                     snapshot_bytes, write_accounts_snapshot, state) < 0) {
+        log_error("PLAYER", "load_accounts() ERROR - new accounts cannot be saved");
     }
     
-    fclose(file);
     log_msg("PLAYER", "load_accounts() - Total loaded: %d accounts", state->num_accounts);
     return state->num_accounts;
 }
 
 /**
- * Saves all player accounts from memory to the data file.
- * Thread-safe, uses mutex to protect account data during write.
+ * Saves all player accounts at shutdown: drains and closes the journal,
+ * writes a fresh snapshot, then drops the journal it now covers.
+ * Must run after the auth workers stopped.
  * @param state Server state containing accounts to save
- * @return 0 on success, -1 on file write error
+ * @return 0 on success, -1 on file write error (the journal is kept)
  */
 int save_accounts(ServerState *state) {
     log_msg("PLAYER", "save_accounts() - saving %d accounts to %s", state->num_accounts, ACCOUNTS_FILE);
 
-    FILE *file = fopen(ACCOUNTS_FILE, "w");
-    if (!file) {
-        log_msg("PLAYER", "save_accounts() ERROR - Failed to open file for writing");
+    journal_close(&state->account_journal);
+    if (write_accounts_snapshot(state) < 0) {
         perror("Failed to save accounts");
         return -1;
     }
+    journal_reset(&state->account_journal);
     
-    pthread_mutex_lock(&state->accounts_mutex);
-    
-    for (int i = 0; i < state->num_accounts; i++) {
-        fprintf(file, "%s;%s\n", 
-                state->accounts[i].pseudo, 
-                state->accounts[i].password_hash);
-    }
-    
-    pthread_mutex_unlock(&state->accounts_mutex);
-    
-    fclose(file);
     log_msg("PLAYER", "save_accounts() - SUCCESS");
     return 0;
 }
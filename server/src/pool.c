@@ -0,0 +1,95 @@
+#include "pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Initializes an empty pool. Only the chunk directory and the free slot
+ * stack are allocated; element memory is added chunk by chunk on demand.
+ * @param pool Pool to initialize
+ * @param elem_size Size of one element
+ * @param chunk_elems Elements allocated together
+ * @param max_elems Maximum number of slots
+ * @return 0 on success, -1 on invalid arguments or allocation failure
+ */
+int pool_init(Pool *pool, size_t elem_size, int chunk_elems, int max_elems) {
+    memset(pool, 0, sizeof(Pool));
+    if (elem_size == 0 || chunk_elems < 1 || max_elems < 1) return -1;
+
+    int max_chunks = (max_elems + chunk_elems - 1) / chunk_elems;
+    pool->chunks = calloc(max_chunks, sizeof(char*));
+    pool->free_slots = malloc(max_elems * sizeof(int));
+    if (!pool->chunks || !pool->free_slots) {
+        pool_destroy(pool);
+        return -1;
+    }
+
+    pool->elem_size = elem_size;
+    pool->chunk_elems = chunk_elems;
+    pool->max_elems = max_elems;
+    return 0;
+}
+
+/**
+ * Frees every chunk. Pointers to pooled elements become invalid.
+ * @param pool Pool to destroy
+ */
+void pool_destroy(Pool *pool) {
+    if (pool->chunks) {
+        int num_chunks = pool->chunk_elems > 0 ? pool->capacity / pool->chunk_elems : 0;
+        for (int i = 0; i < num_chunks; i++) {
+            free(pool->chunks[i]);
+        }
+    }
+    free(pool->chunks);
+    free(pool->free_slots);
+    memset(pool, 0, sizeof(Pool));
+}
+
+/**
+ * Hands out a slot: a previously released one if any, otherwise the next
+ * fresh slot, allocating a new chunk when the current ones are full.
+ * Existing elements never move.
+ * @param pool Pool to allocate from
+ * @return Slot index with a zeroed element, -1 if the limit is reached
+ */
+int pool_alloc(Pool *pool) {
+    int slot;
+
+    if (pool->num_free > 0) {
+        slot = pool->free_slots[--pool->num_free];
+    } else {
+        if (pool->count >= pool->max_elems) return -1;
+
+        if (pool->count == pool->capacity) {
+            char *chunk = calloc(pool->chunk_elems, pool->elem_size);
+            if (!chunk) return -1;
+            pool->chunks[pool->capacity / pool->chunk_elems] = chunk;
+            pool->capacity += pool->chunk_elems;
+        }
+        slot = pool->count++;
+    }
+
+    memset(pool_get(pool, slot), 0, pool->elem_size);
+    return slot;
+}
+
+/**
+ * Returns a slot to the pool for reuse. The element memory stays mapped.
+ * @param pool Pool owning the slot
+ * @param slot Slot previously returned by pool_alloc
+ */
+void pool_free(Pool *pool, int slot) {
+    if (slot < 0 || slot >= pool->count || pool->num_free >= pool->max_elems) return;
+    pool->free_slots[pool->num_free++] = slot;
+}
+
+/**
+ * Resolves a slot index to its element.
+ * @param pool Pool owning the slot
+ * @param slot Slot index
+ * @return Element pointer, NULL if the slot was never handed out
+ */
+void* pool_get(const Pool *pool, int slot) {
+    if (slot < 0 || slot >= pool->count) return NULL;
+    return pool->chunks[slot / pool->chunk_elems] + (size_t)(slot % pool->chunk_elems) * pool->elem_size;
+}
@@ -4,6 +4,9 @@
 #include "handlers/session.h"
 #include "handlers/game.h"
 #include "handlers/joker.h"
+#include "binproto.h"
+#include "endpoints.h"
+#include "metrics.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,91 +18,224 @@
 #include <sys/socket.h>
 #endif
 
+#define JSON_ARENA_BLOCK_SIZE 8192 /**< Initial size of each thread's JSON arena */
+#define MAX_RID 9007199254740991.0  /**< Largest correlation id, exact in a double (2^53 - 1) */
+
+static pthread_key_t json_arena_key;
+static pthread_once_t json_arena_once = PTHREAD_ONCE_INIT;
+
+static void destroy_json_arena(void *arena) {
+    cJSON_ArenaDestroy((cJSON_Arena*)arena);
+}
+
+static void create_json_arena_key(void) {
+    pthread_key_create(&json_arena_key, destroy_json_arena);
+}
+
+/**
+ * Routes the calling thread's cJSON allocations to its scratch arena,
+ * created on first use and freed when the thread exits.
+ * Trees built until json_scratch_end must not be kept past it.
+ * @return Arena that was in use before, to pass to json_scratch_end
+ */
+cJSON_Arena* json_scratch_begin(void) {
+    pthread_once(&json_arena_once, create_json_arena_key);
+    cJSON_Arena *arena = pthread_getspecific(json_arena_key);
+    if (!arena) {
+        arena = cJSON_ArenaCreate(JSON_ARENA_BLOCK_SIZE);
+        if (arena) pthread_setspecific(json_arena_key, arena);
+    }
+    return cJSON_ArenaUse(arena);
+}
+
+/**
+ * Rewinds the scratch arena and restores the previous allocation target.
+ * Nested scopes on the same thread leave the arena to the outermost one.
+ * @param previous Value returned by the matching json_scratch_begin
+ */
+void json_scratch_end(cJSON_Arena *previous) {
+    cJSON_Arena *arena = cJSON_ArenaUse(previous);
+    if (arena && arena != previous) {
+        cJSON_ArenaReset(arena);
+    }
+}
+
+/**
+ * Checks an endpoint's registry requirements for a client.
+ * Sends the error response itself when a check fails.
+ * @param client Client making the request
+ * @param endpoint Registry entry of the request
+ * @param json Decoded body, NULL if the request has none
+ * @return true if the handler may run
+ */
+static bool endpoint_admits(Client *client, const Endpoint *endpoint, cJSON *json) {
+    if (!rate_allow(client->rate, endpoint->rate_class, get_current_time_ms())) {
+        log_warn("PROTOCOL", "Client %d over the %s rate limit (%s)",
+                client->id, rate_class_name(endpoint->rate_class), endpoint->path);
+        send_error(client, endpoint->path, "429", "too many requests");
+        return false;
+    }
+    if ((endpoint->flags & EP_JSON) && !json) {
+        send_bad_request(client);
+        return false;
+    }
+    if ((endpoint->flags & EP_AUTH) && !__atomic_load_n(&client->authenticated, __ATOMIC_ACQUIRE)) {
+        log_warn("PROTOCOL", "%s FAILED - client %d not authenticated", endpoint->path, client->id);
+        send_error(client, endpoint->path, "401", "not authenticated");
+        return false;
+    }
+    if ((endpoint->flags & EP_LOCAL) && strncmp(client->ip, "127.", 4) != 0) {
+        log_warn("PROTOCOL", "%s FAILED - client %d is not local", endpoint->path, client->id);
+        send_error(client, endpoint->path, "403", "only allowed from the server host");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Reads the optional correlation id of a request body.
+ * @param json Decoded body, NULL if the request has none
+ * @param rid Id given on the request line, -1 if none
+ * @return The body's "rid" when it is a valid id, rid otherwise
+ */
+static long long request_rid(cJSON *json, long long rid) {
+    cJSON *item = json ? cJSON_GetObjectItem(json, "rid") : NULL;
+    if (item && cJSON_IsNumber(item) && item->valuedouble >= 0 && item->valuedouble <= MAX_RID &&
+        item->valuedouble == (double)(long long)item->valuedouble) {
+        return (long long)item->valuedouble;
+    }
+    return rid;
+}
+
+/**
+ * Main request router, shared by the text and binary protocols.
+ * Applies the endpoint's registry checks, runs its handler, records its
+ * latency, then releases the body. Responses sent meanwhile echo the
+ * request's correlation id. A request the handler posted to a session has
+ * its latency recorded by the session once handled (session_post_request).
+ * @param state Server state for all operations
+ * @param client Client making the request
+ * @param endpoint Registry entry of the request
+ * @param json Decoded body, NULL if the request has none
+ * @param rid Correlation id from the request line, -1 if none
+ */
+static void route_request(ServerState *state, Client *client, const Endpoint *endpoint,
+                          cJSON *json, long long rid) {
+    const char *method = method_name(endpoint->method);
+    client->rid = request_rid(json, rid);
+    log_debug("PROTOCOL", "Request: %s %s (client %d)", method, endpoint->path, client->id);
+    
+    bool traced = trace_wanted(&state->trace, __atomic_load_n(&client->trace, __ATOMIC_RELAXED),
+                               endpoint->path);
+    double started = get_current_time_ms();
+    client->request_endpoint = endpoint_index(endpoint);
+    client->request_started = started;
+    client->request_handed_off = false;
+    
+    if (endpoint_admits(client, endpoint, json)) {
+        endpoint->handler(state, client, json);
+    }
+    
+    double elapsed = get_current_time_ms() - started;
+    if (!client->request_handed_off) {
+        metrics_observe_endpoint(client->request_endpoint, elapsed);
+    }
+    if (traced) {
+        trace_request(client->id, method, endpoint->path, json, elapsed);
+    }
+    
+    if (json) {
+        cJSON_Delete(json);
+    }
+    client->rid = -1;
+}
+
 /**
- * Main request router for incoming client messages.
- * Parses METHOD endpoint format, extracts JSON body, routes to handler.
+ * Handles one request with its JSON parsing and responses allocated from
+ * the thread's scratch arena, rewound once the handler returns.
  * @param state Server state for all operations
  * @param client Client making the request
- * @param request Raw request string ({method} {endpoint}\n{json})
+ * @param header Request line ({method} {endpoint} [rid]); the correlation id
+ *               may also be given as "rid" in the body, for GET requests it
+ *               can only be given here
+ * @param body JSON body line, NULL if the request has none
  */
-void handle_request(ServerState *state, Client *client, const char *request) {
+void handle_request(ServerState *state, Client *client, const char *header, const char *body) {
+    __atomic_add_fetch(&state->requests_handled, 1, __ATOMIC_RELAXED);
+    
     char method[16] = "";
     char endpoint[64] = "";
-    char *json_start = NULL;
+    long long rid = -1;
+    if (sscanf(header, "%15s %63s %lld", method, endpoint, &rid) < 2) {
+        log_warn("PROTOCOL", "handle_request() FAILED - cannot parse request");
+        send_bad_request(client);
+        return;
+    }
+    if (rid < 0) rid = -1;
     
-    if (sscanf(request, "%15s %63s", method, endpoint) < 2) {
-        log_msg("PROTOCOL", "handle_request() FAILED - cannot parse request");
+    RequestMethod request_method;
+    if (strcmp(method, "POST") == 0) {
+        request_method = METHOD_POST;
+    } else if (strcmp(method, "GET") == 0) {
+        request_method = METHOD_GET;
+    } else {
+        log_msg("PROTOCOL", "Unknown method: %s", method);
+        client->rid = rid;
         send_bad_request(client);
+        client->rid = -1;
+        return;
+    }
+    
+    const Endpoint *ep = endpoint_lookup(request_method, endpoint);
+    if (!ep) {
+        log_msg("PROTOCOL", "Unknown %s endpoint: %s", method, endpoint);
+        client->rid = rid;
+        send_unknown_error(client);
+        client->rid = -1;
         return;
     }
     
-    json_start = strchr(request, '{');
+    cJSON_Arena *previous = json_scratch_begin();
     cJSON *json = NULL;
-    if (json_start) {
-        json = cJSON_Parse(json_start);
+    if (body) {
+        json = cJSON_Parse(body);
         if (!json) {
-            log_msg("PROTOCOL", "handle_request() WARNING - failed to parse JSON");
+            log_warn("PROTOCOL", "handle_request() WARNING - failed to parse JSON");
         }
     }
-    
-    log_msg("PROTOCOL", "Request: %s %s (client %d)", method, endpoint, client->id);
+    route_request(state, client, ep, json, rid);
+    json_scratch_end(previous);
+}
 
-    if (json) {
-        char *json_pretty = cJSON_Print(json);
-        free(json_pretty);
-    }
+/**
+ * Handles one binary-protocol request frame (see binproto.h).
+ * The message id is the endpoint's registry id, the MessagePack payload
+ * is decoded into the same tree a JSON body would produce, its "rid"
+ * field being the correlation id.
+ * @param state Server state for all operations
+ * @param client Client making the request
+ * @param id Message id from the frame header
+ * @param payload Frame payload
+ * @param len Payload length (0 for a request without body)
+ */
+void handle_binary_request(ServerState *state, Client *client, int id, const char *payload, size_t len) {
+    __atomic_add_fetch(&state->requests_handled, 1, __ATOMIC_RELAXED);
     
-    if (strcmp(method, "POST") == 0) {
-        if (strcmp(endpoint, "player/register") == 0) {
-            if (json) handle_register(state, client, json);
-            else send_bad_request(client);
-        }
-        else if (strcmp(endpoint, "player/login") == 0) {
-            if (json) handle_login(state, client, json);
-            else send_bad_request(client);
-        }
-        else if (strcmp(endpoint, "session/create") == 0) {
-            if (json) handle_create_session(state, client, json);
-            else send_bad_request(client);
-        }
-        else if (strcmp(endpoint, "session/join") == 0) {
-            if (json) handle_join_session(state, client, json);
-            else send_bad_request(client);
-        }
-        else if (strcmp(endpoint, "session/start") == 0) {
-            handle_start_session(state, client);
-        }
-        else if (strcmp(endpoint, "question/answer") == 0) {
-            if (json) handle_answer(state, client, json);
-            else send_bad_request(client);
-        }
-        else if (strcmp(endpoint, "joker/use") == 0) {
-            if (json) handle_joker(state, client, json);
-            else send_bad_request(client);
-        }
-        else {
-            log_msg("PROTOCOL", "Unknown POST endpoint: %s", endpoint);
-            send_unknown_error(client);
-        }
-    }
-    else if (strcmp(method, "GET") == 0) {
-        if (strcmp(endpoint, "themes/list") == 0) {
-            handle_get_themes(state, client);
-        }
-        else if (strcmp(endpoint, "sessions/list") == 0) {
-            handle_get_sessions(state, client);
-        }
-        else {
-            log_msg("PROTOCOL", "Unknown GET endpoint: %s", endpoint);
-            send_unknown_error(client);
-        }
-    }
-    else {
-        log_msg("PROTOCOL", "Unknown method: %s", method);
-        send_bad_request(client);
+    const Endpoint *endpoint = endpoint_by_id(id);
+    if (!endpoint) {
+        log_msg("PROTOCOL", "Unknown binary message id: %d", id);
+        send_unknown_error(client);
+        return;
     }
     
-    if (json) {
-        cJSON_Delete(json);
+    cJSON_Arena *previous = json_scratch_begin();
+    cJSON *json = NULL;
+    if (len > 0) {
+        json = binproto_decode(payload, len);
+        if (!json) {
+            log_warn("PROTOCOL", "handle_binary_request() WARNING - malformed payload");
+        }
     }
+    route_request(state, client, endpoint, json, -1);
+    json_scratch_end(previous);
 }
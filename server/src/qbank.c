@@ -0,0 +1,833 @@
+#include "qbank.h"
+#include "types.h"
+#include "utils.h"
+#include "jsonwriter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+/**
+ * In-memory bank under construction, written out by qbank_compile.
+ */
+typedef struct {
+    Question *questions;
+    int num_questions;
+    int questions_capacity;
+    QBankTheme *themes;
+    int num_themes;
+    int themes_capacity;
+    uint16_t *theme_refs;
+    int num_theme_refs;
+    int theme_refs_capacity;
+    uint32_t *posting_starts;
+    uint32_t *postings;
+    uint32_t num_postings;
+    QuestionFragment *fragments;
+    MsgBuf *fragment_pool;
+    char *strings;
+    size_t strings_size;
+    size_t strings_capacity;
+} BankBuilder;
+
+/**
+ * Folds a byte range into a running FNV-1a hash.
+ * @param hash Hash so far
+ * @param data Bytes to add
+ * @param len Number of bytes
+ * @return Updated hash
+ */
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Rounds a size up to the 4-byte section alignment.
+ * @param size Size to align
+ * @return Aligned size
+ */
+static uint64_t align4(uint64_t size) {
+    return (size + 3) & ~(uint64_t)3;
+}
+
+/**
+ * Makes room for one more element in a growable array, doubling it when full.
+ * @param array Array pointer to grow in place
+ * @param capacity Current capacity, updated on growth
+ * @param count Number of elements in use
+ * @param elem_size Size of one element
+ * @return 0 on success, -1 on allocation failure (array left untouched)
+ */
+static int reserve_one(void **array, int *capacity, int count, size_t elem_size) {
+    if (count < *capacity) return 0;
+
+    int new_capacity = *capacity > 0 ? *capacity * 2 : 64;
+    void *grown = realloc(*array, (size_t)new_capacity * elem_size);
+    if (!grown) return -1;
+
+    *array = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * Appends a string to the pool, truncated like the old fixed-size fields.
+ * @param b Builder owning the pool
+ * @param str String to append
+ * @param max_len Field size the string must fit in (including the NUL)
+ * @return Pool offset, 0 for an empty string, -1 on allocation failure
+ */
+static int64_t add_string(BankBuilder *b, const char *str, size_t max_len) {
+    size_t len = strlen(str);
+    if (len == 0) return 0;
+    if (len > max_len - 1) len = max_len - 1;
+
+    if (b->strings_size + len + 1 > UINT32_MAX) return -1;
+    if (b->strings_size + len + 1 > b->strings_capacity) {
+        size_t new_capacity = b->strings_capacity * 2;
+        while (new_capacity < b->strings_size + len + 1) new_capacity *= 2;
+        char *grown = realloc(b->strings, new_capacity);
+        if (!grown) return -1;
+        b->strings = grown;
+        b->strings_capacity = new_capacity;
+    }
+
+    int64_t offset = (int64_t)b->strings_size;
+    memcpy(b->strings + b->strings_size, str, len);
+    b->strings[b->strings_size + len] = '\0';
+    b->strings_size += len + 1;
+    return offset;
+}
+
+/**
+ * Finds an existing theme by name or creates a new one.
+ * @param b Builder holding the themes
+ * @param name Theme name
+ * @return Theme id on success, -1 on allocation failure or too many themes
+ */
+static int get_or_create_theme(BankBuilder *b, const char *name) {
+    for (int i = 0; i < b->num_themes; i++) {
+        if (strcmp(b->strings + b->themes[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    if (b->num_themes > UINT16_MAX) return -1;
+    if (reserve_one((void**)&b->themes, &b->themes_capacity, b->num_themes, sizeof(QBankTheme)) < 0) {
+        return -1;
+    }
+    int64_t name_offset = add_string(b, name, MAX_THEME_NAME);
+    if (name_offset <= 0) return -1;
+
+    b->themes[b->num_themes].name = (uint32_t)name_offset;
+    log_debug("QBANK", "Created new theme: id=%d, name='%s'", b->num_themes, name);
+    return b->num_themes++;
+}
+
+/**
+ * Attaches a theme to the question being parsed.
+ * @param b Builder holding the reference table
+ * @param q Question being parsed
+ * @param name Theme name, surrounding spaces are stripped in place
+ */
+static void add_question_theme(BankBuilder *b, Question *q, char *name) {
+    while (*name == ' ') name++;
+    if (*name == '\0' || q->num_themes >= MAX_THEMES) return;
+    char *end = name + strlen(name) - 1;
+    while (end > name && *end == ' ') *end-- = '\0';
+
+    int theme_id = get_or_create_theme(b, name);
+    if (theme_id < 0) return;
+    for (int i = 0; i < q->num_themes; i++) {
+        if (b->theme_refs[q->themes_first + i] == theme_id) return;
+    }
+    if (reserve_one((void**)&b->theme_refs, &b->theme_refs_capacity, b->num_theme_refs, sizeof(uint16_t)) < 0) {
+        return;
+    }
+    b->theme_refs[b->num_theme_refs++] = (uint16_t)theme_id;
+    q->num_themes++;
+}
+
+/**
+ * Helper function to extract the next semicolon-delimited field from a string.
+ * Handles empty fields correctly (unlike strtok).
+ * @param ptr Pointer to current position in string (updated after call)
+ * @return Pointer to the extracted field, or NULL if end of string
+ */
+static char* get_next_field(char **ptr) {
+    if (*ptr == NULL || **ptr == '\0') return NULL;
+
+    char *start = *ptr;
+    char *semicolon = strchr(start, ';');
+
+    if (semicolon) {
+        *semicolon = '\0';
+        *ptr = semicolon + 1;
+    } else {
+        *ptr = NULL;
+    }
+
+    return start;
+}
+
+/**
+ * Splits a comma-separated list into string pool offsets.
+ * @param b Builder owning the pool
+ * @param field List to split (modified in place)
+ * @param out Offsets of the items
+ * @param max Maximum number of items kept
+ * @return Number of items stored, -1 on allocation failure
+ */
+static int add_string_list(BankBuilder *b, char *field, uint32_t *out, int max) {
+    int count = 0;
+    char *item = field;
+    char *comma;
+
+    while ((comma = strchr(item, ',')) != NULL && count < max) {
+        *comma = '\0';
+        int64_t offset = add_string(b, item, MAX_ANSWER_TEXT);
+        if (offset < 0) return -1;
+        out[count++] = (uint32_t)offset;
+        item = comma + 1;
+    }
+    if (*item && count < max) {
+        int64_t offset = add_string(b, item, MAX_ANSWER_TEXT);
+        if (offset < 0) return -1;
+        out[count++] = (uint32_t)offset;
+    }
+    return count;
+}
+
+/**
+ * Parses one line of the .dat format into a question record.
+ * Format: theme;difficulty;type;question;answers;correct;explanation
+ * @param b Builder receiving strings and theme references
+ * @param line Line to parse (modified in place)
+ * @param q Record to fill
+ * @return 0 on success, -1 if a field is missing or memory ran out
+ */
+static int parse_question(BankBuilder *b, char *line, Question *q) {
+    char *ptr = line;
+    char *field;
+    int64_t offset;
+
+    memset(q, 0, sizeof(Question));
+    q->themes_first = (uint32_t)b->num_theme_refs;
+
+    // themes
+    field = get_next_field(&ptr);
+    if (!field) return -1;
+    char *comma;
+    while ((comma = strchr(field, ',')) != NULL) {
+        *comma = '\0';
+        add_question_theme(b, q, field);
+        field = comma + 1;
+    }
+    add_question_theme(b, q, field);
+
+    // difficulty
+    field = get_next_field(&ptr);
+    if (!field) return -1;
+    q->difficulty = (uint8_t)string_to_difficulty(field);
+
+    // type
+    field = get_next_field(&ptr);
+    if (!field) return -1;
+    if (strcmp(field, "qcm") == 0) q->type = QUESTION_QCM;
+    else if (strcmp(field, "boolean") == 0) q->type = QUESTION_BOOLEAN;
+    else q->type = QUESTION_TEXT;
+
+    // question text
+    field = get_next_field(&ptr);
+    if (!field) return -1;
+    if ((offset = add_string(b, field, MAX_QUESTION_TEXT)) < 0) return -1;
+    q->question = (uint32_t)offset;
+
+    // answers
+    field = get_next_field(&ptr);
+    if (!field) return -1;
+    if (q->type == QUESTION_QCM && add_string_list(b, field, q->answers, 4) < 0) return -1;
+
+    // correct answers
+    field = get_next_field(&ptr);
+    if (!field) return -1;
+    if (q->type == QUESTION_TEXT) {
+        int count = add_string_list(b, field, q->text_answers, 4);
+        if (count < 0) return -1;
+        q->num_text_answers = (uint8_t)count;
+    } else {
+        q->correct_answer = atoi(field);
+    }
+
+    // explanation
+    field = get_next_field(&ptr);
+    if (field) {
+        if ((offset = add_string(b, field, MAX_QUESTION_TEXT)) < 0) return -1;
+        q->explanation = (uint32_t)offset;
+    }
+    return 0;
+}
+
+/**
+ * Builds the per-(theme, difficulty) posting lists with a counting sort
+ * over the theme references. Questions are visited in id order, so every
+ * list comes out sorted.
+ * @param b Builder with all questions parsed
+ * @return 0 on success, -1 on allocation failure
+ */
+static int build_postings(BankBuilder *b) {
+    size_t num_lists = (size_t)b->num_themes * QBANK_DIFFICULTIES;
+    b->posting_starts = calloc(num_lists + 1, sizeof(uint32_t));
+    b->postings = malloc(((size_t)b->num_theme_refs > 0 ? (size_t)b->num_theme_refs : 1) * sizeof(uint32_t));
+    if (!b->posting_starts || !b->postings) return -1;
+
+    for (int i = 0; i < b->num_questions; i++) {
+        const Question *q = &b->questions[i];
+        for (int t = 0; t < q->num_themes; t++) {
+            size_t list = (size_t)b->theme_refs[q->themes_first + t] * QBANK_DIFFICULTIES + q->difficulty;
+            b->posting_starts[list + 1]++;
+        }
+    }
+    for (size_t list = 0; list < num_lists; list++) {
+        b->posting_starts[list + 1] += b->posting_starts[list];
+    }
+
+    // Fill using a moving cursor per list, starting at each list's start
+    uint32_t *cursor = malloc((num_lists > 0 ? num_lists : 1) * sizeof(uint32_t));
+    if (!cursor) return -1;
+    memcpy(cursor, b->posting_starts, num_lists * sizeof(uint32_t));
+    for (int i = 0; i < b->num_questions; i++) {
+        const Question *q = &b->questions[i];
+        for (int t = 0; t < q->num_themes; t++) {
+            size_t list = (size_t)b->theme_refs[q->themes_first + t] * QBANK_DIFFICULTIES + q->difficulty;
+            b->postings[cursor[list]++] = (uint32_t)q->id;
+        }
+    }
+    free(cursor);
+
+    b->num_postings = b->posting_starts[num_lists];
+    return 0;
+}
+
+/**
+ * Encodes the immutable JSON fields of every question into one pool.
+ * question/new gets type, difficulty, text and answers; question/results
+ * gets correctAnswer and the explanation. Done here, offline, so the
+ * server maps the fragments instead of encoding them at startup.
+ * @param b Builder with all questions parsed
+ * @return 0 on success, -1 on allocation failure
+ */
+static int build_fragments(BankBuilder *b) {
+    b->fragments = calloc(b->num_questions > 0 ? (size_t)b->num_questions : 1, sizeof(QuestionFragment));
+    if (!b->fragments) return -1;
+
+    JsonWriter w;
+    jsonw_init(&w, (size_t)b->num_questions * 256);
+
+    for (int i = 0; i < b->num_questions; i++) {
+        const Question *q = &b->questions[i];
+        QuestionFragment *f = &b->fragments[i];
+
+        size_t start = jsonw_mark(&w);
+        jsonw_field_string(&w, "type", question_type_to_string(q->type));
+        jsonw_field_string(&w, "difficulty", difficulty_to_string(q->difficulty));
+        jsonw_field_string(&w, "question", b->strings + q->question);
+        if (q->type == QUESTION_QCM) {
+            jsonw_key(&w, "answers");
+            jsonw_array_begin(&w);
+            for (int j = 0; j < 4; j++) {
+                jsonw_string(&w, b->strings + q->answers[j]);
+            }
+            jsonw_array_end(&w);
+        }
+        size_t end = jsonw_mark(&w);
+        f->question_offset = (uint32_t)start;
+        f->question_len = (uint32_t)(end - start);
+
+        if (q->type == QUESTION_QCM || q->type == QUESTION_BOOLEAN) {
+            jsonw_field_int(&w, "correctAnswer", q->correct_answer);
+        } else {
+            jsonw_field_string(&w, "correctAnswer", b->strings + q->text_answers[0]);
+        }
+        if (q->explanation != 0) {
+            jsonw_field_string(&w, "explanation", b->strings + q->explanation);
+        }
+        f->results_offset = (uint32_t)end;
+        f->results_len = (uint32_t)(jsonw_mark(&w) - end);
+    }
+
+    b->fragment_pool = jsonw_finish(&w);
+    if (!b->fragment_pool) return -1;
+    if (b->fragment_pool->len > UINT32_MAX) return -1;
+    return 0;
+}
+
+/**
+ * Writes a section and folds it into the checksum.
+ * @param file Output file
+ * @param data Section bytes
+ * @param len Section length
+ * @param hash Running checksum
+ * @return 0 on success, -1 on write error
+ */
+static int write_section(FILE *file, const void *data, size_t len, uint32_t *hash) {
+    static const unsigned char padding[4] = {0, 0, 0, 0};
+    size_t pad = (size_t)(align4(len) - len);
+
+    if (len > 0 && fwrite(data, 1, len, file) != len) return -1;
+    if (pad > 0 && fwrite(padding, 1, pad, file) != pad) return -1;
+    *hash = fnv1a(*hash, data, len);
+    *hash = fnv1a(*hash, padding, pad);
+    return 0;
+}
+
+/**
+ * Writes the builder contents as a bank file.
+ * @param b Builder to serialize
+ * @param path Output path
+ * @return 0 on success, -1 on error
+ */
+static int write_bank(const BankBuilder *b, const char *path) {
+    QBankHeader header;
+    memset(&header, 0, sizeof(header));
+
+    uint64_t questions_size = (uint64_t)b->num_questions * sizeof(Question);
+    uint64_t themes_size = (uint64_t)b->num_themes * sizeof(QBankTheme);
+    uint64_t refs_size = (uint64_t)b->num_theme_refs * sizeof(uint16_t);
+    uint64_t starts_size = ((uint64_t)b->num_themes * QBANK_DIFFICULTIES + 1) * sizeof(uint32_t);
+    uint64_t postings_size = (uint64_t)b->num_postings * sizeof(uint32_t);
+    uint64_t fragments_size = (uint64_t)b->num_questions * sizeof(QuestionFragment);
+    uint64_t pool_size = b->fragment_pool->len;
+
+    uint64_t questions_offset = sizeof(QBankHeader);
+    uint64_t themes_offset = questions_offset + align4(questions_size);
+    uint64_t refs_offset = themes_offset + align4(themes_size);
+    uint64_t starts_offset = refs_offset + align4(refs_size);
+    uint64_t postings_offset = starts_offset + starts_size;
+    uint64_t fragments_offset = postings_offset + postings_size;
+    uint64_t pool_offset = fragments_offset + fragments_size;
+    uint64_t strings_offset = pool_offset + align4(pool_size);
+    uint64_t file_size = strings_offset + align4(b->strings_size);
+    if (file_size > UINT32_MAX) {
+        log_error("QBANK", "ERROR - bank would exceed 4 GiB");
+        return -1;
+    }
+
+    header.magic = QBANK_MAGIC;
+    header.version = QBANK_VERSION;
+    header.file_size = (uint32_t)file_size;
+    header.num_questions = (uint32_t)b->num_questions;
+    header.num_themes = (uint32_t)b->num_themes;
+    header.num_theme_refs = (uint32_t)b->num_theme_refs;
+    header.num_postings = b->num_postings;
+    header.questions_offset = (uint32_t)questions_offset;
+    header.themes_offset = (uint32_t)themes_offset;
+    header.theme_refs_offset = (uint32_t)refs_offset;
+    header.posting_starts_offset = (uint32_t)starts_offset;
+    header.postings_offset = (uint32_t)postings_offset;
+    header.fragments_offset = (uint32_t)fragments_offset;
+    header.fragment_pool_offset = (uint32_t)pool_offset;
+    header.fragment_pool_size = (uint32_t)align4(pool_size);
+    header.strings_offset = (uint32_t)strings_offset;
+    header.strings_size = (uint32_t)align4(b->strings_size);
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        log_error("QBANK", "ERROR - cannot create '%s'", path);
+        return -1;
+    }
+
+    // Header goes first as a placeholder, rewritten once the checksum is known
+    uint32_t hash = FNV_OFFSET_BASIS;
+    int rc = 0;
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        write_section(file, b->questions, (size_t)questions_size, &hash) < 0 ||
+        write_section(file, b->themes, (size_t)themes_size, &hash) < 0 ||
+        write_section(file, b->theme_refs, (size_t)refs_size, &hash) < 0 ||
+        write_section(file, b->posting_starts, (size_t)starts_size, &hash) < 0 ||
+        write_section(file, b->postings, (size_t)postings_size, &hash) < 0 ||
+        write_section(file, b->fragments, (size_t)fragments_size, &hash) < 0 ||
+        write_section(file, b->fragment_pool->data, (size_t)pool_size, &hash) < 0 ||
+        write_section(file, b->strings, b->strings_size, &hash) < 0) {
+        rc = -1;
+    }
+
+    header.checksum = hash;
+    if (rc == 0 && (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1)) {
+        rc = -1;
+    }
+    if (fclose(file) != 0) rc = -1;
+
+    if (rc < 0) log_error("QBANK", "ERROR - write to '%s' failed", path);
+    return rc;
+}
+
+/**
+ * Compiles a text question file into a binary bank.
+ * The bank is written next to its destination and renamed into place, so
+ * servers that still map the previous version keep a consistent view.
+ * @param source_path Path of the .dat file
+ * @param bank_path Path of the bank to produce
+ * @return Number of questions compiled, -1 on error
+ */
+int qbank_compile(const char *source_path, const char *bank_path) {
+    log_msg("QBANK", "qbank_compile() - '%s' -> '%s'", source_path, bank_path);
+
+    FILE *file = fopen(source_path, "r");
+    if (!file) {
+        log_error("QBANK", "ERROR - Cannot open questions file '%s'", source_path);
+        return -1;
+    }
+
+    BankBuilder b;
+    memset(&b, 0, sizeof(b));
+    b.strings_capacity = 4096;
+    b.strings = malloc(b.strings_capacity);
+    if (!b.strings) {
+        fclose(file);
+        return -1;
+    }
+    b.strings[0] = '\0';
+    b.strings_size = 1;
+
+    char line[2048];
+    int line_num = 0;
+    int rc = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        line_num++;
+        trim_whitespace(line);
+        if (strlen(line) == 0 || line[0] == '#') continue;
+
+        if (reserve_one((void**)&b.questions, &b.questions_capacity,
+                        b.num_questions, sizeof(Question)) < 0) {
+            log_error("QBANK", "ERROR - Out of memory at line %d", line_num);
+            rc = -1;
+            break;
+        }
+
+        // Roll back what a rejected line added, except newly created themes
+        size_t strings_mark = b.strings_size;
+        int refs_mark = b.num_theme_refs;
+        int themes_mark = b.num_themes;
+        Question *q = &b.questions[b.num_questions];
+        if (parse_question(&b, line, q) < 0) {
+            log_warn("QBANK", "WARNING - skipping malformed line %d", line_num);
+            if (b.num_themes == themes_mark) b.strings_size = strings_mark;
+            b.num_theme_refs = refs_mark;
+            continue;
+        }
+        q->id = ++b.num_questions;
+    }
+    fclose(file);
+
+    if (rc == 0 && build_postings(&b) < 0) {
+        log_error("QBANK", "ERROR - Out of memory while building posting lists");
+        rc = -1;
+    }
+    if (rc == 0 && build_fragments(&b) < 0) {
+        log_error("QBANK", "ERROR - Out of memory while encoding question fragments");
+        rc = -1;
+    }
+
+    if (rc == 0) {
+        char tmp_path[1024];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", bank_path);
+        rc = write_bank(&b, tmp_path);
+#ifdef _WIN32
+        if (rc == 0 && !MoveFileExA(tmp_path, bank_path, MOVEFILE_REPLACE_EXISTING)) rc = -1;
+#else
+        if (rc == 0 && rename(tmp_path, bank_path) != 0) rc = -1;
+#endif
+        if (rc < 0) {
+            log_error("QBANK", "ERROR - cannot install bank '%s'", bank_path);
+            remove(tmp_path);
+        }
+    }
+
+    if (rc == 0) {
+        log_msg("QBANK", "Compiled %d questions, %d themes, %lu bytes of strings, %lu bytes of fragments",
+               b.num_questions, b.num_themes, (unsigned long)b.strings_size,
+               (unsigned long)b.fragment_pool->len);
+        rc = b.num_questions;
+    }
+
+    free(b.questions);
+    free(b.themes);
+    free(b.theme_refs);
+    free(b.posting_starts);
+    free(b.postings);
+    free(b.fragments);
+    free(b.fragment_pool);
+    free(b.strings);
+    return rc;
+}
+
+/**
+ * Checks that a byte range lies inside the mapping and is 4-byte aligned.
+ * @param bank Mapped bank
+ * @param offset Section offset
+ * @param count Number of elements
+ * @param elem_size Size of one element
+ * @return true if the section is usable
+ */
+static bool section_ok(const QBank *bank, uint32_t offset, uint32_t count, size_t elem_size) {
+    return offset % 4 == 0 &&
+           offset >= sizeof(QBankHeader) &&
+           (uint64_t)offset + (uint64_t)count * elem_size <= bank->size;
+}
+
+/**
+ * Validates the header and section bounds of a freshly mapped bank.
+ * Offsets stored in records are checked on access instead, so opening
+ * costs the same for any bank size and only faults in the header page.
+ * @param bank Mapped bank
+ * @return 0 if valid, -1 otherwise
+ */
+static int validate(QBank *bank) {
+    if (bank->size < sizeof(QBankHeader)) return -1;
+
+    const QBankHeader *h = (const QBankHeader*)bank->base;
+    if (h->magic != QBANK_MAGIC || h->version != QBANK_VERSION) return -1;
+    if (h->file_size != bank->size) return -1;
+    if (h->num_themes > (uint32_t)UINT16_MAX + 1) return -1;
+    if (!section_ok(bank, h->questions_offset, h->num_questions, sizeof(Question)) ||
+        !section_ok(bank, h->themes_offset, h->num_themes, sizeof(QBankTheme)) ||
+        !section_ok(bank, h->theme_refs_offset, h->num_theme_refs, sizeof(uint16_t)) ||
+        !section_ok(bank, h->posting_starts_offset, h->num_themes * QBANK_DIFFICULTIES + 1, sizeof(uint32_t)) ||
+        !section_ok(bank, h->postings_offset, h->num_postings, sizeof(uint32_t)) ||
+        !section_ok(bank, h->fragments_offset, h->num_questions, sizeof(QuestionFragment)) ||
+        !section_ok(bank, h->fragment_pool_offset, h->fragment_pool_size, 1) ||
+        !section_ok(bank, h->strings_offset, h->strings_size, 1)) {
+        return -1;
+    }
+    if (h->strings_size == 0 || bank->base[h->strings_offset + h->strings_size - 1] != '\0') {
+        return -1;
+    }
+
+    bank->header = h;
+    bank->questions = (const Question*)(bank->base + h->questions_offset);
+    bank->themes = (const QBankTheme*)(bank->base + h->themes_offset);
+    bank->theme_refs = (const uint16_t*)(bank->base + h->theme_refs_offset);
+    bank->posting_starts = (const uint32_t*)(bank->base + h->posting_starts_offset);
+    bank->postings = (const uint32_t*)(bank->base + h->postings_offset);
+    bank->fragments = (const QuestionFragment*)(bank->base + h->fragments_offset);
+    bank->fragment_pool = (const char*)(bank->base + h->fragment_pool_offset);
+    bank->strings = (const char*)(bank->base + h->strings_offset);
+    return 0;
+}
+
+/**
+ * Maps a bank read-only. Pages are shared with every other process that
+ * maps the same file and are only faulted in when questions are used.
+ * @param bank Bank to fill
+ * @param path Bank file
+ * @return 0 on success, -1 if the file is missing, unreadable or invalid
+ */
+int qbank_open(QBank *bank, const char *path) {
+    memset(bank, 0, sizeof(QBank));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return -1;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return -1;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!base) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return -1;
+    }
+    bank->file_handle = file;
+    bank->mapping_handle = mapping;
+    bank->size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+    bank->size = (size_t)st.st_size;
+#endif
+
+    bank->base = base;
+    if (validate(bank) < 0) {
+        log_error("QBANK", "ERROR - '%s' is not a valid version %d bank", path, QBANK_VERSION);
+        qbank_close(bank);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Unmaps a bank. Question pointers obtained from it become invalid.
+ * @param bank Bank to close
+ */
+void qbank_close(QBank *bank) {
+    if (bank->base) {
+#ifdef _WIN32
+        UnmapViewOfFile(bank->base);
+        CloseHandle(bank->mapping_handle);
+        CloseHandle(bank->file_handle);
+#else
+        munmap((void*)bank->base, bank->size);
+#endif
+    }
+    memset(bank, 0, sizeof(QBank));
+}
+
+/**
+ * Recomputes the checksum over the whole bank. Reads every page, so this
+ * is meant for qbankc and diagnostics rather than server startup.
+ * @param bank Open bank
+ * @return 0 if the checksum matches, -1 otherwise
+ */
+int qbank_verify(const QBank *bank) {
+    if (!bank->header) return -1;
+    uint32_t hash = fnv1a(FNV_OFFSET_BASIS, bank->base + sizeof(QBankHeader),
+                          bank->size - sizeof(QBankHeader));
+    return hash == bank->header->checksum ? 0 : -1;
+}
+
+/**
+ * Looks up a question by id.
+ * @param bank Open bank
+ * @param id Question id
+ * @return Question record, NULL if the id is unknown
+ */
+const Question* qbank_question(const QBank *bank, int id) {
+    if (!bank->header || id < 1 || (uint32_t)id > bank->header->num_questions) return NULL;
+    return &bank->questions[id - 1];
+}
+
+/**
+ * Resolves a string pool offset.
+ * @param bank Open bank
+ * @param offset Offset stored in a record
+ * @return NUL-terminated string, "" for an out-of-range offset
+ */
+const char* qbank_string(const QBank *bank, uint32_t offset) {
+    if (!bank->header || offset >= bank->header->strings_size) return "";
+    return bank->strings + offset;
+}
+
+/**
+ * Returns the i-th theme of a question.
+ * @param bank Open bank
+ * @param q Question record
+ * @param i Index below q->num_themes
+ * @return Theme id, -1 if i or the stored reference is out of range
+ */
+int qbank_question_theme(const QBank *bank, const Question *q, int i) {
+    if (i < 0 || i >= q->num_themes) return -1;
+
+    uint64_t ref = (uint64_t)q->themes_first + (uint64_t)i;
+    if (ref >= bank->header->num_theme_refs) return -1;
+    int theme_id = bank->theme_refs[ref];
+    return (uint32_t)theme_id < bank->header->num_themes ? theme_id : -1;
+}
+
+/**
+ * Returns the display name of a theme.
+ * @param bank Open bank
+ * @param theme_id Theme id
+ * @return Theme name, NULL if the id is unknown
+ */
+const char* qbank_theme_name(const QBank *bank, int theme_id) {
+    if (!bank->header || theme_id < 0 || (uint32_t)theme_id >= bank->header->num_themes) return NULL;
+    return qbank_string(bank, bank->themes[theme_id].name);
+}
+
+/**
+ * Returns the posting list of a (theme, difficulty) pair: the ascending ids
+ * of every question with that difficulty attached to that theme.
+ * @param bank Open bank
+ * @param theme_id Theme id
+ * @param difficulty Difficulty level
+ * @param ids Receives the first id of the list
+ * @return Number of ids in the list, 0 for an unknown pair
+ */
+int qbank_postings(const QBank *bank, int theme_id, int difficulty, const uint32_t **ids) {
+    *ids = NULL;
+    if (!bank->header || theme_id < 0 || (uint32_t)theme_id >= bank->header->num_themes ||
+        difficulty < 0 || difficulty >= QBANK_DIFFICULTIES) {
+        return 0;
+    }
+
+    size_t list = (size_t)theme_id * QBANK_DIFFICULTIES + (size_t)difficulty;
+    uint32_t start = bank->posting_starts[list];
+    uint32_t end = bank->posting_starts[list + 1];
+    if (start > end || end > bank->header->num_postings) return 0;
+
+    *ids = bank->postings + start;
+    return (int)(end - start);
+}
+
+/**
+ * Resolves a slice of the fragment pool.
+ * @param bank Open bank
+ * @param offset Slice offset stored in the fragment table
+ * @param slice_len Slice length stored in the fragment table
+ * @param len Receives the usable length, 0 for an out-of-range slice
+ * @return Start of the slice
+ */
+static const char* fragment_slice(const QBank *bank, uint32_t offset, uint32_t slice_len, size_t *len) {
+    if ((uint64_t)offset + slice_len > bank->header->fragment_pool_size) {
+        *len = 0;
+        return "";
+    }
+    *len = slice_len;
+    return bank->fragment_pool + offset;
+}
+
+/**
+ * Returns the pre-encoded question/new fields of a question.
+ * @param bank Open bank
+ * @param q Question record of this bank
+ * @param len Receives the length of the fields
+ * @return Comma-separated "key":value pairs, not NUL-terminated
+ */
+const char* qbank_question_fields(const QBank *bank, const Question *q, size_t *len) {
+    const QuestionFragment *f = &bank->fragments[q - bank->questions];
+    return fragment_slice(bank, f->question_offset, f->question_len, len);
+}
+
+/**
+ * Returns the pre-encoded question/results fields of a question.
+ * @param bank Open bank
+ * @param q Question record of this bank
+ * @param len Receives the length of the fields
+ * @return Comma-separated "key":value pairs, not NUL-terminated
+ */
+const char* qbank_results_fields(const QBank *bank, const Question *q, size_t *len) {
+    const QuestionFragment *f = &bank->fragments[q - bank->questions];
+    return fragment_slice(bank, f->results_offset, f->results_len, len);
+}
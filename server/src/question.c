@@ -3,293 +3,240 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #define QUESTIONS_FILE "data/questions.dat"
+#define QUESTIONS_BANK "data/questions.qbank"
+#define SAMPLE_ATTEMPTS_PER_QUESTION 64
 
 /**
- * Helper function to extract the next semicolon-delimited field from a string.
- * Handles empty fields correctly (unlike strtok).
- * @param ptr Pointer to current position in string (updated after call)
- * @return Pointer to the extracted field, or NULL if end of string
+ * Tells whether a bank needs to be (re)built from its source file.
+ * @param bank_path Compiled bank
+ * @param source_path Text source of the bank
+ * @return true if the bank is missing or older than the source
  */
-static char* get_next_field(char **ptr) {
-    if (*ptr == NULL || **ptr == '\0') return NULL;
-    
-    char *start = *ptr;
-    char *semicolon = strchr(start, ';');
-    
-    if (semicolon) {
-        *semicolon = '\0';
-        *ptr = semicolon + 1;
-    } else {
-        *ptr = NULL;
-    }
-    
-    return start;
+static bool bank_is_stale(const char *bank_path, const char *source_path) {
+    struct stat bank_st, source_st;
+    if (stat(source_path, &source_st) != 0) return false;
+    if (stat(bank_path, &bank_st) != 0) return true;
+    return bank_st.st_mtime < source_st.st_mtime;
 }
 
 /**
- * Finds an existing theme by name or creates a new one.
- * Used during question loading to auto-detect themes.
- * @param state Server state containing themes array
- * @param theme_name Name of the theme to find or create
- * @return Theme ID on success, -1 if max themes reached
+ * Maps the compiled question bank into server state.
+ * With the default bank, a missing, stale or unreadable bank is first
+ * rebuilt from data/questions.dat (what `make bank` does offline).
+ * @param state Server state to populate with questions
+ * @param filename Path to a compiled bank, or NULL for default "data/questions.qbank"
+ * @return Number of questions loaded, -1 on error
  */
-static int get_or_create_theme(ServerState *state, const char *theme_name) {
-
-    for (int i = 0; i < state->num_themes; i++) {
-        if (strcmp(state->themes[i].name, theme_name) == 0) {
-            return state->themes[i].id;
-        }
+int load_questions(ServerState *state, const char *filename) {
+    const char *bank_path = filename ? filename : QUESTIONS_BANK;
+    log_msg("QUESTION", "load_questions() - mapping '%s'", bank_path);
+    
+    if (!filename && bank_is_stale(QUESTIONS_BANK, QUESTIONS_FILE)) {
+        log_msg("QUESTION", "Bank missing or older than %s, compiling", QUESTIONS_FILE);
+        qbank_compile(QUESTIONS_FILE, QUESTIONS_BANK);
     }
     
-    if (state->num_themes < MAX_THEMES) {
-        int new_id = state->num_themes;
-        state->themes[new_id].id = new_id;
-        strncpy(state->themes[new_id].name, theme_name, 63);
-        state->num_themes++;
-        log_msg("QUESTION", "Created new theme: id=%d, name='%s'", new_id, theme_name);
-        return new_id;
+    int rc = qbank_open(&state->bank, bank_path);
+    if (rc < 0 && !filename && qbank_compile(QUESTIONS_FILE, QUESTIONS_BANK) >= 0) {
+        rc = qbank_open(&state->bank, bank_path);
     }
+    if (rc < 0) {
+        log_error("QUESTION", "ERROR - Cannot map question bank '%s'", bank_path);
+        return -1;
+    }
+    
+    state->questions = state->bank.questions;
+    state->num_questions = (int)state->bank.header->num_questions;
+    state->num_themes = (int)state->bank.header->num_themes;
     
-    log_msg("QUESTION", "WARNING - Max themes reached, cannot create '%s'", theme_name);
-    return -1;
+    log_msg("QUESTION", "Mapped %d questions (%lu bytes) from %s",
+           state->num_questions, (unsigned long)state->bank.size, bank_path);
+    log_msg("QUESTION", "Detected %d themes:", state->num_themes);
+    for (int i = 0; i < state->num_themes; i++) {
+        log_msg("QUESTION", "  [%d] %s", i, qbank_theme_name(&state->bank, i));
+    }
+    return state->num_questions;
 }
 
 /**
- * Loads questions from a data file into server state.
- * Parses format: theme;difficulty;type;question;answers;correct;explanation
- * @param state Server state to populate with questions
- * @param filename Path to questions file, or NULL for default "data/questions.dat"
- * @return Number of questions loaded, -1 on file error
+ * Releases the question bank.
+ * @param state Server state holding the bank
  */
-int load_questions(ServerState *state, const char *filename) {
-    const char *file_to_load = filename ? filename : QUESTIONS_FILE;
-    log_msg("QUESTION", "load_questions() - loading from '%s'", file_to_load);
-    
-    FILE *file = fopen(file_to_load, "r");
-    if (!file) {
-        log_msg("QUESTION", "ERROR - Cannot open questions file '%s'", file_to_load);
-        return -1;
-    }
-    
-    char line[2048];
+void unload_questions(ServerState *state) {
+    qbank_close(&state->bank);
+    state->questions = NULL;
     state->num_questions = 0;
-    int next_question_id = 1; 
-    int line_num = 0;
-    
-    while (fgets(line, sizeof(line), file) && state->num_questions < MAX_QUESTIONS) {
-        line_num++;
-        trim_whitespace(line);
-        if (strlen(line) == 0 || line[0] == '#') continue;
-        
-        log_msg("QUESTION", "Parsing line %d: %.50s...", line_num, line);
-        
-        Question *q = &state->questions[state->num_questions];
-        memset(q, 0, sizeof(Question));
-        q->id = next_question_id++;
-        char line_copy[2048];
-        strncpy(line_copy, line, sizeof(line_copy) - 1);
-        char *ptr = line_copy;
-        
-        // Parse: theme;difficulty;type;question;answers;correct;explanation
-        char *field;
-        
-        // themes
-        field = get_next_field(&ptr);
-        if (!field) continue;
-        if (strlen(field) > 0) {
-            char themes_str[256];
-            strncpy(themes_str, field, 255);
-            char *theme_ptr = themes_str;
-            char *comma;
-            
-            while ((comma = strchr(theme_ptr, ',')) != NULL && q->num_themes < MAX_THEMES) {
-                *comma = '\0';
-
-                while (*theme_ptr == ' ') theme_ptr++;
-                char *end = theme_ptr + strlen(theme_ptr) - 1;
-                while (end > theme_ptr && *end == ' ') *end-- = '\0';
-                
-                int theme_id = get_or_create_theme(state, theme_ptr);
-                if (theme_id >= 0) {
-                    q->theme_ids[q->num_themes++] = theme_id;
-                }
-                theme_ptr = comma + 1;
-            }
+}
 
-            if (*theme_ptr && q->num_themes < MAX_THEMES) {
-                while (*theme_ptr == ' ') theme_ptr++;
-                char *end = theme_ptr + strlen(theme_ptr) - 1;
-                while (end > theme_ptr && *end == ' ') *end-- = '\0';
-                
-                int theme_id = get_or_create_theme(state, theme_ptr);
-                if (theme_id >= 0) {
-                    q->theme_ids[q->num_themes++] = theme_id;
-                }
-            }
-        }
-        
-        // difficulty
-        field = get_next_field(&ptr);
-        if (!field) continue;
-        q->difficulty = string_to_difficulty(field);
-        
-        // type
-        field = get_next_field(&ptr);
-        if (!field) continue;
-        if (strcmp(field, "qcm") == 0) q->type = QUESTION_QCM;
-        else if (strcmp(field, "boolean") == 0) q->type = QUESTION_BOOLEAN;
-        else q->type = QUESTION_TEXT;
-        
-        // Field 5: question text
-        field = get_next_field(&ptr);
-        if (!field) continue;
-        strncpy(q->question, field, MAX_QUESTION_TEXT - 1);
-        
-        // answers
-        field = get_next_field(&ptr);
-        if (!field) continue;
-        if (q->type == QUESTION_QCM && strlen(field) > 0) {
-            char *ans_ptr = field;
-            char *comma;
-            int ans_idx = 0;
-            while ((comma = strchr(ans_ptr, ',')) != NULL && ans_idx < 4) {
-                *comma = '\0';
-                strncpy(q->answers[ans_idx++], ans_ptr, MAX_ANSWER_TEXT - 1);
-                ans_ptr = comma + 1;
-            }
-            if (*ans_ptr && ans_idx < 4) {
-                strncpy(q->answers[ans_idx], ans_ptr, MAX_ANSWER_TEXT - 1);
-            }
-        }
-        
-        // correct answers
-        field = get_next_field(&ptr);
-        if (!field) continue;
-        if (q->type == QUESTION_TEXT && strlen(field) > 0) {
-            char *cor_ptr = field;
-            char *comma;
-            while ((comma = strchr(cor_ptr, ',')) != NULL && q->num_text_answers < 4) {
-                *comma = '\0';
-                strncpy(q->text_answers[q->num_text_answers++], cor_ptr, MAX_ANSWER_TEXT - 1);
-                cor_ptr = comma + 1;
-            }
-            if (*cor_ptr && q->num_text_answers < 4) {
-                strncpy(q->text_answers[q->num_text_answers++], cor_ptr, MAX_ANSWER_TEXT - 1);
-            }
-        } else {
-            q->correct_answer = atoi(field);
-        }
-        
-        // explanation
-        field = get_next_field(&ptr);
-        if (field && strlen(field) > 0) {
-            strncpy(q->explanation, field, MAX_QUESTION_TEXT - 1);
+/**
+ * Tells whether a question is also filed under one of the first
+ * selected themes, whose posting lists are sampled as well.
+ * @param bank Question bank
+ * @param q Candidate question
+ * @param themes Selected theme ids
+ * @param count Number of leading themes to check
+ * @return true if another list owns the question
+ */
+static bool owned_by_earlier_theme(const QBank *bank, const Question *q, const int *themes, int count) {
+    for (int i = 0; i < q->num_themes; i++) {
+        int theme_id = qbank_question_theme(bank, q, i);
+        for (int t = 0; t < count; t++) {
+            if (themes[t] == theme_id) return true;
         }
-        
-        state->num_questions++;
     }
-    
-    fclose(file);
-    log_msg("QUESTION", "Loaded %d questions from %s", state->num_questions, file_to_load);
-    log_msg("QUESTION", "Detected %d themes:", state->num_themes);
-    for (int i = 0; i < state->num_themes; i++) {
-        log_msg("QUESTION", "  [%d] %s", state->themes[i].id, state->themes[i].name);
-    }
-    return state->num_questions;
+    return false;
 }
 
 /**
  * Selects random questions for a game session based on criteria.
- * Filters by difficulty and themes, then shuffles and picks required number.
+ * Samples the prebuilt (theme, difficulty) posting lists of the bank
+ * instead of scanning every question. A draw picks a uniform position in
+ * the concatenated lists; a question listed under several selected themes
+ * only counts in the first of them, so each matching question is equally
+ * likely. Heavy overlap falls back to merging the lists and a partial
+ * Fisher-Yates shuffle.
  * @param state Server state containing all questions
  * @param session Session with theme IDs, difficulty, and num_questions set
  * @return Number of questions selected, -1 if not enough matching questions
  */
 int select_questions_for_session(ServerState *state, Session *session) {
-    log_msg("QUESTION", "select_questions_for_session() - need %d questions, difficulty=%d",
-           session->num_questions, session->difficulty);
+    log_debug("QUESTION", "select_questions_for_session() - need %d questions, difficulty=%d",
+             session->num_questions, session->difficulty);
     
-    int matching[MAX_QUESTIONS];
-    int num_matching = 0;
+    const QBank *bank = &state->bank;
+    int need = session->num_questions;
+    int themes[MAX_THEMES];
+    const uint32_t *lists[MAX_THEMES];
+    int lengths[MAX_THEMES];
+    int num_lists = 0;
+    long total = 0;
     
-    for (int i = 0; i < state->num_questions; i++) {
-        Question *q = &state->questions[i];
-        
-        if (q->difficulty != session->difficulty) continue;
-        
-        bool theme_match = false;
-        for (int t = 0; t < session->num_themes && !theme_match; t++) {
-            for (int qt = 0; qt < q->num_themes && !theme_match; qt++) {
-                if (q->theme_ids[qt] == session->theme_ids[t]) {
-                    theme_match = true;
-                }
-            }
+    for (int t = 0; t < session->num_themes && t < MAX_THEMES; t++) {
+        bool duplicate = false;
+        for (int l = 0; l < num_lists; l++) {
+            if (themes[l] == session->theme_ids[t]) duplicate = true;
         }
+        if (duplicate) continue;
         
-        if (theme_match) {
-            matching[num_matching++] = i;
-        }
+        const uint32_t *ids;
+        int length = qbank_postings(bank, session->theme_ids[t], session->difficulty, &ids);
+        if (length == 0) continue;
+        
+        themes[num_lists] = session->theme_ids[t];
+        lists[num_lists] = ids;
+        lengths[num_lists] = length;
+        num_lists++;
+        total += length;
     }
     
-    if (num_matching < session->num_questions) {
-        log_msg("QUESTION", "select_questions_for_session() FAILED - only %d matching (need %d)",
-               num_matching, session->num_questions);
+    if (total < need) {
+        log_warn("QUESTION", "select_questions_for_session() FAILED - only %ld matching (need %d)",
+                total, need);
         return -1;
     }
     
-    log_msg("QUESTION", "Found %d matching questions, selecting %d", 
-           num_matching, session->num_questions);
+    int chosen = 0;
+    int max_attempts = need * SAMPLE_ATTEMPTS_PER_QUESTION;
+    for (int attempt = 0; attempt < max_attempts && chosen < need; attempt++) {
+        int pos = random_int(0, (int)total - 1);
+        int l = 0;
+        while (pos >= lengths[l]) pos -= lengths[l++];
+        
+        int id = (int)lists[l][pos];
+        const Question *q = qbank_question(bank, id);
+        if (!q || owned_by_earlier_theme(bank, q, themes, l)) continue;
+        
+        bool taken = false;
+        for (int i = 0; i < chosen && !taken; i++) {
+            taken = (session->question_ids[i] == id);
+        }
+        if (!taken) session->question_ids[chosen++] = id;
+    }
     
-    shuffle_array(matching, num_matching);
+    if (chosen < need) {
+        // Lists overlap too much for rejection sampling: merge them once
+        int *matching = malloc((size_t)total * sizeof(int));
+        if (!matching) return -1;
+        int num_matching = 0;
+        for (int l = 0; l < num_lists; l++) {
+            for (int i = 0; i < lengths[l]; i++) {
+                const Question *q = qbank_question(bank, (int)lists[l][i]);
+                if (q && !owned_by_earlier_theme(bank, q, themes, l)) {
+                    matching[num_matching++] = q->id;
+                }
+            }
+        }
+        
+        if (num_matching < need) {
+            log_warn("QUESTION", "select_questions_for_session() FAILED - only %d matching (need %d)",
+                    num_matching, need);
+            free(matching);
+            return -1;
+        }
+        
+        for (int i = 0; i < need; i++) {
+            int j = random_int(i, num_matching - 1);
+            int tmp = matching[i];
+            matching[i] = matching[j];
+            matching[j] = tmp;
+            session->question_ids[i] = matching[i];
+        }
+        free(matching);
+        log_debug("QUESTION", "Merged %d matching questions, selected %d", num_matching, need);
+    } else {
+        log_debug("QUESTION", "Sampled %d questions from %ld postings", need, total);
+    }
     
-    for (int i = 0; i < session->num_questions; i++) {
-        session->question_ids[i] = state->questions[matching[i]].id;
-        log_msg("QUESTION", "  Selected question id=%d", session->question_ids[i]);
+    for (int i = 0; i < need; i++) {
+        log_debug("QUESTION", "  Selected question id=%d", session->question_ids[i]);
     }
     
-    return session->num_questions;
+    return need;
 }
 
 /**
  * Validates a player's answer against the correct answer.
  * Handles QCM (index), boolean, and text (case-insensitive) question types.
+ * @param bank Bank holding the question strings
  * @param q The question being answered
  * @param answer_index For QCM: the selected answer index (0-3)
  * @param text_answer For TEXT: the player's text response
  * @param bool_answer For BOOLEAN: the player's true/false response
  * @return true if answer is correct, false otherwise
  */
-bool check_answer(Question *q, int answer_index, const char *text_answer, bool bool_answer) {
+bool check_answer(const QBank *bank, const Question *q, int answer_index, const char *text_answer, bool bool_answer) {
     bool correct = false;
     
     switch (q->type) {
         case QUESTION_QCM:
             correct = (answer_index == q->correct_answer);
-            log_msg("QUESTION", "check_answer(QCM) - given=%d, expected=%d, correct=%s",
-                   answer_index, q->correct_answer, correct ? "YES" : "NO");
+            log_debug("QUESTION", "check_answer(QCM) - given=%d, expected=%d, correct=%s",
+                     answer_index, q->correct_answer, correct ? "YES" : "NO");
             return correct;
             
         case QUESTION_BOOLEAN:
             correct = (bool_answer == (q->correct_answer == 1));
-            log_msg("QUESTION", "check_answer(BOOL) - given=%s, expected=%d, correct=%s",
-                   bool_answer ? "true" : "false", q->correct_answer, correct ? "YES" : "NO");
+            log_debug("QUESTION", "check_answer(BOOL) - given=%s, expected=%d, correct=%s",
+                     bool_answer ? "true" : "false", q->correct_answer, correct ? "YES" : "NO");
             return correct;
             
         case QUESTION_TEXT:
             for (int i = 0; i < q->num_text_answers; i++) {
-                if (str_equals(text_answer, q->text_answers[i])) {
-                    log_msg("QUESTION", "check_answer(TEXT) - given='%s', matched='%s', correct=YES",
-                           text_answer, q->text_answers[i]);
+                const char *accepted = qbank_string(bank, q->text_answers[i]);
+                if (str_equals(text_answer, accepted)) {
+                    log_debug("QUESTION", "check_answer(TEXT) - given='%s', matched='%s', correct=YES",
+                             text_answer, accepted);
                     return true;
                 }
             }
-            log_msg("QUESTION", "check_answer(TEXT) - given='%s', correct=NO", text_answer);
+            log_debug("QUESTION", "check_answer(TEXT) - given='%s', correct=NO", text_answer);
             return false;
             
         default:
-            log_msg("QUESTION", "check_answer() - unknown question type");
+            log_debug("QUESTION", "check_answer() - unknown question type");
             return false;
     }
 }
@@ -344,8 +291,8 @@ cJSON* create_themes_json(ServerState *state) {
     cJSON *themes_array = cJSON_AddArrayToObject(response, "themes");
     for (int i = 0; i < state->num_themes; i++) {
         cJSON *theme = cJSON_CreateObject();
-        cJSON_AddNumberToObject(theme, "id", state->themes[i].id);
-        cJSON_AddStringToObject(theme, "name", state->themes[i].name);
+        cJSON_AddNumberToObject(theme, "id", i);
+        cJSON_AddStringToObject(theme, "name", qbank_theme_name(&state->bank, i));
         cJSON_AddItemToArray(themes_array, theme);
     }
     
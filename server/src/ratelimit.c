@@ -0,0 +1,54 @@
+#include "ratelimit.h"
+
+typedef struct {
+    const char *name;
+    double per_second;             /**< Refill rate */
+    double burst;                  /**< Bucket capacity */
+} RateLimit;
+
+static const RateLimit rate_limits[RATE_CLASS_COUNT] = {
+    [RATE_NONE]    = { "none",    0.0,  0.0 },
+    [RATE_ACCOUNT] = { "account", 2.0,  10.0 },
+    [RATE_QUERY]   = { "query",   20.0, 50.0 },
+    [RATE_LOBBY]   = { "lobby",   5.0,  20.0 },
+    [RATE_GAME]    = { "game",    20.0, 40.0 },
+    [RATE_ADMIN]   = { "admin",   10.0, 20.0 },
+};
+
+/**
+ * Takes one token from a client's bucket for a request class.
+ * Buckets start full and refill continuously up to their burst size.
+ * Only touched by the thread handling the client's requests.
+ * @param buckets The client's buckets, RATE_CLASS_COUNT entries
+ * @param rate_class Class of the request
+ * @param now_ms Current time in milliseconds
+ * @return true if the request may proceed, false if over the limit
+ */
+bool rate_allow(RateBucket *buckets, RateClass rate_class, double now_ms) {
+    if (rate_class <= RATE_NONE || rate_class >= RATE_CLASS_COUNT) return true;
+    
+    const RateLimit *limit = &rate_limits[rate_class];
+    RateBucket *bucket = &buckets[rate_class];
+    
+    if (bucket->updated_ms == 0) {
+        bucket->tokens = limit->burst;
+    } else if (now_ms > bucket->updated_ms) {
+        bucket->tokens += (now_ms - bucket->updated_ms) * limit->per_second / 1000.0;
+        if (bucket->tokens > limit->burst) bucket->tokens = limit->burst;
+    }
+    bucket->updated_ms = now_ms;
+    
+    if (bucket->tokens < 1.0) return false;
+    bucket->tokens -= 1.0;
+    return true;
+}
+
+/**
+ * Gives the name of a request class, for logs.
+ * @param rate_class Class
+ * @return Static name
+ */
+const char* rate_class_name(RateClass rate_class) {
+    if (rate_class < 0 || rate_class >= RATE_CLASS_COUNT) return "unknown";
+    return rate_limits[rate_class].name;
+}
@@ -0,0 +1,130 @@
+#include "rcu.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Each thread owns a sequence counter, odd while it is inside a read
+// section. A writer waits for every odd counter it sees to move on.
+typedef struct RcuReader {
+    uint64_t seq;                  /**< Odd inside a read section (atomic) */
+    int depth;                     /**< Nesting level, owner thread only */
+    bool in_use;                   /**< Owned by a live thread (atomic) */
+    struct RcuReader *next;        /**< Next record, the list only grows */
+} __attribute__((aligned(64))) RcuReader;
+
+static RcuReader *readers;
+static pthread_key_t reader_key;
+static pthread_once_t reader_once = PTHREAD_ONCE_INIT;
+static __thread RcuReader *self;
+
+/**
+ * Gives a thread's record back for reuse when the thread exits.
+ * @param arg The thread's RcuReader
+ */
+static void release_reader(void *arg) {
+    RcuReader *reader = (RcuReader*)arg;
+    __atomic_store_n(&reader->in_use, false, __ATOMIC_RELEASE);
+}
+
+static void create_reader_key(void) {
+    pthread_key_create(&reader_key, release_reader);
+}
+
+/**
+ * Allocates a zeroed record on its own cache line, as its declared
+ * alignment requires (calloc only guarantees 16 bytes). Records are never
+ * freed. The MSVC runtime mingw links against has no aligned_alloc.
+ * @return New record, NULL on allocation failure
+ */
+static RcuReader* alloc_reader(void) {
+#ifdef _WIN32
+    RcuReader *reader = _aligned_malloc(sizeof(RcuReader), 64);
+#else
+    RcuReader *reader = aligned_alloc(64, sizeof(RcuReader));
+#endif
+    if (reader) memset(reader, 0, sizeof(RcuReader));
+    return reader;
+}
+
+/**
+ * Finds the calling thread's record, claiming a released one or adding a
+ * new one on first use. Records are never freed, so writers can walk the
+ * list without a lock.
+ * @return Record of the calling thread, NULL on allocation failure
+ */
+static RcuReader* current_reader(void) {
+    if (self) return self;
+
+    pthread_once(&reader_once, create_reader_key);
+    RcuReader *reader;
+    for (reader = __atomic_load_n(&readers, __ATOMIC_ACQUIRE); reader; reader = reader->next) {
+        bool expected = false;
+        if (__atomic_compare_exchange_n(&reader->in_use, &expected, true, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (!reader) {
+        reader = alloc_reader();
+        if (!reader) return NULL;
+        reader->in_use = true;
+        reader->next = __atomic_load_n(&readers, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&readers, &reader->next, reader, true,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    reader->depth = 0;
+    pthread_setspecific(reader_key, reader);
+    self = reader;
+    return reader;
+}
+
+/**
+ * Enters a read section (nestable). Objects found inside stay valid until
+ * the matching rcu_read_unlock.
+ */
+void rcu_read_lock(void) {
+    RcuReader *reader = current_reader();
+    if (!reader || reader->depth++ > 0) return;
+
+    __atomic_store_n(&reader->seq, reader->seq + 1, __ATOMIC_RELAXED);
+    // Order the odd counter before every read of the protected data
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * Leaves a read section.
+ */
+void rcu_read_unlock(void) {
+    RcuReader *reader = self;
+    if (!reader || --reader->depth > 0) return;
+
+    __atomic_store_n(&reader->seq, reader->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Waits until every read section in progress when called has ended.
+ * Sections started afterwards cannot see what was unpublished before the
+ * call, so they are not waited for.
+ */
+void rcu_synchronize(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for (RcuReader *reader = __atomic_load_n(&readers, __ATOMIC_ACQUIRE); reader; reader = reader->next) {
+        uint64_t seq = __atomic_load_n(&reader->seq, __ATOMIC_ACQUIRE);
+        if (!(seq & 1)) continue;
+        while (__atomic_load_n(&reader->seq, __ATOMIC_ACQUIRE) == seq) {
+            sched_yield();
+        }
+    }
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,177 @@
+#include "rcuindex.h"
+#include "rcu.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RCUINDEX_MIN_CAPACITY 16
+#define RCUINDEX_REMOVED -1
+
+/**
+ * Fibonacci hashing, as in idindex.c.
+ * @param id Key to hash
+ * @param mask Capacity - 1
+ * @return Home bucket of the id
+ */
+static int home_bucket(int id, int mask) {
+    uint32_t h = (uint32_t)id * 2654435769u;
+    return (int)((h ^ (h >> 16)) & (uint32_t)mask);
+}
+
+/**
+ * Allocates an empty table (header and both arrays in one block).
+ * @param capacity Power-of-two bucket count
+ * @return Table, NULL on allocation failure
+ */
+static RcuIndexTable* alloc_table(int capacity) {
+    size_t ids_size = (size_t)capacity * sizeof(int);
+    size_t values_offset = (sizeof(RcuIndexTable) + ids_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    char *block = calloc(1, values_offset + (size_t)capacity * sizeof(void*));
+    if (!block) return NULL;
+
+    RcuIndexTable *table = (RcuIndexTable*)block;
+    table->capacity = capacity;
+    table->ids = (int*)(block + sizeof(RcuIndexTable));
+    table->values = (void**)(block + values_offset);
+    return table;
+}
+
+/**
+ * Stores an id in its first empty bucket. The value is written before the
+ * id, so a reader that sees the id also sees its value.
+ * @param table Table with room for the id
+ * @param id Positive id, absent from the table
+ * @param value Pointer to store
+ */
+static void place(RcuIndexTable *table, int id, void *value) {
+    int mask = table->capacity - 1;
+    int i = home_bucket(id, mask);
+    while (table->ids[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    __atomic_store_n(&table->values[i], value, __ATOMIC_RELAXED);
+    __atomic_store_n(&table->ids[i], id, __ATOMIC_RELEASE);
+}
+
+/**
+ * Replaces the table by a fresh one holding only the live ids, with room
+ * for as many again before the next rebuild. Readers still walking the
+ * old table finish on it; it is freed once they are gone.
+ * @param index Index to rebuild
+ * @param extra Ids about to be added
+ * @return 0 on success, -1 on allocation failure (index left untouched)
+ */
+static int rebuild(RcuIndex *index, int extra) {
+    RcuIndexTable *old = index->table;
+    int capacity = RCUINDEX_MIN_CAPACITY;
+    while (capacity < (index->count + extra) * 4) capacity <<= 1;
+
+    RcuIndexTable *table = alloc_table(capacity);
+    if (!table) return -1;
+    for (int i = 0; i < old->capacity; i++) {
+        if (old->ids[i] > 0) {
+            place(table, old->ids[i], old->values[i]);
+        }
+    }
+
+    __atomic_store_n(&index->table, table, __ATOMIC_RELEASE);
+    index->used = index->count;
+    rcu_synchronize();
+    free(old);
+    return 0;
+}
+
+/**
+ * Initializes an empty index sized for an expected number of ids.
+ * @param index Index to initialize
+ * @param expected Expected number of ids
+ * @return 0 on success, -1 on allocation failure
+ */
+int rcuindex_init(RcuIndex *index, int expected) {
+    int capacity = RCUINDEX_MIN_CAPACITY;
+    while (capacity < expected * 2) capacity <<= 1;
+    memset(index, 0, sizeof(RcuIndex));
+    index->table = alloc_table(capacity);
+    return index->table ? 0 : -1;
+}
+
+/**
+ * Releases the table. No reader may use the index anymore.
+ * @param index Index to destroy
+ */
+void rcuindex_destroy(RcuIndex *index) {
+    free(index->table);
+    memset(index, 0, sizeof(RcuIndex));
+}
+
+/**
+ * Looks up the pointer stored for an id (linear probing, no lock).
+ * Caller must be inside an RCU read section and keep it until done with
+ * the result.
+ * @param index Index to search
+ * @param id Positive id
+ * @return Stored pointer, NULL if absent
+ */
+void* rcuindex_get(const RcuIndex *index, int id) {
+    if (id <= 0) return NULL;
+
+    const RcuIndexTable *table = __atomic_load_n(&index->table, __ATOMIC_ACQUIRE);
+    if (!table) return NULL;
+    int mask = table->capacity - 1;
+    for (int i = home_bucket(id, mask); ; i = (i + 1) & mask) {
+        int stored = __atomic_load_n(&table->ids[i], __ATOMIC_ACQUIRE);
+        if (stored == id) return __atomic_load_n(&table->values[i], __ATOMIC_RELAXED);
+        if (stored == 0) return NULL;
+    }
+}
+
+/**
+ * Inserts an id, or updates the pointer stored for it.
+ * Keeps at least half of the buckets empty, rebuilding the table first
+ * when needed (which waits for a grace period).
+ * @param index Index to update
+ * @param id Positive id
+ * @param value Pointer to store
+ * @return 0 on success, -1 on invalid id or allocation failure
+ */
+int rcuindex_put(RcuIndex *index, int id, void *value) {
+    if (id <= 0 || !index->table) return -1;
+
+    RcuIndexTable *table = index->table;
+    int mask = table->capacity - 1;
+    for (int i = home_bucket(id, mask); table->ids[i] != 0; i = (i + 1) & mask) {
+        if (table->ids[i] == id) {
+            __atomic_store_n(&table->values[i], value, __ATOMIC_RELEASE);
+            return 0;
+        }
+    }
+
+    if ((index->used + 1) * 2 > table->capacity && rebuild(index, 1) < 0) return -1;
+    place(index->table, id, value);
+    index->count++;
+    index->used++;
+    return 0;
+}
+
+/**
+ * Removes an id by turning its bucket into a tombstone. Readers that
+ * found the id before may keep using its pointer until their read section
+ * ends: call rcu_synchronize before reusing what it points to.
+ * @param index Index to update
+ * @param id Id to remove
+ * @return true if the id was present
+ */
+bool rcuindex_remove(RcuIndex *index, int id) {
+    if (id <= 0 || !index->table) return false;
+
+    RcuIndexTable *table = index->table;
+    int mask = table->capacity - 1;
+    for (int i = home_bucket(id, mask); table->ids[i] != 0; i = (i + 1) & mask) {
+        if (table->ids[i] == id) {
+            __atomic_store_n(&table->ids[i], RCUINDEX_REMOVED, __ATOMIC_RELEASE);
+            index->count--;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,200 @@
+#include "reactor.h"
+#include "server.h"
+#include "outqueue.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#define REACTOR_MAX_EVENTS 64
+#define REACTOR_WAIT_MS 500
+
+/**
+ * Drains a readable client socket until the kernel buffer is empty.
+ * Required by edge-triggered mode: a partial read would never be re-signaled.
+ * @param state Server state
+ * @param client Client whose socket became readable
+ * @return 0 if the connection is still open, -1 if it must be closed
+ */
+static int reactor_read_client(ServerState *state, Client *client) {
+    while (client->connected) {
+        int received = client_receive(client, MSG_DONTWAIT);
+        
+        if (received > 0) {
+            log_debug("CLIENT", "Client %d: Received %d bytes", client->id, received);
+            if (client_process_input(state, client) < 0) return -1;
+            continue;
+        }
+        
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        log_msg("CLIENT", "Client %d: recv() returned %d, closing connection", client->id, received);
+        return -1;
+    }
+    return -1;
+}
+
+/**
+ * Event loop of one reactor thread.
+ * Waits on its epoll instance, dispatches readable sockets and flushes the
+ * output queue of writable ones; each client belongs to exactly one reactor
+ * so its requests are never handled concurrently.
+ * @param arg Pointer to the Reactor
+ * @return NULL when the server stops
+ */
+static void* reactor_loop(void *arg) {
+    Reactor *reactor = (Reactor*)arg;
+    ServerState *state = reactor->state;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    
+    log_msg("REACTOR", "Reactor %d started (epoll fd=%d)", reactor->index, reactor->epoll_fd);
+    
+    while (state->running) {
+        int n = epoll_wait(reactor->epoll_fd, events, REACTOR_MAX_EVENTS, REACTOR_WAIT_MS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_error("REACTOR", "ERROR - epoll_wait failed on reactor %d", reactor->index);
+            break;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            Client *client = (Client*)events[i].data.ptr;
+            int closing = 0;
+            
+            if (events[i].events & EPOLLOUT) {
+                outqueue_flush(client);
+            }
+            
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                closing = reactor_read_client(state, client) < 0;
+            }
+            
+            if (closing) {
+                epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, client->socket, NULL);
+                disconnect_client(state, client);
+            }
+        }
+    }
+    
+    log_msg("REACTOR", "Reactor %d stopped", reactor->index);
+    return NULL;
+}
+
+/**
+ * Creates the reactor threads, each with its own epoll instance.
+ * @param state Server state receiving the reactors array
+ * @param num_threads Number of I/O threads to start (at least 1)
+ * @return 0 on success, -1 on error
+ */
+int reactor_start(ServerState *state, int num_threads) {
+    if (num_threads < 1) num_threads = 1;
+    log_msg("REACTOR", "reactor_start() - starting %d I/O thread(s)", num_threads);
+    
+    state->reactors = calloc(num_threads, sizeof(Reactor));
+    if (!state->reactors) {
+        return -1;
+    }
+    
+    state->num_io_threads = num_threads;
+    for (int i = 0; i < num_threads; i++) {
+        Reactor *reactor = &state->reactors[i];
+        reactor->state = state;
+        reactor->index = i;
+        reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (reactor->epoll_fd < 0) {
+            log_error("REACTOR", "ERROR - epoll_create1 failed");
+            reactor_stop(state);
+            return -1;
+        }
+    }
+    
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&state->reactors[i].thread, NULL, reactor_loop, &state->reactors[i]);
+    }
+    
+    state->next_reactor = 0;
+    return 0;
+}
+
+/**
+ * Registers a freshly accepted client with the next reactor (round-robin).
+ * The socket stays blocking; reads use MSG_DONTWAIT and the output queue
+ * is written with non-blocking sends, resumed on EPOLLOUT edges.
+ * @param state Server state
+ * @param client Accepted client
+ * @return 0 on success, -1 if the socket could not be registered
+ */
+int reactor_add_client(ServerState *state, Client *client) {
+    int index = __atomic_fetch_add(&state->next_reactor, 1, __ATOMIC_RELAXED) % state->num_io_threads;
+    Reactor *reactor = &state->reactors[index];
+    
+    client->reactor_id = index;
+    
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = client;
+    
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, client->socket, &ev) < 0) {
+        log_error("REACTOR", "ERROR - cannot register client %d on reactor %d", client->id, index);
+        return -1;
+    }
+    
+    log_debug("REACTOR", "Client %d assigned to reactor %d", client->id, index);
+    return 0;
+}
+
+/**
+ * Joins all reactor threads and releases their epoll instances.
+ * Must be called after state->running was cleared.
+ * @param state Server state owning the reactors
+ */
+void reactor_stop(ServerState *state) {
+    if (!state->reactors) return;
+    
+    for (int i = 0; i < state->num_io_threads; i++) {
+        Reactor *reactor = &state->reactors[i];
+        if (reactor->thread) {
+            pthread_join(reactor->thread, NULL);
+        }
+        if (reactor->epoll_fd > 0) {
+            close(reactor->epoll_fd);
+        }
+    }
+    
+    free(state->reactors);
+    state->reactors = NULL;
+    log_msg("REACTOR", "reactor_stop() - all I/O threads joined");
+}
+
+#else
+
+int reactor_start(ServerState *state, int num_threads) {
+    (void)state;
+    (void)num_threads;
+    log_msg("REACTOR", "reactor_start() - epoll is not available on this platform");
+    return -1;
+}
+
+int reactor_add_client(ServerState *state, Client *client) {
+    (void)state;
+    (void)client;
+    return -1;
+}
+
+void reactor_stop(ServerState *state) {
+    (void)state;
+}
+
+#endif
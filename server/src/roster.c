@@ -0,0 +1,142 @@
+#include "roster.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ROSTER_MIN_CAPACITY 16
+
+/**
+ * Initializes an empty roster sized for an expected number of players.
+ * @param roster Roster to initialize
+ * @param expected Expected number of players
+ * @return 0 on success, -1 on allocation failure
+ */
+int roster_init(Roster *roster, int expected) {
+    memset(roster, 0, sizeof(Roster));
+    int capacity = ROSTER_MIN_CAPACITY;
+    while (capacity < expected) capacity <<= 1;
+
+    roster->players = malloc((size_t)capacity * sizeof(SessionPlayer));
+    if (!roster->players || idindex_init(&roster->positions, capacity) < 0) {
+        free(roster->players);
+        roster->players = NULL;
+        return -1;
+    }
+    roster->capacity = capacity;
+    return 0;
+}
+
+/**
+ * Releases the players, the index and the change log. Safe on a zeroed
+ * roster.
+ * @param roster Roster to destroy
+ */
+void roster_destroy(Roster *roster) {
+    free(roster->players);
+    free(roster->changes);
+    idindex_destroy(&roster->positions);
+    memset(roster, 0, sizeof(Roster));
+}
+
+/**
+ * Appends a join or a leave to the change log, doubling it when full.
+ * @param roster Roster to update
+ * @param joined Whether the player joined (or left)
+ * @param pseudo Display name of the player
+ * @return 0 on success, -1 on allocation failure
+ */
+static int log_change(Roster *roster, bool joined, const char *pseudo) {
+    if (roster->num_changes == roster->changes_capacity) {
+        int capacity = roster->changes_capacity ? roster->changes_capacity * 2 : ROSTER_MIN_CAPACITY;
+        RosterChange *grown = realloc(roster->changes, (size_t)capacity * sizeof(RosterChange));
+        if (!grown) return -1;
+        roster->changes = grown;
+        roster->changes_capacity = capacity;
+    }
+
+    RosterChange *change = &roster->changes[roster->num_changes++];
+    change->joined = joined;
+    strncpy(change->pseudo, pseudo, MAX_PSEUDO_LEN - 1);
+    change->pseudo[MAX_PSEUDO_LEN - 1] = '\0';
+    return 0;
+}
+
+/**
+ * Adds a player with a fresh game state at the end of the array and logs
+ * the join.
+ * @param roster Roster to update
+ * @param client_id Client ID of the player
+ * @param pseudo Display name of the player
+ * @return New player, NULL if already present or on allocation failure
+ */
+SessionPlayer* roster_add(Roster *roster, int client_id, const char *pseudo) {
+    if (idindex_get(&roster->positions, client_id) >= 0) return NULL;
+
+    if (roster->count == roster->capacity) {
+        int capacity = roster->capacity ? roster->capacity * 2 : ROSTER_MIN_CAPACITY;
+        SessionPlayer *grown = realloc(roster->players, (size_t)capacity * sizeof(SessionPlayer));
+        if (!grown) return NULL;
+        roster->players = grown;
+        roster->capacity = capacity;
+    }
+
+    int position = roster->count;
+    if (idindex_put(&roster->positions, client_id, position) < 0) return NULL;
+    if (log_change(roster, true, pseudo) < 0) {
+        idindex_remove(&roster->positions, client_id);
+        return NULL;
+    }
+
+    SessionPlayer *player = &roster->players[position];
+    memset(player, 0, sizeof(SessionPlayer));
+    player->client_id = client_id;
+    strncpy(player->pseudo, pseudo, MAX_PSEUDO_LEN - 1);
+    player->current_answer = -1;
+    __atomic_store_n(&roster->count, position + 1, __ATOMIC_RELAXED);
+    return player;
+}
+
+/**
+ * Looks up a player by client ID.
+ * @param roster Roster to search
+ * @param client_id Client ID to find
+ * @return Player, NULL if absent
+ */
+SessionPlayer* roster_find(const Roster *roster, int client_id) {
+    int position = idindex_get(&roster->positions, client_id);
+    return position >= 0 ? &roster->players[position] : NULL;
+}
+
+/**
+ * Removes a player, moving the last player into its place, and logs the
+ * leave.
+ * @param roster Roster to update
+ * @param client_id Client ID of the player
+ * @return true if the player was present
+ */
+bool roster_remove(Roster *roster, int client_id) {
+    int position = idindex_get(&roster->positions, client_id);
+    if (position < 0) return false;
+
+    if (log_change(roster, false, roster->players[position].pseudo) < 0) {
+        log_warn("ROSTER", "Cannot log the leave of '%s', it will not be announced",
+                roster->players[position].pseudo);
+    }
+
+    idindex_remove(&roster->positions, client_id);
+    int last = roster->count - 1;
+    if (position != last) {
+        roster->players[position] = roster->players[last];
+        idindex_put(&roster->positions, roster->players[position].client_id, position);
+    }
+    __atomic_store_n(&roster->count, last, __ATOMIC_RELAXED);
+    return true;
+}
+
+/**
+ * Empties the change log once its joins and leaves are announced.
+ * @param roster Roster to update
+ */
+void roster_clear_changes(Roster *roster) {
+    roster->num_changes = 0;
+}
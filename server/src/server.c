@@ -4,9 +4,16 @@
 #include "session.h"
 #include "player.h"
 #include "question.h"
+#include "reactor.h"
+#include "outqueue.h"
+#include "binproto.h"
+#include "endpoints.h"
+#include "metrics.h"
+#include "rcu.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 
 #ifdef _WIN32
@@ -14,12 +21,16 @@
 #include <ws2tcpip.h>
 #pragma comment(lib, "ws2_32.lib")
 #else
+#include <errno.h>
+#include <poll.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #endif
 
+#define CLIENT_POLL_MS 100
+
 typedef struct {
     ServerState *state;
     Client *client;
@@ -27,30 +38,67 @@ typedef struct {
 
 /**
  * Initializes the server with TCP and UDP sockets.
- * Creates listening sockets, loads accounts and questions from data files.
+ * Creates listening sockets, sets up the client/session/account pools and
+ * loads accounts and questions from data files.
  * @param state Server state structure to initialize
  * @param tcp_port Port number for TCP game connections
  * @param udp_port Port number for UDP server discovery
+ * @param limits Capacity limits, NULL for the defaults
  * @return 0 on success, -1 on error
  */
-int init_server(ServerState *state, int tcp_port, int udp_port) {
+int init_server(ServerState *state, int tcp_port, int udp_port, const ServerLimits *limits) {
     log_msg("SERVER", "init_server() - initializing server on TCP:%d UDP:%d", tcp_port, udp_port);
     memset(state, 0, sizeof(ServerState));
     
+    if (limits) {
+        state->limits = *limits;
+    } else {
+        state->limits.max_clients = DEFAULT_MAX_CLIENTS;
+        state->limits.max_sessions = DEFAULT_MAX_SESSIONS;
+        state->limits.max_accounts = DEFAULT_MAX_ACCOUNTS;
+    }
+    
+    if (pool_init(&state->clients, sizeof(Client), 16, state->limits.max_clients) < 0 ||
+        pool_init(&state->sessions, sizeof(Session), 16, state->limits.max_sessions) < 0 ||
+        pool_init(&state->accounts, sizeof(PlayerAccount), 256, state->limits.max_accounts) < 0) {
+        log_error("SERVER", "ERROR - cannot allocate client/session/account pools");
+        return -1;
+    }
+    log_msg("SERVER", "Limits: %d clients, %d sessions, %d accounts",
+           state->limits.max_clients, state->limits.max_sessions, state->limits.max_accounts);
+    
     state->tcp_port = tcp_port;
     state->udp_port = udp_port;
     state->running = true;
     state->next_client_id = 1;
     state->next_session_id = 1;
+    state->max_backlog = DEFAULT_MAX_BACKLOG;
+    state->start_time = time(NULL);
     
     pthread_mutex_init(&state->clients_mutex, NULL);
     pthread_mutex_init(&state->sessions_mutex, NULL);
     pthread_mutex_init(&state->players_mutex, NULL);
+    pthread_mutex_init(&state->accounts_mutex, NULL);
+    timer_wheel_init(&state->timers, state);
+    if (workpool_init(&state->auth_pool, "AUTH", state, AUTH_QUEUE_CAPACITY) < 0) {
+        log_error("SERVER", "ERROR - cannot allocate the auth queue");
+        return -1;
+    }
+    state->num_auth_threads = DEFAULT_AUTH_THREADS;
+    actorpool_init(&state->session_pool, "SESSION", state);
+    state->num_session_threads = DEFAULT_SESSION_THREADS;
+    state->metrics_port = DEFAULT_METRICS_PORT;
+    trace_init(&state->trace);
+    if (endpoints_init() < 0) {
+        return -1;
+    }
+    rcuindex_init(&state->client_index, 64);
+    rcuindex_init(&state->session_index, 16);
     
 #ifdef _WIN32
     WSADATA wsa_data;
     if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
-        log_msg("SERVER", "ERROR - WSAStartup failed");
+        log_error("SERVER", "ERROR - WSAStartup failed");
         return -1;
     }
     log_msg("SERVER", "WSAStartup successful");
@@ -58,7 +106,7 @@ int init_server(ServerState *state, int tcp_port, int udp_port) {
     
     state->tcp_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (state->tcp_socket < 0) {
-        log_msg("SERVER", "ERROR - Failed to create TCP socket");
+        log_error("SERVER", "ERROR - Failed to create TCP socket");
         return -1;
     }
     log_msg("SERVER", "TCP socket created (fd=%d)", (int)state->tcp_socket);
@@ -77,14 +125,14 @@ int init_server(ServerState *state, int tcp_port, int udp_port) {
     tcp_addr.sin_port = htons(tcp_port);
     
     if (bind(state->tcp_socket, (struct sockaddr*)&tcp_addr, sizeof(tcp_addr)) < 0) {
-        log_msg("SERVER", "ERROR - Failed to bind TCP socket to port %d", tcp_port);
+        log_error("SERVER", "ERROR - Failed to bind TCP socket to port %d", tcp_port);
         return -1;
     }
 
     log_msg("SERVER", "TCP socket bound to port %d", tcp_port);
     
     if (listen(state->tcp_socket, 10) < 0) {
-        log_msg("SERVER", "ERROR - Failed to listen on TCP socket");
+        log_error("SERVER", "ERROR - Failed to listen on TCP socket");
         return -1;
     }
 
@@ -92,7 +140,7 @@ int init_server(ServerState *state, int tcp_port, int udp_port) {
     
     state->udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
     if (state->udp_socket < 0) {
-        log_msg("SERVER", "ERROR - Failed to create UDP socket");
+        log_error("SERVER", "ERROR - Failed to create UDP socket");
         return -1;
     }
 
@@ -111,7 +159,7 @@ int init_server(ServerState *state, int tcp_port, int udp_port) {
     udp_addr.sin_port = htons(udp_port);
     
     if (bind(state->udp_socket, (struct sockaddr*)&udp_addr, sizeof(udp_addr)) < 0) {
-        log_msg("SERVER", "ERROR - Failed to bind UDP socket to port %d", udp_port);
+        log_error("SERVER", "ERROR - Failed to bind UDP socket to port %d", udp_port);
         return -1;
     }
 
@@ -139,15 +187,20 @@ void cleanup_server(ServerState *state) {
     log_msg("SERVER", "cleanup_server() - shutting down server");
     state->running = false;
     
+    timer_wheel_stop(&state->timers);
+    actorpool_stop(&state->session_pool);
+    workpool_stop(&state->auth_pool);
+    
     pthread_mutex_lock(&state->clients_mutex);
-    log_msg("SERVER", "Closing %d client connections", state->num_clients);
-    for (int i = 0; i < state->num_clients; i++) {
-        if (state->clients[i].connected) {
-            log_msg("SERVER", "Closing client %d socket", state->clients[i].id);
+    log_msg("SERVER", "Closing %d client connections", __atomic_load_n(&state->num_clients, __ATOMIC_RELAXED));
+    for (int i = 0; i < state->clients.count; i++) {
+        Client *client = pool_get(&state->clients, i);
+        if (client->connected) {
+            log_msg("SERVER", "Closing client %d socket", client->id);
 #ifdef _WIN32
-            closesocket(state->clients[i].socket);
+            closesocket(client->socket);
 #else
-            close(state->clients[i].socket);
+            close(client->socket);
 #endif
         }
     }
@@ -177,6 +230,19 @@ void cleanup_server(ServerState *state) {
     pthread_mutex_destroy(&state->clients_mutex);
     pthread_mutex_destroy(&state->sessions_mutex);
     pthread_mutex_destroy(&state->players_mutex);
+    pthread_mutex_destroy(&state->accounts_mutex);
+    timer_wheel_destroy(&state->timers);
+    workpool_destroy(&state->auth_pool);
+    trace_destroy(&state->trace);
+    rcuindex_destroy(&state->client_index);
+    rcuindex_destroy(&state->session_index);
+    nameindex_destroy(&state->account_index);
+    
+    // Client and session pools, and the session actor workers, are left to
+    // process exit: detached client threads may still be unwinding through
+    // disconnect_client
+    pool_destroy(&state->accounts);
+    unload_questions(state);
     
     log_msg("SERVER", "Server cleaned up successfully");
 }
@@ -198,8 +264,11 @@ Client* accept_client(ServerState *state) {
     
     pthread_mutex_lock(&state->clients_mutex);
     
-    if (state->num_clients >= MAX_CLIENTS) {
+    int slot = pool_alloc(&state->clients);
+    if (slot < 0) {
         pthread_mutex_unlock(&state->clients_mutex);
+        log_warn("SERVER", "WARNING - client limit reached (%d), refusing connection",
+                state->limits.max_clients);
 #ifdef _WIN32
         closesocket(client_socket);
 #else
@@ -208,40 +277,68 @@ Client* accept_client(ServerState *state) {
         return NULL;
     }
     
-    Client *client = NULL;
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (!state->clients[i].connected) {
-            client = &state->clients[i];
-            break;
-        }
-    }
-    
-    if (!client) {
-        client = &state->clients[state->num_clients];
-    }
-    
-    memset(client, 0, sizeof(Client));
+    Client *client = pool_get(&state->clients, slot);
     client->id = state->next_client_id++;
+    client->slot = slot;
     client->socket = client_socket;
     client->connected = true;
     client->authenticated = false;
     client->current_session_id = -1;
+    client->reactor_id = -1;
+    client->out_limit = state->max_backlog;
+    memset(client->rate, 0, sizeof(client->rate));
+    client->rid = -1;
+    framer_init(&client->framer, MAX_MESSAGE_LEN);
+    pthread_mutex_init(&client->send_mutex, NULL);
     strncpy(client->ip, inet_ntoa(client_addr.sin_addr), 15);
     client->port = ntohs(client_addr.sin_port);
     
-    state->num_clients++;
+    // Published last: senders may look the client up from now on
+    if (rcuindex_put(&state->client_index, client->id, client) < 0) {
+        pthread_mutex_destroy(&client->send_mutex);
+        framer_destroy(&client->framer);
+        pool_free(&state->clients, slot);
+        pthread_mutex_unlock(&state->clients_mutex);
+        log_error("SERVER", "ERROR - cannot index client, refusing connection");
+#ifdef _WIN32
+        closesocket(client_socket);
+#else
+        close(client_socket);
+#endif
+        return NULL;
+    }
+    int num_clients = __atomic_add_fetch(&state->num_clients, 1, __ATOMIC_RELAXED);
+    metrics_count(METRIC_CONNECTIONS, 1);
     
     pthread_mutex_unlock(&state->clients_mutex);
     
     log_msg("SERVER", "Client connected: %s:%d (ID: %d, total clients: %d)", 
-           client->ip, client->port, client->id, state->num_clients);
+           client->ip, client->port, client->id, num_clients);
     
     return client;
 }
 
+/**
+ * Finds a connected client by ID through the client index, without a lock.
+ * Caller must be inside rcu_read_lock and may use the client (taking its
+ * send_mutex to write) until rcu_read_unlock.
+ * @param state Server state containing clients list
+ * @param client_id Client's unique ID
+ * @return Pointer to client, NULL if not connected
+ */
+Client* find_client(ServerState *state, int client_id) {
+    Client *client = rcuindex_get(&state->client_index, client_id);
+    if (!client || !client->connected) {
+        return NULL;
+    }
+    return client;
+}
+
 /**
  * Disconnects a client and cleans up their resources.
- * Removes client from any active session, closes socket.
+ * Removes client from the client index, waits out concurrent senders, tells
+ * its session it left, then drops unsent output and closes the socket.
+ * Must not be called inside an RCU read section.
  * @param state Server state
  * @param client Client to disconnect
  */
@@ -250,30 +347,164 @@ void disconnect_client(ServerState *state, Client *client) {
            client->ip, client->port, client->id, 
            client->authenticated ? client->pseudo : "<not authenticated>");
     
-    if (client->current_session_id > 0) {
-        log_msg("SERVER", "Client was in session %d, leaving...", client->current_session_id);
-        Session *session = find_session(state, client->current_session_id);
-        if (session) {
-            leave_session(state, session, client->id);
-        }
+    pthread_mutex_lock(&state->clients_mutex);
+    rcuindex_remove(&state->client_index, client->id);
+    pthread_mutex_unlock(&state->clients_mutex);
+    
+    // Senders that found the client before it was unpublished are done
+    // after the grace period; none can reach it afterwards. Sessions only
+    // add players they find in the index, so no join can land after the
+    // session id is read below
+    rcu_synchronize();
+    
+    int session_id = __atomic_load_n(&client->current_session_id, __ATOMIC_ACQUIRE);
+    if (session_id > 0) {
+        log_msg("SERVER", "Client was in session %d, leaving...", session_id);
+        SessionMsg msg = { .type = SESSION_MSG_LEAVE, .client_id = client->id, .rid = -1 };
+        session_post(state, session_id, &msg);
     }
     
+    pthread_mutex_lock(&client->send_mutex);
+    outqueue_clear_locked(client);
 #ifdef _WIN32
     closesocket(client->socket);
 #else
     close(client->socket);
 #endif
+    client->connected = false;
+    pthread_mutex_unlock(&client->send_mutex);
+    pthread_mutex_destroy(&client->send_mutex);
+    framer_destroy(&client->framer);
     
     pthread_mutex_lock(&state->clients_mutex);
-    client->connected = false;
-    state->num_clients--;
-    log_msg("SERVER", "Client disconnected (remaining clients: %d)", state->num_clients);
+    pool_free(&state->clients, client->slot);
+    int num_clients = __atomic_sub_fetch(&state->num_clients, 1, __ATOMIC_RELAXED);
     pthread_mutex_unlock(&state->clients_mutex);
+    log_msg("SERVER", "Client disconnected (remaining clients: %d)", num_clients);
+}
+
+/**
+ * Dispatches every complete binary-protocol frame buffered by the framer.
+ * @param state Server state
+ * @param client Client that negotiated the binary protocol
+ * @return 0 if the connection stays open, -1 if a frame exceeded MAX_MESSAGE_LEN
+ */
+static int client_process_frames(ServerState *state, Client *client) {
+    char *frame;
+    size_t available;
+    
+    while ((available = framer_available(&client->framer, &frame)) >= BINPROTO_HEADER_LEN) {
+        size_t payload_len = binproto_payload_length(frame);
+        if (payload_len > MAX_MESSAGE_LEN) {
+            log_warn("CLIENT", "Client %d: frame of %lu bytes exceeds %d, closing connection",
+                    client->id, (unsigned long)payload_len, MAX_MESSAGE_LEN);
+            send_error(client, "request", "413", "request too large");
+            return -1;
+        }
+        if (available < BINPROTO_HEADER_LEN + payload_len) break;
+        
+        framer_consume(&client->framer, BINPROTO_HEADER_LEN + payload_len);
+        handle_binary_request(state, client, binproto_message_id(frame),
+                              frame + BINPROTO_HEADER_LEN, payload_len);
+    }
+    return 0;
 }
 
 /**
- * Thread handler for processing client messages.
- * Implements the two-line protocol (METHOD path\n{json}).
+ * Dispatches every complete request buffered by the client's framer.
+ * Implements the two-line protocol (METHOD path\n{json}): a POST header is
+ * held until the next line; if that line is a JSON object it is the body,
+ * otherwise the POST is handled without one and the line stands on its own.
+ * Lines are passed to handle_request in place. Once the client switched to
+ * the binary protocol, the remaining input is read as frames instead.
+ * @param state Server state
+ * @param client Client whose framer just received bytes
+ * @return 0 if the connection stays open, -1 if a line exceeded MAX_MESSAGE_LEN
+ */
+static int client_process_requests(ServerState *state, Client *client) {
+    LineFramer *framer = &client->framer;
+    char *line;
+    size_t len;
+    int rc = 0;
+    
+    while (!client->binary && (rc = framer_next(framer, &line, &len)) > 0) {
+        if (len == 0) continue;
+        log_debug("CLIENT", "Client %d: Line: '%s'", client->id, line);
+        
+        char *header = framer_held(framer);
+        if (header) {
+            bool is_body = line[strspn(line, " \t")] == '{';
+            if (!is_body) {
+                log_debug("CLIENT", "Client %d: POST without JSON body", client->id);
+            }
+            handle_request(state, client, header, is_body ? line : NULL);
+            framer_release(framer);
+            if (is_body) continue;
+        }
+        
+        if (strncmp(line, "POST ", 5) == 0) {
+            log_debug("CLIENT", "Client %d: POST request detected, waiting for JSON body", client->id);
+            framer_hold(framer);
+        } else {
+            handle_request(state, client, line, NULL);
+        }
+    }
+    
+    // The rest of the input follows a protocol/binary switch
+    if (client->binary) {
+        return client_process_frames(state, client);
+    }
+    
+    if (rc < 0) {
+        log_warn("CLIENT", "Client %d: request line longer than %d bytes, closing connection",
+                client->id, MAX_MESSAGE_LEN);
+        send_error(client, "request", "413", "request too large");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Handles every request pipelined in the bytes just received as one batch:
+ * responses are queued as the handlers run and written together afterwards.
+ * Shared by both I/O models.
+ * @param state Server state
+ * @param client Client whose framer just received bytes
+ * @return 0 if the connection stays open, -1 if it must be closed
+ */
+int client_process_input(ServerState *state, Client *client) {
+    outqueue_cork(client);
+    int result = client_process_requests(state, client);
+    if (outqueue_uncork(client) < 0) return -1;
+    return result;
+}
+
+/**
+ * Receives available bytes straight into the client's framer.
+ * @param client Client to read from
+ * @param flags recv flags (MSG_DONTWAIT in epoll mode)
+ * @return recv result, or -1 if the framer cannot grow
+ */
+int client_receive(Client *client, int flags) {
+    size_t room;
+    char *buffer = framer_reserve(&client->framer, &room);
+    if (!buffer) {
+        log_error("CLIENT", "ERROR - cannot grow receive buffer of client %d", client->id);
+        return -1;
+    }
+    
+    int received = recv(client->socket, buffer, room > INT_MAX ? INT_MAX : (int)room, flags);
+    if (received > 0) {
+        framer_commit(&client->framer, (size_t)received);
+        metrics_count(METRIC_BYTES_RECEIVED, (uint64_t)received);
+    }
+    return received;
+}
+
+/**
+ * Thread handler for processing client messages (thread-per-client mode).
+ * Waits for input, feeds the framing buffer and, while output is queued,
+ * flushes it as soon as the socket becomes writable.
  * Runs until client disconnects or server stops.
  * @param arg Pointer to ClientHandlerArgs containing state and client
  * @return NULL when thread exits
@@ -284,72 +515,48 @@ void* client_handler(void *arg) {
     Client *client = args->client;
     free(args);
     
-    log_msg("CLIENT", "Handler started for client %d (%s:%d)", client->id, client->ip, client->port);
-    
-    char buffer[MAX_MESSAGE_LEN];
-    char message_buffer[MAX_MESSAGE_LEN * 2] = "";
-    int message_len = 0;
-    
-    char pending_request[MAX_MESSAGE_LEN] = "";
-    int expecting_json = 0;
+    log_debug("CLIENT", "Handler started for client %d (%s:%d)", client->id, client->ip, client->port);
     
     while (client->connected && state->running) {
-        int received = recv(client->socket, buffer, sizeof(buffer) - 1, 0);
+#ifndef _WIN32
+        struct pollfd pfd;
+        pfd.fd = client->socket;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (outqueue_pending(client)) {
+            pfd.events |= POLLOUT;
+        }
         
-        if (received <= 0) {
-            log_msg("CLIENT", "Client %d: recv() returned %d, closing connection", client->id, received);
-            break;
+        int ready = poll(&pfd, 1, CLIENT_POLL_MS);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready == 0) continue;
+        if (ready > 0 && (pfd.revents & POLLOUT)) {
+            outqueue_flush(client);
         }
+        if (ready > 0 && !(pfd.revents & (POLLIN | POLLHUP | POLLERR))) continue;
+#endif
         
-        buffer[received] = '\0';
-        log_msg("CLIENT", "Client %d: Received %d bytes", client->id, received);
+        int received = client_receive(client, 0);
         
-        // Append to message buffer
-        if (message_len + received < (int)sizeof(message_buffer) - 1) {
-            strcat(message_buffer, buffer);
-            message_len += received;
+        if (received <= 0) {
+            log_msg("CLIENT", "Client %d: recv() returned %d, closing connection", client->id, received);
+            break;
         }
         
-        char *newline;
-        while ((newline = strchr(message_buffer, '\n')) != NULL) {
-            *newline = '\0';
-            
-            if (strlen(message_buffer) > 0) {
-                log_msg("CLIENT", "Client %d: Line: '%s'", client->id, message_buffer);
-                
-                if (expecting_json) {
-                    char full_request[MAX_MESSAGE_LEN * 2];
-                    snprintf(full_request, sizeof(full_request), "%s\n%s", pending_request, message_buffer);
-                    handle_request(state, client, full_request);
-                    expecting_json = 0;
-                    pending_request[0] = '\0';
-                } else if (strncmp(message_buffer, "GET ", 4) == 0) {
-                    log_msg("CLIENT", "Client %d: GET request detected", client->id);
-                    handle_request(state, client, message_buffer);
-                } else if (strncmp(message_buffer, "POST ", 5) == 0) {
-                    log_msg("CLIENT", "Client %d: POST request detected, waiting for JSON body", client->id);
-                    strncpy(pending_request, message_buffer, MAX_MESSAGE_LEN - 1);
-                    expecting_json = 1;
-                } else {
-                    log_msg("CLIENT", "Client %d: Unknown format, processing as-is", client->id);
-                    handle_request(state, client, message_buffer);
-                }
-            }
-            
-            char *remaining = newline + 1;
-            memmove(message_buffer, remaining, strlen(remaining) + 1);
-            message_len = strlen(message_buffer);
-        }
+        log_debug("CLIENT", "Client %d: Received %d bytes", client->id, received);
+        if (client_process_input(state, client) < 0) break;
     }
     
-    log_msg("CLIENT", "Client %d: Handler ending", client->id);
+    log_debug("CLIENT", "Client %d: Handler ending", client->id);
     disconnect_client(state, client);
     return NULL;
 }
 
 /**
- * Main server loop that accepts connections and spawns client handlers.
- * Starts UDP discovery thread, then loops accepting TCP connections.
+ * Main server loop that accepts connections and hands them to the I/O model.
+ * Starts UDP discovery thread, the session timer wheel, the metrics
+ * listener (and reactor threads in epoll mode), then loops accepting TCP
+ * connections.
  * @param state Server state
  */
 void run_server(ServerState *state) {
@@ -359,12 +566,38 @@ void run_server(ServerState *state) {
     pthread_create(&udp_thread, NULL, udp_discovery_handler, state);
     state->udp_thread = udp_thread;
     
-    log_msg("SERVER", "Waiting for connections on port %d...", state->tcp_port);
+    if (timer_wheel_start(&state->timers) < 0) {
+        log_error("SERVER", "ERROR - cannot start timer wheel, sessions will not advance");
+    }
+    
+    if (workpool_start(&state->auth_pool, state->num_auth_threads) < 0) {
+        log_error("SERVER", "ERROR - cannot start auth workers, logins will be refused");
+    }
+    
+    if (actorpool_start(&state->session_pool, state->num_session_threads) < 0) {
+        log_error("SERVER", "ERROR - cannot start session workers, games will not run");
+    }
+    
+    if (state->metrics_port > 0 && metrics_start(state, state->metrics_port) < 0) {
+        log_warn("SERVER", "WARNING - cannot serve metrics on port %d", state->metrics_port);
+    }
+    
+    if (state->io_mode == IO_MODE_EPOLL && reactor_start(state, state->num_io_threads) < 0) {
+        log_warn("SERVER", "WARNING - epoll reactor unavailable, falling back to thread-per-client");
+        state->io_mode = IO_MODE_THREADS;
+    }
+    
+    log_msg("SERVER", "Waiting for connections on port %d (%s mode)...", state->tcp_port,
+           state->io_mode == IO_MODE_EPOLL ? "epoll" : "threads");
     
     while (state->running) {
         Client *client = accept_client(state);
-        if (client) {
-            log_msg("SERVER", "Spawning handler thread for client %d", client->id);
+        if (client && state->io_mode == IO_MODE_EPOLL) {
+            if (reactor_add_client(state, client) < 0) {
+                disconnect_client(state, client);
+            }
+        } else if (client) {
+            log_debug("SERVER", "Spawning handler thread for client %d", client->id);
             ClientHandlerArgs *args = malloc(sizeof(ClientHandlerArgs));
             args->state = state;
             args->client = client;
@@ -375,6 +608,14 @@ void run_server(ServerState *state) {
         }
     }
     
+    if (state->io_mode == IO_MODE_EPOLL) {
+        reactor_stop(state);
+    }
+    
+    timer_wheel_stop(&state->timers);
+    actorpool_stop(&state->session_pool);
+    metrics_stop();
+    
     log_msg("SERVER", "run_server() - main loop ended, canceling UDP thread");
     pthread_cancel(udp_thread);
     pthread_join(udp_thread, NULL);
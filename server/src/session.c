@@ -1,941 +1,1659 @@
-#include "session.h"
-#include "question.h"
-#include "protocol.h"
-#include "utils.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <time.h>
-
-#ifdef _WIN32
-#include <windows.h>
-#else
-#include <unistd.h>
-#endif
-
-/**
- * Creates a new game session with specified parameters.
- * Initializes session structure, selects matching questions, and registers in server state.
- * @param state Server state containing sessions array and questions
- * @param name Display name for the session
- * @param theme_ids Array of theme IDs to filter questions
- * @param num_themes Number of themes in the array
- * @param difficulty Difficulty level for question filtering
- * @param num_questions Number of questions for the game
- * @param time_limit Time allowed per question in seconds
- * @param mode Game mode (solo or battle)
- * @param max_players Maximum number of players allowed
- * @param creator_client_id Client ID of the session creator
- * @return Pointer to created session, or NULL on failure
- */
-Session* create_session(ServerState *state, const char *name, int *theme_ids, int num_themes,
-                        Difficulty difficulty, int num_questions, int time_limit,
-                        GameMode mode, int initial_lives, int max_players, int creator_client_id) {
-    log_msg("SESSION", "create_session() - name='%s', themes=%d, difficulty=%d, questions=%d",
-           name, num_themes, difficulty, num_questions);
-    pthread_mutex_lock(&state->sessions_mutex);
-    
-    if (state->num_sessions >= MAX_SESSIONS) {
-        log_msg("SESSION", "create_session() FAILED - max sessions reached (%d)", MAX_SESSIONS);
-        pthread_mutex_unlock(&state->sessions_mutex);
-        return NULL;
-    }
-    
-    Session *session = NULL;
-    
-    for (int i = 0; i < MAX_SESSIONS; i++) {
-        if (state->sessions[i].status == SESSION_FINISHED || state->sessions[i].id == 0) {
-            session = &state->sessions[i];
-            log_msg("SESSION", "Found empty slot at index %d", i);
-            break;
-        }
-    }
-    
-    if (!session) {
-        log_msg("SESSION", "create_session() FAILED - no empty slot found");
-        pthread_mutex_unlock(&state->sessions_mutex);
-        return NULL;
-    }
-    
-    memset(session, 0, sizeof(Session));
-    pthread_mutex_init(&session->mutex, NULL);
-    
-    session->id = state->next_session_id++;
-    strncpy(session->name, name, 63);
-    
-    session->num_themes = num_themes;
-    for (int i = 0; i < num_themes; i++) {
-        session->theme_ids[i] = theme_ids[i];
-    }
-    
-    session->difficulty = difficulty;
-    session->num_questions = num_questions;
-    session->time_limit = time_limit;
-    session->mode = mode;
-    session->initial_lives = (mode == MODE_BATTLE) ? initial_lives : 0;
-    session->max_players = max_players;
-    session->status = SESSION_WAITING;
-    session->creator_client_id = creator_client_id;
-    session->current_question = -1;
-    
-    log_msg("SESSION", "Session initialized: id=%d, selecting questions...", session->id);
-    
-    if (select_questions_for_session(state, session) < 0) {
-        log_msg("SESSION", "create_session() FAILED - not enough matching questions");
-        memset(session, 0, sizeof(Session));
-        pthread_mutex_unlock(&state->sessions_mutex);
-        return NULL;
-    }
-    
-    state->num_sessions++;
-    log_msg("SESSION", "Session created successfully: id=%d (total sessions: %d)", 
-           session->id, state->num_sessions);
-    
-    pthread_mutex_unlock(&state->sessions_mutex);
-    
-    return session;
-}
-
-/**
- * Finds a session by its unique ID.
- * Searches through all session slots in server state.
- * @param state Server state containing sessions array
- * @param session_id Unique session ID to find
- * @return Pointer to session if found, NULL otherwise
- */
-Session* find_session(ServerState *state, int session_id) {
-    for (int i = 0; i < MAX_SESSIONS; i++) {
-        if (state->sessions[i].id == session_id) {
-            return &state->sessions[i];
-        }
-    }
-    log_msg("SESSION", "find_session() - session %d not found", session_id);
-    return NULL;
-}
-
-/**
- * Adds a player to an existing session.
- * Validates session is waiting and has room, notifies other players.
- * @param state Server state for sending notifications
- * @param session Target session to join
- * @param client_id Client ID of the joining player
- * @param pseudo Display name of the joining player
- * @return 0 on success, -1 not waiting, -2 full, -3 already in session
- */
-int join_session(ServerState *state, Session *session, int client_id, const char *pseudo) {
-    log_msg("SESSION", "join_session() - client %d ('%s') joining session %d",
-           client_id, pseudo, session->id);
-    pthread_mutex_lock(&session->mutex);
-    
-    if (session->status != SESSION_WAITING) {
-        log_msg("SESSION", "join_session() FAILED - session not waiting (status=%d)", session->status);
-        pthread_mutex_unlock(&session->mutex);
-        return -1;
-    }
-    
-    if (session->num_players >= session->max_players) {
-        log_msg("SESSION", "join_session() FAILED - session full (%d/%d)", 
-               session->num_players, session->max_players);
-        pthread_mutex_unlock(&session->mutex);
-        return -2;
-    }
-    
-    // Check if already in session
-    for (int i = 0; i < session->num_players; i++) {
-        if (session->players[i].client_id == client_id) {
-            log_msg("SESSION", "join_session() FAILED - already in session");
-            pthread_mutex_unlock(&session->mutex);
-            return -3;
-        }
-    }
-    
-    SessionPlayer *player = &session->players[session->num_players];
-    player->client_id = client_id;
-    strncpy(player->pseudo, pseudo, MAX_PSEUDO_LEN - 1);
-    player->score = 0;
-    player->lives = session->initial_lives;
-    player->correct_answers = 0;
-    player->has_answered = false;
-    player->current_answer = -1;
-    player->response_time = 0;
-    player->eliminated = false;
-    player->eliminated_at = 0;
-    player->joker_fifty_used = false;
-    player->joker_skip_used = false;
-    player->used_skip_this_question = false;
-    
-    session->num_players++;
-    log_msg("SESSION", "Player '%s' added (now %d/%d players)", 
-           pseudo, session->num_players, session->max_players);
-    
-    log_msg("SESSION", "Notifying %d other player(s)", session->num_players - 1);
-    for (int i = 0; i < session->num_players - 1; i++) {
-        int other_client_id = session->players[i].client_id;
-        
-        cJSON *notify = cJSON_CreateObject();
-        cJSON_AddStringToObject(notify, "action", "session/player/joined");
-        cJSON_AddStringToObject(notify, "pseudo", pseudo);
-        cJSON_AddNumberToObject(notify, "nbPlayers", session->num_players);
-        
-        char *msg = cJSON_PrintUnformatted(notify);
-        send_to_client(state, other_client_id, msg);
-        free(msg);
-        cJSON_Delete(notify);
-    }
-    
-    pthread_mutex_unlock(&session->mutex);
-    return 0;
-}
-
-/**
- * Removes a player from a session.
- * Shifts remaining players, reassigns creator if needed, notifies others.
- * @param state Server state for sending notifications
- * @param session Session to leave
- * @param client_id Client ID of the leaving player
- * @return 0 on success, -1 if player not in session
- */
-int leave_session(ServerState *state, Session *session, int client_id) {
-    log_msg("SESSION", "leave_session() - client %d leaving session %d", client_id, session->id);
-    pthread_mutex_lock(&session->mutex);
-    
-    int player_index = -1;
-    char leaving_pseudo[MAX_PSEUDO_LEN] = "";
-    
-    for (int i = 0; i < session->num_players; i++) {
-        if (session->players[i].client_id == client_id) {
-            player_index = i;
-            strncpy(leaving_pseudo, session->players[i].pseudo, MAX_PSEUDO_LEN - 1);
-            break;
-        }
-    }
-    
-    if (player_index < 0) {
-        log_msg("SESSION", "leave_session() FAILED - client not in session");
-        pthread_mutex_unlock(&session->mutex);
-        return -1;
-    }
-    
-    log_msg("SESSION", "Removing player '%s' at index %d", leaving_pseudo, player_index);
-    
-    for (int i = player_index; i < session->num_players - 1; i++) {
-        session->players[i] = session->players[i + 1];
-    }
-    session->num_players--;
-    
-    if (client_id == session->creator_client_id && session->num_players > 0) {
-        session->creator_client_id = session->players[0].client_id;
-        log_msg("SESSION", "New creator: client %d ('%s')", 
-               session->creator_client_id, session->players[0].pseudo);
-    }
-    
-    log_msg("SESSION", "Notifying %d remaining player(s)", session->num_players);
-    for (int i = 0; i < session->num_players; i++) {
-        int other_client_id = session->players[i].client_id;
-        
-        cJSON *notify = cJSON_CreateObject();
-        cJSON_AddStringToObject(notify, "action", "session/player/left");
-        cJSON_AddStringToObject(notify, "pseudo", leaving_pseudo);
-        cJSON_AddStringToObject(notify, "reason", "disconnected");
-        
-        char *msg = cJSON_PrintUnformatted(notify);
-        send_to_client(state, other_client_id, msg);
-        free(msg);
-        cJSON_Delete(notify);
-    }
-    
-    if (session->num_players == 0) {
-        log_msg("SESSION", "No players left, ending session");
-        session->status = SESSION_FINISHED;
-        pthread_mutex_unlock(&session->mutex);
-    } else if (session->num_players == 1 && session->status == SESSION_PLAYING) {
-        log_msg("SESSION", "Only 1 player left during game, ending session with results");
-        pthread_mutex_unlock(&session->mutex);
-        end_session(state, session);
-    } else {
-        pthread_mutex_unlock(&session->mutex);
-    }
-    return 0;
-}
-
-/**
- * Starts a game session after countdown.
- * Validates minimum players, sends start notification, then first question.
- * @param state Server state for sending messages
- * @param session Session to start
- * @return 0 on success, -1 if not enough players
- */
-int start_session(ServerState *state, Session *session) {
-    log_msg("SESSION", "start_session() - session %d starting with %d players", 
-           session->id, session->num_players);
-    pthread_mutex_lock(&session->mutex);
-    
-    if (session->num_players < 2) {
-        log_msg("SESSION", "start_session() FAILED - not enough players");
-        pthread_mutex_unlock(&session->mutex);
-        return -1;
-    }
-    
-    session->status = SESSION_PLAYING;
-    session->current_question = 0;
-    log_msg("SESSION", "Session status set to PLAYING, starting with question 0");
-    
-    log_msg("SESSION", "Sending start notification to %d players", session->num_players);
-    for (int i = 0; i < session->num_players; i++) {
-        cJSON *notify = cJSON_CreateObject();
-        cJSON_AddStringToObject(notify, "action", "session/started");
-        cJSON_AddStringToObject(notify, "message", "session is starting");
-        cJSON_AddNumberToObject(notify, "countdown", 3);
-        
-        char *msg = cJSON_PrintUnformatted(notify);
-        send_to_client(state, session->players[i].client_id, msg);
-        free(msg);
-        cJSON_Delete(notify);
-    }
-    
-    pthread_mutex_unlock(&session->mutex);
-    
-    log_msg("SESSION", "Waiting 3 seconds countdown...");
-    #ifdef _WIN32
-    Sleep(3000);
-    #else
-    sleep(3);
-    #endif
-    
-    // Send first question
-    log_msg("SESSION", "Sending first question");
-    send_question_to_all(state, session);
-    
-    return 0;
-}
-
-/**
- * Finds a player in a session by client ID.
- * Searches through session's player list.
- * @param session Session to search in
- * @param client_id Client ID to find
- * @return Pointer to SessionPlayer if found, NULL otherwise
- */
-SessionPlayer* find_session_player(Session *session, int client_id) {
-    for (int i = 0; i < session->num_players; i++) {
-        if (session->players[i].client_id == client_id) {
-            return &session->players[i];
-        }
-    }
-    log_msg("SESSION", "find_session_player() - client %d not found", client_id);
-    return NULL;
-}
-
-/**
- * Finds a player in a session by their pseudo/username.
- * Case-sensitive string comparison.
- * @param session Session to search in
- * @param pseudo Player's display name to find
- * @return Pointer to SessionPlayer if found, NULL otherwise
- */
-SessionPlayer* find_session_player_by_pseudo(Session *session, const char *pseudo) {
-    for (int i = 0; i < session->num_players; i++) {
-        if (strcmp(session->players[i].pseudo, pseudo) == 0) {
-            return &session->players[i];
-        }
-    }
-    return NULL;
-}
-
-/**
- * Gets the current question being asked in a session.
- * Uses session's question_ids array and current_question index.
- * @param state Server state containing all questions
- * @param session Session with current question index
- * @return Pointer to current Question, NULL if out of range
- */
-Question* get_current_question(ServerState *state, Session *session) {
-    if (session->current_question < 0 || session->current_question >= session->num_questions) {
-        return NULL;
-    }
-    
-    int question_id = session->question_ids[session->current_question];
-    
-    for (int i = 0; i < state->num_questions; i++) {
-        if (state->questions[i].id == question_id) {
-            return &state->questions[i];
-        }
-    }
-    return NULL;
-}
-
-/**
- * Sends the current question to all active players.
- * Resets player answer states, formats question as JSON.
- * @param state Server state for sending messages
- * @param session Session with current question
- */
-void send_question_to_all(ServerState *state, Session *session) {
-    pthread_mutex_lock(&session->mutex);
-    
-    // Check if session is still playing
-    if (session->status != SESSION_PLAYING) {
-        log_msg("SESSION", "send_question_to_all() SKIPPED - session not playing (status=%d)", session->status);
-        pthread_mutex_unlock(&session->mutex);
-        return;
-    }
-    
-    Question *q = get_current_question(state, session);
-    if (!q) {
-        log_msg("SESSION", "send_question_to_all() FAILED - no current question");
-        pthread_mutex_unlock(&session->mutex);
-        return;
-    }
-    
-    log_msg("SESSION", "Sending question %d/%d: '%s'", 
-           session->current_question + 1, session->num_questions, q->question);
-    
-    for (int i = 0; i < session->num_players; i++) {
-        session->players[i].has_answered = false;
-        session->players[i].was_correct = false;
-        session->players[i].current_answer = -1;
-        session->players[i].response_time = 0;
-        session->players[i].used_skip_this_question = false;
-    }
-    
-    session->question_start_time = time(NULL);
-    
-    int active_players = 0;
-    for (int i = 0; i < session->num_players; i++) {
-        if (session->players[i].eliminated) {
-            log_msg("SESSION", "  Skipping eliminated player '%s'", session->players[i].pseudo);
-            continue;
-        }
-        active_players++;
-        
-        cJSON *msg = cJSON_CreateObject();
-        cJSON_AddStringToObject(msg, "action", "question/new");
-        cJSON_AddNumberToObject(msg, "questionNum", session->current_question + 1);
-        cJSON_AddNumberToObject(msg, "totalQuestions", session->num_questions);
-        cJSON_AddStringToObject(msg, "type", question_type_to_string(q->type));
-        cJSON_AddStringToObject(msg, "difficulty", difficulty_to_string(q->difficulty));
-        cJSON_AddStringToObject(msg, "question", q->question);
-        cJSON_AddNumberToObject(msg, "timeLimit", session->time_limit);
-        
-        if (q->type == QUESTION_QCM) {
-            cJSON *answers = cJSON_AddArrayToObject(msg, "answers");
-            for (int j = 0; j < 4; j++) {
-                cJSON_AddItemToArray(answers, cJSON_CreateString(q->answers[j]));
-            }
-        }
-        
-        char *json = cJSON_PrintUnformatted(msg);
-        send_to_client(state, session->players[i].client_id, json);
-        free(json);
-        cJSON_Delete(msg);
-    }
-    
-    log_msg("SESSION", "Question sent to %d active player(s)", active_players);
-    pthread_mutex_unlock(&session->mutex);
-}
-
-/**
- * Processes a player's answer to the current question.
- * Validates timing, checks correctness, awards points, triggers results when all answered.
- * @param state Server state for sending results
- * @param session Current game session
- * @param client_id Client who submitted the answer
- * @param answer_index QCM answer index (0-3)
- * @param text_answer Text answer for TEXT type questions
- * @param bool_answer Boolean answer for BOOLEAN type questions
- * @param response_time Time taken to answer in seconds
- */
-void process_answer(ServerState *state, Session *session, int client_id,
-                   int answer_index, const char *text_answer, bool bool_answer, double response_time) {
-    log_msg("SESSION", "process_answer() - client %d, answer=%d, time=%.2f", 
-           client_id, answer_index, response_time);
-    pthread_mutex_lock(&session->mutex);
-    
-    SessionPlayer *player = find_session_player(session, client_id);
-    if (!player || player->has_answered || player->eliminated) {
-        pthread_mutex_unlock(&session->mutex);
-        return;
-    }
-    
-    time_t current_time = time(NULL);
-    double server_elapsed = difftime(current_time, session->question_start_time);
-    
-    if (server_elapsed > session->time_limit + 1) {
-        response_time = session->time_limit + 1;
-    }
-    
-    player->has_answered = true;
-    player->current_answer = answer_index;
-    player->response_time = response_time;
-    
-    Question *q = get_current_question(state, session);
-    bool correct = false;
-    
-    if (q) {
-        if (q->type == QUESTION_TEXT) {
-            correct = check_answer(q, 0, text_answer, false);
-        } else if (q->type == QUESTION_BOOLEAN) {
-            correct = check_answer(q, 0, NULL, bool_answer);
-            player->current_answer = bool_answer ? 1 : 0;
-        } else {
-            correct = check_answer(q, answer_index, NULL, false);
-        }
-        
-        if (correct) {
-            int points = calculate_points(q->difficulty, response_time, session->time_limit);
-            player->score += points;
-            player->correct_answers++;
-        }
-        player->was_correct = correct;
-    }
-    
-    bool all_answered = true;
-    for (int i = 0; i < session->num_players; i++) {
-        if (!session->players[i].eliminated && !session->players[i].has_answered) {
-            all_answered = false;
-            break;
-        }
-    }
-    
-    pthread_mutex_unlock(&session->mutex);
-    
-    if (all_answered) {
-        send_question_results(state, session);
-    }
-}
-
-/**
- * Sends question results to all players after everyone answered.
- * Applies Battle mode penalties, builds results JSON, checks for game end.
- * @param state Server state for sending messages
- * @param session Current game session
- */
-void send_question_results(ServerState *state, Session *session) {
-    pthread_mutex_lock(&session->mutex);
-    
-    Question *q = get_current_question(state, session);
-    if (!q) {
-        pthread_mutex_unlock(&session->mutex);
-        return;
-    }
-    
-    double max_response_time = 0;
-    int last_player_index = -1;
-    
-    if (session->mode == MODE_BATTLE) {
-        for (int i = 0; i < session->num_players; i++) {
-            SessionPlayer *p = &session->players[i];
-            if (p->eliminated || p->used_skip_this_question) continue;
-            
-            bool correct = false;
-            if (q->type == QUESTION_QCM) {
-                correct = (p->current_answer == q->correct_answer);
-            } else if (q->type == QUESTION_BOOLEAN) {
-                correct = (p->current_answer == q->correct_answer);
-            } else {
-                correct = p->has_answered;
-            }
-            
-            if (!correct && p->has_answered) {
-                p->lives--;
-                if (p->lives <= 0) {
-                    p->eliminated = true;
-                    p->eliminated_at = session->current_question + 1;
-                }
-            }
-            
-            if (p->has_answered && p->response_time > max_response_time) {
-                max_response_time = p->response_time;
-                last_player_index = i;
-            }
-        }
-        
-        if (last_player_index >= 0) {
-            SessionPlayer *last = &session->players[last_player_index];
-            if (!last->eliminated) {
-                bool was_correct = false;
-                if (q->type == QUESTION_QCM || q->type == QUESTION_BOOLEAN) {
-                    was_correct = (last->current_answer == q->correct_answer);
-                }
-                if (was_correct) { 
-                    last->lives--;
-                    if (last->lives <= 0) {
-                        last->eliminated = true;
-                        last->eliminated_at = session->current_question + 1;
-                    }
-                }
-            }
-        }
-    }
-    
-    cJSON *results = cJSON_CreateObject();
-    cJSON_AddStringToObject(results, "action", "question/results");
-    
-    if (q->type == QUESTION_QCM || q->type == QUESTION_BOOLEAN) {
-        cJSON_AddNumberToObject(results, "correctAnswer", q->correct_answer);
-    } else {
-        cJSON_AddStringToObject(results, "correctAnswer", q->text_answers[0]);
-    }
-    
-    if (strlen(q->explanation) > 0) {
-        cJSON_AddStringToObject(results, "explanation", q->explanation);
-    }
-    
-    if (session->mode == MODE_BATTLE && last_player_index >= 0) {
-        cJSON_AddStringToObject(results, "lastPlayer", session->players[last_player_index].pseudo);
-    }
-    
-    cJSON *results_array = cJSON_AddArrayToObject(results, "results");
-    
-    for (int i = 0; i < session->num_players; i++) {
-        SessionPlayer *p = &session->players[i];
-        
-        cJSON *player_result = cJSON_CreateObject();
-        cJSON_AddStringToObject(player_result, "pseudo", p->pseudo);
-        cJSON_AddNumberToObject(player_result, "answer", p->has_answered ? p->current_answer : -1);
-        
-        cJSON_AddBoolToObject(player_result, "correct", p->was_correct);
-        
-        int points = 0;
-        if (p->was_correct) {
-            points = calculate_points(q->difficulty, p->response_time, session->time_limit);
-        }
-        cJSON_AddNumberToObject(player_result, "points", points);
-        cJSON_AddNumberToObject(player_result, "totalScore", p->score);
-        
-        if (session->mode == MODE_BATTLE) {
-            cJSON_AddNumberToObject(player_result, "responseTime", p->response_time);
-            cJSON_AddNumberToObject(player_result, "lives", p->lives);
-        }
-        
-        cJSON_AddItemToArray(results_array, player_result);
-    }
-    
-    char *json = cJSON_PrintUnformatted(results);
-    
-    for (int i = 0; i < session->num_players; i++) {
-        send_to_client(state, session->players[i].client_id, json);
-    }
-    
-    free(json);
-    cJSON_Delete(results);
-    
-    if (session->mode == MODE_BATTLE) {
-        for (int i = 0; i < session->num_players; i++) {
-            if (session->players[i].eliminated && session->players[i].eliminated_at == session->current_question + 1) {
-                cJSON *elim = cJSON_CreateObject();
-                cJSON_AddStringToObject(elim, "action", "session/player/eliminated");
-                cJSON_AddStringToObject(elim, "pseudo", session->players[i].pseudo);
-                
-                char *elim_json = cJSON_PrintUnformatted(elim);
-                for (int j = 0; j < session->num_players; j++) {
-                    send_to_client(state, session->players[j].client_id, elim_json);
-                }
-                free(elim_json);
-                cJSON_Delete(elim);
-            }
-        }
-    }
-    
-    pthread_mutex_unlock(&session->mutex);
-    
-    int active_players = 0;
-    for (int i = 0; i < session->num_players; i++) {
-        if (!session->players[i].eliminated) active_players++;
-    }
-    
-    if (session->mode == MODE_BATTLE && active_players <= 1) {
-        end_session(state, session);
-    } else if (session->current_question + 1 >= session->num_questions) {
-        end_session(state, session);
-    } else {
-        #ifdef _WIN32
-        Sleep(5000);
-        #else
-        sleep(5);
-        #endif
-        
-        pthread_mutex_lock(&session->mutex);
-        SessionStatus status = session->status;
-        pthread_mutex_unlock(&session->mutex);
-        
-        if (status == SESSION_PLAYING) {
-            advance_to_next_question(state, session);
-        } else {
-            log_msg("SESSION", "Session no longer playing, not advancing to next question");
-        }
-    }
-}
-
-/**
- * Advances session to the next question.
- * Increments current_question index and sends new question to all.
- * @param state Server state for sending messages
- * @param session Session to advance
- */
-void advance_to_next_question(ServerState *state, Session *session) {
-    pthread_mutex_lock(&session->mutex);
-    session->current_question++;
-    pthread_mutex_unlock(&session->mutex);
-    
-    send_question_to_all(state, session);
-}
-
-/**
- * Ends a game session and sends final results.
- * Sorts players for ranking, sends session/finished message to all.
- * @param state Server state for sending messages and updating clients
- * @param session Session to end
- */
-void end_session(ServerState *state, Session *session) {
-    pthread_mutex_lock(&session->mutex);
-    
-    session->status = SESSION_FINISHED;
-    
-    cJSON *final = cJSON_CreateObject();
-    cJSON_AddStringToObject(final, "action", "session/finished");
-    cJSON_AddStringToObject(final, "mode", mode_to_string(session->mode));
-    
-    SessionPlayer sorted_players[MAX_PLAYERS_PER_SESSION];
-    memcpy(sorted_players, session->players, sizeof(SessionPlayer) * session->num_players);
-    
-    for (int i = 0; i < session->num_players - 1; i++) {
-        for (int j = 0; j < session->num_players - i - 1; j++) {
-            bool swap = false;
-            
-            if (session->mode == MODE_BATTLE) {
-                if (sorted_players[j].lives < sorted_players[j+1].lives) {
-                    swap = true;
-                } else if (sorted_players[j].lives == sorted_players[j+1].lives) {
-                    if (sorted_players[j].eliminated_at < sorted_players[j+1].eliminated_at) {
-                        swap = true;
-                    } else if (sorted_players[j].eliminated_at == sorted_players[j+1].eliminated_at) {
-                        if (sorted_players[j].score < sorted_players[j+1].score) {
-                            swap = true;
-                        }
-                    }
-                }
-            } else {
-                if (sorted_players[j].score < sorted_players[j+1].score) {
-                    swap = true;
-                }
-            }
-            
-            if (swap) {
-                SessionPlayer temp = sorted_players[j];
-                sorted_players[j] = sorted_players[j+1];
-                sorted_players[j+1] = temp;
-            }
-        }
-    }
-    
-    if (session->mode == MODE_BATTLE) {
-        cJSON_AddStringToObject(final, "winner", sorted_players[0].pseudo);
-    }
-    
-    cJSON *ranking = cJSON_AddArrayToObject(final, "ranking");
-    
-    for (int i = 0; i < session->num_players; i++) {
-        SessionPlayer *p = &sorted_players[i];
-        
-        cJSON *player_rank = cJSON_CreateObject();
-        cJSON_AddNumberToObject(player_rank, "rank", i + 1);
-        cJSON_AddStringToObject(player_rank, "pseudo", p->pseudo);
-        cJSON_AddNumberToObject(player_rank, "score", p->score);
-        cJSON_AddNumberToObject(player_rank, "correctAnswers", p->correct_answers);
-        
-        if (session->mode == MODE_BATTLE) {
-            cJSON_AddNumberToObject(player_rank, "lives", p->lives);
-            if (p->eliminated) {
-                cJSON_AddNumberToObject(player_rank, "eliminatedAt", p->eliminated_at);
-            }
-        }
-        
-        cJSON_AddItemToArray(ranking, player_rank);
-    }
-    
-    char *json = cJSON_PrintUnformatted(final);
-    
-    for (int i = 0; i < session->num_players; i++) {
-        send_to_client(state, session->players[i].client_id, json);
-        
-        // Update client session state
-        Client *client = NULL;
-        for (int c = 0; c < state->num_clients; c++) {
-            if (state->clients[c].id == session->players[i].client_id) {
-                client = &state->clients[c];
-                break;
-            }
-        }
-        if (client) {
-            client->current_session_id = -1;
-        }
-    }
-    
-    free(json);
-    cJSON_Delete(final);
-    
-    pthread_mutex_unlock(&session->mutex);
-}
-
-/**
- * Uses the 50/50 joker to eliminate two wrong answers.
- * Only works for QCM questions, can only be used once per session.
- * @param state Server state for getting current question
- * @param session Current game session
- * @param client_id Client using the joker
- * @param removed_answers Output array to store the two removed answer indices
- * @return 0 on success, -1 already used or answered, -2 not QCM question
- */
-int use_joker_fifty(ServerState *state, Session *session, int client_id, int *removed_answers) {
-    pthread_mutex_lock(&session->mutex);
-    
-    SessionPlayer *player = find_session_player(session, client_id);
-    if (!player || player->joker_fifty_used || player->has_answered) {
-        pthread_mutex_unlock(&session->mutex);
-        return -1;
-    }
-    
-    Question *q = get_current_question(state, session);
-    if (!q || q->type != QUESTION_QCM) {
-        pthread_mutex_unlock(&session->mutex);
-        return -2;
-    }
-    
-    player->joker_fifty_used = true;
-    
-    int wrong_answers[3];
-    int num_wrong = 0;
-    
-    for (int i = 0; i < 4; i++) {
-        if (i != q->correct_answer) {
-            wrong_answers[num_wrong++] = i;
-        }
-    }
-    
-    shuffle_array(wrong_answers, num_wrong);
-    removed_answers[0] = wrong_answers[0];
-    removed_answers[1] = wrong_answers[1];
-    
-    pthread_mutex_unlock(&session->mutex);
-    return 0;
-}
-
-/**
- * Uses the skip joker to skip the current question.
- * Player is marked as answered with neutral result, can only be used once.
- * @param state Server state (unused but kept for consistency)
- * @param session Current game session
- * @param client_id Client using the joker
- * @return 0 on success, -1 already used or answered
- */
-int use_joker_skip(ServerState *state, Session *session, int client_id) {
-    pthread_mutex_lock(&session->mutex);
-    
-    SessionPlayer *player = find_session_player(session, client_id);
-    if (!player || player->joker_skip_used || player->has_answered) {
-        pthread_mutex_unlock(&session->mutex);
-        return -1;
-    }
-    
-    player->joker_skip_used = true;
-    player->has_answered = true;
-    player->used_skip_this_question = true;
-    player->current_answer = -2; // Special value for skipped
-    
-    pthread_mutex_unlock(&session->mutex);
-    return 0;
-}
-
-/**
- * Creates JSON response with list of all waiting sessions.
- * Used for sessions/list endpoint to show available games.
- * @param state Server state containing all sessions
- * @return cJSON object with action, status, nbSessions, and sessions array
- */
-cJSON* create_sessions_list_json(ServerState *state) {
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "action", "sessions/list");
-    cJSON_AddStringToObject(response, "statut", "200");
-    cJSON_AddStringToObject(response, "message", "ok");
-    
-    int count = 0;
-    for (int i = 0; i < MAX_SESSIONS; i++) {
-        if (state->sessions[i].status == SESSION_WAITING && state->sessions[i].id > 0) {
-            count++;
-        }
-    }
-    
-    cJSON_AddNumberToObject(response, "nbSessions", count);
-    
-    if (count > 0) {
-        cJSON *sessions_array = cJSON_AddArrayToObject(response, "sessions");
-        
-        for (int i = 0; i < MAX_SESSIONS; i++) {
-            Session *s = &state->sessions[i];
-            if (s->status != SESSION_WAITING || s->id == 0) continue;
-            
-            cJSON *session = cJSON_CreateObject();
-            cJSON_AddNumberToObject(session, "id", s->id);
-            cJSON_AddStringToObject(session, "name", s->name);
-            
-            cJSON *theme_ids = cJSON_AddArrayToObject(session, "themeIds");
-            cJSON *theme_names = cJSON_AddArrayToObject(session, "themeNames");
-            
-            for (int t = 0; t < s->num_themes; t++) {
-                cJSON_AddItemToArray(theme_ids, cJSON_CreateNumber(s->theme_ids[t]));
-                // Find theme name
-                for (int th = 0; th < state->num_themes; th++) {
-                    if (state->themes[th].id == s->theme_ids[t]) {
-                        cJSON_AddItemToArray(theme_names, cJSON_CreateString(state->themes[th].name));
-                        break;
-                    }
-                }
-            }
-            
-            cJSON_AddStringToObject(session, "difficulty", difficulty_to_string(s->difficulty));
-            cJSON_AddNumberToObject(session, "nbQuestions", s->num_questions);
-            cJSON_AddNumberToObject(session, "timeLimit", s->time_limit);
-            cJSON_AddStringToObject(session, "mode", mode_to_string(s->mode));
-            cJSON_AddNumberToObject(session, "nbPlayers", s->num_players);
-            cJSON_AddNumberToObject(session, "maxPlayers", s->max_players);
-            cJSON_AddStringToObject(session, "status", "waiting");
-            
-            cJSON_AddItemToArray(sessions_array, session);
-        }
-    }
-    
-    return response;
-}
-
-/**
- * Creates JSON response for a successful session join.
- * Includes session info, player list, joker availability.
- * @param session The joined session
- * @param client_id Client who joined
- * @return cJSON object with session details and player list
- */
-cJSON* create_session_join_response(Session *session, int client_id) {
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "action", "session/join");
-    cJSON_AddStringToObject(response, "statut", "201");
-    cJSON_AddStringToObject(response, "message", "session joined");
-    cJSON_AddNumberToObject(response, "sessionId", session->id);
-    cJSON_AddStringToObject(response, "mode", mode_to_string(session->mode));
-    cJSON_AddBoolToObject(response, "isCreator", session->creator_client_id == client_id);
-    
-    cJSON *players = cJSON_AddArrayToObject(response, "players");
-    for (int i = 0; i < session->num_players; i++) {
-        cJSON_AddItemToArray(players, cJSON_CreateString(session->players[i].pseudo));
-    }
-    
-    if (session->mode == MODE_BATTLE) {
-        cJSON_AddNumberToObject(response, "lives", session->initial_lives);
-    }
-    
-    cJSON *jokers = cJSON_AddObjectToObject(response, "jokers");
-    cJSON_AddNumberToObject(jokers, "fifty", 1);
-    cJSON_AddNumberToObject(jokers, "skip", 1);
-    
-    return response;
-}
+#include "session.h"
+#include "binproto.h"
+#include "question.h"
+#include "protocol.h"
+#include "server.h"
+#include "utils.h"
+#include "jsonwriter.h"
+#include "metrics.h"
+#include "rcu.h"
+#include "roster.h"
+#include "leaderboard.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define START_COUNTDOWN_SECONDS 3  /**< Delay between session/started and the first question */
+#define RESULTS_PAUSE_SECONDS 5    /**< Delay between question/results and the next question */
+#define ANSWER_GRACE_SECONDS 1     /**< Extra time accepted after the question time limit */
+#define ROSTER_FLUSH_MS 250        /**< Window over which joins and leaves are coalesced */
+#define ROSTER_PAGE_SIZE 200       /**< Pseudos per session/roster page */
+#define RANKING_TOP_K 10           /**< Players listed in question/results and session/finished */
+
+// Everything below but create_session, session_post, the timer callbacks
+// and encode_sessions_list runs on the session actor.
+
+static void session_timer_fired(void *context, void *arg, int tag);
+static void roster_timer_fired(void *context, void *arg, int tag);
+static void session_receive(void *context, Actor *actor, ActorMsg *msg);
+static void send_question_results(ServerState *state, Session *session);
+static void end_session(ServerState *state, Session *session);
+
+/**
+ * Replaces the pending deadline of a session with a new phase.
+ * A deadline already fired for the previous phase is told apart by
+ * phase_seq when it reaches the actor.
+ * @param state Server state owning the timer wheel
+ * @param session Session to update
+ * @param phase New phase
+ * @param delay_ms Delay before the phase deadline fires, negative for none
+ */
+static void set_session_phase(ServerState *state, Session *session, SessionPhase phase, int delay_ms) {
+    timer_cancel(&state->timers, &session->phase_timer);
+    session->phase = phase;
+    session->phase_seq++;
+    if (delay_ms >= 0) {
+        session->phase_timer = timer_schedule(&state->timers, delay_ms, session_timer_fired,
+                                              (void*)(uintptr_t)session->phase_seq, session->id);
+    }
+}
+
+/**
+ * Actor release of a retired session: frees what it owns and returns its
+ * slot to the pool. Runs on the worker once the last message is handled.
+ * @param context Server state
+ * @param actor Actor embedded in the session
+ */
+static void release_session(void *context, Actor *actor) {
+    ServerState *state = (ServerState*)context;
+    Session *session = (Session*)((char*)actor - offsetof(Session, actor));
+    
+    timer_cancel(&state->timers, &session->phase_timer);
+    timer_cancel(&state->timers, &session->roster_timer);
+    roster_destroy(&session->roster);
+    leaderboard_destroy(&session->ranking);
+    
+    pthread_mutex_lock(&state->sessions_mutex);
+    int slot = session->slot;
+    memset(session, 0, sizeof(Session));
+    pool_free(&state->sessions, slot);
+    pthread_mutex_unlock(&state->sessions_mutex);
+}
+
+/**
+ * Marks a session finished and unindexes it. After a grace period no
+ * message can be posted to it anymore, and its slot is released once the
+ * actor has drained the messages already posted.
+ * @param state Server state with the session index
+ * @param session Session to retire
+ */
+static void retire_session(ServerState *state, Session *session) {
+    __atomic_store_n(&session->status, SESSION_FINISHED, __ATOMIC_RELAXED);
+    set_session_phase(state, session, PHASE_NONE, -1);
+    timer_cancel(&state->timers, &session->roster_timer);
+    session->roster_flush_pending = false;
+    
+    pthread_mutex_lock(&state->sessions_mutex);
+    rcuindex_remove(&state->session_index, session->id);
+    pthread_mutex_unlock(&state->sessions_mutex);
+    
+    // Posters that found the session before it was unindexed are done after
+    // the grace period; what they posted is in the inbox and is handled
+    // before release_session runs
+    rcu_synchronize();
+    actor_finish(&session->actor, release_session);
+}
+
+/**
+ * Queues the reply to the request carried by a message, tagged with its
+ * correlation id.
+ * @param state Server state for send_reply_buf
+ * @param msg Message from the requesting client
+ * @param response Reply to encode
+ */
+static void reply_json(ServerState *state, const SessionMsg *msg, const cJSON *response) {
+    MsgBuf *buf = msgbuf_from_json(response);
+    if (buf) {
+        send_reply_buf(state, msg->client_id, msg->rid, buf);
+        msgbuf_release(buf);
+    }
+}
+
+/**
+ * Replies to the request carried by a message with an error.
+ * @param state Server state for send_reply_buf
+ * @param msg Message from the requesting client
+ * @param action Endpoint of the request
+ * @param status HTTP-style status code as string
+ * @param message Error description
+ */
+static void reply_error(ServerState *state, const SessionMsg *msg, const char *action,
+                        const char *status, const char *message) {
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "action", action);
+    cJSON_AddStringToObject(response, "statut", status);
+    cJSON_AddStringToObject(response, "message", message);
+    reply_json(state, msg, response);
+    cJSON_Delete(response);
+}
+
+/**
+ * Timer wheel callback for session deadlines: hands the deadline to the
+ * session actor. A session finished meanwhile is no longer indexed and the
+ * deadline is dropped.
+ * @param context Server state
+ * @param arg phase_seq of the session when the timer was armed
+ * @param tag Session id
+ */
+static void session_timer_fired(void *context, void *arg, int tag) {
+    SessionMsg msg;
+    memset(&msg, 0, sizeof(SessionMsg));
+    msg.type = SESSION_MSG_DEADLINE;
+    msg.rid = -1;
+    msg.data.phase_seq = (unsigned int)(uintptr_t)arg;
+    session_post((ServerState*)context, tag, &msg);
+}
+
+/**
+ * Timer wheel callback announcing the roster changes of a session.
+ * @param context Server state
+ * @param arg Unused
+ * @param tag Session id
+ */
+static void roster_timer_fired(void *context, void *arg, int tag) {
+    (void)arg;
+    SessionMsg msg;
+    memset(&msg, 0, sizeof(SessionMsg));
+    msg.type = SESSION_MSG_ROSTER;
+    msg.rid = -1;
+    session_post((ServerState*)context, tag, &msg);
+}
+
+/**
+ * Makes sure the roster changes just logged get announced within
+ * ROSTER_FLUSH_MS, along with any other change made until then.
+ * @param state Server state owning the timer wheel
+ * @param session Session whose roster changed
+ */
+static void schedule_roster_flush(ServerState *state, Session *session) {
+    if (session->roster_flush_pending) return;
+    session->roster_flush_pending = true;
+    session->roster_timer = timer_schedule(&state->timers, ROSTER_FLUSH_MS, roster_timer_fired,
+                                           NULL, session->id);
+}
+
+/**
+ * Computes the ranking key of a player: score in solo mode; lives, then
+ * how late the player was eliminated, then score in battle mode.
+ * @param session Session the player is in
+ * @param player Player to rank
+ * @return Key, higher ranks first
+ */
+static long long ranking_key(const Session *session, const SessionPlayer *player) {
+    if (session->mode != MODE_BATTLE) {
+        return player->score;
+    }
+    return ((long long)player->lives << 40) | ((long long)player->eliminated_at << 32) |
+           (unsigned int)player->score;
+}
+
+/**
+ * Moves a player to its rank after its score, lives or elimination changed.
+ * @param session Session the player is in
+ * @param player Player to move
+ */
+static void update_rank(Session *session, SessionPlayer *player) {
+    leaderboard_update(&session->ranking, player->rank_node, ranking_key(session, player));
+}
+
+/**
+ * Encodes the question/results entry of a player.
+ * @param w Writer positioned for a value
+ * @param session Session the player is in
+ * @param q Question being closed
+ * @param p Player
+ * @param rank 1-based rank of the player
+ */
+static void write_result_entry(JsonWriter *w, const Session *session, const Question *q,
+                               const SessionPlayer *p, int rank) {
+    jsonw_object_begin(w);
+    jsonw_field_int(w, "rank", rank);
+    jsonw_field_string(w, "pseudo", p->pseudo);
+    jsonw_field_int(w, "answer", p->has_answered ? p->current_answer : -1);
+    jsonw_field_bool(w, "correct", p->was_correct);
+    
+    int points = 0;
+    if (p->was_correct) {
+        points = calculate_points(q->difficulty, p->response_time, session->time_limit);
+    }
+    jsonw_field_int(w, "points", points);
+    jsonw_field_int(w, "totalScore", p->score);
+    
+    if (session->mode == MODE_BATTLE) {
+        jsonw_field_number(w, "responseTime", p->response_time);
+        jsonw_field_int(w, "lives", p->lives);
+    }
+    jsonw_object_end(w);
+}
+
+/**
+ * Encodes the session/finished ranking entry of a player.
+ * @param w Writer positioned for a value
+ * @param session Session the player is in
+ * @param p Player
+ * @param rank 1-based rank of the player
+ */
+static void write_ranking_entry(JsonWriter *w, const Session *session, const SessionPlayer *p, int rank) {
+    jsonw_object_begin(w);
+    jsonw_field_int(w, "rank", rank);
+    jsonw_field_string(w, "pseudo", p->pseudo);
+    jsonw_field_int(w, "score", p->score);
+    jsonw_field_int(w, "correctAnswers", p->correct_answers);
+    
+    if (session->mode == MODE_BATTLE) {
+        jsonw_field_int(w, "lives", p->lives);
+        if (p->eliminated) {
+            jsonw_field_int(w, "eliminatedAt", p->eliminated_at);
+        }
+    }
+    jsonw_object_end(w);
+}
+
+/**
+ * Members shared by the per-player messages of one broadcast.
+ */
+typedef struct {
+    const char *action;            /**< Message action */
+    MsgBuf *text;                  /**< Writer output holding the shared members */
+    size_t start;                  /**< Offset of the members in text */
+    size_t end;                    /**< End of the members in text */
+    MsgBuf *pairs;                 /**< Members as MessagePack pairs, transcoded for the first binary recipient */
+    int num_pairs;                 /**< Number of pairs */
+} SharedFields;
+
+/**
+ * Sends a player a message made of the shared members followed by its own.
+ * Binary clients get a frame spliced from the shared pairs, transcoded once
+ * per broadcast, and their own members, instead of a re-parse of the whole
+ * message.
+ * @param state Server state for sending messages
+ * @param client_id Recipient
+ * @param shared Shared members, their pairs are filled in on first use
+ * @param own Recipient's own members ("key":value pairs)
+ * @param own_len Length of own
+ */
+static void send_personal(ServerState *state, int client_id, SharedFields *shared,
+                          const char *own, size_t own_len) {
+    JsonWriter w;
+    jsonw_init(&w, 64 + (shared->end - shared->start) + own_len);
+    jsonw_object_begin(&w);
+    jsonw_field_string(&w, "action", shared->action);
+    jsonw_fields(&w, shared->text->data + shared->start, shared->end - shared->start);
+    jsonw_fields(&w, own, own_len);
+    jsonw_object_end(&w);
+    MsgBuf *buf = jsonw_finish(&w);
+    if (!buf) return;
+    
+    int id = binproto_id(shared->action);
+    if (id && client_uses_binary(state, client_id)) {
+        if (!shared->pairs) {
+            shared->pairs = binproto_encode_fields(shared->text->data + shared->start,
+                                                   shared->end - shared->start, &shared->num_pairs);
+        }
+        int num_own = 0;
+        MsgBuf *own_pairs = binproto_encode_fields(own, own_len, &num_own);
+        if (shared->pairs && own_pairs) {
+            MsgBuf *parts[2] = { shared->pairs, own_pairs };
+            int counts[2] = { shared->num_pairs, num_own };
+            buf->binary = binproto_frame(id, parts, counts, 2);
+        }
+        msgbuf_release(own_pairs);
+    }
+    
+    send_buf_to_client(state, client_id, buf);
+    msgbuf_release(buf);
+}
+
+/**
+ * Appends a player with a fresh game state to a session that has room,
+ * and ranks it.
+ * @param session Session to update
+ * @param client_id Client ID of the player
+ * @param pseudo Display name of the player
+ * @return New player, NULL on allocation failure
+ */
+static SessionPlayer* add_player(Session *session, int client_id, const char *pseudo) {
+    SessionPlayer fresh;
+    memset(&fresh, 0, sizeof(SessionPlayer));
+    fresh.lives = session->initial_lives;
+    int node = leaderboard_insert(&session->ranking, client_id, ranking_key(session, &fresh));
+    if (node < 0) {
+        return NULL;
+    }
+    
+    SessionPlayer *player = roster_add(&session->roster, client_id, pseudo);
+    if (!player) {
+        leaderboard_remove(&session->ranking, node);
+        return NULL;
+    }
+    player->lives = session->initial_lives;
+    player->rank_node = node;
+    return player;
+}
+
+/**
+ * Clears the current session of a client, unless it joined another
+ * session since.
+ * @param state Server state for the client lookup
+ * @param session_id Session the client is no longer in
+ * @param client_id Client to update
+ */
+static void release_client(ServerState *state, int session_id, int client_id) {
+    rcu_read_lock();
+    Client *client = find_client(state, client_id);
+    if (client) {
+        int expected = session_id;
+        __atomic_compare_exchange_n(&client->current_session_id, &expected, -1, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+    rcu_read_unlock();
+}
+
+/**
+ * Creates a new game session with specified parameters.
+ * Initializes session structure, selects matching questions, adds the
+ * creator as first player, then publishes the session: from then on it is
+ * only reached through session_post.
+ * @param state Server state containing sessions array and questions
+ * @param name Display name for the session
+ * @param theme_ids Array of theme IDs to filter questions
+ * @param num_themes Number of themes in the array
+ * @param difficulty Difficulty level for question filtering
+ * @param num_questions Number of questions for the game
+ * @param time_limit Time allowed per question in seconds
+ * @param mode Game mode (solo or battle)
+ * @param max_players Maximum number of players allowed
+ * @param creator_client_id Client ID of the session creator
+ * @param creator_pseudo Display name of the session creator
+ * @return ID of the created session, or -1 on failure
+ */
+int create_session(ServerState *state, const char *name, int *theme_ids, int num_themes,
+                   Difficulty difficulty, int num_questions, int time_limit,
+                   GameMode mode, int initial_lives, int max_players, int creator_client_id,
+                   const char *creator_pseudo) {
+    log_msg("SESSION", "create_session() - name='%s', themes=%d, difficulty=%d, questions=%d",
+           name, num_themes, difficulty, num_questions);
+    
+    // The session is built aside; sessions_mutex only covers claiming a
+    // slot and publishing it
+    Session fresh;
+    memset(&fresh, 0, sizeof(Session));
+    strncpy(fresh.name, name, 63);
+    
+    fresh.num_themes = num_themes;
+    for (int i = 0; i < num_themes; i++) {
+        fresh.theme_ids[i] = theme_ids[i];
+    }
+    
+    fresh.difficulty = difficulty;
+    fresh.num_questions = num_questions;
+    fresh.time_limit = time_limit;
+    fresh.mode = mode;
+    fresh.initial_lives = (mode == MODE_BATTLE) ? initial_lives : 0;
+    fresh.max_players = max_players;
+    fresh.status = SESSION_WAITING;
+    fresh.creator_client_id = creator_client_id;
+    fresh.current_question = -1;
+    
+    if (select_questions_for_session(state, &fresh) < 0) {
+        log_warn("SESSION", "create_session() FAILED - not enough matching questions");
+        return -1;
+    }
+    
+    SessionPlayer *creator = NULL;
+    if (roster_init(&fresh.roster, 16) == 0 && leaderboard_init(&fresh.ranking, 16) == 0) {
+        creator = add_player(&fresh, creator_client_id, creator_pseudo);
+    }
+    if (!creator) {
+        log_warn("SESSION", "create_session() FAILED - cannot allocate the roster");
+        roster_destroy(&fresh.roster);
+        leaderboard_destroy(&fresh.ranking);
+        return -1;
+    }
+    // The creator learns the roster from its own create reply
+    creator->roster_synced = true;
+    roster_clear_changes(&fresh.roster);
+    
+    pthread_mutex_lock(&state->sessions_mutex);
+    
+    // Retired sessions hand their slot back through release_session
+    int slot = pool_alloc(&state->sessions);
+    if (slot < 0) {
+        log_warn("SESSION", "create_session() FAILED - max sessions reached (%d)",
+                state->limits.max_sessions);
+        pthread_mutex_unlock(&state->sessions_mutex);
+        roster_destroy(&fresh.roster);
+        leaderboard_destroy(&fresh.ranking);
+        return -1;
+    }
+    Session *session = pool_get(&state->sessions, slot);
+    log_debug("SESSION", "Allocated slot %d", slot);
+    
+    *session = fresh;
+    actor_init(&session->actor, session_receive);
+    session->slot = slot;
+    session->id = state->next_session_id++;
+    
+    int session_id = session->id;
+    if (rcuindex_put(&state->session_index, session_id, session) < 0) {
+        log_warn("SESSION", "create_session() FAILED - cannot grow the session index");
+        roster_destroy(&session->roster);
+        leaderboard_destroy(&session->ranking);
+        memset(session, 0, sizeof(Session));
+        pool_free(&state->sessions, slot);
+        pthread_mutex_unlock(&state->sessions_mutex);
+        return -1;
+    }
+    log_msg("SESSION", "Session created successfully: id=%d (session slots: %d)", 
+           session_id, state->sessions.count);
+    
+    pthread_mutex_unlock(&state->sessions_mutex);
+    
+    return session_id;
+}
+
+/**
+ * Posts a message to a session actor.
+ * The lookup and the post happen in one read section: retire_session
+ * waits for a grace period after unindexing a session before its slot
+ * can be reused, so a message never lands in a reused slot.
+ * @param state Server state containing the session index
+ * @param session_id Destination session
+ * @param msg Message, copied
+ * @return 0 if posted, -1 if the session is gone or on allocation failure
+ */
+int session_post(ServerState *state, int session_id, const SessionMsg *msg) {
+    SessionMsg *copy = malloc(sizeof(SessionMsg));
+    if (!copy) return -1;
+    memcpy(copy, msg, sizeof(SessionMsg));
+    
+    rcu_read_lock();
+    Session *session = rcuindex_get(&state->session_index, session_id);
+    if (session) {
+        actor_post(&state->session_pool, &session->actor, &copy->header);
+    }
+    rcu_read_unlock();
+    
+    if (!session) {
+        log_debug("SESSION", "session_post() - session %d not found", session_id);
+        free(copy);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Posts the request a client is making to a session actor. The session
+ * records the request latency once it has handled it, in place of
+ * route_request, so the histogram covers the work and not just the post.
+ * @param state Server state containing the session index
+ * @param client Client making the request
+ * @param session_id Destination session
+ * @param msg Message, copied; client_id, rid and the timing are filled in
+ * @return 0 if posted, -1 if the session is gone or on allocation failure
+ */
+int session_post_request(ServerState *state, Client *client, int session_id, SessionMsg *msg) {
+    msg->client_id = client->id;
+    msg->rid = client->rid;
+    msg->endpoint = client->request_endpoint;
+    msg->received_ms = client->request_started;
+    if (session_post(state, session_id, msg) < 0) {
+        return -1;
+    }
+    client->request_handed_off = true;
+    return 0;
+}
+
+/**
+ * Adds a player to an existing session.
+ * Validates session is waiting and has room; the join is announced to the
+ * other players, and the roster sent to the new one, at the next flush.
+ * @param state Server state for the client lookup and the flush timer
+ * @param session Target session to join
+ * @param client_id Client ID of the joining player
+ * @param pseudo Display name of the joining player
+ * @return 0 on success, -1 not waiting, -2 full, -3 already in session,
+ *         -4 client disconnected, -5 allocation failure
+ */
+static int join_session(ServerState *state, Session *session, int client_id, const char *pseudo) {
+    log_msg("SESSION", "join_session() - client %d ('%s') joining session %d",
+           client_id, pseudo, session->id);
+    
+    if (session->status != SESSION_WAITING) {
+        log_warn("SESSION", "join_session() FAILED - session not waiting (status=%d)", session->status);
+        return -1;
+    }
+    
+    if (session->roster.count >= session->max_players) {
+        log_warn("SESSION", "join_session() FAILED - session full (%d/%d)", 
+                session->roster.count, session->max_players);
+        return -2;
+    }
+    
+    if (roster_find(&session->roster, client_id)) {
+        log_warn("SESSION", "join_session() FAILED - already in session");
+        return -3;
+    }
+    
+    // Only a client found in a read section joins: disconnect_client reads
+    // current_session_id after a grace period, so it sees this store and
+    // posts the matching leave
+    rcu_read_lock();
+    Client *client = find_client(state, client_id);
+    if (client) {
+        __atomic_store_n(&client->current_session_id, session->id, __ATOMIC_RELAXED);
+    }
+    rcu_read_unlock();
+    if (!client) {
+        log_debug("SESSION", "join_session() - client %d left before joining", client_id);
+        return -4;
+    }
+    
+    if (!add_player(session, client_id, pseudo)) {
+        log_warn("SESSION", "join_session() FAILED - cannot grow the roster");
+        release_client(state, session->id, client_id);
+        return -5;
+    }
+    log_msg("SESSION", "Player '%s' added (now %d/%d players)", 
+           pseudo, session->roster.count, session->max_players);
+    
+    schedule_roster_flush(state, session);
+    return 0;
+}
+
+/**
+ * Removes a player from a session.
+ * Reassigns creator if needed; the leave is announced at the next flush.
+ * @param state Server state for sending results and the flush timer
+ * @param session Session to leave
+ * @param client_id Client ID of the leaving player
+ * @return 0 on success, -1 if player not in session
+ */
+static int leave_session(ServerState *state, Session *session, int client_id) {
+    log_msg("SESSION", "leave_session() - client %d leaving session %d", client_id, session->id);
+    
+    SessionPlayer *player = roster_find(&session->roster, client_id);
+    if (!player) {
+        log_warn("SESSION", "leave_session() FAILED - client not in session");
+        return -1;
+    }
+    
+    log_msg("SESSION", "Removing player '%s'", player->pseudo);
+    bool was_awaited = session->phase == PHASE_QUESTION &&
+                       !player->eliminated && !player->has_answered;
+    leaderboard_remove(&session->ranking, player->rank_node);
+    roster_remove(&session->roster, client_id);
+    if (was_awaited) {
+        session->awaiting_answers--;
+    }
+    
+    int num_players = session->roster.count;
+    if (client_id == session->creator_client_id && num_players > 0) {
+        session->creator_client_id = session->roster.players[0].client_id;
+        log_msg("SESSION", "New creator: client %d ('%s')", 
+               session->creator_client_id, session->roster.players[0].pseudo);
+    }
+    
+    if (num_players == 0) {
+        log_msg("SESSION", "No players left, ending session");
+        retire_session(state, session);
+        return 0;
+    }
+    
+    schedule_roster_flush(state, session);
+    if (num_players == 1 && session->status == SESSION_PLAYING) {
+        log_msg("SESSION", "Only 1 player left during game, ending session with results");
+        end_session(state, session);
+    } else if (was_awaited && session->awaiting_answers == 0) {
+        // The leaving player was the last one we were waiting for
+        send_question_results(state, session);
+    }
+    return 0;
+}
+
+/**
+ * Encodes the logged roster changes, one session/player/joined or
+ * session/player/left event per run of consecutive joins or leaves, so
+ * that applying them in order gives the current roster.
+ * @param session Session whose roster changed
+ * @param bufs Output, room for one message per change
+ * @return Number of messages encoded
+ */
+static int encode_roster_changes(Session *session, MsgBuf **bufs) {
+    const Roster *roster = &session->roster;
+    int num_bufs = 0;
+    int i = 0;
+    
+    while (i < roster->num_changes) {
+        bool joined = roster->changes[i].joined;
+        int run_end = i;
+        while (run_end < roster->num_changes && roster->changes[run_end].joined == joined) {
+            run_end++;
+        }
+        
+        JsonWriter w;
+        jsonw_init(&w, 128 + (size_t)(run_end - i) * (MAX_PSEUDO_LEN + 3));
+        jsonw_object_begin(&w);
+        jsonw_field_string(&w, "action", joined ? "session/player/joined" : "session/player/left");
+        jsonw_key(&w, "pseudos");
+        jsonw_array_begin(&w);
+        for (; i < run_end; i++) {
+            jsonw_string(&w, roster->changes[i].pseudo);
+        }
+        jsonw_array_end(&w);
+        if (!joined) {
+            jsonw_field_string(&w, "reason", "disconnected");
+        }
+        jsonw_field_int(&w, "nbPlayers", roster->count);
+        jsonw_object_end(&w);
+        
+        bufs[num_bufs] = jsonw_finish(&w);
+        if (bufs[num_bufs]) num_bufs++;
+    }
+    return num_bufs;
+}
+
+/**
+ * Encodes the whole roster as session/roster pages of ROSTER_PAGE_SIZE
+ * pseudos.
+ * @param session Session to describe
+ * @param bufs Output, room for one message per page
+ * @return Number of pages encoded
+ */
+static int encode_roster_pages(Session *session, MsgBuf **bufs) {
+    const Roster *roster = &session->roster;
+    int num_bufs = 0;
+    
+    for (int offset = 0; offset < roster->count; offset += ROSTER_PAGE_SIZE) {
+        int page_end = offset + ROSTER_PAGE_SIZE < roster->count ? offset + ROSTER_PAGE_SIZE : roster->count;
+        
+        JsonWriter w;
+        jsonw_init(&w, 128 + (size_t)(page_end - offset) * (MAX_PSEUDO_LEN + 3));
+        jsonw_object_begin(&w);
+        jsonw_field_string(&w, "action", "session/roster");
+        jsonw_field_int(&w, "offset", offset);
+        jsonw_field_int(&w, "nbPlayers", roster->count);
+        jsonw_key(&w, "players");
+        jsonw_array_begin(&w);
+        for (int i = offset; i < page_end; i++) {
+            jsonw_string(&w, roster->players[i].pseudo);
+        }
+        jsonw_array_end(&w);
+        jsonw_object_end(&w);
+        
+        bufs[num_bufs] = jsonw_finish(&w);
+        if (bufs[num_bufs]) num_bufs++;
+    }
+    return num_bufs;
+}
+
+/**
+ * Announces the roster changes logged since the last flush. Players who
+ * already had the roster get the changes as coalesced events; players who
+ * joined meanwhile get the whole current roster instead, in pages. Each
+ * message is encoded once and shared by all of its recipients.
+ * @param state Server state for sending messages
+ * @param session Session to flush
+ */
+static void flush_roster(ServerState *state, Session *session) {
+    timer_cancel(&state->timers, &session->roster_timer);
+    session->roster_flush_pending = false;
+    
+    Roster *roster = &session->roster;
+    int max_pages = (roster->count + ROSTER_PAGE_SIZE - 1) / ROSTER_PAGE_SIZE;
+    MsgBuf **changes = NULL;
+    MsgBuf **pages = NULL;
+    int num_changes = 0;
+    int num_pages = 0;
+    bool changes_encoded = false;
+    bool pages_encoded = false;
+    int synced = 0;
+    
+    double fanout_started = get_current_time_ms();
+    for (int i = 0; i < roster->count; i++) {
+        SessionPlayer *p = &roster->players[i];
+        if (!p->roster_synced) {
+            if (!pages_encoded) {
+                pages_encoded = true;
+                pages = malloc((size_t)max_pages * sizeof(MsgBuf*));
+                if (pages) num_pages = encode_roster_pages(session, pages);
+            }
+            for (int j = 0; j < num_pages; j++) {
+                send_buf_to_client(state, p->client_id, pages[j]);
+            }
+            p->roster_synced = true;
+            synced++;
+        } else if (roster->num_changes > 0) {
+            if (!changes_encoded) {
+                changes_encoded = true;
+                changes = malloc((size_t)roster->num_changes * sizeof(MsgBuf*));
+                if (changes) num_changes = encode_roster_changes(session, changes);
+            }
+            for (int j = 0; j < num_changes; j++) {
+                send_buf_to_client(state, p->client_id, changes[j]);
+            }
+        }
+    }
+    metrics_observe(SECTION_BROADCAST, get_current_time_ms() - fanout_started);
+    
+    log_debug("SESSION", "Session %d roster flushed: %d change(s), %d new player(s) sent %d page(s)",
+             session->id, roster->num_changes, synced, num_pages);
+    for (int j = 0; j < num_changes; j++) msgbuf_release(changes[j]);
+    for (int j = 0; j < num_pages; j++) msgbuf_release(pages[j]);
+    free(changes);
+    free(pages);
+    roster_clear_changes(roster);
+}
+
+/**
+ * Starts a game session.
+ * Validates minimum players, sends start notification and arms the countdown
+ * timer that will send the first question. Does not block.
+ * @param state Server state for sending messages
+ * @param session Session to start
+ * @return 0 on success, -1 if not enough players, -2 if already started
+ */
+static int start_session(ServerState *state, Session *session) {
+    log_msg("SESSION", "start_session() - session %d starting with %d players", 
+           session->id, session->roster.count);
+    
+    if (session->status != SESSION_WAITING) {
+        log_warn("SESSION", "start_session() FAILED - session not waiting (status=%d)", session->status);
+        return -2;
+    }
+    
+    if (session->roster.count < 2) {
+        log_warn("SESSION", "start_session() FAILED - not enough players");
+        return -1;
+    }
+    
+    // Everyone gets the final roster before the game starts
+    flush_roster(state, session);
+    
+    __atomic_store_n(&session->status, SESSION_PLAYING, __ATOMIC_RELAXED);
+    session->current_question = 0;
+    log_msg("SESSION", "Session status set to PLAYING, starting with question 0");
+    
+    log_msg("SESSION", "Sending start notification to %d players", session->roster.count);
+    cJSON *notify = cJSON_CreateObject();
+    cJSON_AddStringToObject(notify, "action", "session/started");
+    cJSON_AddStringToObject(notify, "message", "session is starting");
+    cJSON_AddNumberToObject(notify, "countdown", START_COUNTDOWN_SECONDS);
+    
+    MsgBuf *buf = msgbuf_from_json(notify);
+    cJSON_Delete(notify);
+    for (int i = 0; buf && i < session->roster.count; i++) {
+        send_buf_to_client(state, session->roster.players[i].client_id, buf);
+    }
+    msgbuf_release(buf);
+    
+    log_msg("SESSION", "Arming %d seconds countdown", START_COUNTDOWN_SECONDS);
+    set_session_phase(state, session, PHASE_COUNTDOWN, START_COUNTDOWN_SECONDS * 1000);
+    
+    return 0;
+}
+
+/**
+ * Finds a player in a session by client ID.
+ * @param session Session to search in
+ * @param client_id Client ID to find
+ * @return Pointer to SessionPlayer if found, NULL otherwise
+ */
+static SessionPlayer* find_session_player(Session *session, int client_id) {
+    SessionPlayer *player = roster_find(&session->roster, client_id);
+    if (!player) {
+        log_debug("SESSION", "find_session_player() - client %d not found", client_id);
+    }
+    return player;
+}
+
+/**
+ * Gets the current question being asked in a session.
+ * Uses session's question_ids array and current_question index.
+ * @param state Server state containing all questions
+ * @param session Session with current question index
+ * @return Pointer to current Question, NULL if out of range
+ */
+static const Question* get_current_question(ServerState *state, Session *session) {
+    if (session->current_question < 0 || session->current_question >= session->num_questions) {
+        return NULL;
+    }
+    
+    return qbank_question(&state->bank, session->question_ids[session->current_question]);
+}
+
+/**
+ * Sends the current question to all active players.
+ * Resets player answer states, formats question as JSON.
+ * @param state Server state for sending messages
+ * @param session Session with current question
+ */
+static void send_question_to_all(ServerState *state, Session *session) {
+    // Check if session is still playing
+    if (session->status != SESSION_PLAYING) {
+        log_msg("SESSION", "send_question_to_all() SKIPPED - session not playing (status=%d)", session->status);
+        return;
+    }
+    
+    const Question *q = get_current_question(state, session);
+    if (!q) {
+        log_warn("SESSION", "send_question_to_all() FAILED - no current question");
+        return;
+    }
+    
+    log_msg("SESSION", "Sending question %d/%d: '%s'", 
+           session->current_question + 1, session->num_questions,
+           qbank_string(&state->bank, q->question));
+    
+    session->awaiting_answers = 0;
+    for (int i = 0; i < session->roster.count; i++) {
+        SessionPlayer *p = &session->roster.players[i];
+        p->has_answered = false;
+        p->was_correct = false;
+        p->current_answer = -1;
+        p->response_time = 0;
+        p->used_skip_this_question = false;
+        if (!p->eliminated) session->awaiting_answers++;
+    }
+    
+    session->question_start_time = time(NULL);
+    set_session_phase(state, session, PHASE_QUESTION,
+                      (session->time_limit + ANSWER_GRACE_SECONDS) * 1000);
+    
+    // Same payload for everyone: per-session header, then the question's
+    // fields as encoded by the bank compiler
+    size_t fields_len;
+    const char *fields = qbank_question_fields(&state->bank, q, &fields_len);
+    JsonWriter w;
+    jsonw_init(&w, 128 + fields_len);
+    jsonw_object_begin(&w);
+    jsonw_field_string(&w, "action", "question/new");
+    jsonw_field_int(&w, "questionNum", session->current_question + 1);
+    jsonw_field_int(&w, "totalQuestions", session->num_questions);
+    jsonw_field_int(&w, "timeLimit", session->time_limit);
+    jsonw_fields(&w, fields, fields_len);
+    jsonw_object_end(&w);
+    
+    MsgBuf *buf = jsonw_finish(&w);
+    
+    double fanout_started = get_current_time_ms();
+    int active_players = 0;
+    for (int i = 0; buf && i < session->roster.count; i++) {
+        SessionPlayer *p = &session->roster.players[i];
+        if (p->eliminated) {
+            log_debug("SESSION", "  Skipping eliminated player '%s'", p->pseudo);
+            continue;
+        }
+        active_players++;
+        send_buf_to_client(state, p->client_id, buf);
+    }
+    metrics_observe(SECTION_BROADCAST, get_current_time_ms() - fanout_started);
+    msgbuf_release(buf);
+    
+    log_debug("SESSION", "Question sent to %d active player(s)", active_players);
+}
+
+/**
+ * Processes a player's answer to the current question.
+ * Validates timing, checks correctness, awards points, triggers results when all answered.
+ * @param state Server state for sending results
+ * @param session Current game session
+ * @param client_id Client who submitted the answer
+ * @param answer_index QCM answer index (0-3)
+ * @param text_answer Text answer for TEXT type questions
+ * @param bool_answer Boolean answer for BOOLEAN type questions
+ * @param response_time Time taken to answer in seconds
+ */
+static void process_answer(ServerState *state, Session *session, int client_id,
+                           int answer_index, const char *text_answer, bool bool_answer,
+                           double response_time) {
+    log_debug("SESSION", "process_answer() - client %d, answer=%d, time=%.2f", 
+             client_id, answer_index, response_time);
+    
+    SessionPlayer *player = find_session_player(session, client_id);
+    if (session->phase != PHASE_QUESTION || !player || player->has_answered || player->eliminated) {
+        return;
+    }
+    
+    time_t current_time = time(NULL);
+    double server_elapsed = difftime(current_time, session->question_start_time);
+    
+    if (server_elapsed > session->time_limit + 1) {
+        response_time = session->time_limit + 1;
+    }
+    
+    player->has_answered = true;
+    player->current_answer = answer_index;
+    player->response_time = response_time;
+    session->awaiting_answers--;
+    
+    const Question *q = get_current_question(state, session);
+    bool correct = false;
+    
+    if (q) {
+        if (q->type == QUESTION_TEXT) {
+            correct = check_answer(&state->bank, q, 0, text_answer, false);
+        } else if (q->type == QUESTION_BOOLEAN) {
+            correct = check_answer(&state->bank, q, 0, NULL, bool_answer);
+            player->current_answer = bool_answer ? 1 : 0;
+        } else {
+            correct = check_answer(&state->bank, q, answer_index, NULL, false);
+        }
+        
+        if (correct) {
+            int points = calculate_points(q->difficulty, response_time, session->time_limit);
+            player->score += points;
+            player->correct_answers++;
+            update_rank(session, player);
+        }
+        player->was_correct = correct;
+    }
+    
+    if (session->awaiting_answers == 0) {
+        send_question_results(state, session);
+    }
+}
+
+/**
+ * Closes the current question once its deadline has passed.
+ * Players who did not answer are recorded as wrong with the full time used,
+ * so an AFK player can no longer stall the session.
+ * @param state Server state for sending results
+ * @param session Session whose question deadline fired
+ */
+static void check_question_timeout(ServerState *state, Session *session) {
+    if (session->status != SESSION_PLAYING || session->phase != PHASE_QUESTION) {
+        return;
+    }
+    
+    double elapsed = difftime(time(NULL), session->question_start_time);
+    if (elapsed < session->time_limit) {
+        return;
+    }
+    
+    int timed_out = 0;
+    for (int i = 0; i < session->roster.count; i++) {
+        SessionPlayer *p = &session->roster.players[i];
+        if (p->eliminated || p->has_answered) continue;
+        
+        p->has_answered = true;
+        p->was_correct = false;
+        p->current_answer = -1;
+        p->response_time = session->time_limit;
+        timed_out++;
+    }
+    session->awaiting_answers = 0;
+    
+    log_msg("SESSION", "Question %d of session %d timed out (%d player(s) without answer)",
+           session->current_question + 1, session->id, timed_out);
+    
+    send_question_results(state, session);
+}
+
+/**
+ * Sends question results to all players after everyone answered or the
+ * question timed out. Applies Battle mode penalties, sends each player the
+ * top of the ranking plus its own entry, then either ends the game or arms
+ * the pause before the next question.
+ * @param state Server state for sending messages
+ * @param session Current game session
+ */
+static void send_question_results(ServerState *state, Session *session) {
+    double started = get_current_time_ms();
+    
+    // Only the first of "all answered" / "deadline" closes the question
+    if (session->phase != PHASE_QUESTION) {
+        return;
+    }
+    set_session_phase(state, session, PHASE_RESULTS, -1);
+    
+    const Question *q = get_current_question(state, session);
+    if (!q) {
+        return;
+    }
+    
+    double max_response_time = 0;
+    int last_player_index = -1;
+    
+    if (session->mode == MODE_BATTLE) {
+        for (int i = 0; i < session->roster.count; i++) {
+            SessionPlayer *p = &session->roster.players[i];
+            if (p->eliminated || p->used_skip_this_question) continue;
+            
+            bool correct = false;
+            if (q->type == QUESTION_QCM) {
+                correct = (p->current_answer == q->correct_answer);
+            } else if (q->type == QUESTION_BOOLEAN) {
+                correct = (p->current_answer == q->correct_answer);
+            } else {
+                correct = p->has_answered;
+            }
+            
+            if (!correct && p->has_answered) {
+                p->lives--;
+                if (p->lives <= 0) {
+                    p->eliminated = true;
+                    p->eliminated_at = session->current_question + 1;
+                }
+                update_rank(session, p);
+            }
+            
+            if (p->has_answered && p->response_time > max_response_time) {
+                max_response_time = p->response_time;
+                last_player_index = i;
+            }
+        }
+        
+        if (last_player_index >= 0) {
+            SessionPlayer *last = &session->roster.players[last_player_index];
+            if (!last->eliminated) {
+                bool was_correct = false;
+                if (q->type == QUESTION_QCM || q->type == QUESTION_BOOLEAN) {
+                    was_correct = (last->current_answer == q->correct_answer);
+                }
+                if (was_correct) { 
+                    last->lives--;
+                    if (last->lives <= 0) {
+                        last->eliminated = true;
+                        last->eliminated_at = session->current_question + 1;
+                    }
+                    update_rank(session, last);
+                }
+            }
+        }
+    }
+    
+    size_t fields_len;
+    const char *fields = qbank_results_fields(&state->bank, q, &fields_len);
+    const char *last_pseudo = NULL;
+    if (session->mode == MODE_BATTLE && last_player_index >= 0) {
+        last_pseudo = session->roster.players[last_player_index].pseudo;
+    }
+    
+    int top[RANKING_TOP_K];
+    int num_top = leaderboard_top(&session->ranking, RANKING_TOP_K, top);
+    
+    JsonWriter shared;
+    jsonw_init(&shared, 128 + fields_len + (size_t)num_top * 128);
+    size_t start = jsonw_mark(&shared);
+    jsonw_fields(&shared, fields, fields_len);
+    if (last_pseudo) {
+        jsonw_field_string(&shared, "lastPlayer", last_pseudo);
+    }
+    jsonw_key(&shared, "results");
+    jsonw_array_begin(&shared);
+    for (int i = 0; i < num_top; i++) {
+        write_result_entry(&shared, session, q, roster_find(&session->roster, top[i]), i + 1);
+    }
+    jsonw_array_end(&shared);
+    jsonw_field_int(&shared, "nbPlayers", session->roster.count);
+    SharedFields results = { .action = "question/results", .start = start, .end = jsonw_mark(&shared) };
+    results.text = jsonw_finish(&shared);
+    
+    double fanout_started = get_current_time_ms();
+    for (int i = 0; results.text && i < session->roster.count; i++) {
+        SessionPlayer *p = &session->roster.players[i];
+        
+        JsonWriter w;
+        jsonw_init(&w, 256);
+        size_t own_start = jsonw_mark(&w);
+        jsonw_key(&w, "you");
+        write_result_entry(&w, session, q, p, leaderboard_rank(&session->ranking, p->rank_node));
+        size_t own_end = jsonw_mark(&w);
+        MsgBuf *own = jsonw_finish(&w);
+        if (own) {
+            send_personal(state, p->client_id, &results, own->data + own_start, own_end - own_start);
+            msgbuf_release(own);
+        }
+    }
+    metrics_observe(SECTION_BROADCAST, get_current_time_ms() - fanout_started);
+    msgbuf_release(results.text);
+    msgbuf_release(results.pairs);
+    
+    int active_players = 0;
+    int num_eliminated = 0;
+    for (int i = 0; i < session->roster.count; i++) {
+        SessionPlayer *p = &session->roster.players[i];
+        if (!p->eliminated) {
+            active_players++;
+        } else if (p->eliminated_at == session->current_question + 1) {
+            num_eliminated++;
+        }
+    }
+    
+    // All of the question's eliminations go out as one event
+    if (num_eliminated > 0) {
+        JsonWriter w;
+        jsonw_init(&w, 128 + (size_t)num_eliminated * (MAX_PSEUDO_LEN + 3));
+        jsonw_object_begin(&w);
+        jsonw_field_string(&w, "action", "session/player/eliminated");
+        jsonw_key(&w, "pseudos");
+        jsonw_array_begin(&w);
+        for (int i = 0; i < session->roster.count; i++) {
+            SessionPlayer *p = &session->roster.players[i];
+            if (p->eliminated && p->eliminated_at == session->current_question + 1) {
+                jsonw_string(&w, p->pseudo);
+            }
+        }
+        jsonw_array_end(&w);
+        jsonw_field_int(&w, "nbActive", active_players);
+        jsonw_object_end(&w);
+        
+        MsgBuf *elim_buf = jsonw_finish(&w);
+        for (int i = 0; elim_buf && i < session->roster.count; i++) {
+            send_buf_to_client(state, session->roster.players[i].client_id, elim_buf);
+        }
+        msgbuf_release(elim_buf);
+    }
+    
+    bool game_over = (session->mode == MODE_BATTLE && active_players <= 1) ||
+                     session->current_question + 1 >= session->num_questions;
+    
+    if (!game_over) {
+        set_session_phase(state, session, PHASE_RESULTS, RESULTS_PAUSE_SECONDS * 1000);
+    }
+    
+    metrics_observe(SECTION_QUESTION_RESULTS, get_current_time_ms() - started);
+    
+    if (game_over) {
+        end_session(state, session);
+    }
+}
+
+/**
+ * Advances session to the next question.
+ * Increments current_question index and sends new question to all.
+ * @param state Server state for sending messages
+ * @param session Session to advance
+ */
+static void advance_to_next_question(ServerState *state, Session *session) {
+    if (session->status != SESSION_PLAYING || session->phase != PHASE_RESULTS) {
+        log_msg("SESSION", "Session no longer playing, not advancing to next question");
+        return;
+    }
+    session->phase = PHASE_NONE;
+    session->current_question++;
+    
+    send_question_to_all(state, session);
+}
+
+/**
+ * Ends a game session and sends final results.
+ * Retires the session and sends each player a session/finished message
+ * with the top of the ranking plus its own entry.
+ * @param state Server state for sending messages and updating clients
+ * @param session Session to end
+ */
+static void end_session(ServerState *state, Session *session) {
+    double started = get_current_time_ms();
+    
+    retire_session(state, session);
+    
+    int num_players = session->roster.count;
+    int top[RANKING_TOP_K];
+    int num_top = leaderboard_top(&session->ranking, RANKING_TOP_K, top);
+    
+    JsonWriter shared;
+    jsonw_init(&shared, 128 + (size_t)num_top * 128);
+    size_t start = jsonw_mark(&shared);
+    jsonw_field_string(&shared, "mode", mode_to_string(session->mode));
+    if (session->mode == MODE_BATTLE && num_top > 0) {
+        jsonw_field_string(&shared, "winner", roster_find(&session->roster, top[0])->pseudo);
+    }
+    jsonw_key(&shared, "ranking");
+    jsonw_array_begin(&shared);
+    for (int i = 0; i < num_top; i++) {
+        write_ranking_entry(&shared, session, roster_find(&session->roster, top[i]), i + 1);
+    }
+    jsonw_array_end(&shared);
+    jsonw_field_int(&shared, "nbPlayers", num_players);
+    SharedFields finished = { .action = "session/finished", .start = start, .end = jsonw_mark(&shared) };
+    finished.text = jsonw_finish(&shared);
+    
+    for (int i = 0; i < num_players; i++) {
+        SessionPlayer *p = &session->roster.players[i];
+        
+        if (finished.text) {
+            JsonWriter w;
+            jsonw_init(&w, 256);
+            size_t own_start = jsonw_mark(&w);
+            jsonw_key(&w, "you");
+            write_ranking_entry(&w, session, p, leaderboard_rank(&session->ranking, p->rank_node));
+            size_t own_end = jsonw_mark(&w);
+            MsgBuf *own = jsonw_finish(&w);
+            if (own) {
+                send_personal(state, p->client_id, &finished, own->data + own_start, own_end - own_start);
+                msgbuf_release(own);
+            }
+        }
+        release_client(state, session->id, p->client_id);
+    }
+    
+    msgbuf_release(finished.text);
+    msgbuf_release(finished.pairs);
+    
+    metrics_observe(SECTION_END_SESSION, get_current_time_ms() - started);
+}
+
+/**
+ * Uses the 50/50 joker to eliminate two wrong answers.
+ * Only works for QCM questions, can only be used once per session.
+ * @param state Server state for getting current question
+ * @param session Current game session
+ * @param client_id Client using the joker
+ * @param removed_answers Output array to store the two removed answer indices
+ * @return 0 on success, -1 already used, answered or no question open, -2 not QCM question
+ */
+static int use_joker_fifty(ServerState *state, Session *session, int client_id, int *removed_answers) {
+    SessionPlayer *player = find_session_player(session, client_id);
+    if (session->phase != PHASE_QUESTION || !player || player->joker_fifty_used || player->has_answered) {
+        return -1;
+    }
+    
+    const Question *q = get_current_question(state, session);
+    if (!q || q->type != QUESTION_QCM) {
+        return -2;
+    }
+    
+    player->joker_fifty_used = true;
+    
+    int wrong_answers[3];
+    int num_wrong = 0;
+    
+    for (int i = 0; i < 4; i++) {
+        if (i != q->correct_answer) {
+            wrong_answers[num_wrong++] = i;
+        }
+    }
+    
+    shuffle_array(wrong_answers, num_wrong);
+    removed_answers[0] = wrong_answers[0];
+    removed_answers[1] = wrong_answers[1];
+    
+    return 0;
+}
+
+/**
+ * Uses the skip joker to skip the current question.
+ * Player is marked as answered with neutral result, can only be used once.
+ * @param session Current game session
+ * @param client_id Client using the joker
+ * @return 0 on success, -1 already used, answered or no question open
+ */
+static int use_joker_skip(Session *session, int client_id) {
+    SessionPlayer *player = find_session_player(session, client_id);
+    if (session->phase != PHASE_QUESTION || !player || player->joker_skip_used || player->has_answered) {
+        return -1;
+    }
+    
+    player->joker_skip_used = true;
+    player->has_answered = true;
+    player->used_skip_this_question = true;
+    session->awaiting_answers--;
+    player->current_answer = -2; // Special value for skipped
+    
+    return 0;
+}
+
+/**
+ * @brief Settings of a waiting session, copied for the sessions list
+ */
+typedef struct {
+    int id;                        /**< Session identifier */
+    char name[64];                 /**< Display name */
+    int theme_ids[MAX_THEMES];     /**< Selected theme IDs */
+    int num_themes;                /**< Number of themes selected */
+    Difficulty difficulty;         /**< Difficulty level */
+    int num_questions;             /**< Questions in the game */
+    int time_limit;                /**< Time limit per question (seconds) */
+    GameMode mode;                 /**< Game mode */
+    int num_players;               /**< Players at the time of the copy */
+    int max_players;               /**< Maximum players allowed */
+} SessionListing;
+
+/**
+ * Encodes the sessions/list response with every waiting session.
+ * The listed settings are copied under sessions_mutex, which keeps them
+ * stable, and encoded after it is released; status and player counts are
+ * read as the actors last stored them.
+ * @param state Server state containing all sessions
+ * @return Encoded message with one reference, NULL on allocation failure
+ */
+MsgBuf* encode_sessions_list(ServerState *state) {
+    pthread_mutex_lock(&state->sessions_mutex);
+    
+    int count = 0;
+    for (int i = 0; i < state->sessions.count; i++) {
+        Session *s = pool_get(&state->sessions, i);
+        if (s->id > 0 && __atomic_load_n(&s->status, __ATOMIC_RELAXED) == SESSION_WAITING) {
+            count++;
+        }
+    }
+    
+    SessionListing *listings = malloc((size_t)(count > 0 ? count : 1) * sizeof(SessionListing));
+    if (!listings) {
+        pthread_mutex_unlock(&state->sessions_mutex);
+        return NULL;
+    }
+    
+    int num_listings = 0;
+    for (int i = 0; i < state->sessions.count && num_listings < count; i++) {
+        Session *s = pool_get(&state->sessions, i);
+        if (s->id == 0 || __atomic_load_n(&s->status, __ATOMIC_RELAXED) != SESSION_WAITING) continue;
+        
+        SessionListing *l = &listings[num_listings++];
+        l->id = s->id;
+        memcpy(l->name, s->name, sizeof(l->name));
+        memcpy(l->theme_ids, s->theme_ids, sizeof(l->theme_ids));
+        l->num_themes = s->num_themes;
+        l->difficulty = s->difficulty;
+        l->num_questions = s->num_questions;
+        l->time_limit = s->time_limit;
+        l->mode = s->mode;
+        l->num_players = __atomic_load_n(&s->roster.count, __ATOMIC_RELAXED);
+        l->max_players = s->max_players;
+    }
+    
+    pthread_mutex_unlock(&state->sessions_mutex);
+    
+    JsonWriter w;
+    jsonw_init(&w, 128 + (size_t)num_listings * 384);
+    jsonw_object_begin(&w);
+    jsonw_field_string(&w, "action", "sessions/list");
+    jsonw_field_string(&w, "statut", "200");
+    jsonw_field_string(&w, "message", "ok");
+    jsonw_field_int(&w, "nbSessions", num_listings);
+    
+    if (num_listings > 0) {
+        jsonw_key(&w, "sessions");
+        jsonw_array_begin(&w);
+        
+        for (int i = 0; i < num_listings; i++) {
+            const SessionListing *l = &listings[i];
+            
+            jsonw_object_begin(&w);
+            jsonw_field_int(&w, "id", l->id);
+            jsonw_field_string(&w, "name", l->name);
+            
+            jsonw_key(&w, "themeIds");
+            jsonw_array_begin(&w);
+            for (int t = 0; t < l->num_themes; t++) {
+                jsonw_int(&w, l->theme_ids[t]);
+            }
+            jsonw_array_end(&w);
+            
+            jsonw_key(&w, "themeNames");
+            jsonw_array_begin(&w);
+            for (int t = 0; t < l->num_themes; t++) {
+                const char *theme_name = qbank_theme_name(&state->bank, l->theme_ids[t]);
+                if (theme_name) {
+                    jsonw_string(&w, theme_name);
+                }
+            }
+            jsonw_array_end(&w);
+            
+            jsonw_field_string(&w, "difficulty", difficulty_to_string(l->difficulty));
+            jsonw_field_int(&w, "nbQuestions", l->num_questions);
+            jsonw_field_int(&w, "timeLimit", l->time_limit);
+            jsonw_field_string(&w, "mode", mode_to_string(l->mode));
+            jsonw_field_int(&w, "nbPlayers", l->num_players);
+            jsonw_field_int(&w, "maxPlayers", l->max_players);
+            jsonw_field_string(&w, "status", "waiting");
+            jsonw_object_end(&w);
+        }
+        jsonw_array_end(&w);
+    }
+    jsonw_object_end(&w);
+    free(listings);
+    
+    return jsonw_finish(&w);
+}
+
+/**
+ * Creates JSON response for a successful session join.
+ * Includes session info and joker availability; the player list follows
+ * as session/roster pages at the next roster flush.
+ * @param session The joined session
+ * @param client_id Client who joined
+ * @return cJSON object with session details and player list
+ */
+static cJSON* create_session_join_response(Session *session, int client_id) {
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "action", "session/join");
+    cJSON_AddStringToObject(response, "statut", "201");
+    cJSON_AddStringToObject(response, "message", "session joined");
+    cJSON_AddNumberToObject(response, "sessionId", session->id);
+    cJSON_AddStringToObject(response, "mode", mode_to_string(session->mode));
+    cJSON_AddBoolToObject(response, "isCreator", session->creator_client_id == client_id);
+    
+    cJSON_AddNumberToObject(response, "nbPlayers", session->roster.count);
+    
+    if (session->mode == MODE_BATTLE) {
+        cJSON_AddNumberToObject(response, "lives", session->initial_lives);
+    }
+    
+    cJSON *jokers = cJSON_AddObjectToObject(response, "jokers");
+    cJSON_AddNumberToObject(jokers, "fifty", 1);
+    cJSON_AddNumberToObject(jokers, "skip", 1);
+    
+    return response;
+}
+
+/**
+ * Handles a join request and replies with the session details or an error.
+ * @param state Server state for sending messages
+ * @param session Session to join
+ * @param msg SESSION_MSG_JOIN message
+ */
+static void receive_join(ServerState *state, Session *session, const SessionMsg *msg) {
+    int result = join_session(state, session, msg->client_id, msg->data.pseudo);
+    
+    if (result == -2) {
+        reply_error(state, msg, "session/join", "403", "session is full");
+    } else if (result == -4) {
+        // Nobody left to reply to
+    } else if (result != 0) {
+        reply_error(state, msg, "session/join", "400", "cannot join session");
+    } else {
+        log_msg("SESSION", "'%s' joined session %d", msg->data.pseudo, session->id);
+        cJSON *response = create_session_join_response(session, msg->client_id);
+        reply_json(state, msg, response);
+        cJSON_Delete(response);
+    }
+}
+
+/**
+ * Handles a start request from the session creator.
+ * Only errors are replied: success is announced by session/started.
+ * @param state Server state for sending messages
+ * @param session Session to start
+ * @param msg SESSION_MSG_START message
+ */
+static void receive_start(ServerState *state, Session *session, const SessionMsg *msg) {
+    if (session->creator_client_id != msg->client_id) {
+        log_warn("SESSION", "start_session() FAILED - not creator (creator=%d, requester=%d)",
+                session->creator_client_id, msg->client_id);
+        reply_error(state, msg, "session/start", "403", "only creator can start session");
+        return;
+    }
+    
+    int result = start_session(state, session);
+    if (result == -1) {
+        reply_error(state, msg, "session/start", "400", "need at least 2 players");
+    } else if (result < 0) {
+        reply_error(state, msg, "session/start", "400", "session already started");
+    }
+}
+
+/**
+ * Handles an answer and acknowledges it.
+ * @param state Server state for sending messages
+ * @param session Session the answer is for
+ * @param msg SESSION_MSG_ANSWER message
+ */
+static void receive_answer(ServerState *state, Session *session, const SessionMsg *msg) {
+    if (session->status != SESSION_PLAYING) {
+        log_warn("SESSION", "process_answer() FAILED - session %d not playing", session->id);
+        reply_error(state, msg, "question/answer", "400", "session not playing");
+        return;
+    }
+    // No question on screen yet (countdown) or already closed (results)
+    if (session->phase != PHASE_QUESTION) {
+        reply_error(state, msg, "question/answer", "400", "no question open");
+        return;
+    }
+    
+    process_answer(state, session, msg->client_id, msg->data.answer.index, msg->data.answer.text,
+                   msg->data.answer.value, msg->data.answer.response_time);
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "action", "question/answer");
+    cJSON_AddStringToObject(response, "statut", "200");
+    cJSON_AddStringToObject(response, "message", "answer received");
+    reply_json(state, msg, response);
+    cJSON_Delete(response);
+}
+
+/**
+ * Handles a joker use and replies with the jokers left (and the remaining
+ * answers for 50/50).
+ * @param state Server state for the current question
+ * @param session Session the joker is used in
+ * @param msg SESSION_MSG_JOKER message
+ */
+static void receive_joker(ServerState *state, Session *session, const SessionMsg *msg) {
+    if (session->status != SESSION_PLAYING) {
+        log_warn("SESSION", "use_joker() FAILED - session %d not playing", session->id);
+        reply_error(state, msg, "joker/use", "400", "session not playing");
+        return;
+    }
+    if (session->phase != PHASE_QUESTION) {
+        reply_error(state, msg, "joker/use", "400", "no question open");
+        return;
+    }
+    
+    SessionPlayer *player = find_session_player(session, msg->client_id);
+    if (!player) {
+        log_warn("SESSION", "use_joker() FAILED - player not found in session");
+        reply_error(state, msg, "joker/use", "400", "player not found");
+        return;
+    }
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "action", "joker/use");
+    
+    if (msg->data.joker == JOKER_FIFTY) {
+        int removed[2];
+        if (use_joker_fifty(state, session, msg->client_id, removed) == 0) {
+            cJSON_AddStringToObject(response, "statut", "200");
+            cJSON_AddStringToObject(response, "message", "joker activated");
+            
+            // Get remaining answers
+            const Question *q = get_current_question(state, session);
+            
+            if (q) {
+                cJSON *remaining = cJSON_AddArrayToObject(response, "remainingAnswers");
+                for (int i = 0; i < 4; i++) {
+                    if (i != removed[0] && i != removed[1]) {
+                        cJSON_AddItemToArray(remaining, cJSON_CreateString(qbank_string(&state->bank, q->answers[i])));
+                    }
+                }
+            }
+            
+            cJSON *jokers = cJSON_AddObjectToObject(response, "jokers");
+            cJSON_AddNumberToObject(jokers, "fifty", 0);
+            cJSON_AddNumberToObject(jokers, "skip", player->joker_skip_used ? 0 : 1);
+        } else {
+            cJSON_AddStringToObject(response, "statut", "400");
+            cJSON_AddStringToObject(response, "message", "joker not available");
+        }
+    } else {
+        if (use_joker_skip(session, msg->client_id) == 0) {
+            cJSON_AddStringToObject(response, "statut", "200");
+            cJSON_AddStringToObject(response, "message", "question skipped");
+            
+            cJSON *jokers = cJSON_AddObjectToObject(response, "jokers");
+            cJSON_AddNumberToObject(jokers, "fifty", player->joker_fifty_used ? 0 : 1);
+            cJSON_AddNumberToObject(jokers, "skip", 0);
+        } else {
+            cJSON_AddStringToObject(response, "statut", "400");
+            cJSON_AddStringToObject(response, "message", "joker not available");
+        }
+    }
+    
+    reply_json(state, msg, response);
+    cJSON_Delete(response);
+}
+
+/**
+ * Handles a phase deadline, unless the phase it was armed for is over.
+ * @param state Server state for sending messages
+ * @param session Session whose deadline fired
+ * @param phase_seq Phase the deadline was armed for
+ */
+static void receive_deadline(ServerState *state, Session *session, unsigned int phase_seq) {
+    if (phase_seq != session->phase_seq || session->status != SESSION_PLAYING) return;
+    
+    switch (session->phase) {
+        case PHASE_COUNTDOWN:
+            log_msg("SESSION", "Session %d countdown elapsed, sending first question", session->id);
+            send_question_to_all(state, session);
+            break;
+        case PHASE_QUESTION:
+            check_question_timeout(state, session);
+            break;
+        case PHASE_RESULTS:
+            advance_to_next_question(state, session);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Session actor handler: applies one message to the session.
+ * @param context Server state
+ * @param actor Actor embedded in the session
+ * @param header SessionMsg, freed by the pool
+ */
+static void session_receive(void *context, Actor *actor, ActorMsg *header) {
+    ServerState *state = (ServerState*)context;
+    Session *session = (Session*)((char*)actor - offsetof(Session, actor));
+    const SessionMsg *msg = (const SessionMsg*)header;
+    
+    // Messages built on the worker use its scratch arena, like requests
+    cJSON_Arena *previous = json_scratch_begin();
+    switch (msg->type) {
+        case SESSION_MSG_JOIN:
+            receive_join(state, session, msg);
+            break;
+        case SESSION_MSG_LEAVE:
+            leave_session(state, session, msg->client_id);
+            break;
+        case SESSION_MSG_START:
+            receive_start(state, session, msg);
+            break;
+        case SESSION_MSG_ANSWER:
+            receive_answer(state, session, msg);
+            break;
+        case SESSION_MSG_JOKER:
+            receive_joker(state, session, msg);
+            break;
+        case SESSION_MSG_DEADLINE:
+            receive_deadline(state, session, msg->data.phase_seq);
+            break;
+        case SESSION_MSG_ROSTER:
+            if (session->status != SESSION_FINISHED) {
+                flush_roster(state, session);
+            }
+            break;
+    }
+    json_scratch_end(previous);
+    
+    if (msg->received_ms > 0) {
+        metrics_observe_endpoint(msg->endpoint, get_current_time_ms() - msg->received_ms);
+    }
+}
@@ -0,0 +1,311 @@
+#include "timer.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define TIMER_SLOT_MASK (TIMER_SLOTS - 1)
+#define TIMER_CHUNK_NODES 64
+
+struct TimerChunk {
+    struct TimerChunk *next;
+    TimerNode nodes[TIMER_CHUNK_NODES];
+};
+
+/**
+ * Monotonic clock in milliseconds, immune to wall-clock adjustments.
+ * @return Milliseconds since an arbitrary fixed point
+ */
+static double monotonic_ms(void) {
+#ifdef _WIN32
+    return get_current_time_ms();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+#endif
+}
+
+/**
+ * Takes a node from the free list, allocating a new chunk when empty.
+ * Nodes are never returned to malloc so stale handles stay safe to inspect.
+ * Caller must hold the wheel mutex.
+ * @param wheel Timer wheel
+ * @return Free node, NULL on allocation failure
+ */
+static TimerNode* alloc_node(TimerWheel *wheel) {
+    if (!wheel->free_list) {
+        TimerChunk *chunk = calloc(1, sizeof(TimerChunk));
+        if (!chunk) return NULL;
+        chunk->next = wheel->chunks;
+        wheel->chunks = chunk;
+        for (int i = 0; i < TIMER_CHUNK_NODES; i++) {
+            chunk->nodes[i].next = wheel->free_list;
+            wheel->free_list = &chunk->nodes[i];
+        }
+    }
+
+    TimerNode *node = wheel->free_list;
+    wheel->free_list = node->next;
+    node->next = NULL;
+    node->prev = NULL;
+    return node;
+}
+
+/**
+ * Links a node into the slot matching its expiry relative to the current tick.
+ * Caller must hold the wheel mutex.
+ * @param wheel Timer wheel
+ * @param node Node with expires set
+ */
+static void insert_node(TimerWheel *wheel, TimerNode *node) {
+    uint64_t delta = node->expires > wheel->current_tick ? node->expires - wheel->current_tick : 0;
+    uint64_t expires = node->expires < wheel->current_tick ? wheel->current_tick : node->expires;
+    int level = 0;
+
+    while (level < TIMER_LEVELS - 1 && delta >= ((uint64_t)1 << (TIMER_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+
+    int slot = (int)((expires >> (TIMER_SLOT_BITS * level)) & TIMER_SLOT_MASK);
+
+    node->level = level;
+    node->slot = slot;
+    node->pending = true;
+    node->prev = NULL;
+    node->next = wheel->slots[level][slot];
+    if (node->next) node->next->prev = node;
+    wheel->slots[level][slot] = node;
+}
+
+/**
+ * Unlinks a pending node from its slot list.
+ * Caller must hold the wheel mutex.
+ * @param wheel Timer wheel
+ * @param node Pending node
+ */
+static void unlink_node(TimerWheel *wheel, TimerNode *node) {
+    if (node->prev) node->prev->next = node->next;
+    else wheel->slots[node->level][node->slot] = node->next;
+    if (node->next) node->next->prev = node->prev;
+    node->next = NULL;
+    node->prev = NULL;
+    node->pending = false;
+}
+
+/**
+ * Moves every node of a higher-level slot down to its precise slot.
+ * Caller must hold the wheel mutex.
+ * @param wheel Timer wheel
+ * @param level Level to cascade from (>= 1)
+ * @param slot Slot to empty
+ */
+static void cascade(TimerWheel *wheel, int level, int slot) {
+    TimerNode *node = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+
+    while (node) {
+        TimerNode *next = node->next;
+        insert_node(wheel, node);
+        node = next;
+    }
+}
+
+/**
+ * Processes one tick: cascades higher levels when level 0 wraps, then
+ * fires every timer of the current slot. Callbacks run without the lock
+ * so they may schedule or cancel timers themselves.
+ * @param wheel Timer wheel
+ */
+static void process_tick(TimerWheel *wheel) {
+    pthread_mutex_lock(&wheel->mutex);
+
+    uint64_t tick = wheel->current_tick;
+    int index = (int)(tick & TIMER_SLOT_MASK);
+
+    for (int level = 1; level < TIMER_LEVELS && index == 0; level++) {
+        index = (int)((tick >> (TIMER_SLOT_BITS * level)) & TIMER_SLOT_MASK);
+        cascade(wheel, level, index);
+    }
+
+    index = (int)(tick & TIMER_SLOT_MASK);
+    TimerNode *expired = wheel->slots[0][index];
+    wheel->slots[0][index] = NULL;
+
+    for (TimerNode *node = expired; node; node = node->next) {
+        node->pending = false;
+        node->generation++;
+    }
+
+    wheel->current_tick++;
+    pthread_mutex_unlock(&wheel->mutex);
+
+    if (!expired) return;
+
+    TimerNode *last = NULL;
+    for (TimerNode *node = expired; node; node = node->next) {
+        node->callback(wheel->context, node->arg, node->tag);
+        last = node;
+    }
+
+    pthread_mutex_lock(&wheel->mutex);
+    last->next = wheel->free_list;
+    wheel->free_list = expired;
+    pthread_mutex_unlock(&wheel->mutex);
+}
+
+/**
+ * Timer thread: catches the wheel up with the monotonic clock every tick.
+ * @param arg Pointer to the TimerWheel
+ * @return NULL when the wheel is stopped
+ */
+static void* timer_thread(void *arg) {
+    TimerWheel *wheel = (TimerWheel*)arg;
+    log_msg("TIMER", "Timer thread started (tick=%dms)", TIMER_TICK_MS);
+
+    while (wheel->running) {
+        uint64_t target = (uint64_t)((monotonic_ms() - wheel->start_ms) / TIMER_TICK_MS);
+
+        while (wheel->running && wheel->current_tick <= target) {
+            process_tick(wheel);
+        }
+
+#ifdef _WIN32
+        Sleep(TIMER_TICK_MS);
+#else
+        usleep(TIMER_TICK_MS * 1000);
+#endif
+    }
+
+    log_msg("TIMER", "Timer thread stopped");
+    return NULL;
+}
+
+/**
+ * Initializes an empty timer wheel.
+ * @param wheel Wheel to initialize
+ * @param context Value passed as first argument to every callback
+ * @return 0 on success
+ */
+int timer_wheel_init(TimerWheel *wheel, void *context) {
+    memset(wheel, 0, sizeof(TimerWheel));
+    pthread_mutex_init(&wheel->mutex, NULL);
+    wheel->context = context;
+    wheel->start_ms = monotonic_ms();
+    return 0;
+}
+
+/**
+ * Starts the thread driving the wheel.
+ * @param wheel Initialized wheel
+ * @return 0 on success, -1 if the thread could not be created
+ */
+int timer_wheel_start(TimerWheel *wheel) {
+    wheel->running = true;
+    if (pthread_create(&wheel->thread, NULL, timer_thread, wheel) != 0) {
+        wheel->running = false;
+        log_error("TIMER", "ERROR - cannot create timer thread");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Stops the wheel thread; pending timers are discarded without firing.
+ * @param wheel Running wheel
+ */
+void timer_wheel_stop(TimerWheel *wheel) {
+    if (!wheel->running) return;
+    wheel->running = false;
+    pthread_join(wheel->thread, NULL);
+}
+
+/**
+ * Releases every node allocation. The wheel must be stopped.
+ * @param wheel Wheel to destroy
+ */
+void timer_wheel_destroy(TimerWheel *wheel) {
+    TimerChunk *chunk = wheel->chunks;
+    while (chunk) {
+        TimerChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    wheel->chunks = NULL;
+    wheel->free_list = NULL;
+    pthread_mutex_destroy(&wheel->mutex);
+}
+
+/**
+ * Schedules a callback to run once after the given delay.
+ * The delay is rounded up to the next tick.
+ * @param wheel Timer wheel
+ * @param delay_ms Delay in milliseconds
+ * @param callback Function to call on expiry (from the timer thread)
+ * @param arg Callback argument
+ * @param tag Callback integer tag
+ * @return Handle usable with timer_cancel, node is NULL on failure
+ */
+TimerHandle timer_schedule(TimerWheel *wheel, int delay_ms, TimerCallback callback, void *arg, int tag) {
+    TimerHandle handle = { NULL, 0 };
+    if (delay_ms < 0) delay_ms = 0;
+
+    pthread_mutex_lock(&wheel->mutex);
+
+    TimerNode *node = alloc_node(wheel);
+    if (!node) {
+        pthread_mutex_unlock(&wheel->mutex);
+        log_error("TIMER", "ERROR - cannot allocate timer node");
+        return handle;
+    }
+
+    uint64_t now_tick = (uint64_t)((monotonic_ms() - wheel->start_ms) / TIMER_TICK_MS);
+    if (now_tick < wheel->current_tick) now_tick = wheel->current_tick;
+
+    node->expires = now_tick + (uint64_t)((delay_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS);
+    node->callback = callback;
+    node->arg = arg;
+    node->tag = tag;
+    insert_node(wheel, node);
+
+    handle.node = node;
+    handle.generation = node->generation;
+
+    pthread_mutex_unlock(&wheel->mutex);
+    return handle;
+}
+
+/**
+ * Cancels a scheduled timer. Safe to call with a handle that already
+ * fired or was cancelled; the handle is cleared either way.
+ * @param wheel Timer wheel
+ * @param handle Handle returned by timer_schedule
+ * @return true if the timer was pending and will not fire
+ */
+bool timer_cancel(TimerWheel *wheel, TimerHandle *handle) {
+    bool cancelled = false;
+    if (!handle->node) return false;
+
+    pthread_mutex_lock(&wheel->mutex);
+
+    TimerNode *node = handle->node;
+    if (node->pending && node->generation == handle->generation) {
+        unlink_node(wheel, node);
+        node->generation++;
+        node->next = wheel->free_list;
+        wheel->free_list = node;
+        cancelled = true;
+    }
+
+    pthread_mutex_unlock(&wheel->mutex);
+
+    handle->node = NULL;
+    return cancelled;
+}
@@ -0,0 +1,159 @@
+#include "trace.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// Bodies are logged in parts that fit one message next to the client id
+// and part numbers; a short body stays on the request's own line
+#define TRACE_INLINE_LEN (LOG_ARGS_SIZE - 96)
+#define TRACE_CHUNK_LEN (LOG_ARGS_SIZE - 48)
+#define TRACE_MAX_PARTS 32             /**< Longer bodies are cut, the ring would drop them anyway */
+
+/**
+ * Initializes tracing with everything off.
+ * @param trace Trace configuration to initialize
+ */
+void trace_init(TraceConfig *trace) {
+    memset(trace, 0, sizeof(TraceConfig));
+    pthread_mutex_init(&trace->mutex, NULL);
+}
+
+/**
+ * Releases the trace configuration.
+ * @param trace Trace configuration
+ */
+void trace_destroy(TraceConfig *trace) {
+    pthread_mutex_destroy(&trace->mutex);
+}
+
+/**
+ * Sets the sampling rate.
+ * @param trace Trace configuration
+ * @param sample_rate Trace 1 request in sample_rate, 0 to disable sampling
+ */
+void trace_set_sample_rate(TraceConfig *trace, int sample_rate) {
+    __atomic_store_n(&trace->sample_rate, sample_rate > 0 ? sample_rate : 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * Turns tracing on or off for every request to an endpoint.
+ * @param trace Trace configuration
+ * @param endpoint Endpoint path (e.g. "question/answer")
+ * @param enabled Whether requests to the endpoint are traced
+ * @return 0 on success, -1 if the endpoint list is full or the name too long
+ */
+int trace_set_endpoint(TraceConfig *trace, const char *endpoint, bool enabled) {
+    if (strlen(endpoint) >= TRACE_ENDPOINT_LEN) return -1;
+    
+    pthread_mutex_lock(&trace->mutex);
+    int count = trace->num_endpoints;
+    int found = -1;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(trace->endpoints[i], endpoint) == 0) found = i;
+    }
+    
+    int result = 0;
+    if (enabled && found < 0) {
+        if (count < TRACE_MAX_ENDPOINTS) {
+            strcpy(trace->endpoints[count++], endpoint);
+        } else {
+            result = -1;
+        }
+    } else if (!enabled && found >= 0) {
+        strcpy(trace->endpoints[found], trace->endpoints[--count]);
+    }
+    __atomic_store_n(&trace->num_endpoints, count, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&trace->mutex);
+    return result;
+}
+
+/**
+ * Decides whether a request is traced. Cheap when tracing is off: no lock,
+ * no serialization, a single atomic increment only while sampling.
+ * @param trace Trace configuration
+ * @param client_traced Whether tracing is on for the requesting client
+ * @param endpoint Requested endpoint
+ * @return true if the request body should be dumped
+ */
+bool trace_wanted(TraceConfig *trace, bool client_traced, const char *endpoint) {
+    if (LOG_LEVEL_INFO < LOG_COMPILE_LEVEL || LOG_LEVEL_INFO < log_runtime_level) {
+        return false;
+    }
+    if (client_traced) return true;
+    
+    if (__atomic_load_n(&trace->num_endpoints, __ATOMIC_ACQUIRE) > 0) {
+        bool listed = false;
+        pthread_mutex_lock(&trace->mutex);
+        for (int i = 0; i < trace->num_endpoints && !listed; i++) {
+            listed = strcmp(trace->endpoints[i], endpoint) == 0;
+        }
+        pthread_mutex_unlock(&trace->mutex);
+        if (listed) return true;
+    }
+    
+    int rate = __atomic_load_n(&trace->sample_rate, __ATOMIC_RELAXED);
+    return rate > 0 &&
+           __atomic_fetch_add(&trace->sample_counter, 1, __ATOMIC_RELAXED) % (unsigned long)rate == 0;
+}
+
+/**
+ * Masks top-level password fields in place so they never reach the log.
+ * The request has already been handled when this runs.
+ * @param body Parsed request body
+ */
+static void mask_passwords(cJSON *body) {
+    cJSON *item;
+    cJSON_ArrayForEach(item, body) {
+        if (item->string && strcasecmp(item->string, "password") == 0 &&
+            cJSON_IsString(item) && item->valuestring[0]) {
+            size_t len = strlen(item->valuestring);
+            size_t stars = len < 3 ? len : 3;
+            memset(item->valuestring, '*', stars);
+            item->valuestring[stars] = '\0';
+        }
+    }
+}
+
+/**
+ * Dumps a handled request to the log. A body too long for one log message
+ * follows the request line as numbered parts ("client N body i/n ..."),
+ * which appear in order since they come from the same thread.
+ * @param client_id Requesting client
+ * @param method Request method
+ * @param endpoint Request endpoint
+ * @param body Parsed body, NULL if the request had none (modified: passwords masked)
+ * @param elapsed_ms Time spent in the handler
+ */
+void trace_request(int client_id, const char *method, const char *endpoint,
+                   cJSON *body, double elapsed_ms) {
+    char *text = NULL;
+    if (body) {
+        mask_passwords(body);
+        text = cJSON_PrintUnformatted(body);
+    }
+    size_t len = text ? strlen(text) : 0;
+    if (len <= TRACE_INLINE_LEN) {
+        log_msg("TRACE", "client %d %s %s (%.3f ms) %s", client_id, method, endpoint,
+                elapsed_ms, text ? text : "-");
+        free(text);
+        return;
+    }
+    
+    int parts = (int)((len + TRACE_CHUNK_LEN - 1) / TRACE_CHUNK_LEN);
+    bool cut = parts > TRACE_MAX_PARTS;
+    if (cut) parts = TRACE_MAX_PARTS;
+    log_msg("TRACE", "client %d %s %s (%.3f ms) body of %lu bytes in %d parts%s", client_id,
+            method, endpoint, elapsed_ms, (unsigned long)len, parts, cut ? " (cut)" : "");
+    
+    char chunk[TRACE_CHUNK_LEN + 1];
+    for (int i = 0; i < parts; i++) {
+        size_t offset = (size_t)i * TRACE_CHUNK_LEN;
+        size_t n = len - offset < TRACE_CHUNK_LEN ? len - offset : TRACE_CHUNK_LEN;
+        memcpy(chunk, text + offset, n);
+        chunk[n] = '\0';
+        log_msg("TRACE", "client %d body %d/%d %s", client_id, i + 1, parts, chunk);
+    }
+    free(text);
+}
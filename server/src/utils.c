@@ -27,33 +27,6 @@
 
 #include <stdarg.h>
 
-/**
- * Logs a message with a tag and timestamp
- */
-void log_msg(const char* tag, const char* format, ...) {
-#ifdef _WIN32
-  SYSTEMTIME st;
-  GetLocalTime(&st);
-  printf("%02d:%02d:%02d.%03d [%s] ", st.wHour, st.wMinute, st.wSecond,
-         st.wMilliseconds, tag);
-#else
-  struct timeval tv;
-  struct tm* tm_info;
-  gettimeofday(&tv, NULL);
-  tm_info = localtime(&tv.tv_sec);
-  printf("%02d:%02d:%02d.%03d [%s] ", tm_info->tm_hour, tm_info->tm_min,
-         tm_info->tm_sec, (int)(tv.tv_usec / 1000), tag);
-#endif
-
-  va_list args;
-  va_start(args, format);
-  vprintf(format, args);
-  va_end(args);
-
-  printf("\n");
-  fflush(stdout);
-}
-
 /**
  * Lowercasing a string
  */
@@ -216,9 +189,11 @@ void trim_whitespace(char* str) {
 }
 
 /**
- * Generates a simple hash of the input string
+ * Unsalted djb2 digest stored by the first account files, formatted as
+ * 64 hex digits. Only kept to verify those accounts until they are
+ * rehashed (see passhash.c); never use it for new hashes.
  */
-void sha256_hash(const char* input, char* output) {
+void legacy_password_hash(const char* input, char* output) {
   unsigned long hash = 5381;
   int c;
   const char* str = input;
@@ -245,6 +220,29 @@ void init_random(void) {
 #endif
 }
 
+/**
+ * Fills a buffer from the operating system's cryptographic generator
+ *
+ * @return 0 on success, -1 if the generator is unavailable
+ */
+int random_bytes(void* buffer, size_t len) {
+  unsigned char* out = buffer;
+#ifdef _WIN32
+  for (size_t i = 0; i < len; i++) {
+    unsigned int val;
+    if (rand_s(&val) != 0) return -1;
+    out[i] = (unsigned char)val;
+  }
+  return 0;
+#else
+  FILE* urandom = fopen("/dev/urandom", "rb");
+  if (!urandom) return -1;
+  size_t got = fread(out, 1, len, urandom);
+  fclose(urandom);
+  return got == len ? 0 : -1;
+#endif
+}
+
 /**
  * Generates a secure random integer
  *
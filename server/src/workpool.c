@@ -0,0 +1,147 @@
+#include "workpool.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Prepares an empty pool; no thread runs before workpool_start.
+ * @param pool Pool to initialize
+ * @param name Log tag (static string)
+ * @param context Passed to every job
+ * @param capacity Jobs that can wait at once
+ * @return 0 on success, -1 on allocation failure
+ */
+int workpool_init(WorkPool *pool, const char *name, void *context, int capacity) {
+    memset(pool, 0, sizeof(WorkPool));
+    pool->name = name;
+    pool->context = context;
+    pool->capacity = capacity > 0 ? capacity : 1;
+    pool->queue = calloc(pool->capacity, sizeof(WorkItem));
+    if (!pool->queue) return -1;
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->ready, NULL);
+    return 0;
+}
+
+/**
+ * Worker loop: runs queued jobs in FIFO order until the pool stops.
+ * @param arg Pointer to the WorkPool
+ * @return NULL when the pool stops
+ */
+static void* workpool_thread(void *arg) {
+    WorkPool *pool = (WorkPool*)arg;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->running) {
+        if (pool->count == 0) {
+            pthread_cond_wait(&pool->ready, &pool->mutex);
+            continue;
+        }
+
+        WorkItem item = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+        pthread_mutex_unlock(&pool->mutex);
+
+        item.fn(pool->context, item.arg);
+        free(item.arg);
+
+        pthread_mutex_lock(&pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+/**
+ * Starts the worker threads.
+ * @param pool Initialized pool
+ * @param num_threads Number of workers (at least 1)
+ * @return 0 on success, -1 if no worker could be started
+ */
+int workpool_start(WorkPool *pool, int num_threads) {
+    if (num_threads < 1) num_threads = 1;
+    pool->threads = calloc(num_threads, sizeof(pthread_t));
+    if (!pool->threads) return -1;
+
+    pool->running = true;
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, workpool_thread, pool) != 0) break;
+        pool->num_threads++;
+    }
+    if (pool->num_threads == 0) {
+        pool->running = false;
+        return -1;
+    }
+
+    log_msg(pool->name, "Worker pool started (%d thread(s), queue of %d)",
+           pool->num_threads, pool->capacity);
+    return 0;
+}
+
+/**
+ * Queues a job. The pool owns arg from now on and frees it after the job
+ * ran, or at shutdown if it never did.
+ * @param pool Running pool
+ * @param fn Job function, called on a worker thread
+ * @param arg malloc'ed job data
+ * @return 0 if queued, -1 if the queue is full or the pool stopped (arg is
+ *         left to the caller)
+ */
+int workpool_submit(WorkPool *pool, WorkFn fn, void *arg) {
+    pthread_mutex_lock(&pool->mutex);
+    if (!pool->running || pool->count == pool->capacity) {
+        pthread_mutex_unlock(&pool->mutex);
+        return -1;
+    }
+
+    int tail = (pool->head + pool->count) % pool->capacity;
+    pool->queue[tail].fn = fn;
+    pool->queue[tail].arg = arg;
+    pool->count++;
+    pthread_cond_signal(&pool->ready);
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+/**
+ * Stops the workers after their current job and joins them.
+ * Jobs still queued are dropped.
+ * @param pool Pool to stop
+ */
+void workpool_stop(WorkPool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    bool was_running = pool->running;
+    pool->running = false;
+    pthread_cond_broadcast(&pool->ready);
+    pthread_mutex_unlock(&pool->mutex);
+    if (!was_running) return;
+
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pool->num_threads = 0;
+
+    if (pool->count > 0) {
+        log_warn(pool->name, "Worker pool stopped, %d queued job(s) dropped", pool->count);
+    }
+    while (pool->count > 0) {
+        free(pool->queue[pool->head].arg);
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+    }
+}
+
+/**
+ * Releases a stopped pool.
+ * @param pool Pool to release
+ */
+void workpool_destroy(WorkPool *pool) {
+    workpool_stop(pool);
+    free(pool->threads);
+    free(pool->queue);
+    pool->threads = NULL;
+    pool->queue = NULL;
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->ready);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file endpointgen.c
+ * @brief Endpoint perfect hash generator (build step)
+ *
+ * Finds a seed for which endpoint_hash puts every ENDPOINT_LIST entry in
+ * its own slot and writes the seed and slot table as a header included by
+ * src/endpoints.c. Fails the build when the registry is inconsistent or no
+ * seed is collision-free.
+ *
+ *   endpointgen <endpoint_slots.h>
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "binproto.h"
+#include "endpoints.h"
+
+#define NUM_SLOTS (1 << ENDPOINT_HASH_BITS)
+#define MAX_SEEDS 1000000u
+
+typedef struct {
+  int id;
+  RequestMethod method;
+  const char* path;
+} EndpointKey;
+
+#define ENDPOINT_KEY(id, method, path, handler, flags, rate_class) \
+  { id, METHOD_##method, path },
+
+static const EndpointKey keys[] = {ENDPOINT_LIST(ENDPOINT_KEY)};
+
+static int check_ids(void) {
+  for (int i = 0; i < NUM_ENDPOINTS; i++) {
+    if (keys[i].id <= 0 || keys[i].id >= BINPROTO_FIRST_PUSH_ID) {
+      fprintf(stderr, "endpointgen: %s has id %d, must be in 1..%d\n",
+              keys[i].path, keys[i].id, BINPROTO_FIRST_PUSH_ID - 1);
+      return -1;
+    }
+    for (int j = 0; j < i; j++) {
+      if (keys[j].id == keys[i].id) {
+        fprintf(stderr, "endpointgen: %s and %s share id %d\n", keys[j].path,
+                keys[i].path, keys[i].id);
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+static int build_slots(uint32_t seed, int slots[NUM_SLOTS]) {
+  memset(slots, 0, sizeof(int) * NUM_SLOTS);
+  for (int i = 0; i < NUM_ENDPOINTS; i++) {
+    uint32_t slot = endpoint_hash(seed, keys[i].method, keys[i].path);
+    if (slots[slot]) return -1;
+    slots[slot] = i + 1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    printf("Usage: %s <endpoint_slots.h>\n", argv[0]);
+    return 2;
+  }
+  if (NUM_ENDPOINTS * 2 > NUM_SLOTS) {
+    fprintf(stderr, "endpointgen: %d endpoints need more than %d slots, raise ENDPOINT_HASH_BITS\n",
+            NUM_ENDPOINTS, NUM_SLOTS);
+    return 1;
+  }
+  if (check_ids() < 0) return 1;
+
+  int slots[NUM_SLOTS];
+  uint32_t seed = 0;
+  while (seed < MAX_SEEDS && build_slots(seed, slots) < 0) seed++;
+  if (seed == MAX_SEEDS) {
+    fprintf(stderr, "endpointgen: no collision-free seed below %u, raise ENDPOINT_HASH_BITS\n",
+            MAX_SEEDS);
+    return 1;
+  }
+
+  FILE* out = fopen(argv[1], "w");
+  if (!out) {
+    fprintf(stderr, "endpointgen: cannot create %s\n", argv[1]);
+    return 1;
+  }
+  fprintf(out, "// Generated by tools/endpointgen.c from ENDPOINT_LIST, do not edit.\n");
+  fprintf(out, "#define ENDPOINT_HASH_SEED %uu\n", seed);
+  fprintf(out, "static const int8_t endpoint_slots[%d] = {", NUM_SLOTS);
+  for (int i = 0; i < NUM_SLOTS; i++) {
+    fprintf(out, "%s%d", i % 16 == 0 ? "\n    " : " ", slots[i]);
+    if (i + 1 < NUM_SLOTS) fputc(',', out);
+  }
+  fprintf(out, "\n};\n");
+  if (fclose(out) != 0) {
+    fprintf(stderr, "endpointgen: cannot write %s\n", argv[1]);
+    remove(argv[1]);
+    return 1;
+  }
+  return 0;
+}
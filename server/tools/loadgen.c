@@ -0,0 +1,760 @@
+/**
+ * @file loadgen.c
+ * @brief Headless load generator and latency benchmark
+ *
+ * Simulates groups of players that register, log in, create or join a
+ * session, start it and answer every question after a think time. Reports
+ * throughput and p50/p99/p999 latency per endpoint, plus the broadcast
+ * fan-out delay of question/new (first to last receipt within a session).
+ *
+ *   loadgen [--clients N] [--players P] [--games G] [--think MS] ...
+ *
+ * Exits non-zero if any request failed or a --max-p99 gate was exceeded,
+ * so it can be used as a release check.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET socket_t;
+#define poll WSAPoll
+#define close_socket closesocket
+#define get_pid() ((int)GetCurrentProcessId())
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#define get_pid() ((int)getpid())
+#endif
+
+#include "cJSON.h"
+
+#define INPUT_BUFFER_SIZE 65536
+#define MAX_GROUP_PLAYERS 10
+#define MAX_THEME_IDS 20      /**< Server limit on themes per session */
+
+typedef enum {
+  M_CONNECT,
+  M_REGISTER,
+  M_LOGIN,
+  M_THEMES,
+  M_CREATE,
+  M_JOIN,
+  M_START,
+  M_ANSWER,
+  M_FANOUT,
+  M_COUNT
+} Metric;
+
+typedef struct {
+  const char* name;   /**< Endpoint as shown in the report */
+  const char* method; /**< Request method, NULL for non-request timings */
+  const char* reply;  /**< Action that completes the request */
+} MetricInfo;
+
+// session/start has no direct reply: it completes on the session/started
+// broadcast. Errors always come back with the endpoint as action.
+static const MetricInfo metric_info[M_COUNT] = {
+    {"connect", NULL, NULL},
+    {"player/register", "POST", "player/register"},
+    {"player/login", "POST", "player/login"},
+    {"themes/list", "GET", "themes/list"},
+    {"session/create", "POST", "session/create"},
+    {"session/join", "POST", "session/join"},
+    {"session/start", "POST", "session/started"},
+    {"question/answer", "POST", "question/answer"},
+    {"question/new fan-out", NULL, NULL},
+};
+
+typedef struct {
+  double* samples; /**< Latencies in milliseconds */
+  size_t count;
+  size_t capacity;
+  long errors;
+} Samples;
+
+typedef struct {
+  const char* host;
+  int port;
+  int clients;
+  int players;
+  int games;
+  int questions;
+  int think_ms;
+  int time_limit;
+  const char* difficulty;
+  int timeout_ms;
+  double max_p99_ms;
+  unsigned seed;
+} Options;
+
+typedef struct Group Group;
+
+typedef struct {
+  socket_t sock;
+  Group* group;
+  bool leader;
+  bool live;
+  bool logged_in;
+  bool in_session;
+  char pseudo[32];
+  char* in;
+  size_t in_len;
+  char* out;
+  size_t out_len;
+  size_t out_cap;
+  int pending;         /**< Metric awaited, -1 when idle */
+  double sent_at;      /**< Send time of the pending request */
+  double answer_at;    /**< Scheduled answer time, 0 when none */
+  char question_type[16];
+} Client;
+
+struct Group {
+  Client* members[MAX_GROUP_PLAYERS];
+  int size;
+  int session_id;
+  int joined;
+  int finished;
+  int games_done;
+  bool active;
+  int question_num;
+  int receipts;
+  double first_receipt;
+  char theme_ids[MAX_THEME_IDS * 8];
+};
+
+static Options opts = {"127.0.0.1", 5556, 8, 4, 1, 10, 200, 10, "facile",
+                       15000, 0.0, 0};
+static Samples metrics[M_COUNT];
+static long messages_received;
+static long failed_groups;
+static long games_completed;
+
+static double now_ms(void) {
+#ifdef _WIN32
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+#endif
+}
+
+static void record(Metric metric, double ms) {
+  Samples* s = &metrics[metric];
+  if (s->count == s->capacity) {
+    size_t capacity = s->capacity ? s->capacity * 2 : 256;
+    double* grown = realloc(s->samples, capacity * sizeof(double));
+    if (!grown) return;
+    s->samples = grown;
+    s->capacity = capacity;
+  }
+  s->samples[s->count++] = ms;
+}
+
+static void queue_bytes(Client* c, const char* data, size_t len) {
+  if (c->out_len + len > c->out_cap) {
+    size_t capacity = c->out_cap ? c->out_cap : 1024;
+    while (capacity < c->out_len + len) capacity *= 2;
+    char* grown = realloc(c->out, capacity);
+    if (!grown) return;
+    c->out = grown;
+    c->out_cap = capacity;
+  }
+  memcpy(c->out + c->out_len, data, len);
+  c->out_len += len;
+}
+
+static void flush_output(Client* c) {
+  size_t sent = 0;
+  while (sent < c->out_len) {
+    int n = send(c->sock, c->out + sent, (int)(c->out_len - sent), 0);
+    if (n <= 0) break;
+    sent += (size_t)n;
+  }
+  memmove(c->out, c->out + sent, c->out_len - sent);
+  c->out_len -= sent;
+}
+
+/**
+ * Sends a request and starts its latency measurement.
+ * @param c Client sending the request
+ * @param metric Endpoint being called
+ * @param body JSON body, NULL for none
+ */
+static void send_request(Client* c, Metric metric, const char* body) {
+  char header[64];
+  int len = snprintf(header, sizeof(header), "%s %s\n",
+                     metric_info[metric].method, metric_info[metric].name);
+  queue_bytes(c, header, (size_t)len);
+  if (body) {
+    queue_bytes(c, body, strlen(body));
+    queue_bytes(c, "\n", 1);
+  }
+  c->pending = metric;
+  c->sent_at = now_ms();
+  flush_output(c);
+}
+
+static void send_login(Client* c, Metric metric) {
+  char body[128];
+  snprintf(body, sizeof(body), "{\"pseudo\":\"%s\",\"password\":\"loadgen\"}",
+           c->pseudo);
+  send_request(c, metric, body);
+}
+
+static void send_create(Client* c) {
+  char body[MAX_THEME_IDS * 8 + 256];
+  snprintf(body, sizeof(body),
+           "{\"name\":\"loadgen %s\",\"themeIds\":[%s],\"difficulty\":\"%s\","
+           "\"nbQuestions\":%d,\"timeLimit\":%d,\"mode\":\"solo\","
+           "\"maxPlayers\":%d}",
+           c->pseudo, c->group->theme_ids, opts.difficulty, opts.questions,
+           opts.time_limit, c->group->size);
+  send_request(c, M_CREATE, body);
+}
+
+static void send_join(Client* c) {
+  char body[64];
+  snprintf(body, sizeof(body), "{\"sessionId\":%d}", c->group->session_id);
+  send_request(c, M_JOIN, body);
+}
+
+static void send_answer(Client* c) {
+  const char* answer = strcmp(c->question_type, "boolean") == 0 ? "true"
+                       : strcmp(c->question_type, "qcm") == 0   ? "0"
+                                                                : "\"loadgen\"";
+  char body[128];
+  snprintf(body, sizeof(body), "{\"answer\":%s,\"responseTime\":%.2f}", answer,
+           opts.think_ms / 1000.0);
+  c->answer_at = 0;
+  send_request(c, M_ANSWER, body);
+}
+
+static void close_group(Group* g, bool failed) {
+  if (!g->active) return;
+  g->active = false;
+  if (failed) failed_groups++;
+  for (int i = 0; i < g->size; i++) {
+    Client* c = g->members[i];
+    if (c->live) close_socket(c->sock);
+    c->live = false;
+  }
+}
+
+static void fail_group(Group* g, const char* reason, const Client* c) {
+  if (!g->active) return;
+  fprintf(stderr, "loadgen: group of %s failed: %s\n", g->members[0]->pseudo,
+          reason);
+  if (c && c->pending >= 0) metrics[c->pending].errors++;
+  close_group(g, true);
+}
+
+static void join_waiting_members(Group* g) {
+  for (int i = 0; i < g->size; i++) {
+    Client* c = g->members[i];
+    if (!c->leader && c->logged_in && !c->in_session && c->pending < 0)
+      send_join(c);
+  }
+}
+
+static void start_game(Group* g) {
+  g->session_id = 0;
+  g->joined = 0;
+  g->finished = 0;
+  g->question_num = 0;
+  send_create(g->members[0]);
+}
+
+static void on_themes(Client* c, cJSON* msg) {
+  Group* g = c->group;
+  cJSON* themes = cJSON_GetObjectItem(msg, "themes");
+  size_t len = 0;
+  g->theme_ids[0] = '\0';
+  for (int i = 0; i < cJSON_GetArraySize(themes) && i < MAX_THEME_IDS; i++) {
+    cJSON* id = cJSON_GetObjectItem(cJSON_GetArrayItem(themes, i), "id");
+    if (!cJSON_IsNumber(id)) continue;
+    len += (size_t)snprintf(g->theme_ids + len, sizeof(g->theme_ids) - len,
+                            "%s%d", len ? "," : "", id->valueint);
+  }
+  start_game(g);
+}
+
+/**
+ * Completes the pending request of a client and moves its scenario on.
+ * @param c Client that received the reply
+ * @param msg Reply message
+ * @param now Receipt time
+ */
+static void on_reply(Client* c, cJSON* msg, double now) {
+  Group* g = c->group;
+  Metric metric = (Metric)c->pending;
+  cJSON* statut = cJSON_GetObjectItem(msg, "statut");
+  if (cJSON_IsString(statut) && statut->valuestring[0] != '2') {
+    char reason[192];
+    cJSON* message = cJSON_GetObjectItem(msg, "message");
+    snprintf(reason, sizeof(reason), "%s returned %s (%s)",
+             metric_info[metric].name, statut->valuestring,
+             cJSON_IsString(message) ? message->valuestring : "no message");
+    fail_group(g, reason, c);
+    return;
+  }
+
+  record(metric, now - c->sent_at);
+  c->pending = -1;
+
+  switch (metric) {
+    case M_REGISTER:
+      send_login(c, M_LOGIN);
+      break;
+    case M_LOGIN:
+      c->logged_in = true;
+      if (c->leader)
+        send_request(c, M_THEMES, NULL);
+      else if (g->session_id > 0)
+        send_join(c);
+      break;
+    case M_THEMES:
+      on_themes(c, msg);
+      break;
+    case M_CREATE: {
+      cJSON* id = cJSON_GetObjectItem(msg, "sessionId");
+      if (!cJSON_IsNumber(id)) {
+        fail_group(g, "session/create reply without sessionId", NULL);
+        return;
+      }
+      g->session_id = id->valueint;
+      g->joined = 1;
+      c->in_session = true;
+      join_waiting_members(g);
+      break;
+    }
+    case M_JOIN:
+      c->in_session = true;
+      if (++g->joined == g->size) send_request(g->members[0], M_START, "{}");
+      break;
+    default:
+      break;
+  }
+}
+
+static void on_question(Client* c, cJSON* msg, double now) {
+  Group* g = c->group;
+  cJSON* num = cJSON_GetObjectItem(msg, "questionNum");
+  cJSON* type = cJSON_GetObjectItem(msg, "type");
+  int question_num = cJSON_IsNumber(num) ? num->valueint : 0;
+
+  if (question_num != g->question_num) {
+    g->question_num = question_num;
+    g->receipts = 0;
+    g->first_receipt = now;
+  }
+  if (++g->receipts == g->size) record(M_FANOUT, now - g->first_receipt);
+
+  snprintf(c->question_type, sizeof(c->question_type), "%s",
+           cJSON_IsString(type) ? type->valuestring : "qcm");
+  int think = opts.think_ms > 0 ? rand() % (2 * opts.think_ms + 1) : 0;
+  c->answer_at = now + think;
+}
+
+/**
+ * Ends the current game of a group once every member got session/finished
+ * and no request is still in flight (the last answer is acknowledged after
+ * the final ranking), then starts the next game or closes the group.
+ * @param g Session group
+ */
+static void check_game_over(Group* g) {
+  if (!g->active || g->finished < g->size) return;
+  for (int i = 0; i < g->size; i++)
+    if (g->members[i]->pending >= 0) return;
+
+  games_completed++;
+  if (++g->games_done < opts.games)
+    start_game(g);
+  else
+    close_group(g, false);
+}
+
+static void on_finished(Client* c) {
+  c->in_session = false;
+  c->answer_at = 0;
+  c->group->finished++;
+}
+
+static void handle_line(Client* c, const char* line, double now) {
+  messages_received++;
+  cJSON* msg = cJSON_Parse(line);
+  if (!msg) {
+    fail_group(c->group, "unparseable message", c);
+    return;
+  }
+
+  cJSON* action = cJSON_GetObjectItem(msg, "action");
+  const char* name = cJSON_IsString(action) ? action->valuestring : "";
+
+  if (c->pending >= 0 &&
+      (strcmp(name, metric_info[c->pending].reply) == 0 ||
+       strcmp(name, metric_info[c->pending].name) == 0 || name[0] == '\0')) {
+    on_reply(c, msg, now);
+  } else if (strcmp(name, "question/new") == 0) {
+    on_question(c, msg, now);
+  } else if (strcmp(name, "session/finished") == 0) {
+    on_finished(c);
+  }
+  cJSON_Delete(msg);
+  check_game_over(c->group);
+}
+
+static void read_input(Client* c) {
+  int n = recv(c->sock, c->in + c->in_len,
+               (int)(INPUT_BUFFER_SIZE - 1 - c->in_len), 0);
+  if (n <= 0) {
+#ifndef _WIN32
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+#endif
+    fail_group(c->group, "connection closed by server", c);
+    return;
+  }
+
+  double now = now_ms();
+  c->in_len += (size_t)n;
+  char* start = c->in;
+  char* end;
+  while (c->live && (end = memchr(start, '\n', c->in_len - (size_t)(start - c->in)))) {
+    *end = '\0';
+    if (end > start) handle_line(c, start, now);
+    start = end + 1;
+  }
+  if (!c->live) return;
+
+  c->in_len -= (size_t)(start - c->in);
+  memmove(c->in, start, c->in_len);
+  if (c->in_len == INPUT_BUFFER_SIZE - 1)
+    fail_group(c->group, "message larger than input buffer", c);
+}
+
+static socket_t connect_client(void) {
+  socket_t sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (sock == INVALID_SOCKET) return INVALID_SOCKET;
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((unsigned short)opts.port);
+  if (inet_pton(AF_INET, opts.host, &addr.sin_addr) != 1 ||
+      connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    close_socket(sock);
+    return INVALID_SOCKET;
+  }
+
+  int one = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char*)&one, sizeof(one));
+#ifdef _WIN32
+  u_long nonblocking = 1;
+  ioctlsocket(sock, FIONBIO, &nonblocking);
+#else
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+  return sock;
+}
+
+typedef struct {
+  bool valid;
+  double requests;
+  double json_heap_allocs;
+  double json_arena_allocs;
+} ServerStats;
+
+/**
+ * Reads the server counters over a short-lived connection (GET server/stats).
+ * @param stats Filled in, valid stays false if the server does not answer
+ */
+static void fetch_server_stats(ServerStats* stats) {
+  memset(stats, 0, sizeof(*stats));
+  socket_t sock = connect_client();
+  if (sock == INVALID_SOCKET) return;
+
+  const char* request = "GET server/stats\n";
+  char line[4096];
+  size_t len = 0;
+  double deadline = now_ms() + 2000;
+  send(sock, request, (int)strlen(request), 0);
+  while (len < sizeof(line) - 1 && !memchr(line, '\n', len) && now_ms() < deadline) {
+    struct pollfd pfd = {sock, POLLIN, 0};
+    if (poll(&pfd, 1, 100) <= 0) continue;
+    int n = recv(sock, line + len, (int)(sizeof(line) - 1 - len), 0);
+    if (n <= 0) break;
+    len += (size_t)n;
+  }
+  close_socket(sock);
+  line[len] = '\0';
+
+  cJSON* msg = cJSON_Parse(line);
+  cJSON* requests = cJSON_GetObjectItem(msg, "requests");
+  if (cJSON_IsNumber(requests)) {
+    stats->valid = true;
+    stats->requests = requests->valuedouble;
+    cJSON* heap = cJSON_GetObjectItem(msg, "jsonHeapAllocs");
+    cJSON* arena = cJSON_GetObjectItem(msg, "jsonArenaAllocs");
+    stats->json_heap_allocs = cJSON_IsNumber(heap) ? heap->valuedouble : 0;
+    stats->json_arena_allocs = cJSON_IsNumber(arena) ? arena->valuedouble : 0;
+  }
+  cJSON_Delete(msg);
+}
+
+static void print_server_stats(const ServerStats* before, const ServerStats* after) {
+  if (!before->valid || !after->valid) return;
+  double requests = after->requests - before->requests;
+  if (requests <= 0) return;
+  // Broadcasts built on the timer thread are included in the per-request costs
+  printf("server: %.0f requests, per request %.2f cJSON heap allocations, "
+         "%.2f arena allocations\n",
+         requests, (after->json_heap_allocs - before->json_heap_allocs) / requests,
+         (after->json_arena_allocs - before->json_arena_allocs) / requests);
+}
+
+static int compare_double(const void* a, const void* b) {
+  double x = *(const double*)a, y = *(const double*)b;
+  return x < y ? -1 : x > y;
+}
+
+static double percentile(const Samples* s, double p) {
+  if (s->count == 0) return 0.0;
+  size_t rank = (size_t)(p * (double)s->count + 0.999999);
+  if (rank < 1) rank = 1;
+  if (rank > s->count) rank = s->count;
+  return s->samples[rank - 1];
+}
+
+/**
+ * Prints the per-endpoint report and applies the p99 gate.
+ * @param elapsed_ms Wall time of the run
+ * @return Number of endpoints over the gate
+ */
+static int print_report(double elapsed_ms) {
+  double seconds = elapsed_ms / 1000.0;
+  long requests = 0;
+  int over_gate = 0;
+
+  printf("\n%-22s %8s %7s %9s %9s %9s %9s %9s\n", "endpoint", "count",
+         "errors", "req/s", "p50 ms", "p99 ms", "p999 ms", "max ms");
+  for (int m = 0; m < M_COUNT; m++) {
+    Samples* s = &metrics[m];
+    qsort(s->samples, s->count, sizeof(double), compare_double);
+    double p99 = percentile(s, 0.99);
+    bool over = opts.max_p99_ms > 0 && p99 > opts.max_p99_ms;
+    over_gate += over;
+    if (metric_info[m].method) requests += (long)s->count;
+
+    printf("%-22s %8lu %7ld %9.1f %9.3f %9.3f %9.3f %9.3f%s\n",
+           metric_info[m].name, (unsigned long)s->count, s->errors,
+           s->count / seconds, percentile(s, 0.50), p99,
+           percentile(s, 0.999), s->count ? s->samples[s->count - 1] : 0.0,
+           over ? "  > gate" : "");
+  }
+
+  printf("\n%d clients in groups of %d, %ld game(s) completed, %ld group(s) "
+         "failed in %.1f s\n",
+         opts.clients, opts.players, games_completed, failed_groups, seconds);
+  printf("throughput: %.1f requests/s, %.1f messages received/s\n",
+         requests / seconds, messages_received / seconds);
+  return over_gate;
+}
+
+static void print_usage(const char* program) {
+  printf("Usage: %s [options]\n", program);
+  printf("Options:\n");
+  printf("  --host <addr>        Server address (default: %s)\n", opts.host);
+  printf("  --port <port>        Server TCP port (default: %d)\n", opts.port);
+  printf("  --clients <n>        Simulated players (default: %d)\n", opts.clients);
+  printf("  --players <n>        Players per session, 2-%d, must divide --clients "
+         "(default: %d)\n", MAX_GROUP_PLAYERS, opts.players);
+  printf("  --games <n>          Games played by each session group (default: %d)\n",
+         opts.games);
+  printf("  --questions <n>      Questions per game, 10-50 (default: %d)\n", opts.questions);
+  printf("  --think <ms>         Mean think time before answering, uniform "
+         "0..2x (default: %d)\n", opts.think_ms);
+  printf("  --time-limit <s>     Question time limit, 10-60 "
+         "(default: %d)\n", opts.time_limit);
+  printf("  --difficulty <d>     facile, moyen or difficile (default: %s)\n",
+         opts.difficulty);
+  printf("  --timeout <ms>       Fail a group when a reply takes longer "
+         "(default: %d)\n", opts.timeout_ms);
+  printf("  --max-p99 <ms>       Exit non-zero if any endpoint p99 exceeds this\n");
+  printf("  --seed <n>           Think time random seed (default: time based)\n");
+  printf("  -h, --help           Show this help\n");
+}
+
+static int parse_options(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+      print_usage(argv[0]);
+      exit(0);
+    }
+    if (!value) {
+      fprintf(stderr, "Missing value for %s\n", arg);
+      return -1;
+    }
+    i++;
+    if (strcmp(arg, "--host") == 0) opts.host = value;
+    else if (strcmp(arg, "--port") == 0) opts.port = atoi(value);
+    else if (strcmp(arg, "--clients") == 0) opts.clients = atoi(value);
+    else if (strcmp(arg, "--players") == 0) opts.players = atoi(value);
+    else if (strcmp(arg, "--games") == 0) opts.games = atoi(value);
+    else if (strcmp(arg, "--questions") == 0) opts.questions = atoi(value);
+    else if (strcmp(arg, "--think") == 0) opts.think_ms = atoi(value);
+    else if (strcmp(arg, "--time-limit") == 0) opts.time_limit = atoi(value);
+    else if (strcmp(arg, "--difficulty") == 0) opts.difficulty = value;
+    else if (strcmp(arg, "--timeout") == 0) opts.timeout_ms = atoi(value);
+    else if (strcmp(arg, "--max-p99") == 0) opts.max_p99_ms = atof(value);
+    else if (strcmp(arg, "--seed") == 0) opts.seed = (unsigned)strtoul(value, NULL, 10);
+    else {
+      fprintf(stderr, "Unknown option %s\n", arg);
+      return -1;
+    }
+  }
+
+  if (opts.players < 2 || opts.players > MAX_GROUP_PLAYERS || opts.clients < 1 ||
+      opts.clients % opts.players != 0 || opts.games < 1 || opts.questions < 1 ||
+      opts.think_ms < 0 || opts.timeout_ms < 1) {
+    fprintf(stderr, "Invalid options: --clients must be a multiple of --players "
+                    "(2-%d), counts must be positive\n", MAX_GROUP_PLAYERS);
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (parse_options(argc, argv) < 0) {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+#ifdef _WIN32
+  WSADATA wsa_data;
+  if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+    fprintf(stderr, "WSAStartup failed\n");
+    return 1;
+  }
+#endif
+
+  unsigned run_id = (unsigned)time(NULL) ^ ((unsigned)get_pid() << 16);
+  srand(opts.seed ? opts.seed : run_id);
+
+  int num_groups = opts.clients / opts.players;
+  Client* clients = calloc((size_t)opts.clients, sizeof(Client));
+  Group* groups = calloc((size_t)num_groups, sizeof(Group));
+  struct pollfd* fds = calloc((size_t)opts.clients, sizeof(struct pollfd));
+  Client** polled = calloc((size_t)opts.clients, sizeof(Client*));
+  if (!clients || !groups || !fds || !polled) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  printf("loadgen: %d clients, %d per session, %d game(s) of %d question(s) "
+         "against %s:%d\n",
+         opts.clients, opts.players, opts.games, opts.questions, opts.host,
+         opts.port);
+
+  ServerStats stats_before, stats_after;
+  fetch_server_stats(&stats_before);
+
+  double started = now_ms();
+  for (int i = 0; i < opts.clients; i++) {
+    Client* c = &clients[i];
+    Group* g = &groups[i / opts.players];
+    c->group = g;
+    c->leader = g->size == 0;
+    c->pending = -1;
+    g->members[g->size++] = c;
+    g->active = true;
+    snprintf(c->pseudo, sizeof(c->pseudo), "lg%06x_%d", run_id & 0xffffff, i);
+
+    c->in = malloc(INPUT_BUFFER_SIZE);
+    double connect_start = now_ms();
+    c->sock = connect_client();
+    record(M_CONNECT, now_ms() - connect_start);
+    if (!c->in || c->sock == INVALID_SOCKET) {
+      fprintf(stderr, "loadgen: cannot connect to %s:%d\n", opts.host, opts.port);
+      return 1;
+    }
+    c->live = true;
+  }
+  for (int i = 0; i < opts.clients; i++) send_login(&clients[i], M_REGISTER);
+
+  int active = num_groups;
+  while (active > 0) {
+    double now = now_ms();
+    int wait_ms = 100;
+    int nfds = 0;
+
+    for (int i = 0; i < opts.clients; i++) {
+      Client* c = &clients[i];
+      if (!c->live) continue;
+      if (c->pending >= 0 && now - c->sent_at > opts.timeout_ms) {
+        fail_group(c->group, "reply timed out", c);
+        continue;
+      }
+      if (c->answer_at > 0 && c->pending < 0) {
+        if (c->answer_at <= now) send_answer(c);
+        else if (c->answer_at - now < wait_ms) wait_ms = (int)(c->answer_at - now) + 1;
+      }
+      fds[nfds].fd = c->sock;
+      fds[nfds].events = (short)(POLLIN | (c->out_len ? POLLOUT : 0));
+      fds[nfds].revents = 0;
+      polled[nfds++] = c;
+    }
+
+    if (nfds > 0 && poll(fds, (unsigned long)nfds, wait_ms) > 0) {
+      for (int i = 0; i < nfds; i++) {
+        Client* c = polled[i];
+        if (!c->live || fds[i].revents == 0) continue;
+        if (fds[i].revents & POLLOUT) flush_output(c);
+        if (fds[i].revents & (POLLIN | POLLERR | POLLHUP)) read_input(c);
+      }
+    }
+
+    active = 0;
+    for (int i = 0; i < num_groups; i++) active += groups[i].active;
+  }
+
+  int over_gate = print_report(now_ms() - started);
+  fetch_server_stats(&stats_after);
+  print_server_stats(&stats_before, &stats_after);
+
+  for (int i = 0; i < opts.clients; i++) {
+    free(clients[i].in);
+    free(clients[i].out);
+  }
+  for (int m = 0; m < M_COUNT; m++) free(metrics[m].samples);
+  free(polled);
+  free(fds);
+  free(groups);
+  free(clients);
+#ifdef _WIN32
+  WSACleanup();
+#endif
+
+  if (failed_groups > 0 || over_gate > 0) return 1;
+  return 0;
+}
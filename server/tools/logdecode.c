@@ -0,0 +1,129 @@
+/**
+ * @file logdecode.c
+ * @brief Offline formatter for binary server logs
+ *
+ * Reads a log written with --log-format binary and prints it as the text
+ * log would have looked.
+ *
+ *   logdecode <server.qlog> [min-level]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+typedef struct {
+  char* tag;
+  char* format;
+} FormatDef;
+
+static FormatDef* defs;
+static uint32_t num_defs;
+
+static char* read_string(FILE* file) {
+  uint16_t len;
+  if (fread(&len, sizeof(len), 1, file) != 1) return NULL;
+  char* str = malloc((size_t)len + 1);
+  if (!str) return NULL;
+  if (len > 0 && fread(str, 1, len, file) != len) {
+    free(str);
+    return NULL;
+  }
+  str[len] = '\0';
+  return str;
+}
+
+static int read_format(FILE* file) {
+  uint32_t id;
+  if (fread(&id, sizeof(id), 1, file) != 1) return -1;
+  char* tag = read_string(file);
+  char* format = tag ? read_string(file) : NULL;
+  if (!format || id > 1000000) {
+    free(tag);
+    free(format);
+    return -1;
+  }
+
+  if (id >= num_defs) {
+    FormatDef* grown = realloc(defs, (id + 1) * sizeof(FormatDef));
+    if (!grown) return -1;
+    memset(grown + num_defs, 0, (id + 1 - num_defs) * sizeof(FormatDef));
+    defs = grown;
+    num_defs = id + 1;
+  }
+  free(defs[id].tag);
+  free(defs[id].format);
+  defs[id].tag = tag;
+  defs[id].format = format;
+  return 0;
+}
+
+static int read_event(FILE* file, int min_level) {
+  uint32_t id;
+  uint8_t level, truncated;
+  uint64_t time_ns;
+  uint16_t args_len;
+  unsigned char args[65536];
+
+  if (fread(&id, sizeof(id), 1, file) != 1 || fread(&level, 1, 1, file) != 1 ||
+      fread(&truncated, 1, 1, file) != 1 ||
+      fread(&time_ns, sizeof(time_ns), 1, file) != 1 ||
+      fread(&args_len, sizeof(args_len), 1, file) != 1 ||
+      (args_len > 0 && fread(args, 1, args_len, file) != args_len)) {
+    return -1;
+  }
+  if (id >= num_defs || !defs[id].format) return -1;
+  if (level < min_level) return 0;
+
+  char line[4096];
+  log_format_line(line, sizeof(line), time_ns, defs[id].tag, defs[id].format,
+                  args, args_len, truncated != 0);
+  puts(line);
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argc > 3) {
+    printf("Usage: %s <binary log> [debug|info|warn|error]\n", argv[0]);
+    return 2;
+  }
+
+  int min_level = argc == 3 ? log_parse_level(argv[2]) : LOG_LEVEL_DEBUG;
+  if (min_level < 0) {
+    fprintf(stderr, "Unknown level '%s'\n", argv[2]);
+    return 2;
+  }
+
+  FILE* file = fopen(argv[1], "rb");
+  if (!file) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  char magic[sizeof(LOG_BINARY_MAGIC) - 1];
+  if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+      memcmp(magic, LOG_BINARY_MAGIC, sizeof(magic)) != 0) {
+    fprintf(stderr, "%s: not a binary QuizNet log\n", argv[1]);
+    fclose(file);
+    return 1;
+  }
+
+  int type;
+  int rc = 0;
+  while ((type = fgetc(file)) != EOF) {
+    int ok = type == LOG_RECORD_FORMAT  ? read_format(file)
+             : type == LOG_RECORD_EVENT ? read_event(file, min_level)
+                                        : -1;
+    if (ok < 0) {
+      fprintf(stderr, "%s: corrupt or truncated record at offset %ld\n",
+              argv[1], ftell(file));
+      rc = 1;
+      break;
+    }
+  }
+
+  fclose(file);
+  return rc;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file qbankc.c
+ * @brief Offline question bank compiler
+ *
+ * Turns a text question file (data/questions.dat format) into the binary
+ * bank mapped by the server, or checks an existing bank.
+ *
+ *   qbankc <input.dat> <output.qbank>
+ *   qbankc -v <bank.qbank>
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "qbank.h"
+
+static void print_usage(const char* program) {
+  printf("Usage: %s <input.dat> <output.qbank>\n", program);
+  printf("       %s -v <bank.qbank>   Verify a compiled bank\n", program);
+}
+
+static int verify_bank(const char* path) {
+  QBank bank;
+  if (qbank_open(&bank, path) < 0) {
+    fprintf(stderr, "%s: cannot open or invalid bank\n", path);
+    return 1;
+  }
+
+  int rc = qbank_verify(&bank);
+  printf("%s: version %u, %u questions, %u themes, %lu bytes, checksum %08x %s\n",
+         path, bank.header->version, bank.header->num_questions,
+         bank.header->num_themes, (unsigned long)bank.size,
+         bank.header->checksum, rc == 0 ? "OK" : "MISMATCH");
+  qbank_close(&bank);
+  return rc == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc == 3 && strcmp(argv[1], "-v") == 0) return verify_bank(argv[2]);
+
+  if (argc != 3) {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  if (qbank_compile(argv[1], argv[2]) < 0) return 1;
+  return verify_bank(argv[2]);
+}